@@ -0,0 +1,144 @@
+#ifndef MODBUS_METRICS_H
+#define MODBUS_METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Function codes with their own statistics, unsupported ones share the last slot
+#define MODBUS_METRICS_NUMBER_OF_FUNCTIONS 10
+// Number of buckets of each service time histogram
+#define MODBUS_METRICS_NUMBER_OF_BUCKETS   12
+
+/**
+ * @brief Statistics of one Modbus function code
+ *
+ * The service time is measured from the reception of the request's MBAP
+ * header until the last byte of the response was accepted by send().
+ */
+typedef struct {
+    uint8_t function_code;      // Function code, 0 for the slot of unsupported codes
+    uint32_t requests;          // Requests received
+    uint32_t exceptions;        // Exception responses sent
+    uint32_t responses;         // Responses sent, samples of the histogram
+    uint32_t min_us;            // Shortest service time in microseconds
+    uint32_t max_us;            // Longest service time in microseconds
+    uint64_t total_us;          // Sum of all service times in microseconds
+    uint32_t buckets[MODBUS_METRICS_NUMBER_OF_BUCKETS];
+} modbus_function_metrics_t;
+
+/**
+ * @brief Statistics of the ModbusTCP server
+ *
+ * Updated by the server task inside a short critical section, other tasks
+ * read a consistent copy with modbus_metrics_get().
+ */
+typedef struct {
+    modbus_function_metrics_t functions[MODBUS_METRICS_NUMBER_OF_FUNCTIONS];
+    uint64_t bytes_in;              // Request bytes received
+    uint64_t bytes_out;             // Response bytes accepted by send()
+    uint32_t protocol_errors;       // Connections closed for an invalid MBAP header
+    uint32_t connections_accepted;
+    uint32_t connections_evicted;   // Closed to make room for a new client
+    uint32_t connections_rejected;  // Refused while all connections were in use
+    uint32_t connections_timed_out; // Closed after the idle timeout
+    uint32_t connections_closed;    // Closed by the client or after an error
+    uint32_t connections_current;
+    uint32_t connections_peak;
+} modbus_metrics_t;
+
+/** @brief Upper limits of all but the last bucket in microseconds */
+extern const uint32_t modbus_metrics_bucket_limits_us[MODBUS_METRICS_NUMBER_OF_BUCKETS - 1];
+
+/**
+ * @brief Get the slot of a function code in modbus_metrics_t.functions
+ *
+ * @param function_code Modbus function code, without the exception flag
+ * @return Index of the function code, or of the slot of unsupported codes
+ */
+uint8_t modbus_metrics_function_index(uint8_t function_code);
+
+/**
+ * @brief Count a received request
+ *
+ * @param function_index Slot of the request's function code
+ * @param length Length of the ADU in bytes
+ */
+void modbus_metrics_request(uint8_t function_index, size_t length);
+
+/**
+ * @brief Count an exception response
+ *
+ * @param function_index Slot of the request's function code
+ */
+void modbus_metrics_exception(uint8_t function_index);
+
+/**
+ * @brief Account for a response completely accepted by send()
+ *
+ * @param function_index Slot of the request's function code
+ * @param service_time_us Time since the request's MBAP header was received
+ */
+void modbus_metrics_response_sent(uint8_t function_index, uint32_t service_time_us);
+
+/** @brief Add bytes accepted by send() */
+void modbus_metrics_bytes_out(size_t length);
+
+/** @brief Count a connection closed for an invalid MBAP header */
+void modbus_metrics_protocol_error(void);
+
+/** @brief Count an accepted connection */
+void modbus_metrics_connection_accepted(void);
+
+/** @brief Count a connection refused because all connections were in use */
+void modbus_metrics_connection_rejected(void);
+
+// Reasons for closing a connection
+typedef enum {
+    MODBUS_METRICS_CLOSE_CLIENT = 0,    // Closed by the client or after an error
+    MODBUS_METRICS_CLOSE_EVICTED,       // Replaced by a new client
+    MODBUS_METRICS_CLOSE_IDLE,          // Idle timeout
+    MODBUS_METRICS_CLOSE_STOP           // Server stopped
+} modbus_metrics_close_reason_t;
+
+/** @brief Count a closed connection */
+void modbus_metrics_connection_closed(modbus_metrics_close_reason_t reason);
+
+/**
+ * @brief Get a consistent copy of the statistics
+ *
+ * @param metrics Destination of the copy
+ */
+void modbus_metrics_get(modbus_metrics_t *metrics);
+
+/** @brief Clear all counters and histograms except the current connection count */
+void modbus_metrics_reset(void);
+
+/**
+ * @brief Write the statistics as binary snapshot for tools/modbus_metrics.py
+ *
+ * All values are little-endian. Layout:
+ * - "MBM1" magic, uint8 version (2), uint8 number of functions,
+ *   uint8 number of buckets, uint8 reserved
+ * - uint32 bucket limits in microseconds (number of buckets - 1)
+ * - uint64 bytes in, uint64 bytes out
+ * - uint32 protocol errors, connections accepted, evicted, rejected,
+ *   timed out, closed, current and peak
+ * - per function: uint8 function code, uint8[3] reserved, uint32 requests,
+ *   exceptions, responses, min_us, max_us, uint64 total_us, uint32 buckets
+ *
+ * @param buffer Destination buffer
+ * @param size Size of the buffer
+ * @return Length of the snapshot, 0 if the buffer is too small
+ */
+size_t modbus_metrics_snapshot(uint8_t *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MODBUS_METRICS_H
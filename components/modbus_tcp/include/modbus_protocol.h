@@ -2,22 +2,101 @@
 #define MODBUS_PROTOCOL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// MBAP header: transaction id, protocol id, length
+#define MODBUS_TCP_MBAP_HEADER_SIZE 6
+// Largest ADU: MBAP header + unit id + 253 byte PDU
+#define MODBUS_TCP_MAX_ADU_SIZE     260
+// Receive buffer per connection, holds several pipelined requests
+#define MODBUS_TCP_RX_BUFFER_SIZE   (2 * MODBUS_TCP_MAX_ADU_SIZE)
+// Transmit queue per connection, responses of one wakeup are sent together
+#define MODBUS_TCP_TX_BUFFER_SIZE   (4 * MODBUS_TCP_MAX_ADU_SIZE)
+// Responses in the transmit queue whose service time is still to be measured
+#define MODBUS_TCP_MAX_PENDING_RESPONSES 16
+
+// A queued response, accounted for once the socket accepted its last byte
+typedef struct {
+    uint32_t end;               // Value of tx_queued after the response was queued
+    uint32_t start_us;          // Time the MBAP header of its request was received
+    uint8_t function_index;     // Slot of the function code in the metrics
+} modbus_tcp_pending_response_t;
+
+/**
+ * @brief Per client state of the ModbusTCP framing
+ *
+ * Received bytes are buffered until a complete ADU is available, so a
+ * request split across TCP segments is reassembled and several requests
+ * in one segment are all served in the same pass. Their responses are
+ * queued and submitted with a single send(). While the socket cannot take
+ * the queued responses no further requests are read, so a client that does
+ * not read its responses is held back by TCP flow control.
+ */
+typedef struct {
+    int socket;
+    uint8_t rx_buffer[MODBUS_TCP_RX_BUFFER_SIZE];
+    size_t rx_length;       // Bytes buffered in rx_buffer
+    size_t frame_length;    // Length of the ADU being received, 0 until its MBAP header is complete
+    uint8_t tx_buffer[MODBUS_TCP_TX_BUFFER_SIZE];
+    size_t tx_length;       // Bytes of queued responses not yet accepted by the socket
+    uint32_t tx_queued;     // Bytes queued since the connection was opened, wraps around
+    uint32_t tx_sent;       // Bytes accepted by the socket since the connection was opened, wraps around
+    uint32_t rx_time_us;    // Time of the last recv()
+    uint32_t header_time_us;        // Time the MBAP header of the current ADU was received
+    uint8_t request_function_index; // Metrics slot of the request being handled
+    modbus_tcp_pending_response_t pending[MODBUS_TCP_MAX_PENDING_RESPONSES];
+    uint8_t pending_first;
+    uint8_t pending_count;
+} modbus_tcp_connection_t;
+
 /**
- * @brief Handle ModbusTCP request from client
- * 
+ * @brief Initialize the framing state of a new client connection
+ *
+ * @param connection Connection state to initialize
  * @param client_socket Client socket file descriptor
+ */
+void modbus_tcp_connection_init(modbus_tcp_connection_t *connection, int client_socket);
+
+/**
+ * @brief Receive pending data from a client and handle every complete request
+ *
+ * Call when the client socket is readable and no responses are pending.
+ * Requests are answered in the order they were received, incomplete
+ * requests stay buffered for the next call.
+ *
+ * @param connection Client connection state
  * @return true if connection should remain open, false to close
  */
-bool modbus_tcp_handle_request(int client_socket);
+bool modbus_tcp_connection_receive(modbus_tcp_connection_t *connection);
+
+/**
+ * @brief Send pending responses and continue with the buffered requests
+ *
+ * Call when the client socket is writable while responses are pending.
+ *
+ * @param connection Client connection state
+ * @return true if connection should remain open, false to close
+ */
+bool modbus_tcp_connection_send(modbus_tcp_connection_t *connection);
+
+/**
+ * @brief Check if responses are waiting for the socket to become writable
+ *
+ * @param connection Client connection state
+ * @return true to wait for writability, false to wait for new requests
+ */
+static inline bool modbus_tcp_connection_tx_pending(const modbus_tcp_connection_t *connection)
+{
+    return connection->tx_length > 0;
+}
 
 #ifdef __cplusplus
 }
 #endif
 
 #endif // MODBUS_PROTOCOL_H
-
@@ -2,16 +2,110 @@
 #define MODBUS_REGISTER_MAP_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Modbus data tables
+typedef enum {
+    MODBUS_TABLE_COILS = 0,             // Read-write bits (FC 1, 5, 15)
+    MODBUS_TABLE_DISCRETE_INPUTS,       // Read-only bits (FC 2)
+    MODBUS_TABLE_INPUT_REGISTERS,       // Read-only registers (FC 4)
+    MODBUS_TABLE_HOLDING_REGISTERS,     // Read-write registers (FC 3, 6, 16, 23)
+    MODBUS_TABLE_COUNT
+} modbus_table_t;
+
+/**
+ * @brief A block of consecutive Modbus addresses mapped onto an assembly
+ *
+ * Registers map to consecutive 16-bit words of the assembly starting at byte
+ * assembly_offset. The words are little-endian in the assembly and big-endian
+ * on the wire. Coils and discrete inputs map to consecutive bits starting at
+ * bit assembly_offset, bit 0 being the least significant bit of byte 0.
+ */
+typedef struct {
+    modbus_table_t table;
+    uint16_t start_address;     // First Modbus address of the block
+    uint16_t count;             // Number of registers or bits
+    uint16_t assembly;          // Assembly instance number
+    uint16_t assembly_offset;   // Byte offset for registers, bit offset for coils and discrete inputs
+} modbus_register_range_t;
+
+// Maximum number of ranges in a register map
+#define MODBUS_REGISTER_MAP_MAX_RANGES 32
+
+/**
+ * @brief Load a register map
+ *
+ * The ranges are validated against the assemblies and compiled into a sorted
+ * index, requests spanning adjacent ranges are split along them. Call before
+ * modbus_tcp_start(), the active map is not replaced while the server runs.
+ *
+ * @param ranges Ranges of the map, in any order
+ * @param count Number of ranges (up to MODBUS_REGISTER_MAP_MAX_RANGES)
+ * @return true on success, false if a range overlaps another one or does not
+ *         fit its assembly; the previous map stays active then
+ */
+bool modbus_register_map_load(const modbus_register_range_t *ranges, size_t count);
+
+/**
+ * @brief Load the default register map unless one was loaded already
+ *
+ * Default map:
+ * - Input Registers 0-15 and Discrete Inputs 0-255: Input Assembly 100
+ * - Holding Registers 100-115 and Coils 0-255: Output Assembly 150
+ * - Holding Registers 150-154: Config Assembly 151
+ *
+ * @return true if a register map is active
+ */
+bool modbus_register_map_init(void);
+
+/**
+ * @brief Read coils
+ *
+ * @param start_addr Starting coil address
+ * @param quantity Number of coils to read (1-2000)
+ * @param data Buffer to store coil states (packed LSB first, unused high bits zero)
+ * @return true on success, false on invalid address/quantity
+ */
+bool modbus_read_coils(uint16_t start_addr, uint16_t quantity, uint8_t *data);
+
 /**
- * @brief Read input registers (read-only, maps to Input Assembly 100)
- * 
- * @param start_addr Starting register address (0-15)
+ * @brief Read discrete inputs
+ *
+ * @param start_addr Starting input address
+ * @param quantity Number of inputs to read (1-2000)
+ * @param data Buffer to store input states (packed LSB first, unused high bits zero)
+ * @return true on success, false on invalid address/quantity
+ */
+bool modbus_read_discrete_inputs(uint16_t start_addr, uint16_t quantity, uint8_t *data);
+
+/**
+ * @brief Write single coil
+ *
+ * @param address Coil address
+ * @param value New coil state
+ * @return true on success, false on invalid address
+ */
+bool modbus_write_coil(uint16_t address, bool value);
+
+/**
+ * @brief Write multiple coils
+ *
+ * @param start_addr Starting coil address
+ * @param quantity Number of coils to write (1-1968)
+ * @param data Coil states (packed LSB first)
+ * @return true on success, false on invalid address/quantity
+ */
+bool modbus_write_coils(uint16_t start_addr, uint16_t quantity, const uint8_t *data);
+
+/**
+ * @brief Read input registers (read-only)
+ *
+ * @param start_addr Starting register address
  * @param quantity Number of registers to read (1-125)
  * @param data Buffer to store register values (big-endian, 2 bytes per register)
  * @return true on success, false on invalid address/quantity
@@ -19,8 +113,8 @@ extern "C" {
 bool modbus_read_input_registers(uint16_t start_addr, uint16_t quantity, uint8_t *data);
 
 /**
- * @brief Read holding registers (read-write, maps to Output Assembly 150 and Config Assembly 151)
- * 
+ * @brief Read holding registers (read-write)
+ *
  * @param start_addr Starting register address
  * @param quantity Number of registers to read (1-125)
  * @param data Buffer to store register values (big-endian, 2 bytes per register)
@@ -30,18 +124,18 @@ bool modbus_read_holding_registers(uint16_t start_addr, uint16_t quantity, uint8
 
 /**
  * @brief Write single holding register
- * 
+ *
  * @param address Register address
- * @param value Register value (big-endian)
+ * @param value Register value
  * @return true on success, false on invalid address
  */
 bool modbus_write_holding_register(uint16_t address, uint16_t value);
 
 /**
  * @brief Write multiple holding registers
- * 
+ *
  * @param start_addr Starting register address
- * @param quantity Number of registers to write
+ * @param quantity Number of registers to write (1-123)
  * @param data Register values (big-endian, 2 bytes per register)
  * @return true on success, false on invalid address/quantity
  */
@@ -52,4 +146,3 @@ bool modbus_write_holding_registers(uint16_t start_addr, uint16_t quantity, cons
 #endif
 
 #endif // MODBUS_REGISTER_MAP_H
-
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2025, Adam G. Sweeney <agsweeney@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "modbus_metrics.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+const uint32_t modbus_metrics_bucket_limits_us[MODBUS_METRICS_NUMBER_OF_BUCKETS - 1] = {
+    100, 250, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 250000
+};
+
+// Function codes with their own slot, the last slot counts unsupported ones
+static const uint8_t s_function_codes[MODBUS_METRICS_NUMBER_OF_FUNCTIONS] = {
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x0F, 0x10, 0x17, 0x00
+};
+#define FUNCTION_SLOT(index) [index] = { .function_code = s_function_codes[index] }
+
+static modbus_metrics_t s_metrics = {
+    .functions = {
+        FUNCTION_SLOT(0), FUNCTION_SLOT(1), FUNCTION_SLOT(2), FUNCTION_SLOT(3),
+        FUNCTION_SLOT(4), FUNCTION_SLOT(5), FUNCTION_SLOT(6), FUNCTION_SLOT(7),
+        FUNCTION_SLOT(8), FUNCTION_SLOT(9),
+    },
+};
+
+// Updated by the server task, read and reset by the web server. The 64-bit
+// counters are not written atomically, so every access is done under this lock.
+static portMUX_TYPE s_metrics_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#define SNAPSHOT_MAGIC   "MBM1"
+#define SNAPSHOT_VERSION 2
+
+uint8_t modbus_metrics_function_index(uint8_t function_code)
+{
+    for (uint8_t i = 0; i < MODBUS_METRICS_NUMBER_OF_FUNCTIONS - 1; i++) {
+        if (s_function_codes[i] == function_code) {
+            return i;
+        }
+    }
+    return MODBUS_METRICS_NUMBER_OF_FUNCTIONS - 1;
+}
+
+void modbus_metrics_request(uint8_t function_index, size_t length)
+{
+    portENTER_CRITICAL(&s_metrics_lock);
+    s_metrics.functions[function_index].requests++;
+    s_metrics.bytes_in += length;
+    portEXIT_CRITICAL(&s_metrics_lock);
+}
+
+void modbus_metrics_exception(uint8_t function_index)
+{
+    portENTER_CRITICAL(&s_metrics_lock);
+    s_metrics.functions[function_index].exceptions++;
+    portEXIT_CRITICAL(&s_metrics_lock);
+}
+
+void modbus_metrics_response_sent(uint8_t function_index, uint32_t service_time_us)
+{
+    modbus_function_metrics_t *function = &s_metrics.functions[function_index];
+    
+    int bucket = 0;
+    while (bucket < MODBUS_METRICS_NUMBER_OF_BUCKETS - 1 &&
+           service_time_us > modbus_metrics_bucket_limits_us[bucket]) {
+        bucket++;
+    }
+    
+    portENTER_CRITICAL(&s_metrics_lock);
+    function->buckets[bucket]++;
+    
+    if (function->responses == 0 || service_time_us < function->min_us) {
+        function->min_us = service_time_us;
+    }
+    if (service_time_us > function->max_us) {
+        function->max_us = service_time_us;
+    }
+    function->responses++;
+    function->total_us += service_time_us;
+    portEXIT_CRITICAL(&s_metrics_lock);
+}
+
+void modbus_metrics_bytes_out(size_t length)
+{
+    portENTER_CRITICAL(&s_metrics_lock);
+    s_metrics.bytes_out += length;
+    portEXIT_CRITICAL(&s_metrics_lock);
+}
+
+void modbus_metrics_protocol_error(void)
+{
+    portENTER_CRITICAL(&s_metrics_lock);
+    s_metrics.protocol_errors++;
+    portEXIT_CRITICAL(&s_metrics_lock);
+}
+
+void modbus_metrics_connection_accepted(void)
+{
+    portENTER_CRITICAL(&s_metrics_lock);
+    s_metrics.connections_accepted++;
+    s_metrics.connections_current++;
+    if (s_metrics.connections_current > s_metrics.connections_peak) {
+        s_metrics.connections_peak = s_metrics.connections_current;
+    }
+    portEXIT_CRITICAL(&s_metrics_lock);
+}
+
+void modbus_metrics_connection_rejected(void)
+{
+    portENTER_CRITICAL(&s_metrics_lock);
+    s_metrics.connections_rejected++;
+    portEXIT_CRITICAL(&s_metrics_lock);
+}
+
+void modbus_metrics_connection_closed(modbus_metrics_close_reason_t reason)
+{
+    portENTER_CRITICAL(&s_metrics_lock);
+    switch (reason) {
+        case MODBUS_METRICS_CLOSE_EVICTED:
+            s_metrics.connections_evicted++;
+            break;
+        case MODBUS_METRICS_CLOSE_IDLE:
+            s_metrics.connections_timed_out++;
+            break;
+        case MODBUS_METRICS_CLOSE_CLIENT:
+            s_metrics.connections_closed++;
+            break;
+        default:
+            break;
+    }
+    if (s_metrics.connections_current > 0) {
+        s_metrics.connections_current--;
+    }
+    portEXIT_CRITICAL(&s_metrics_lock);
+}
+
+void modbus_metrics_get(modbus_metrics_t *metrics)
+{
+    portENTER_CRITICAL(&s_metrics_lock);
+    *metrics = s_metrics;
+    portEXIT_CRITICAL(&s_metrics_lock);
+}
+
+void modbus_metrics_reset(void)
+{
+    portENTER_CRITICAL(&s_metrics_lock);
+    for (int i = 0; i < MODBUS_METRICS_NUMBER_OF_FUNCTIONS; i++) {
+        modbus_function_metrics_t *function = &s_metrics.functions[i];
+        memset(function, 0, sizeof(*function));
+        function->function_code = s_function_codes[i];
+    }
+    s_metrics.bytes_in = 0;
+    s_metrics.bytes_out = 0;
+    s_metrics.protocol_errors = 0;
+    s_metrics.connections_accepted = 0;
+    s_metrics.connections_evicted = 0;
+    s_metrics.connections_rejected = 0;
+    s_metrics.connections_timed_out = 0;
+    s_metrics.connections_closed = 0;
+    s_metrics.connections_peak = s_metrics.connections_current;
+    portEXIT_CRITICAL(&s_metrics_lock);
+}
+
+static uint8_t *put_u32(uint8_t *position, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        *position++ = (value >> (8 * i)) & 0xFF;
+    }
+    return position;
+}
+
+static uint8_t *put_u64(uint8_t *position, uint64_t value)
+{
+    position = put_u32(position, (uint32_t)value);
+    return put_u32(position, (uint32_t)(value >> 32));
+}
+
+size_t modbus_metrics_snapshot(uint8_t *buffer, size_t size)
+{
+    const size_t header_size = 8 + 4 * (MODBUS_METRICS_NUMBER_OF_BUCKETS - 1) + 2 * 8 + 8 * 4;
+    const size_t function_size = 4 + 5 * 4 + 8 + 4 * MODBUS_METRICS_NUMBER_OF_BUCKETS;
+    if (size < header_size + MODBUS_METRICS_NUMBER_OF_FUNCTIONS * function_size) {
+        return 0;
+    }
+    
+    modbus_metrics_t snapshot;
+    modbus_metrics_get(&snapshot);
+    const modbus_metrics_t *metrics = &snapshot;
+    uint8_t *position = buffer;
+    memcpy(position, SNAPSHOT_MAGIC, 4);
+    position += 4;
+    *position++ = SNAPSHOT_VERSION;
+    *position++ = MODBUS_METRICS_NUMBER_OF_FUNCTIONS;
+    *position++ = MODBUS_METRICS_NUMBER_OF_BUCKETS;
+    *position++ = 0;
+    for (int i = 0; i < MODBUS_METRICS_NUMBER_OF_BUCKETS - 1; i++) {
+        position = put_u32(position, modbus_metrics_bucket_limits_us[i]);
+    }
+    position = put_u64(position, metrics->bytes_in);
+    position = put_u64(position, metrics->bytes_out);
+    position = put_u32(position, metrics->protocol_errors);
+    position = put_u32(position, metrics->connections_accepted);
+    position = put_u32(position, metrics->connections_evicted);
+    position = put_u32(position, metrics->connections_rejected);
+    position = put_u32(position, metrics->connections_timed_out);
+    position = put_u32(position, metrics->connections_closed);
+    position = put_u32(position, metrics->connections_current);
+    position = put_u32(position, metrics->connections_peak);
+    
+    for (int i = 0; i < MODBUS_METRICS_NUMBER_OF_FUNCTIONS; i++) {
+        const modbus_function_metrics_t *function = &metrics->functions[i];
+        *position++ = function->function_code;
+        *position++ = 0;
+        *position++ = 0;
+        *position++ = 0;
+        position = put_u32(position, function->requests);
+        position = put_u32(position, function->exceptions);
+        position = put_u32(position, function->responses);
+        position = put_u32(position, function->min_us);
+        position = put_u32(position, function->max_us);
+        position = put_u64(position, function->total_us);
+        for (int j = 0; j < MODBUS_METRICS_NUMBER_OF_BUCKETS; j++) {
+            position = put_u32(position, function->buckets[j]);
+        }
+    }
+    return position - buffer;
+}
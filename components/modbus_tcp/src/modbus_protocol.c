@@ -22,7 +22,9 @@
 
 #include "modbus_protocol.h"
 #include "modbus_register_map.h"
+#include "modbus_metrics.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "lwip/sockets.h"
 #include <string.h>
 #include <errno.h>
@@ -40,10 +42,15 @@ typedef struct {
 } modbus_tcp_adu_t;
 
 // Modbus function codes
-#define MODBUS_FC_READ_HOLDING_REGISTERS   0x03
-#define MODBUS_FC_READ_INPUT_REGISTERS     0x04
-#define MODBUS_FC_WRITE_SINGLE_REGISTER    0x06
-#define MODBUS_FC_WRITE_MULTIPLE_REGISTERS 0x10
+#define MODBUS_FC_READ_COILS                    0x01
+#define MODBUS_FC_READ_DISCRETE_INPUTS          0x02
+#define MODBUS_FC_READ_HOLDING_REGISTERS        0x03
+#define MODBUS_FC_READ_INPUT_REGISTERS          0x04
+#define MODBUS_FC_WRITE_SINGLE_COIL             0x05
+#define MODBUS_FC_WRITE_SINGLE_REGISTER         0x06
+#define MODBUS_FC_WRITE_MULTIPLE_COILS          0x0F
+#define MODBUS_FC_WRITE_MULTIPLE_REGISTERS      0x10
+#define MODBUS_FC_READ_WRITE_MULTIPLE_REGISTERS 0x17
 
 // Exception codes
 #define MODBUS_EX_ILLEGAL_FUNCTION          0x01
@@ -51,11 +58,32 @@ typedef struct {
 #define MODBUS_EX_ILLEGAL_DATA_VALUE        0x03
 #define MODBUS_EX_SLAVE_DEVICE_FAILURE      0x04
 
+// Responses are built in place at the end of the transmit queue, which has room for
+// a maximum size ADU whenever a request is handled
+static uint8_t *response_buffer(modbus_tcp_connection_t *connection)
+{
+    return &connection->tx_buffer[connection->tx_length];
+}
+
+static void queue_response(modbus_tcp_connection_t *connection, size_t response_len)
+{
+    connection->tx_length += response_len;
+    connection->tx_queued += response_len;
+    
+    // Remember the response until the socket accepted it for its service time
+    uint8_t slot = (connection->pending_first + connection->pending_count) % MODBUS_TCP_MAX_PENDING_RESPONSES;
+    connection->pending[slot].end = connection->tx_queued;
+    connection->pending[slot].start_us = connection->header_time_us;
+    connection->pending[slot].function_index = connection->request_function_index;
+    connection->pending_count++;
+}
 
-static void send_exception(int client_socket, uint16_t transaction_id, uint8_t unit_id, 
+static void send_exception(modbus_tcp_connection_t *connection, uint16_t transaction_id, uint8_t unit_id, 
                           uint8_t function_code, uint8_t exception_code)
 {
-    uint8_t response[9];
+    modbus_metrics_exception(connection->request_function_index);
+    
+    uint8_t *response = response_buffer(connection);
     response[0] = (transaction_id >> 8) & 0xFF;
     response[1] = transaction_id & 0xFF;
     response[2] = 0x00; // Protocol ID
@@ -66,15 +94,58 @@ static void send_exception(int client_socket, uint16_t transaction_id, uint8_t u
     response[7] = function_code | 0x80; // Exception flag
     response[8] = exception_code;
     
-    send(client_socket, response, sizeof(response), 0);
+    queue_response(connection, 9);
+}
+
+static bool handle_read_bits(modbus_tcp_connection_t *connection, uint16_t transaction_id, 
+                             uint8_t unit_id, uint8_t function_code, const uint8_t *pdu, int pdu_len)
+{
+    // Read Coils / Discrete Inputs requires: start_addr (2 bytes) + quantity (2 bytes) = 4 bytes
+    if (pdu_len < 4) {
+        send_exception(connection, transaction_id, unit_id, function_code, MODBUS_EX_ILLEGAL_DATA_VALUE);
+        return true;
+    }
+    
+    uint16_t start_addr = (pdu[0] << 8) | pdu[1];
+    uint16_t quantity = (pdu[2] << 8) | pdu[3];
+    
+    // Validate quantity (Modbus spec: 1-2000 bits)
+    if (quantity == 0 || quantity > 2000) {
+        send_exception(connection, transaction_id, unit_id, function_code, MODBUS_EX_ILLEGAL_DATA_VALUE);
+        return true;
+    }
+    
+    uint8_t *response = response_buffer(connection);
+    size_t response_data_size = (quantity + 7) / 8;
+    int response_len = 9 + response_data_size;
+    response[0] = (transaction_id >> 8) & 0xFF;
+    response[1] = transaction_id & 0xFF;
+    response[2] = 0x00; // Protocol ID
+    response[3] = 0x00;
+    response[4] = ((response_len - 6) >> 8) & 0xFF; // Length
+    response[5] = (response_len - 6) & 0xFF;
+    response[6] = unit_id;
+    response[7] = function_code;
+    response[8] = response_data_size; // Byte count
+    
+    bool read = function_code == MODBUS_FC_READ_COILS
+                ? modbus_read_coils(start_addr, quantity, &response[9])
+                : modbus_read_discrete_inputs(start_addr, quantity, &response[9]);
+    if (!read) {
+        send_exception(connection, transaction_id, unit_id, function_code, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+        return true;
+    }
+    
+    queue_response(connection, response_len);
+    return true;
 }
 
-static bool handle_read_holding_registers(int client_socket, uint16_t transaction_id, 
+static bool handle_read_holding_registers(modbus_tcp_connection_t *connection, uint16_t transaction_id, 
                                          uint8_t unit_id, const uint8_t *pdu, int pdu_len)
 {
     // Read Holding Registers requires: start_addr (2 bytes) + quantity (2 bytes) = 4 bytes
     if (pdu_len < 4) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_VALUE);
         return true;
     }
@@ -84,7 +155,7 @@ static bool handle_read_holding_registers(int client_socket, uint16_t transactio
     
     // Validate quantity (Modbus spec: 1-125 registers)
     if (quantity == 0 || quantity > 125) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_VALUE);
         return true;
     }
@@ -92,12 +163,12 @@ static bool handle_read_holding_registers(int client_socket, uint16_t transactio
     // Check response buffer size
     size_t response_data_size = quantity * 2;
     if (response_data_size > 250) { // Max 125 registers * 2 bytes = 250 bytes
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_VALUE);
         return true;
     }
     
-    uint8_t response[256];
+    uint8_t *response = response_buffer(connection);
     int response_len = 9 + response_data_size;
     response[0] = (transaction_id >> 8) & 0xFF;
     response[1] = transaction_id & 0xFF;
@@ -113,24 +184,21 @@ static bool handle_read_holding_registers(int client_socket, uint16_t transactio
     if (!modbus_read_holding_registers(start_addr, quantity, &response[9])) {
         ESP_LOGE(TAG, "Failed to read holding registers: start_addr=%d, quantity=%d", 
                  start_addr, quantity);
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_ADDRESS);
         return true;
     }
     
-    int sent = send(client_socket, response, response_len, 0);
-    if (sent != response_len) {
-        ESP_LOGE(TAG, "Failed to send full response: sent %d of %d bytes", sent, response_len);
-    }
+    queue_response(connection, response_len);
     return true;
 }
 
-static bool handle_read_input_registers(int client_socket, uint16_t transaction_id, 
+static bool handle_read_input_registers(modbus_tcp_connection_t *connection, uint16_t transaction_id, 
                                         uint8_t unit_id, const uint8_t *pdu, int pdu_len)
 {
     // Read Input Registers requires: start_addr (2 bytes) + quantity (2 bytes) = 4 bytes
     if (pdu_len < 4) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_VALUE);
         return true;
     }
@@ -140,7 +208,7 @@ static bool handle_read_input_registers(int client_socket, uint16_t transaction_
     
     // Validate quantity (Modbus spec: 1-125 registers)
     if (quantity == 0 || quantity > 125) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_VALUE);
         return true;
     }
@@ -148,12 +216,12 @@ static bool handle_read_input_registers(int client_socket, uint16_t transaction_
     // Check response buffer size
     size_t response_data_size = quantity * 2;
     if (response_data_size > 250) { // Max 125 registers * 2 bytes = 250 bytes
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_VALUE);
         return true;
     }
     
-    uint8_t response[256];
+    uint8_t *response = response_buffer(connection);
     int response_len = 9 + response_data_size;
     response[0] = (transaction_id >> 8) & 0xFF;
     response[1] = transaction_id & 0xFF;
@@ -169,24 +237,21 @@ static bool handle_read_input_registers(int client_socket, uint16_t transaction_
     if (!modbus_read_input_registers(start_addr, quantity, &response[9])) {
         ESP_LOGE(TAG, "Failed to read input registers: start_addr=%d, quantity=%d", 
                  start_addr, quantity);
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_ADDRESS);
         return true;
     }
     
-    int sent = send(client_socket, response, response_len, 0);
-    if (sent != response_len) {
-        ESP_LOGE(TAG, "Failed to send full response: sent %d of %d bytes", sent, response_len);
-    }
+    queue_response(connection, response_len);
     return true;
 }
 
-static bool handle_write_single_register(int client_socket, uint16_t transaction_id, 
+static bool handle_write_single_register(modbus_tcp_connection_t *connection, uint16_t transaction_id, 
                                          uint8_t unit_id, const uint8_t *pdu, int pdu_len)
 {
     // Write Single Register requires: address (2 bytes) + value (2 bytes) = 4 bytes
     if (pdu_len < 4) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_WRITE_SINGLE_REGISTER, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_SINGLE_REGISTER, 
                       MODBUS_EX_ILLEGAL_DATA_VALUE);
         return true;
     }
@@ -197,13 +262,13 @@ static bool handle_write_single_register(int client_socket, uint16_t transaction
     // Write register to map
     if (!modbus_write_holding_register(address, value)) {
         ESP_LOGE(TAG, "Failed to write holding register: address=%d, value=%d", address, value);
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_WRITE_SINGLE_REGISTER, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_SINGLE_REGISTER, 
                       MODBUS_EX_ILLEGAL_DATA_ADDRESS);
         return true;
     }
     
     // Echo back the request
-    uint8_t response[12];
+    uint8_t *response = response_buffer(connection);
     response[0] = (transaction_id >> 8) & 0xFF;
     response[1] = transaction_id & 0xFF;
     response[2] = 0x00; // Protocol ID
@@ -217,19 +282,16 @@ static bool handle_write_single_register(int client_socket, uint16_t transaction
     response[10] = (value >> 8) & 0xFF;
     response[11] = value & 0xFF;
     
-    int sent = send(client_socket, response, sizeof(response), 0);
-    if (sent != sizeof(response)) {
-        ESP_LOGE(TAG, "Failed to send write response: sent %d of %d bytes", sent, sizeof(response));
-    }
+    queue_response(connection, 12);
     return true;
 }
 
-static bool handle_write_multiple_registers(int client_socket, uint16_t transaction_id, 
+static bool handle_write_multiple_registers(modbus_tcp_connection_t *connection, uint16_t transaction_id, 
                                            uint8_t unit_id, const uint8_t *pdu, int pdu_len)
 {
     // Write Multiple Registers requires: start_addr (2) + quantity (2) + byte_count (1) + data (N) = at least 6 bytes
     if (pdu_len < 6) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_VALUE);
         return true;
     }
@@ -240,7 +302,7 @@ static bool handle_write_multiple_registers(int client_socket, uint16_t transact
     
     // Validate parameters
     if (quantity == 0 || quantity > 123 || byte_count != quantity * 2 || pdu_len < 5 + byte_count) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_VALUE);
         return true;
     }
@@ -248,13 +310,13 @@ static bool handle_write_multiple_registers(int client_socket, uint16_t transact
     // Write registers to map
     if (!modbus_write_holding_registers(start_addr, quantity, &pdu[5])) {
         ESP_LOGE(TAG, "Failed to write holding registers: start_addr=%d, quantity=%d", start_addr, quantity);
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 
                       MODBUS_EX_ILLEGAL_DATA_ADDRESS);
         return true;
     }
     
     // Response
-    uint8_t response[12];
+    uint8_t *response = response_buffer(connection);
     response[0] = (transaction_id >> 8) & 0xFF;
     response[1] = transaction_id & 0xFF;
     response[2] = 0x00; // Protocol ID
@@ -268,89 +330,197 @@ static bool handle_write_multiple_registers(int client_socket, uint16_t transact
     response[10] = (quantity >> 8) & 0xFF;
     response[11] = quantity & 0xFF;
     
-    int sent = send(client_socket, response, sizeof(response), 0);
-    if (sent != sizeof(response)) {
-        ESP_LOGE(TAG, "Failed to send write response: sent %d of %d bytes", sent, sizeof(response));
+    queue_response(connection, 12);
+    return true;
+}
+
+static bool handle_write_single_coil(modbus_tcp_connection_t *connection, uint16_t transaction_id, 
+                                    uint8_t unit_id, const uint8_t *pdu, int pdu_len)
+{
+    // Write Single Coil requires: address (2 bytes) + value (2 bytes) = 4 bytes
+    if (pdu_len < 4) {
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_SINGLE_COIL, 
+                      MODBUS_EX_ILLEGAL_DATA_VALUE);
+        return true;
     }
+    
+    uint16_t address = (pdu[0] << 8) | pdu[1];
+    uint16_t value = (pdu[2] << 8) | pdu[3];
+    
+    // Only 0xFF00 (ON) and 0x0000 (OFF) are valid
+    if (value != 0xFF00 && value != 0x0000) {
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_SINGLE_COIL, 
+                      MODBUS_EX_ILLEGAL_DATA_VALUE);
+        return true;
+    }
+    
+    if (!modbus_write_coil(address, value == 0xFF00)) {
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_SINGLE_COIL, 
+                      MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+        return true;
+    }
+    
+    // Echo back the request
+    uint8_t *response = response_buffer(connection);
+    response[0] = (transaction_id >> 8) & 0xFF;
+    response[1] = transaction_id & 0xFF;
+    response[2] = 0x00; // Protocol ID
+    response[3] = 0x00;
+    response[4] = 0x00; // Length
+    response[5] = 0x06;
+    response[6] = unit_id;
+    response[7] = MODBUS_FC_WRITE_SINGLE_COIL;
+    response[8] = (address >> 8) & 0xFF;
+    response[9] = address & 0xFF;
+    response[10] = (value >> 8) & 0xFF;
+    response[11] = value & 0xFF;
+    
+    queue_response(connection, 12);
     return true;
 }
 
-bool modbus_tcp_handle_request(int client_socket)
+static bool handle_write_multiple_coils(modbus_tcp_connection_t *connection, uint16_t transaction_id, 
+                                        uint8_t unit_id, const uint8_t *pdu, int pdu_len)
 {
-    uint8_t mbap_header[6];
+    // Write Multiple Coils requires: start_addr (2) + quantity (2) + byte_count (1) + data (N) = at least 6 bytes
+    if (pdu_len < 6) {
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_COILS, 
+                      MODBUS_EX_ILLEGAL_DATA_VALUE);
+        return true;
+    }
     
-    // Read MBAP header (6 bytes)
-    int received = recv(client_socket, mbap_header, sizeof(mbap_header), 0);
+    uint16_t start_addr = (pdu[0] << 8) | pdu[1];
+    uint16_t quantity = (pdu[2] << 8) | pdu[3];
+    uint8_t byte_count = pdu[4];
     
-    if (received <= 0) {
-        if (received == 0 || errno == ECONNRESET) {
-            return false; // Connection closed
-        }
-        return true; // Try again
+    // Validate parameters
+    if (quantity == 0 || quantity > 1968 || byte_count != (quantity + 7) / 8 || pdu_len < 5 + byte_count) {
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_COILS, 
+                      MODBUS_EX_ILLEGAL_DATA_VALUE);
+        return true;
     }
     
-    if (received < 6) {
-        return true; // Wait for more data
+    if (!modbus_write_coils(start_addr, quantity, &pdu[5])) {
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_COILS, 
+                      MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+        return true;
     }
     
-    uint16_t transaction_id = (mbap_header[0] << 8) | mbap_header[1];
-    uint16_t protocol_id = (mbap_header[2] << 8) | mbap_header[3];
-    uint16_t length = (mbap_header[4] << 8) | mbap_header[5];
+    // Response
+    uint8_t *response = response_buffer(connection);
+    response[0] = (transaction_id >> 8) & 0xFF;
+    response[1] = transaction_id & 0xFF;
+    response[2] = 0x00; // Protocol ID
+    response[3] = 0x00;
+    response[4] = 0x00; // Length
+    response[5] = 0x06;
+    response[6] = unit_id;
+    response[7] = MODBUS_FC_WRITE_MULTIPLE_COILS;
+    response[8] = (start_addr >> 8) & 0xFF;
+    response[9] = start_addr & 0xFF;
+    response[10] = (quantity >> 8) & 0xFF;
+    response[11] = quantity & 0xFF;
     
-    if (protocol_id != 0 || length < 2 || length > 253) {
-        return false;
+    queue_response(connection, 12);
+    return true;
+}
+
+static bool handle_read_write_multiple_registers(modbus_tcp_connection_t *connection, uint16_t transaction_id, 
+                                                 uint8_t unit_id, const uint8_t *pdu, int pdu_len)
+{
+    // Read/Write Multiple Registers requires: read_start (2) + read_quantity (2) + write_start (2) +
+    // write_quantity (2) + byte_count (1) + data (N) = at least 11 bytes
+    if (pdu_len < 11) {
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_WRITE_MULTIPLE_REGISTERS, 
+                      MODBUS_EX_ILLEGAL_DATA_VALUE);
+        return true;
     }
     
-    // Read PDU (unit_id + function_code + data)
-    // MBAP length field includes unit_id byte, so PDU is length bytes total
-    uint8_t pdu[256];
-    if (length > sizeof(pdu)) {
-        return false;
+    uint16_t read_start = (pdu[0] << 8) | pdu[1];
+    uint16_t read_quantity = (pdu[2] << 8) | pdu[3];
+    uint16_t write_start = (pdu[4] << 8) | pdu[5];
+    uint16_t write_quantity = (pdu[6] << 8) | pdu[7];
+    uint8_t byte_count = pdu[8];
+    
+    // Validate parameters (Modbus spec: read 1-125, write 1-121 registers)
+    if (read_quantity == 0 || read_quantity > 125 || write_quantity == 0 || write_quantity > 121 ||
+        byte_count != write_quantity * 2 || pdu_len < 9 + byte_count) {
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_WRITE_MULTIPLE_REGISTERS, 
+                      MODBUS_EX_ILLEGAL_DATA_VALUE);
+        return true;
     }
     
-    // Read the full PDU - may need multiple recv calls for large PDUs
-    size_t total_received = 0;
-    while (total_received < length) {
-        received = recv(client_socket, pdu + total_received, length - total_received, 0);
-        if (received <= 0) {
-            if (received == 0 || errno == ECONNRESET) {
-                return false;
-            }
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Would block, try again
-                continue;
-            }
-            ESP_LOGE(TAG, "Error reading PDU: %s", strerror(errno));
-            return false;
-        }
-        total_received += received;
+    // The write is performed before the read
+    if (!modbus_write_holding_registers(write_start, write_quantity, &pdu[9])) {
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_WRITE_MULTIPLE_REGISTERS, 
+                      MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+        return true;
     }
     
-    if (total_received != length || length < 2) {
-        return false;
+    uint8_t *response = response_buffer(connection);
+    size_t response_data_size = read_quantity * 2;
+    int response_len = 9 + response_data_size;
+    response[0] = (transaction_id >> 8) & 0xFF;
+    response[1] = transaction_id & 0xFF;
+    response[2] = 0x00; // Protocol ID
+    response[3] = 0x00;
+    response[4] = ((response_len - 6) >> 8) & 0xFF; // Length
+    response[5] = (response_len - 6) & 0xFF;
+    response[6] = unit_id;
+    response[7] = MODBUS_FC_READ_WRITE_MULTIPLE_REGISTERS;
+    response[8] = response_data_size; // Byte count
+    
+    if (!modbus_read_holding_registers(read_start, read_quantity, &response[9])) {
+        send_exception(connection, transaction_id, unit_id, MODBUS_FC_READ_WRITE_MULTIPLE_REGISTERS, 
+                      MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+        return true;
     }
     
-    uint8_t unit_id = pdu[0];
-    uint8_t function_code = pdu[1];
-    const uint8_t *pdu_data = &pdu[2];
-    int pdu_data_len = length - 2; // Data portion after unit_id and function_code
+    queue_response(connection, response_len);
+    return true;
+}
+
+// Dispatch one complete ADU (MBAP header, unit id, function code and data) to its handler
+static bool handle_adu(modbus_tcp_connection_t *connection, const uint8_t *adu, size_t adu_len)
+{
+    uint16_t transaction_id = (adu[0] << 8) | adu[1];
+    uint8_t unit_id = adu[6];
+    uint8_t function_code = adu[7];
+    const uint8_t *pdu_data = &adu[8];
+    int pdu_data_len = adu_len - 8; // Data portion after unit_id and function_code
+    
+    connection->request_function_index = modbus_metrics_function_index(function_code);
+    modbus_metrics_request(connection->request_function_index, adu_len);
     
     bool result = true;
     switch (function_code) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+            result = handle_read_bits(connection, transaction_id, unit_id, function_code, pdu_data, pdu_data_len);
+            break;
         case MODBUS_FC_READ_HOLDING_REGISTERS:
-            result = handle_read_holding_registers(client_socket, transaction_id, unit_id, pdu_data, pdu_data_len);
+            result = handle_read_holding_registers(connection, transaction_id, unit_id, pdu_data, pdu_data_len);
             break;
         case MODBUS_FC_READ_INPUT_REGISTERS:
-            result = handle_read_input_registers(client_socket, transaction_id, unit_id, pdu_data, pdu_data_len);
+            result = handle_read_input_registers(connection, transaction_id, unit_id, pdu_data, pdu_data_len);
             break;
         case MODBUS_FC_WRITE_SINGLE_REGISTER:
-            result = handle_write_single_register(client_socket, transaction_id, unit_id, pdu_data, pdu_data_len);
+            result = handle_write_single_register(connection, transaction_id, unit_id, pdu_data, pdu_data_len);
             break;
         case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
-            result = handle_write_multiple_registers(client_socket, transaction_id, unit_id, pdu_data, pdu_data_len);
+            result = handle_write_multiple_registers(connection, transaction_id, unit_id, pdu_data, pdu_data_len);
+            break;
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+            result = handle_write_single_coil(connection, transaction_id, unit_id, pdu_data, pdu_data_len);
+            break;
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+            result = handle_write_multiple_coils(connection, transaction_id, unit_id, pdu_data, pdu_data_len);
+            break;
+        case MODBUS_FC_READ_WRITE_MULTIPLE_REGISTERS:
+            result = handle_read_write_multiple_registers(connection, transaction_id, unit_id, pdu_data, pdu_data_len);
             break;
         default:
-            send_exception(client_socket, transaction_id, unit_id, function_code, MODBUS_EX_ILLEGAL_FUNCTION);
+            send_exception(connection, transaction_id, unit_id, function_code, MODBUS_EX_ILLEGAL_FUNCTION);
             result = true;
             break;
     }
@@ -358,3 +528,163 @@ bool modbus_tcp_handle_request(int client_socket)
     return result;
 }
 
+// Handle the complete ADUs in the receive buffer while the transmit queue has room
+// for their responses, keep the remaining and partial ones
+static bool process_rx_buffer(modbus_tcp_connection_t *connection)
+{
+    size_t offset = 0;
+    
+    while (true) {
+        const uint8_t *frame = &connection->rx_buffer[offset];
+        size_t available = connection->rx_length - offset;
+        
+        if (connection->frame_length == 0) {
+            if (available < MODBUS_TCP_MBAP_HEADER_SIZE) {
+                break; // Wait for the rest of the MBAP header
+            }
+            
+            uint16_t protocol_id = (frame[2] << 8) | frame[3];
+            uint16_t length = (frame[4] << 8) | frame[5];
+            
+            // Length covers unit_id + function_code + data
+            if (protocol_id != 0 || length < 2 ||
+                length > MODBUS_TCP_MAX_ADU_SIZE - MODBUS_TCP_MBAP_HEADER_SIZE) {
+                ESP_LOGE(TAG, "Invalid MBAP header: protocol_id=%d, length=%d", protocol_id, length);
+                modbus_metrics_protocol_error();
+                return false;
+            }
+            connection->frame_length = MODBUS_TCP_MBAP_HEADER_SIZE + length;
+            // No recv() happened since the header was buffered
+            connection->header_time_us = connection->rx_time_us;
+        }
+        
+        if (available < connection->frame_length) {
+            break; // Wait for the rest of the ADU
+        }
+        
+        if (sizeof(connection->tx_buffer) - connection->tx_length < MODBUS_TCP_MAX_ADU_SIZE ||
+            connection->pending_count == MODBUS_TCP_MAX_PENDING_RESPONSES) {
+            break; // Transmit queue full, handle the request once it has drained
+        }
+        
+        if (!handle_adu(connection, frame, connection->frame_length)) {
+            return false;
+        }
+        offset += connection->frame_length;
+        connection->frame_length = 0;
+    }
+    
+    // Move the partial ADU to the start of the buffer
+    if (offset > 0) {
+        connection->rx_length -= offset;
+        memmove(connection->rx_buffer, &connection->rx_buffer[offset], connection->rx_length);
+    }
+    return true;
+}
+
+// Submit the queued responses with one send(), keep what the socket buffer cannot take
+static bool flush_tx_queue(modbus_tcp_connection_t *connection)
+{
+    int sent = send(connection->socket, connection->tx_buffer, connection->tx_length, MSG_DONTWAIT);
+    
+    if (sent < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return true; // Socket buffer full, retry once writable
+        }
+        if (errno != ECONNRESET && errno != EPIPE) {
+            ESP_LOGE(TAG, "Error sending responses: %s", strerror(errno));
+        }
+        return false;
+    }
+    
+    connection->tx_length -= sent;
+    if (connection->tx_length > 0) {
+        memmove(connection->tx_buffer, &connection->tx_buffer[sent], connection->tx_length);
+    }
+    
+    // Account for the responses the socket accepted completely
+    connection->tx_sent += sent;
+    modbus_metrics_bytes_out(sent);
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    while (connection->pending_count > 0) {
+        const modbus_tcp_pending_response_t *pending = &connection->pending[connection->pending_first];
+        if ((int32_t)(connection->tx_sent - pending->end) < 0) {
+            break;
+        }
+        modbus_metrics_response_sent(pending->function_index, now_us - pending->start_us);
+        connection->pending_first = (connection->pending_first + 1) % MODBUS_TCP_MAX_PENDING_RESPONSES;
+        connection->pending_count--;
+    }
+    return true;
+}
+
+// Answer the buffered requests until they are all handled or the socket stops
+// accepting responses
+static bool service_connection(modbus_tcp_connection_t *connection)
+{
+    do {
+        if (!process_rx_buffer(connection)) {
+            return false;
+        }
+        if (connection->tx_length == 0) {
+            return true; // No complete request left
+        }
+        if (!flush_tx_queue(connection)) {
+            return false;
+        }
+    } while (connection->tx_length == 0);
+    
+    return true; // Backpressure, continued by modbus_tcp_connection_send()
+}
+
+void modbus_tcp_connection_init(modbus_tcp_connection_t *connection, int client_socket)
+{
+    connection->socket = client_socket;
+    connection->rx_length = 0;
+    connection->frame_length = 0;
+    connection->tx_length = 0;
+    connection->tx_queued = 0;
+    connection->tx_sent = 0;
+    connection->pending_first = 0;
+    connection->pending_count = 0;
+}
+
+bool modbus_tcp_connection_receive(modbus_tcp_connection_t *connection)
+{
+    // Requests are only read while no responses are pending, so the buffer holds at most
+    // a partial ADU, which is always shorter than MODBUS_TCP_MAX_ADU_SIZE, and there is
+    // room for at least one more complete request. Anything beyond the free space stays
+    // in the socket and is read on the next wakeup.
+    int received = recv(connection->socket,
+                        &connection->rx_buffer[connection->rx_length],
+                        sizeof(connection->rx_buffer) - connection->rx_length,
+                        MSG_DONTWAIT);
+    
+    if (received == 0) {
+        return false; // Connection closed
+    }
+    if (received < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return true; // Try again
+        }
+        if (errno != ECONNRESET) {
+            ESP_LOGE(TAG, "Error reading request: %s", strerror(errno));
+        }
+        return false;
+    }
+    
+    connection->rx_time_us = (uint32_t)esp_timer_get_time();
+    connection->rx_length += received;
+    return service_connection(connection);
+}
+
+bool modbus_tcp_connection_send(modbus_tcp_connection_t *connection)
+{
+    if (!flush_tx_queue(connection)) {
+        return false;
+    }
+    if (connection->tx_length > 0) {
+        return true; // Still waiting for the client to read
+    }
+    return service_connection(connection);
+}
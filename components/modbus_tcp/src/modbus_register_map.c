@@ -22,233 +22,374 @@
 
 #include "modbus_register_map.h"
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
+#include "opener_api.h"
 #include <string.h>
 
-// Forward declarations for assembly buffers
-extern uint8_t g_assembly_data064[32];  // Input Assembly 100
-extern uint8_t g_assembly_data096[32];  // Output Assembly 150
-extern uint8_t g_assembly_data097[10];  // Config Assembly 151
+// Assemblies of the OpENer sample application, accessed with AssemblyReadData() and
+// AssemblyUpdateData() so a Modbus request never blocks the EtherNet/IP I/O path
+#define INPUT_ASSEMBLY_NUM     100  // g_assembly_data064, 32 bytes
+#define OUTPUT_ASSEMBLY_NUM    150  // g_assembly_data096, 32 bytes
+#define CONFIG_ASSEMBLY_NUM    151  // g_assembly_data097, 10 bytes
 
-// Forward declaration for shared assembly mutex
-extern SemaphoreHandle_t sample_application_get_assembly_mutex(void);
+// Largest quantities of the Modbus function codes
+#define MODBUS_MAX_READ_REGISTERS  125
+#define MODBUS_MAX_WRITE_REGISTERS 123
+#define MODBUS_MAX_READ_BITS       2000
+#define MODBUS_MAX_WRITE_BITS      1968
 
 static const char *TAG = "modbus_regmap";
 
-// Register address ranges
-#define INPUT_REG_START        0
-#define INPUT_REG_END          15
-#define HOLDING_REG_OUTPUT_START 100
-#define HOLDING_REG_OUTPUT_END   115
-#define HOLDING_REG_CONFIG_START  150
-#define HOLDING_REG_CONFIG_END    154
+static const modbus_register_range_t s_default_map[] = {
+    { MODBUS_TABLE_INPUT_REGISTERS,   0,   16,  INPUT_ASSEMBLY_NUM,  0 },
+    { MODBUS_TABLE_HOLDING_REGISTERS, 100, 16,  OUTPUT_ASSEMBLY_NUM, 0 },
+    { MODBUS_TABLE_HOLDING_REGISTERS, 150, 5,   CONFIG_ASSEMBLY_NUM, 0 },
+    { MODBUS_TABLE_DISCRETE_INPUTS,   0,   256, INPUT_ASSEMBLY_NUM,  0 },
+    { MODBUS_TABLE_COILS,             0,   256, OUTPUT_ASSEMBLY_NUM, 0 },
+};
 
-static uint16_t bytes_to_big_endian_uint16(const uint8_t *bytes)
+// Active map, sorted by table and start address. The ranges of table t are
+// s_ranges[s_table_first[t]] up to s_ranges[s_table_first[t + 1] - 1].
+static modbus_register_range_t s_ranges[MODBUS_REGISTER_MAP_MAX_RANGES];
+static uint8_t s_table_first[MODBUS_TABLE_COUNT + 1];
+static bool s_map_loaded = false;
+
+static bool range_is_bits(const modbus_register_range_t *range)
 {
-    return (bytes[0] << 8) | bytes[1];
+    return range->table == MODBUS_TABLE_COILS || range->table == MODBUS_TABLE_DISCRETE_INPUTS;
 }
 
-static void uint16_to_big_endian_bytes(uint16_t value, uint8_t *bytes)
+static bool range_precedes(const modbus_register_range_t *a, const modbus_register_range_t *b)
 {
-    bytes[0] = (value >> 8) & 0xFF;
-    bytes[1] = value & 0xFF;
+    return a->table != b->table ? a->table < b->table : a->start_address < b->start_address;
 }
 
-static uint16_t big_endian_to_little_endian(uint16_t be_value)
+bool modbus_register_map_load(const modbus_register_range_t *ranges, size_t count)
 {
-    return ((be_value & 0xFF) << 8) | ((be_value >> 8) & 0xFF);
+    if (count > MODBUS_REGISTER_MAP_MAX_RANGES) {
+        ESP_LOGE(TAG, "Register map has %d ranges, at most %d supported",
+                 (int)count, MODBUS_REGISTER_MAP_MAX_RANGES);
+        return false;
+    }
+    
+    modbus_register_range_t sorted[MODBUS_REGISTER_MAP_MAX_RANGES];
+    for (size_t i = 0; i < count; i++) {
+        const modbus_register_range_t *range = &ranges[i];
+        if (range->table >= MODBUS_TABLE_COUNT || range->count == 0 ||
+            range->start_address + range->count > 0x10000) {
+            ESP_LOGE(TAG, "Invalid register map range %d", (int)i);
+            return false;
+        }
+        
+        // The last mapped byte must exist in the assembly
+        size_t end = range_is_bits(range) ? ((size_t)range->assembly_offset + range->count + 7) / 8
+                                          : (size_t)range->assembly_offset + range->count * 2;
+        uint8_t probe;
+        if (AssemblyReadData(range->assembly, end - 1, &probe, 1) != kEipStatusOk) {
+            ESP_LOGE(TAG, "Register map range %d exceeds assembly %d", (int)i, range->assembly);
+            return false;
+        }
+        
+        // Insertion sort, maps are short
+        size_t position = i;
+        while (position > 0 && range_precedes(range, &sorted[position - 1])) {
+            sorted[position] = sorted[position - 1];
+            position--;
+        }
+        sorted[position] = *range;
+    }
+    
+    for (size_t i = 1; i < count; i++) {
+        if (sorted[i].table == sorted[i - 1].table &&
+            sorted[i - 1].start_address + sorted[i - 1].count > sorted[i].start_address) {
+            ESP_LOGE(TAG, "Register map ranges overlap at address %d", sorted[i].start_address);
+            return false;
+        }
+    }
+    
+    memcpy(s_ranges, sorted, count * sizeof(sorted[0]));
+    size_t index = 0;
+    for (int table = 0; table <= MODBUS_TABLE_COUNT; table++) {
+        while (index < count && (int)sorted[index].table < table) {
+            index++;
+        }
+        s_table_first[table] = index;
+    }
+    s_map_loaded = true;
+    return true;
 }
 
-static SemaphoreHandle_t get_assembly_mutex(void)
+bool modbus_register_map_init(void)
 {
-    return sample_application_get_assembly_mutex();
+    if (s_map_loaded) {
+        return true;
+    }
+    return modbus_register_map_load(s_default_map, sizeof(s_default_map) / sizeof(s_default_map[0]));
 }
 
-bool modbus_read_input_registers(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+// Index of the first range of a request, or -1 unless the whole request is covered
+// by that range and the ones directly following it
+static int find_ranges(modbus_table_t table, uint16_t start_addr, uint16_t quantity)
 {
-    // Check bounds: start_addr must be within range and quantity must not overflow
-    if (start_addr > INPUT_REG_END || quantity == 0 || start_addr + quantity > INPUT_REG_END + 1) {
-        ESP_LOGE(TAG, "Invalid input register range: %d-%d", start_addr, start_addr + quantity - 1);
-        return false;
+    // Binary search for the last range starting at or before start_addr
+    int low = s_table_first[table];
+    int high = s_table_first[table + 1];
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (s_ranges[middle].start_address <= start_addr) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
     }
-    
-    SemaphoreHandle_t assembly_mutex = get_assembly_mutex();
-    if (assembly_mutex == NULL) {
-        ESP_LOGE(TAG, "Assembly mutex not initialized");
-        return false;
+    int first = low - 1;
+    if (first < s_table_first[table]) {
+        return -1;
     }
     
-    xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-    
-    // Map Input Assembly 100 (32 bytes = 16 registers) to Modbus Input Registers 0-15
-    // Assembly data is stored as little-endian bytes [low_byte, high_byte]
-    // Modbus requires big-endian bytes [high_byte, low_byte]
-    for (uint16_t i = 0; i < quantity; i++) {
-        uint16_t reg_addr = start_addr + i;
-        uint16_t byte_offset = reg_addr * 2;
-        
-        if (byte_offset + 1 < sizeof(g_assembly_data064)) {
-            // Read little-endian from assembly: [low_byte, high_byte]
-            uint8_t low_byte = g_assembly_data064[byte_offset];
-            uint8_t high_byte = g_assembly_data064[byte_offset + 1];
-            
-            // Write as big-endian for Modbus: [high_byte, low_byte]
-            data[i * 2] = high_byte;
-            data[i * 2 + 1] = low_byte;
-            
+    uint32_t end = (uint32_t)start_addr + quantity;
+    uint32_t covered = s_ranges[first].start_address + s_ranges[first].count;
+    if (covered <= start_addr) {
+        return -1;
+    }
+    for (int i = first + 1; covered < end; i++) {
+        if (i == s_table_first[table + 1] || s_ranges[i].start_address != covered) {
+            return -1;
+        }
+        covered += s_ranges[i].count;
+    }
+    return first;
+}
+
+// Swap the bytes of each 16-bit register, two registers per step
+static void swap_register_bytes(uint8_t *destination, const uint8_t *source, size_t registers)
+{
+    size_t i = 0;
+    for (; i + 2 <= registers; i += 2) {
+        uint32_t words;
+        memcpy(&words, &source[i * 2], sizeof(words));
+        words = ((words & 0x00FF00FFu) << 8) | ((words >> 8) & 0x00FF00FFu);
+        memcpy(&destination[i * 2], &words, sizeof(words));
+    }
+    if (i < registers) {
+        uint8_t low_byte = source[i * 2];
+        destination[i * 2] = source[i * 2 + 1];
+        destination[i * 2 + 1] = low_byte;
+    }
+}
+
+// Copy quantity bits, bit n being bit n % 8 of byte n / 8
+static void copy_bits(uint8_t *destination, size_t destination_bit,
+                      const uint8_t *source, size_t source_bit, size_t quantity)
+{
+    if (destination_bit % 8 == 0 && source_bit % 8 == 0) {
+        memcpy(&destination[destination_bit / 8], &source[source_bit / 8], quantity / 8);
+        destination_bit += quantity & ~7u;
+        source_bit += quantity & ~7u;
+        quantity %= 8;
+    }
+    for (size_t i = 0; i < quantity; i++) {
+        size_t to = destination_bit + i;
+        size_t from = source_bit + i;
+        uint8_t bit = 1u << (to % 8);
+        if (source[from / 8] & (1u << (from % 8))) {
+            destination[to / 8] |= bit;
         } else {
-            // Out of range, return zero
-            data[i * 2] = 0;
-            data[i * 2 + 1] = 0;
+            destination[to / 8] &= ~bit;
         }
     }
-    
-    xSemaphoreGive(assembly_mutex);
-    return true;
 }
 
-bool modbus_read_holding_registers(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+// Read registers with one snapshot per mapped range and convert them to Modbus byte order
+static bool read_registers(modbus_table_t table, uint16_t start_addr, uint16_t quantity, uint8_t *data)
 {
-    // Check if address is in output assembly range (100-115)
-    if (start_addr >= HOLDING_REG_OUTPUT_START && start_addr + quantity <= HOLDING_REG_OUTPUT_END + 1) {
-        SemaphoreHandle_t assembly_mutex = get_assembly_mutex();
-        if (assembly_mutex == NULL) {
+    int index = quantity == 0 ? -1 : find_ranges(table, start_addr, quantity);
+    if (index < 0) {
+        return false;
+    }
+    
+    uint32_t address = start_addr;
+    uint32_t end = address + quantity;
+    while (address < end) {
+        const modbus_register_range_t *range = &s_ranges[index++];
+        uint32_t first = address - range->start_address;
+        uint32_t count = range->count - first;
+        if (count > end - address) {
+            count = end - address;
+        }
+        uint8_t *words = &data[(address - start_addr) * 2];
+        if (AssemblyReadData(range->assembly, range->assembly_offset + first * 2, words, count * 2) != kEipStatusOk) {
             return false;
         }
-        
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-        
-        // Map Output Assembly 150 (32 bytes = 16 registers) to Modbus Holding Registers 100-115
         // Assembly data is stored as little-endian bytes [low_byte, high_byte]
         // Modbus requires big-endian bytes [high_byte, low_byte]
-        uint16_t reg_offset = start_addr - HOLDING_REG_OUTPUT_START;
-        for (uint16_t i = 0; i < quantity; i++) {
-            uint16_t byte_offset = (reg_offset + i) * 2;
-            
-            if (byte_offset + 1 < sizeof(g_assembly_data096)) {
-                // Read little-endian from assembly: [low_byte, high_byte]
-                uint8_t low_byte = g_assembly_data096[byte_offset];
-                uint8_t high_byte = g_assembly_data096[byte_offset + 1];
-                
-                // Write as big-endian for Modbus: [high_byte, low_byte]
-                data[i * 2] = high_byte;
-                data[i * 2 + 1] = low_byte;
-                
-            } else {
-                // Out of range, return zero
-                data[i * 2] = 0;
-                data[i * 2 + 1] = 0;
-            }
-        }
-        
-        xSemaphoreGive(assembly_mutex);
-        return true;
+        swap_register_bytes(words, words, count);
+        address += count;
+    }
+    return true;
+}
+
+// Convert registers from Modbus byte order and publish each mapped range as one update
+static bool write_registers(modbus_table_t table, uint16_t start_addr, uint16_t quantity, const uint8_t *data)
+{
+    int index = quantity == 0 || quantity > MODBUS_MAX_WRITE_REGISTERS ? -1
+                                                                        : find_ranges(table, start_addr, quantity);
+    if (index < 0) {
+        return false;
     }
     
-    // Check if address is in config assembly range (150-154)
-    if (start_addr >= HOLDING_REG_CONFIG_START && start_addr + quantity <= HOLDING_REG_CONFIG_END + 1) {
-        SemaphoreHandle_t assembly_mutex = get_assembly_mutex();
-        if (assembly_mutex == NULL) {
+    uint8_t words[MODBUS_MAX_WRITE_REGISTERS * 2];
+    swap_register_bytes(words, data, quantity);
+    
+    uint32_t address = start_addr;
+    uint32_t end = address + quantity;
+    while (address < end) {
+        const modbus_register_range_t *range = &s_ranges[index++];
+        uint32_t first = address - range->start_address;
+        uint32_t count = range->count - first;
+        if (count > end - address) {
+            count = end - address;
+        }
+        if (AssemblyUpdateData(range->assembly, range->assembly_offset + first * 2,
+                               &words[(address - start_addr) * 2], count * 2) != kEipStatusOk) {
             return false;
         }
-        
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-        
-        // Map Config Assembly 151 (10 bytes = 5 registers) to Modbus Holding Registers 150-154
-        // Assembly data is stored as little-endian bytes [low_byte, high_byte]
-        // Modbus requires big-endian bytes [high_byte, low_byte]
-        uint16_t reg_offset = start_addr - HOLDING_REG_CONFIG_START;
-        for (uint16_t i = 0; i < quantity; i++) {
-            uint16_t byte_offset = (reg_offset + i) * 2;
-            
-            if (byte_offset + 1 < sizeof(g_assembly_data097)) {
-                // Read little-endian from assembly: [low_byte, high_byte]
-                uint8_t low_byte = g_assembly_data097[byte_offset];
-                uint8_t high_byte = g_assembly_data097[byte_offset + 1];
-                
-                // Write as big-endian for Modbus: [high_byte, low_byte]
-                data[i * 2] = high_byte;
-                data[i * 2 + 1] = low_byte;
-            } else {
-                // Out of range, return zero
-                data[i * 2] = 0;
-                data[i * 2 + 1] = 0;
-            }
+        address += count;
+    }
+    return true;
+}
+
+// Read bits with one snapshot per mapped range
+static bool read_bits(modbus_table_t table, uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    int index = quantity == 0 || quantity > MODBUS_MAX_READ_BITS ? -1
+                                                                  : find_ranges(table, start_addr, quantity);
+    if (index < 0) {
+        return false;
+    }
+    
+    memset(data, 0, (quantity + 7) / 8);
+    uint32_t address = start_addr;
+    uint32_t end = address + quantity;
+    while (address < end) {
+        const modbus_register_range_t *range = &s_ranges[index++];
+        uint32_t first = address - range->start_address;
+        uint32_t count = range->count - first;
+        if (count > end - address) {
+            count = end - address;
         }
-        
-        xSemaphoreGive(assembly_mutex);
-        return true;
+        uint32_t bit = range->assembly_offset + first;
+        uint8_t snapshot[(MODBUS_MAX_READ_BITS + 7) / 8 + 1];
+        if (AssemblyReadData(range->assembly, bit / 8, snapshot, (bit % 8 + count + 7) / 8) != kEipStatusOk) {
+            return false;
+        }
+        copy_bits(data, address - start_addr, snapshot, bit % 8, count);
+        address += count;
+    }
+    return true;
+}
+
+// Update bits of each mapped range as one masked update, other bits of the bytes are kept
+static bool write_bits(modbus_table_t table, uint16_t start_addr, uint16_t quantity, const uint8_t *data)
+{
+    int index = quantity == 0 || quantity > MODBUS_MAX_WRITE_BITS ? -1
+                                                                   : find_ranges(table, start_addr, quantity);
+    if (index < 0) {
+        return false;
     }
     
+    uint32_t address = start_addr;
+    uint32_t end = address + quantity;
+    while (address < end) {
+        const modbus_register_range_t *range = &s_ranges[index++];
+        uint32_t first = address - range->start_address;
+        uint32_t count = range->count - first;
+        if (count > end - address) {
+            count = end - address;
+        }
+        uint32_t bit = range->assembly_offset + first;
+        size_t bytes = (bit % 8 + count + 7) / 8;
+        uint8_t values[(MODBUS_MAX_WRITE_BITS + 7) / 8 + 1];
+        uint8_t mask[(MODBUS_MAX_WRITE_BITS + 7) / 8 + 1];
+        memset(values, 0, bytes);
+        memset(mask, 0, bytes);
+        copy_bits(values, bit % 8, data, address - start_addr, count);
+        for (uint32_t i = bit % 8; i < bit % 8 + count; i++) {
+            mask[i / 8] |= 1u << (i % 8);
+        }
+        if (AssemblyUpdateDataMasked(range->assembly, bit / 8, values, mask, bytes) != kEipStatusOk) {
+            return false;
+        }
+        address += count;
+    }
+    return true;
+}
+
+bool modbus_read_coils(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    if (!read_bits(MODBUS_TABLE_COILS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid coil range: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
+    }
+    return true;
+}
+
+bool modbus_read_discrete_inputs(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    if (!read_bits(MODBUS_TABLE_DISCRETE_INPUTS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid discrete input range: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
+    }
+    return true;
+}
+
+bool modbus_write_coil(uint16_t address, bool value)
+{
+    uint8_t data = value ? 1 : 0;
+    return modbus_write_coils(address, 1, &data);
+}
+
+bool modbus_write_coils(uint16_t start_addr, uint16_t quantity, const uint8_t *data)
+{
+    if (!write_bits(MODBUS_TABLE_COILS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid coil range for write: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
+    }
+    return true;
+}
+
+bool modbus_read_input_registers(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    if (quantity > MODBUS_MAX_READ_REGISTERS ||
+        !read_registers(MODBUS_TABLE_INPUT_REGISTERS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid input register range: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
+    }
+    return true;
+}
+
+bool modbus_read_holding_registers(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    if (quantity > MODBUS_MAX_READ_REGISTERS ||
+        !read_registers(MODBUS_TABLE_HOLDING_REGISTERS, start_addr, quantity, data)) {
         ESP_LOGE(TAG, "Invalid holding register range: %d-%d", start_addr, start_addr + quantity - 1);
-    return false;
+        return false;
+    }
+    return true;
 }
 
 bool modbus_write_holding_register(uint16_t address, uint16_t value)
 {
     uint8_t data[2];
-    uint16_to_big_endian_bytes(value, data);
+    data[0] = (value >> 8) & 0xFF;
+    data[1] = value & 0xFF;
     return modbus_write_holding_registers(address, 1, data);
 }
 
 bool modbus_write_holding_registers(uint16_t start_addr, uint16_t quantity, const uint8_t *data)
 {
-    // Check if address is in output assembly range (100-115)
-    if (start_addr >= HOLDING_REG_OUTPUT_START && start_addr + quantity <= HOLDING_REG_OUTPUT_END + 1) {
-        SemaphoreHandle_t assembly_mutex = get_assembly_mutex();
-        if (assembly_mutex == NULL) {
-            return false;
-        }
-        
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-        
-        // Map Modbus Holding Registers 100-115 to Output Assembly 150 (32 bytes = 16 registers)
-        uint16_t reg_offset = start_addr - HOLDING_REG_OUTPUT_START;
-        for (uint16_t i = 0; i < quantity; i++) {
-            uint16_t byte_offset = (reg_offset + i) * 2;
-            
-            if (byte_offset + 1 < sizeof(g_assembly_data096)) {
-                // Convert big-endian from Modbus to little-endian for assembly
-                uint16_t be_value = bytes_to_big_endian_uint16(&data[i * 2]);
-                uint16_t le_value = big_endian_to_little_endian(be_value);
-                g_assembly_data096[byte_offset] = le_value & 0xFF;
-                g_assembly_data096[byte_offset + 1] = (le_value >> 8) & 0xFF;
-            }
-        }
-        
-        xSemaphoreGive(assembly_mutex);
-        
-        return true;
-    }
-    
-    // Check if address is in config assembly range (150-154)
-    if (start_addr >= HOLDING_REG_CONFIG_START && start_addr + quantity <= HOLDING_REG_CONFIG_END + 1) {
-        SemaphoreHandle_t assembly_mutex = get_assembly_mutex();
-        if (assembly_mutex == NULL) {
-            return false;
-        }
-        
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-        
-        // Map Modbus Holding Registers 150-154 to Config Assembly 151 (10 bytes = 5 registers)
-        uint16_t reg_offset = start_addr - HOLDING_REG_CONFIG_START;
-        for (uint16_t i = 0; i < quantity; i++) {
-            uint16_t byte_offset = (reg_offset + i) * 2;
-            
-            if (byte_offset + 1 < sizeof(g_assembly_data097)) {
-                uint16_t be_value = bytes_to_big_endian_uint16(&data[i * 2]);
-                uint16_t le_value = big_endian_to_little_endian(be_value);
-                g_assembly_data097[byte_offset] = le_value & 0xFF;
-                g_assembly_data097[byte_offset + 1] = (le_value >> 8) & 0xFF;
-            }
-        }
-        
-        xSemaphoreGive(assembly_mutex);
-        return true;
+    if (!write_registers(MODBUS_TABLE_HOLDING_REGISTERS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid holding register range for write: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
     }
-    
-    ESP_LOGE(TAG, "Invalid holding register range for write: %d-%d", start_addr, start_addr + quantity - 1);
-    return false;
+    return true;
 }
-
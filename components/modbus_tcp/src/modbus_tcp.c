@@ -22,6 +22,8 @@
 
 #include "modbus_tcp.h"
 #include "modbus_protocol.h"
+#include "modbus_register_map.h"
+#include "modbus_metrics.h"
 #include "esp_log.h"
 #include "lwip/sockets.h"
 #include "lwip/netdb.h"
@@ -31,107 +33,218 @@
 #include "freertos/semphr.h"
 #include <string.h>
 #include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
 
 static const char *TAG = "modbus_tcp";
 static int s_listen_socket = -1;
 static TaskHandle_t s_server_task_handle = NULL;
-static bool s_running = false;
+static atomic_bool s_running = false;
 static SemaphoreHandle_t s_modbus_mutex = NULL;
 
 #define MODBUS_TCP_PORT 502
+
+#ifdef CONFIG_MODBUS_TCP_MAX_CONNECTIONS
+#define MODBUS_TCP_MAX_CONNECTIONS CONFIG_MODBUS_TCP_MAX_CONNECTIONS
+#else
 #define MODBUS_TCP_MAX_CONNECTIONS 20
+#endif
 
-static void modbus_tcp_server_task(void *pvParameters)
+// Connections without a request for this long are closed, 0 keeps them open
+#ifdef CONFIG_MODBUS_TCP_IDLE_TIMEOUT_S
+#define MODBUS_TCP_IDLE_TIMEOUT_S CONFIG_MODBUS_TCP_IDLE_TIMEOUT_S
+#else
+#define MODBUS_TCP_IDLE_TIMEOUT_S 60
+#endif
+
+// A new client only replaces a connection idle for at least this long
+#ifdef CONFIG_MODBUS_TCP_EVICT_MIN_IDLE_S
+#define MODBUS_TCP_EVICT_MIN_IDLE_S CONFIG_MODBUS_TCP_EVICT_MIN_IDLE_S
+#else
+#define MODBUS_TCP_EVICT_MIN_IDLE_S 10
+#endif
+
+// Longest select() wait, bounds the time until a stop request is noticed
+#define MODBUS_TCP_STOP_CHECK_MS 1000
+
+typedef struct {
+    modbus_tcp_connection_t connection;
+    TickType_t last_activity;   // Tick of the last request or response progress
+} modbus_tcp_client_t;
+
+// Client connections including their buffers, kept off the task stack
+static modbus_tcp_client_t s_client_pool[MODBUS_TCP_MAX_CONNECTIONS];
+// The open connections, densely packed so a wakeup only visits live sockets
+static modbus_tcp_client_t *s_clients[MODBUS_TCP_MAX_CONNECTIONS];
+static int s_client_count = 0;
+
+static void close_client(int index, modbus_metrics_close_reason_t reason)
+{
+    modbus_tcp_client_t *client = s_clients[index];
+    close(client->connection.socket);
+    client->connection.socket = -1;
+    s_clients[index] = s_clients[--s_client_count];
+    modbus_metrics_connection_closed(reason);
+}
+
+// Index of the connection that has been idle the longest
+static int least_recently_active_client(TickType_t now)
+{
+    int oldest = 0;
+    for (int i = 1; i < s_client_count; i++) {
+        if (now - s_clients[i]->last_activity > now - s_clients[oldest]->last_activity) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+static void accept_client(int listen_socket)
 {
     struct sockaddr_in client_addr;
     socklen_t client_addr_len = sizeof(client_addr);
-    int client_sockets[MODBUS_TCP_MAX_CONNECTIONS];
-    int max_fd;
-    fd_set read_fds;
-    bool running = true;
-    
-    memset(client_sockets, -1, sizeof(client_sockets));
+    int new_socket = accept(listen_socket, (struct sockaddr *)&client_addr, &client_addr_len);
+    if (new_socket < 0) {
+        return;
+    }
     
-    while (running) {
-        // Check running flag with mutex protection
-        if (s_modbus_mutex != NULL) {
-            xSemaphoreTake(s_modbus_mutex, portMAX_DELAY);
-            running = s_running;
-            xSemaphoreGive(s_modbus_mutex);
+    TickType_t now = xTaskGetTickCount();
+    if (s_client_count == MODBUS_TCP_MAX_CONNECTIONS) {
+        // Make room by dropping the connection that has been quiet the longest,
+        // typically one left behind by a client that reconnected. Clients that
+        // are still polling keep their connection and the new one is refused.
+        int oldest = least_recently_active_client(now);
+        TickType_t idle = now - s_clients[oldest]->last_activity;
+        if (idle < pdMS_TO_TICKS(MODBUS_TCP_EVICT_MIN_IDLE_S * 1000)) {
+            ESP_LOGW(TAG, "Max connections reached, refusing new connection");
+            close(new_socket);
+            modbus_metrics_connection_rejected();
+            return;
         }
-        
-        if (!running) {
+        ESP_LOGW(TAG, "Max connections reached, closing connection idle for %u ms",
+                 (unsigned)(idle * portTICK_PERIOD_MS));
+        close_client(oldest, MODBUS_METRICS_CLOSE_EVICTED);
+    }
+    
+    // Disable Nagle's algorithm for low latency
+    int flag = 1;
+    if (setsockopt(new_socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) < 0) {
+        ESP_LOGW(TAG, "Failed to set TCP_NODELAY on new connection: %s", strerror(errno));
+    }
+    
+    modbus_tcp_client_t *client = NULL;
+    for (int i = 0; i < MODBUS_TCP_MAX_CONNECTIONS; i++) {
+        if (s_client_pool[i].connection.socket < 0) {
+            client = &s_client_pool[i];
             break;
         }
+    }
+    modbus_tcp_connection_init(&client->connection, new_socket);
+    client->last_activity = now;
+    s_clients[s_client_count++] = client;
+    modbus_metrics_connection_accepted();
+}
+
+// Close the connections idle for longer than the timeout and return the ticks
+// until the next one expires
+static TickType_t close_idle_clients(TickType_t now)
+{
+    TickType_t next_expiry = pdMS_TO_TICKS(MODBUS_TCP_STOP_CHECK_MS);
+#if MODBUS_TCP_IDLE_TIMEOUT_S > 0
+    const TickType_t idle_timeout = pdMS_TO_TICKS(MODBUS_TCP_IDLE_TIMEOUT_S * 1000);
+    for (int i = s_client_count - 1; i >= 0; i--) {
+        TickType_t idle = now - s_clients[i]->last_activity;
+        if (idle >= idle_timeout) {
+            ESP_LOGW(TAG, "Closing connection idle for %d s", MODBUS_TCP_IDLE_TIMEOUT_S);
+            close_client(i, MODBUS_METRICS_CLOSE_IDLE);
+        } else if (idle_timeout - idle < next_expiry) {
+            next_expiry = idle_timeout - idle;
+        }
+    }
+#else
+    (void)now;
+#endif
+    return next_expiry;
+}
+
+static void modbus_tcp_server_task(void *pvParameters)
+{
+    const int listen_socket = (int)(intptr_t)pvParameters;
+    fd_set read_fds;
+    fd_set write_fds;
+    
+    for (int i = 0; i < MODBUS_TCP_MAX_CONNECTIONS; i++) {
+        s_client_pool[i].connection.socket = -1;
+    }
+    s_client_count = 0;
+    
+    TickType_t wait_ticks = pdMS_TO_TICKS(MODBUS_TCP_STOP_CHECK_MS);
+    while (atomic_load(&s_running)) {
         FD_ZERO(&read_fds);
-        FD_SET(s_listen_socket, &read_fds);
-        max_fd = s_listen_socket;
+        FD_ZERO(&write_fds);
+        FD_SET(listen_socket, &read_fds);
+        int max_fd = listen_socket;
         
-        // Add client sockets to set
-        for (int i = 0; i < MODBUS_TCP_MAX_CONNECTIONS; i++) {
-            if (client_sockets[i] >= 0) {
-                FD_SET(client_sockets[i], &read_fds);
-                if (client_sockets[i] > max_fd) {
-                    max_fd = client_sockets[i];
-                }
+        // Wait for requests, or for writability while responses are pending
+        for (int i = 0; i < s_client_count; i++) {
+            modbus_tcp_connection_t *connection = &s_clients[i]->connection;
+            if (modbus_tcp_connection_tx_pending(connection)) {
+                FD_SET(connection->socket, &write_fds);
+            } else {
+                FD_SET(connection->socket, &read_fds);
+            }
+            if (connection->socket > max_fd) {
+                max_fd = connection->socket;
             }
         }
         
-        struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
-        int activity = select(max_fd + 1, &read_fds, NULL, NULL, &timeout);
+        // Sleep until a socket is ready or the next idle connection expires
+        TickType_t wait_ms = wait_ticks * portTICK_PERIOD_MS;
+        struct timeval timeout = {.tv_sec = wait_ms / 1000, .tv_usec = (wait_ms % 1000) * 1000};
+        int activity = select(max_fd + 1, &read_fds, &write_fds, NULL, &timeout);
         
-        if (activity < 0 && errno != EINTR) {
-            ESP_LOGE(TAG, "Select error: %s", strerror(errno));
+        if (activity < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (atomic_load(&s_running)) {
+                ESP_LOGE(TAG, "Select error: %s", strerror(errno));
+            }
             break;
         }
         
-        // Check for new connections
-        if (FD_ISSET(s_listen_socket, &read_fds)) {
-            int new_socket = accept(s_listen_socket, (struct sockaddr *)&client_addr, &client_addr_len);
-            if (new_socket >= 0) {
-                // New ModbusTCP connection
-                
-                // Disable Nagle's algorithm for low latency
-                int flag = 1;
-                if (setsockopt(new_socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) < 0) {
-                    ESP_LOGW(TAG, "Failed to set TCP_NODELAY on new connection: %s", strerror(errno));
-                }
-                
-                // Find empty slot
-                bool added = false;
-                for (int i = 0; i < MODBUS_TCP_MAX_CONNECTIONS; i++) {
-                    if (client_sockets[i] < 0) {
-                        client_sockets[i] = new_socket;
-                        added = true;
-                        break;
-                    }
-                }
-                
-                if (!added) {
-                    ESP_LOGE(TAG, "Max connections reached, closing new connection");
-                    close(new_socket);
-                }
+        TickType_t now = xTaskGetTickCount();
+        
+        // Serve the ready clients, backwards so closing one does not skip another
+        for (int i = s_client_count - 1; activity > 0 && i >= 0; i--) {
+            modbus_tcp_client_t *client = s_clients[i];
+            bool keep_open = true;
+            if (FD_ISSET(client->connection.socket, &write_fds)) {
+                keep_open = modbus_tcp_connection_send(&client->connection);
+            } else if (FD_ISSET(client->connection.socket, &read_fds)) {
+                keep_open = modbus_tcp_connection_receive(&client->connection);
+            } else {
+                continue;
+            }
+            activity--;
+            client->last_activity = now;
+            if (!keep_open) {
+                // Connection closed or error
+                close_client(i, MODBUS_METRICS_CLOSE_CLIENT);
             }
         }
         
-        // Check client sockets for data
-        for (int i = 0; i < MODBUS_TCP_MAX_CONNECTIONS; i++) {
-            if (client_sockets[i] >= 0 && FD_ISSET(client_sockets[i], &read_fds)) {
-                if (!modbus_tcp_handle_request(client_sockets[i])) {
-                    // Connection closed or error
-                    // Closing ModbusTCP connection
-                    close(client_sockets[i]);
-                    client_sockets[i] = -1;
-                }
-            }
+        wait_ticks = close_idle_clients(now);
+        
+        // New clients last, the ready sets do not cover their sockets
+        if (activity > 0 && FD_ISSET(listen_socket, &read_fds)) {
+            accept_client(listen_socket);
         }
     }
     
     // Cleanup
-    for (int i = 0; i < MODBUS_TCP_MAX_CONNECTIONS; i++) {
-        if (client_sockets[i] >= 0) {
-            close(client_sockets[i]);
-        }
+    while (s_client_count > 0) {
+        close_client(s_client_count - 1, MODBUS_METRICS_CLOSE_STOP);
     }
     
     if (s_modbus_mutex != NULL) {
@@ -224,10 +337,18 @@ bool modbus_tcp_start(void)
         return true;
     }
     
-    s_running = true;
-    BaseType_t result = xTaskCreate(modbus_tcp_server_task, "modbus_tcp", 8192, NULL, 5, &s_server_task_handle);
+    if (!modbus_register_map_init()) {
+        xSemaphoreGive(s_modbus_mutex);
+        ESP_LOGE(TAG, "Failed to load ModbusTCP register map");
+        return false;
+    }
+    
+    // The task owns the listening socket it was started with, stop() closes it to end the task
+    atomic_store(&s_running, true);
+    BaseType_t result = xTaskCreate(modbus_tcp_server_task, "modbus_tcp", 8192,
+                                    (void *)(intptr_t)s_listen_socket, 5, &s_server_task_handle);
     if (result != pdPASS) {
-        s_running = false;
+        atomic_store(&s_running, false);
         xSemaphoreGive(s_modbus_mutex);
         ESP_LOGE(TAG, "Failed to create ModbusTCP server task");
         return false;
@@ -245,7 +366,7 @@ void modbus_tcp_stop(void)
     }
     
     xSemaphoreTake(s_modbus_mutex, portMAX_DELAY);
-    s_running = false;
+    atomic_store(&s_running, false);
     TaskHandle_t task_handle = s_server_task_handle;
     
     // Close socket with mutex protection
@@ -6,6 +6,7 @@
 
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
 #include "cipassembly.h"
 
@@ -13,6 +14,7 @@
 #include "opener_api.h"
 #include "trace.h"
 #include "cipconnectionmanager.h"
+#include "networkhandler.h"
 
 /** @brief Retrieve the given data according to CIP encoding from the
  *              message buffer.
@@ -30,6 +32,91 @@ int DecodeCipAssemblyAttribute3(void *const data,
                                 CipMessageRouterRequest *const message_router_request,
                                 CipMessageRouterResponse *const message_router_response);
 
+/** @brief Per instance data of an assembly object
+ *
+ * The byte array has to stay the first member, attribute 3 points to this
+ * struct and is accessed as CipByteArray.
+ *
+ * The data is shared with application tasks and protected by a sequence lock:
+ * writers are serialized by a short platform critical section and make
+ * write_sequence odd while they copy, readers copy without locking and retry
+ * if write_sequence was odd or has changed. Readers never block a writer.
+ *
+ * Application tasks find the data by its instance number in
+ * g_assembly_data_table, not through the CIP object model, so they can keep
+ * accessing it while the stack is shut down and restarted.
+ */
+typedef struct {
+  CipByteArray byte_array; /**< attribute 3 and attribute 4 */
+  atomic_uint data_revision; /**< incremented on every change of the data */
+  atomic_uint write_sequence; /**< odd while the data is written */
+  atomic_uint instance_number; /**< published last, 0 for an unused entry */
+} CipAssemblyData;
+
+/** Data of all assembly instances, never freed. An entry is assigned to its
+ * instance number on the first creation and reused when the stack creates the
+ * instance again, its buffer and length do not change afterwards. */
+static CipAssemblyData g_assembly_data_table[OPENER_ASSEMBLY_NUMBER_OF_INSTANCES];
+
+/** set when an assembly changed since the last AssemblyTakeChangeNotification() */
+static atomic_bool g_assembly_change_pending;
+
+/** @brief Find the data of an assembly instance, from any task
+ *
+ * @param instance_number instance number of the assembly object
+ * @return the data of the instance, NULL if it was never created
+ */
+static CipAssemblyData *GetAssemblyData(const CipInstanceNum instance_number) {
+  for(size_t i = 0; i < OPENER_ASSEMBLY_NUMBER_OF_INSTANCES; ++i) {
+    if(instance_number ==
+       atomic_load_explicit(&g_assembly_data_table[i].instance_number,
+                            memory_order_acquire) ) {
+      return &g_assembly_data_table[i];
+    }
+  }
+  return NULL;
+}
+
+static void AssemblyDataNoteChanged(CipAssemblyData *const assembly_data) {
+  atomic_fetch_add_explicit(&assembly_data->data_revision, 1,
+                            memory_order_release);
+  atomic_store_explicit(&g_assembly_change_pending, true,
+                        memory_order_release);
+}
+
+/** @brief Start writing the data of an assembly, has to be ended with AssemblyWriteEnd() */
+static void AssemblyWriteBegin(CipAssemblyData *const assembly_data) {
+  EnterCriticalSectionPlatform();
+  atomic_fetch_add_explicit(&assembly_data->write_sequence, 1,
+                            memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+static void AssemblyWriteEnd(CipAssemblyData *const assembly_data) {
+  atomic_fetch_add_explicit(&assembly_data->write_sequence, 1,
+                            memory_order_release);
+  LeaveCriticalSectionPlatform();
+}
+
+/** @brief Copy a consistent snapshot of a byte range of the assembly data */
+static void AssemblyDataReadSnapshot(CipAssemblyData *const assembly_data,
+                                     const size_t offset,
+                                     EipUint8 *const destination,
+                                     const size_t length) {
+  unsigned int sequence = 0;
+  do {
+    sequence = atomic_load_explicit(&assembly_data->write_sequence,
+                                    memory_order_acquire);
+    memcpy(destination, assembly_data->byte_array.data + offset, length);
+    atomic_thread_fence(memory_order_acquire);
+  } while( (0 != (sequence & 1U) ) ||
+           (sequence != atomic_load_explicit(&assembly_data->write_sequence,
+                                             memory_order_relaxed) ) );
+}
+
+static void EncodeCipAssemblyAttribute3(const void *const data,
+                                        ENIPMessage *const outgoing_message);
+
 static EipStatus AssemblyPreGetCallback(CipInstance *const instance,
                                         CipAttributeStruct *const attribute,
                                         CipByte service);
@@ -81,18 +168,8 @@ EipStatus CipAssemblyInitialize(void) {
 }
 
 void ShutdownAssemblies(void) {
-  const CipClass *const assembly_class = GetCipClass(kCipAssemblyClassCode);
-
-  if(NULL != assembly_class) {
-    const CipInstance *instance = assembly_class->instances;
-    while(NULL != instance) {
-      const CipAttributeStruct *const attribute = GetCipAttribute(instance, 3);
-      if(NULL != attribute) {
-        CipFree(attribute->data);
-      }
-      instance = instance->next;
-    }
-  }
+  /* the data stays in g_assembly_data_table, application tasks may still
+   * access it and the next initialization of the stack reuses it */
 }
 
 CipInstance *CreateAssemblyObject(const CipInstanceNum instance_id,
@@ -107,22 +184,41 @@ CipInstance *CreateAssemblyObject(const CipInstanceNum instance_id,
     return NULL;
   }
 
-  CipInstance *const instance = AddCipInstance(assembly_class, instance_id); /* add instances (always succeeds (or asserts))*/
+  if(0 == instance_id) {
+    return NULL; /* 0 marks an unused entry of g_assembly_data_table */
+  }
 
-  CipByteArray *const assembly_byte_array = (CipByteArray *) CipCalloc(1,
-                                                                       sizeof(
-                                                                         CipByteArray) );
-  if(assembly_byte_array == NULL) {
-    return NULL; /*TODO remove assembly instance in case of error*/
+  CipAssemblyData *assembly_data = GetAssemblyData(instance_id);
+  if(NULL != assembly_data) {
+    /* created again after a restart of the stack, other tasks may be using
+     * the data, so it has to stay where it is */
+    if( (data != assembly_data->byte_array.data) ||
+        (data_length != assembly_data->byte_array.length) ) {
+      OPENER_TRACE_ERR("assembly %u was created with other data before\n",
+                       (unsigned) instance_id);
+      return NULL;
+    }
+  } else {
+    assembly_data = GetAssemblyData(0);
+    if(NULL == assembly_data) {
+      OPENER_TRACE_ERR("no space for assembly %u, increase "
+                       "OPENER_ASSEMBLY_NUMBER_OF_INSTANCES\n",
+                       (unsigned) instance_id);
+      return NULL;
+    }
+    assembly_data->byte_array.length = data_length;
+    assembly_data->byte_array.data = data;
+    atomic_store_explicit(&assembly_data->instance_number, instance_id,
+                          memory_order_release);
   }
+  CipByteArray *const assembly_byte_array = &assembly_data->byte_array;
 
-  assembly_byte_array->length = data_length;
-  assembly_byte_array->data = data;
+  CipInstance *const instance = AddCipInstance(assembly_class, instance_id); /* add instances (always succeeds (or asserts))*/
 
   InsertAttribute(instance,
                   3,
                   kCipByteArray,
-                  EncodeCipByteArray,
+                  EncodeCipAssemblyAttribute3,
                   DecodeCipAssemblyAttribute3,
                   assembly_byte_array,
                   kSetAndGetAble | kPreGetFunc | kPostSetFunc);
@@ -139,13 +235,23 @@ EipStatus NotifyAssemblyConnectedDataReceived(CipInstance *const instance,
                                               const size_t data_length) {
   /* empty path (path size = 0) need to be checked and taken care of in future */
   /* copy received data to Attribute 3 */
-  const CipByteArray *const assembly_byte_array =
-    (CipByteArray *) instance->attributes->data;
+  CipAssemblyData *const assembly_data =
+    (CipAssemblyData *) instance->attributes->data;
+  const CipByteArray *const assembly_byte_array = &assembly_data->byte_array;
   if(assembly_byte_array->length != data_length) {
     OPENER_TRACE_ERR("wrong amount of data arrived for assembly object\n");
     return kEipStatusError; /*TODO question should we notify the application that wrong data has been received???*/
-  } else {
-    memcpy(assembly_byte_array->data, data, data_length);
+  } else if(0 != data_length) {
+    AssemblyWriteBegin(assembly_data);
+    const bool changed =
+      0 != memcmp(assembly_byte_array->data, data, data_length);
+    if(changed) {
+      memcpy(assembly_byte_array->data, data, data_length);
+    }
+    AssemblyWriteEnd(assembly_data);
+    if(changed) {
+      AssemblyNoteDataChanged(instance);
+    }
     /* call the application that new data arrived */
   }
 
@@ -179,9 +285,13 @@ int DecodeCipAssemblyAttribute3(void *const data,
   }
 
   // data-length is correct
+  CipAssemblyData *const assembly_data = (CipAssemblyData *) data;
+  AssemblyWriteBegin(assembly_data);
   memcpy(cip_byte_array->data,
          message_router_request->data,
          cip_byte_array->length);
+  AssemblyWriteEnd(assembly_data);
+  AssemblyNoteDataChanged(instance);
 
   if(AfterAssemblyDataReceived(instance) != kEipStatusOk) {
     /* punt early without updating the status... though I don't know
@@ -202,6 +312,23 @@ int DecodeCipAssemblyAttribute3(void *const data,
   return number_of_decoded_bytes;
 }
 
+/** @brief Encode attribute 3 of an assembly from a consistent snapshot of its data
+ *
+ *  @param data the CipAssemblyData of the instance
+ *  @param outgoing_message the message the data is appended to
+ */
+static void EncodeCipAssemblyAttribute3(const void *const data,
+                                        ENIPMessage *const outgoing_message) {
+  OPENER_TRACE_INFO(" -> get attribute byte array\r\n");
+  CipAssemblyData *const assembly_data = (CipAssemblyData *) data;
+  const size_t length = assembly_data->byte_array.length;
+  AssemblyDataReadSnapshot(assembly_data, 0,
+                           outgoing_message->current_message_position,
+                           length);
+  outgoing_message->current_message_position += length;
+  outgoing_message->used_message_length += length;
+}
+
 static EipStatus AssemblyPreGetCallback(CipInstance *const instance,
                                         CipAttributeStruct *const attribute,
                                         CipByte service) {
@@ -225,3 +352,141 @@ static EipStatus AssemblyPostSetCallback(CipInstance *const instance,
 
   return rc;
 }
+
+void AssemblyNoteDataChanged(CipInstance *const instance) {
+  AssemblyDataNoteChanged( (CipAssemblyData *) instance->attributes->data );
+}
+
+EipUint32 AssemblyGetDataRevision(const CipInstance *const instance) {
+  const CipAssemblyData *const assembly_data =
+    (const CipAssemblyData *) instance->attributes->data;
+  return atomic_load_explicit(&assembly_data->data_revision,
+                              memory_order_acquire);
+}
+
+void AssemblyReadSnapshot(const CipInstance *const instance,
+                          const size_t offset,
+                          EipUint8 *const destination,
+                          const size_t length) {
+  AssemblyDataReadSnapshot( (CipAssemblyData *) instance->attributes->data,
+                            offset, destination, length );
+}
+
+bool AssemblyTakeChangeNotification(void) {
+  return atomic_exchange_explicit(&g_assembly_change_pending, false,
+                                  memory_order_acq_rel);
+}
+
+/** @brief Get the data of an assembly instance and check that the byte range lies within it
+ *
+ * Does not use the CIP object model, which is freed on a shutdown of the stack.
+ *
+ * @param instance_number instance number of the assembly object
+ * @param offset first byte of the range
+ * @param length number of bytes in the range
+ * @return the assembly data, NULL if there is none or the range is invalid
+ */
+static CipAssemblyData *GetAssemblyDataForRange(
+  const CipInstanceNum instance_number,
+  const size_t offset,
+  const size_t length) {
+  CipAssemblyData *const assembly_data = (0 != instance_number) ?
+                                         GetAssemblyData(instance_number) :
+                                         NULL;
+  if(NULL == assembly_data) {
+    OPENER_TRACE_WARN("assembly %u does not exist\n",
+                      (unsigned) instance_number);
+    return NULL;
+  }
+  const CipByteArray *const assembly_byte_array = &assembly_data->byte_array;
+  if( (0 == length) || (offset > assembly_byte_array->length) ||
+      (length > assembly_byte_array->length - offset) ) {
+    OPENER_TRACE_WARN("invalid byte range %u+%u for assembly %u\n",
+                      (unsigned) offset, (unsigned) length,
+                      (unsigned) instance_number);
+    return NULL;
+  }
+  return assembly_data;
+}
+
+EipStatus AssemblyMarkDataChanged(const CipInstanceNum instance_number,
+                                  const size_t offset,
+                                  const size_t length) {
+  CipAssemblyData *const assembly_data = GetAssemblyDataForRange(
+    instance_number,
+    offset,
+    length);
+  if(NULL == assembly_data) {
+    return kEipStatusError;
+  }
+  AssemblyDataNoteChanged(assembly_data);
+  return kEipStatusOk;
+}
+
+EipStatus AssemblyUpdateData(const CipInstanceNum instance_number,
+                             const size_t offset,
+                             const EipUint8 *const data,
+                             const size_t length) {
+  CipAssemblyData *const assembly_data = GetAssemblyDataForRange(
+    instance_number,
+    offset,
+    length);
+  if(NULL == assembly_data) {
+    return kEipStatusError;
+  }
+  EipUint8 *const destination = assembly_data->byte_array.data + offset;
+  AssemblyWriteBegin(assembly_data);
+  const bool changed = 0 != memcmp(destination, data, length);
+  if(changed) {
+    memcpy(destination, data, length);
+  }
+  AssemblyWriteEnd(assembly_data);
+  if(changed) {
+    AssemblyDataNoteChanged(assembly_data);
+  }
+  return kEipStatusOk;
+}
+
+EipStatus AssemblyUpdateDataMasked(const CipInstanceNum instance_number,
+                                   const size_t offset,
+                                   const EipUint8 *const data,
+                                   const EipUint8 *const mask,
+                                   const size_t length) {
+  CipAssemblyData *const assembly_data = GetAssemblyDataForRange(
+    instance_number,
+    offset,
+    length);
+  if(NULL == assembly_data) {
+    return kEipStatusError;
+  }
+  EipUint8 *const destination = assembly_data->byte_array.data + offset;
+  bool changed = false;
+  AssemblyWriteBegin(assembly_data);
+  for(size_t i = 0; i < length; i++) {
+    const EipUint8 value = (destination[i] & ~mask[i]) | (data[i] & mask[i]);
+    if(value != destination[i]) {
+      destination[i] = value;
+      changed = true;
+    }
+  }
+  AssemblyWriteEnd(assembly_data);
+  if(changed) {
+    AssemblyDataNoteChanged(assembly_data);
+  }
+  return kEipStatusOk;
+}
+
+EipStatus AssemblyReadData(const CipInstanceNum instance_number,
+                           const size_t offset,
+                           EipUint8 *const data,
+                           const size_t length) {
+  CipAssemblyData *const assembly_data = GetAssemblyDataForRange(
+    instance_number,
+    offset,
+    length);
+  if(NULL == assembly_data) {
+    return kEipStatusError;
+  }
+  AssemblyDataReadSnapshot(assembly_data, offset, data, length);
+  return kEipStatusOk;
+}
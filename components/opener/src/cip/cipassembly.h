@@ -6,12 +6,19 @@
 #ifndef OPENER_CIPASSEMBLY_H_
 #define OPENER_CIPASSEMBLY_H_
 
+#include <stdbool.h>
+
 #include "typedefs.h"
 #include "ciptypes.h"
 
 /** @brief Assembly class code */
 static const CipUint kCipAssemblyClassCode = 0x04U;
 
+#ifndef OPENER_ASSEMBLY_NUMBER_OF_INSTANCES
+/** @brief Number of assembly object instances the application can create */
+#define OPENER_ASSEMBLY_NUMBER_OF_INSTANCES 8
+#endif
+
 
 /** @brief Assembly object instance attribute IDs.
  *
@@ -33,12 +40,12 @@ typedef enum {
  */
 EipStatus CipAssemblyInitialize(void);
 
-/** @brief clean up the data allocated in the assembly object instances
+/** @brief clean up the data of the assembly object instances
  *
- * Assembly object instances allocate per instance data to store attribute 3.
- * This will be freed here. The assembly object data given by the application
- * is not freed neither the assembly object instances. These are handled in the
- * main shutdown function.
+ * The per instance data of attribute 3 is kept in a static table, application
+ * tasks may still access it with AssemblyUpdateData() and AssemblyReadData()
+ * during and after the shutdown. Nothing is freed here. The assembly object
+ * instances are handled in the main shutdown function.
  */
 void ShutdownAssemblies(void);
 
@@ -58,4 +65,43 @@ EipStatus NotifyAssemblyConnectedDataReceived(CipInstance *const instance,
                                               const EipUint8 *const data,
                                               const size_t data_length);
 
+/** @brief Record that the data of an assembly object has changed
+ *
+ * Increments the data revision of the assembly, see AssemblyGetDataRevision().
+ * Safe to be called from any task.
+ *
+ * @param instance the assembly object instance whose data changed
+ */
+void AssemblyNoteDataChanged(CipInstance *const instance);
+
+/** @brief Get the data revision of an assembly object
+ *
+ * The revision changes whenever the data was marked as changed. Producing
+ * connections compare it with the revision of their last production.
+ *
+ * @param instance the assembly object instance
+ * @return the current data revision
+ */
+EipUint32 AssemblyGetDataRevision(const CipInstance *const instance);
+
+/** @brief Copy a consistent snapshot of a byte range of an assembly object's data
+ *
+ * Does not block, retries while a writer of another task is copying new data.
+ *
+ * @param instance the assembly object instance
+ * @param offset first byte to be copied, the range has to lie within the data
+ * @param destination buffer receiving the bytes
+ * @param length number of bytes to be copied
+ */
+void AssemblyReadSnapshot(const CipInstance *const instance,
+                          const size_t offset,
+                          EipUint8 *const destination,
+                          const size_t length);
+
+/** @brief Check and reset if any assembly changed since the last call
+ *
+ * @return true if at least one assembly was marked as changed
+ */
+bool AssemblyTakeChangeNotification(void);
+
 #endif /* OPENER_CIPASSEMBLY_H_ */
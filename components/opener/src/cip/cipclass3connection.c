@@ -49,7 +49,12 @@ CipError EstablishClass3Connection(
     explicit_connection->connection_timeout_function =
       Class3ConnectionTimeoutHandler;
 
-    AddNewActiveConnection(explicit_connection);
+    if(kEipStatusOk != AddNewActiveConnection(explicit_connection) ) {
+      ConnectionObjectInitializeEmpty(explicit_connection);
+      cip_error = kCipErrorConnectionFailure;
+      *extended_error =
+        kConnectionManagerExtendedStatusCodeErrorNoMoreConnectionsAvailable;
+    }
   }
   return cip_error;
 }
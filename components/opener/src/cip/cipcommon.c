@@ -24,6 +24,7 @@
   #include "cipdlr.h"
 #endif
 #include "cipqos.h"
+#include "cipdiagnostics.h"
 #include "cpf.h"
 #include "trace.h"
 #include "appcontype.h"
@@ -63,6 +64,8 @@ EipStatus CipStackInit(const EipUint16 unique_connection_id) {
 #endif
   eip_status = CipQoSInit();
   OPENER_ASSERT(kEipStatusOk == eip_status);
+  eip_status = CipDiagnosticsInit();
+  OPENER_ASSERT(kEipStatusOk == eip_status);
 
 #if defined(CIP_FILE_OBJECT) && 0 != CIP_FILE_OBJECT
   eip_status = CipFileInit();
@@ -82,6 +85,11 @@ EipStatus CipStackInit(const EipUint16 unique_connection_id) {
   eip_status = ApplicationInitialization();
   OPENER_ASSERT(kEipStatusOk == eip_status);
 
+  /* all objects exist now, set up the message router's lookup tables */
+  if(kEipStatusOk != CipMessageRouterBuildDispatchTables() ) {
+    OPENER_TRACE_WARN("Dispatch tables incomplete, using list lookups\n");
+  }
+
   return eip_status;
 }
 
@@ -235,6 +243,7 @@ CipInstance *AddCipInstances(CipClass *RESTRICT const cip_class,
   }
 
   cip_class->max_instance = GetMaxInstanceNumber(cip_class); /* update largest instance number (class Attribute 2) */
+  CipMessageRouterUpdateInstanceTable(cip_class);
 
   if(new_instances != number_of_instances) {
     /* TODO: Free again all attributes and instances allocated so far in this call. */
@@ -255,6 +264,7 @@ CipInstance *AddCipInstance(CipClass *RESTRICT const cip_class,
   if(NULL == instance) { /*we have no instance with given id*/
     instance = AddCipInstances(cip_class, 1);
     instance->instance_number = instance_id;
+    CipMessageRouterUpdateInstanceTable(cip_class); /* the number changed */
   }
 
   cip_class->max_instance = GetMaxInstanceNumber(cip_class); /* update largest instance number (class Attribute 2) */
@@ -420,6 +430,14 @@ void InsertAttribute(CipInstance *const instance,
   /* adding a attribute to a class that was not declared to have any attributes is not allowed */
   for(int i = 0; i < instance->cip_class->number_of_attributes; i++) {
     if(attribute->data == NULL) { /* found non set attribute */
+      /* Keep the set attributes sorted by attribute number so that
+       * GetCipAttribute() can do a binary search. Attributes are mostly
+       * inserted in ascending order, then nothing has to be moved. */
+      while(attribute != instance->attributes &&
+            (attribute - 1)->attribute_number > attribute_number) {
+        *attribute = *(attribute - 1);
+        attribute--;
+      }
       attribute->attribute_number = attribute_number;
       attribute->type = cip_type;
       attribute->encode = encode_function;
@@ -467,6 +485,15 @@ void InsertService(const CipClass *const cip_class,
     if(service->service_number == service_number ||
        service->service_function == NULL)                                              /* found undefined service slot*/
     {
+      /* Keep the set services sorted by service number for the binary
+       * search in GetCipService() */
+      while(service->service_function == NULL &&
+            service != cip_class->services &&
+            (service - 1)->service_number > service_number) {
+        *service = *(service - 1);
+        (service - 1)->service_function = NULL;
+        service--;
+      }
       service->service_number = service_number; /* fill in service number*/
       service->service_function = service_function; /* fill in function address*/
       service->name = service_name;
@@ -500,14 +527,25 @@ void InsertGetSetCallback(CipClass *const cip_class,
 CipAttributeStruct *GetCipAttribute(const CipInstance *const instance,
                                     const EipUint16 attribute_number) {
 
-  CipAttributeStruct *attribute = instance->attributes; /* init pointer to array of attributes*/
-  for(int i = 0; i < instance->cip_class->number_of_attributes; i++) {
-    if(attribute_number == attribute->attribute_number) {
-      return attribute;
+  /* The set attributes are kept sorted by InsertAttribute(), unset ones
+   * (data == NULL) follow at the end of the array */
+  CipAttributeStruct *const attributes = instance->attributes;
+  size_t lower = 0;
+  size_t upper = instance->cip_class->number_of_attributes;
+  while(lower < upper) {
+    const size_t middle = lower + (upper - lower) / 2;
+    if(NULL != attributes[middle].data &&
+       attributes[middle].attribute_number < attribute_number) {
+      lower = middle + 1;
     } else {
-      ++attribute;
+      upper = middle;
     }
   }
+  if(lower < instance->cip_class->number_of_attributes &&
+     NULL != attributes[lower].data &&
+     attribute_number == attributes[lower].attribute_number) {
+    return &attributes[lower];
+  }
 
   OPENER_TRACE_WARN("attribute %d not defined\n", attribute_number);
 
@@ -1060,13 +1098,24 @@ int DecodeCipShortString(CipShortString *data,
 
 CipServiceStruct *GetCipService(const CipInstance *const instance,
                                 CipUsint service_number) {
-  CipServiceStruct *service = instance->cip_class->services;
-  for(size_t i = 0; i < instance->cip_class->number_of_services; i++) /* hunt for the GET_ATTRIBUTE_SINGLE service*/
-  {
-    if(service->service_number == service_number) {
-      return service; /* found the service */
+  /* The set services are kept sorted by InsertService(), unset ones
+   * (service_function == NULL) follow at the end of the array */
+  CipServiceStruct *const services = instance->cip_class->services;
+  size_t lower = 0;
+  size_t upper = instance->cip_class->number_of_services;
+  while(lower < upper) {
+    const size_t middle = lower + (upper - lower) / 2;
+    if(NULL != services[middle].service_function &&
+       services[middle].service_number < service_number) {
+      lower = middle + 1;
+    } else {
+      upper = middle;
     }
-    service++;
+  }
+  if(lower < instance->cip_class->number_of_services &&
+     NULL != services[lower].service_function &&
+     service_number == services[lower].service_number) {
+    return &services[lower]; /* found the service */
   }
   return NULL; /* didn't find the service */
 }
@@ -1155,7 +1204,7 @@ EipStatus GetAttributeList(CipInstance *instance,
           CipSint) );
 
       const int_fast64_t remaining_message_space =
-        (int_fast64_t) PC_OPENER_ETHERNET_BUFFER_SIZE -
+        (int_fast64_t) message_router_response->message.message_buffer_size -
         (int_fast64_t)  message_router_response->message.used_message_length -
         33LL;                                                                                                                                                                   //need 33 bytes extra space for the rest of the ENIP message
       if (needed_message_space > remaining_message_space) {
@@ -1261,7 +1310,7 @@ EipStatus SetAttributeList(CipInstance *instance,
           CipSint) );
 
       const int_fast64_t remaining_message_space =
-        (int_fast64_t) PC_OPENER_ETHERNET_BUFFER_SIZE -
+        (int_fast64_t) message_router_response->message.message_buffer_size -
         (int_fast64_t)  message_router_response->message.used_message_length -
         33LL;                                                                                                                                                                   //need 33 bytes extra space for the rest of the ENIP message
       if (needed_message_space > remaining_message_space) {
@@ -1569,6 +1618,7 @@ EipStatus CipDeleteService(CipInstance *RESTRICT const instance,
                                             recorded by the class - Attr. 3 */
 
     class->max_instance = GetMaxInstanceNumber(class); /* update largest instance number (class Attribute 2) */
+    CipMessageRouterUpdateInstanceTable(class);
 
     message_router_response->general_status = kCipErrorSuccess;
   }
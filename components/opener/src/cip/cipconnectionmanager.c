@@ -28,6 +28,7 @@
 #include "cipepath.h"
 #include "cipelectronickey.h"
 #include "cipqos.h"
+#include "cipdiagnostics.h"
 #include "xorshiftrandom.h"
 
 #if defined(__ESP_PLATFORM__) || defined(ESP_PLATFORM)
@@ -61,6 +62,11 @@ CipConnectionObject g_dummy_connection_object;
 /** @brief Holds the connection ID's "incarnation ID" in the upper 16 bits */
 EipUint32 g_incarnation_id;
 
+/** @brief Hash buckets of the active connection indexes, the buckets are
+ * chained through CipConnectionObject::index_next */
+static CipConnectionObject *g_active_connection_index[
+  kConnectionObjectNumberOfIndexes][OPENER_CONNECTION_INDEX_SIZE];
+
 /** @brief Connection Manager instance statistics */
 typedef struct {
   CipUint open_requests;              /* Attribute 1 */
@@ -71,9 +77,11 @@ typedef struct {
   CipUint close_format_requests;       /* Attribute 6 */
   CipUint close_other_requests;       /* Attribute 7 */
   CipUint connection_timeouts;        /* Attribute 8 */
-  CipUint cpu_utilization;            /* Attribute 11 (0-100, percentage) */
+  CipUint cpu_utilization;            /* Attribute 11 (0-1000, 0.1 %) */
   CipUint max_buff_size;              /* Attribute 12 */
   CipUint buff_size_remaining;       /* Attribute 13 */
+  CipUdint produced_frames;          /* Attribute 100 (vendor specific) */
+  CipUdint produced_payload_copies;  /* Attribute 101 (vendor specific) */
 } ConnectionManagerStatistics;
 
 static ConnectionManagerStatistics g_connection_manager_stats = {0};
@@ -82,7 +90,8 @@ static ConnectionManagerStatistics g_connection_manager_stats = {0};
 static CipUint g_connection_entry_list_dummy = 0;
 
 #ifdef OPENER_ESP32_PORT
-/* CPU utilization reporting disabled; always report 0%. */
+/* Required by CONFIG_FREERTOS_USE_IDLE_HOOK. The CPU utilization is measured
+ * by the network handler loop, see NetworkGetLoadStatistics(). */
 void vApplicationIdleHook(void) { }
 #endif
 
@@ -365,6 +374,22 @@ void InitializeConnectionManager(CipClass *class) {
   InsertAttribute(instance, 13, kCipUint, EncodeCipUint, NULL,
                   (void *)&g_connection_manager_stats.buff_size_remaining,
                   kGetableSingleAndAll);
+  /* Vendor specific: produced I/O frames and the copies of their assembly data
+   * made before the frames are handed to the IP stack */
+  InsertAttribute(instance, 100, kCipUdint, EncodeCipUdint, NULL,
+                  (void *)&g_connection_manager_stats.produced_frames,
+                  kGetableSingle);
+  InsertAttribute(instance, 101, kCipUdint, EncodeCipUdint, NULL,
+                  (void *)&g_connection_manager_stats.produced_payload_copies,
+                  kGetableSingle);
+  /* Vendor specific: peak usage and exhaustions of the connection list node
+   * pool, to size the connection pools from measured peaks */
+  InsertAttribute(instance, 102, kCipUdint, EncodeCipUdint, NULL,
+                  (void *)&CipConnectionObjectGetListNodePool()->high_water_mark,
+                  kGetableSingle);
+  InsertAttribute(instance, 103, kCipUdint, EncodeCipUdint, NULL,
+                  (void *)&CipConnectionObjectGetListNodePool()->number_of_exhaustions,
+                  kGetableSingle);
 
   InsertService(meta_class,
                 kGetAttributeAll,
@@ -384,8 +409,8 @@ EipStatus ConnectionManagerInit(EipUint16 unique_connection_id) {
                                                 0, /* # of class attributes */
                                                 7, /* # highest class attribute number*/
                                                 2, /* # of class services */
-                                                13, /* # of instance attributes */
-                                                14, /* # highest instance attribute number*/
+                                                17, /* # of instance attributes */
+                                                103, /* # highest instance attribute number*/
                                                 8, /* # of instance services */
                                                 1, /* # of instances */
                                                 "connection manager", /* class name */
@@ -1069,7 +1094,7 @@ void AssembleConnectionDataResponseMessage(
   AddDintToMessage(connection_object->o_to_t_requested_packet_interval,
                    &message_router_response->message);
   // Originator API O->T UDINT
-  AddDintToMessage(connection_object->transmission_trigger_timer,
+  AddDintToMessage(connection_object->o_to_t_requested_packet_interval,
                    &message_router_response->message);
   // Originator T->O CID UDINT
   AddDintToMessage(connection_object->cip_produced_connection_id,
@@ -1090,94 +1115,213 @@ void AssembleConnectionDataResponseMessage(
   AddDintToMessage(connection_object->t_to_o_requested_packet_interval,
                    &message_router_response->message);
   // Originator API T->O UDINT
-  AddDintToMessage(connection_object->transmission_trigger_timer,
+  AddDintToMessage(ConnectionObjectGetTToOActualPacketInterval(connection_object),
                    &message_router_response->message);
 }
 
+/** @brief Checks if the inactivity watchdog of the connection has to be supervised
+ *
+ * @param connection_object The connection to check
+ * @return true for consuming and all server connections
+ */
+static bool ConnectionHasInactivityWatchdog(
+  const CipConnectionObject *const connection_object) {
+  return (NULL != connection_object->consuming_instance) || /* we have a consuming connection check inactivity watchdog timer */
+         (kConnectionObjectTransportClassTriggerDirectionServer ==
+          ConnectionObjectGetTransportClassTriggerDirection(connection_object) ); /* all server connections have to maintain an inactivity watchdog timer */
+}
+
+/** @brief Checks if the connection produces data
+ *
+ * @param connection_object The connection to check
+ * @return true if the connection is the producing master connection
+ */
+static bool ConnectionIsProducing(
+  const CipConnectionObject *const connection_object) {
+  return (0 != ConnectionObjectGetExpectedPacketRate(connection_object) )
+         && (kEipInvalidSocket !=
+             connection_object->socket[kUdpCommuncationDirectionProducing]); /* only produce for the master connection */
+}
+
+/** @brief Checks if the production of the connection is triggered by the application
+ *
+ * @param connection_object The connection to check
+ * @return true for change-of-state and application triggered connections
+ */
+static bool ConnectionIsApplicationTriggered(
+  const CipConnectionObject *const connection_object) {
+  const ConnectionObjectTransportClassTriggerProductionTrigger trigger =
+    ConnectionObjectGetTransportClassTriggerProductionTrigger(connection_object);
+  return (kConnectionObjectTransportClassTriggerProductionTriggerChangeOfState
+          == trigger) ||
+         (kConnectionObjectTransportClassTriggerProductionTriggerApplicationObject
+          == trigger);
+}
+
+/** @brief Move the next production of the connection to the next allowed occurrence
+ *
+ * That is now, or the end of the production inhibit time if it has not passed
+ * yet. The heartbeat at the RPI follows from there, see HandleConnectionTimer().
+ *
+ * @param connection_object The connection to be produced
+ */
+static void ScheduleTriggeredProduction(
+  CipConnectionObject *const connection_object) {
+  MilliSeconds deadline = g_actual_time;
+  if( !TimerQueueDeadlineReached(
+        connection_object->production_inhibit_deadline, deadline) ) {
+    deadline = connection_object->production_inhibit_deadline;
+  }
+  if( !TimerQueueDeadlineReached(
+        connection_object->transmission_trigger_deadline, deadline) ) {
+    connection_object->transmission_trigger_deadline = deadline;
+    UpdateConnectionTimer(connection_object);
+  }
+}
+
+/** @brief Schedule the production of all triggered connections whose assembly changed
+ *
+ * Runs only if an assembly was marked as changed since the last call.
+ */
+static void TriggerChangedConnections(void) {
+  if( !AssemblyTakeChangeNotification() ) {
+    return;
+  }
+
+  DoublyLinkedListNode *node = connection_list.first;
+  while(NULL != node) {
+    CipConnectionObject *connection_object = node->data;
+    if( (kConnectionObjectStateEstablished ==
+         ConnectionObjectGetState(connection_object) ) &&
+        (NULL != connection_object->producing_instance) &&
+        ConnectionIsProducing(connection_object) &&
+        ConnectionIsApplicationTriggered(connection_object) &&
+        (connection_object->produced_data_revision !=
+         AssemblyGetDataRevision(connection_object->producing_instance) ) ) {
+      ScheduleTriggeredProduction(connection_object);
+    }
+    node = node->next;
+  }
+}
+
 EipStatus ManageConnections(MilliSeconds elapsed_time) {
   //OPENER_TRACE_INFO("Entering ManageConnections\n");
   /*Inform application that it can execute */
   HandleApplication();
+  TriggerChangedConnections();
   ManageEncapsulationMessages(elapsed_time);
 
-  DoublyLinkedListNode *node = connection_list.first;
+  /* The connection timers are not decremented here anymore, every established
+   * connection has its own entry in the network handler's deadline queue, see
+   * HandleConnectionTimer() */
+  return kEipStatusOk;
+}
 
-  while(NULL != node) {
-    //OPENER_TRACE_INFO("Entering Connection Object loop\n");
-    CipConnectionObject *connection_object = node->data;
-    if(kConnectionObjectStateEstablished ==
-       ConnectionObjectGetState(connection_object) ) {
-      if( (NULL != connection_object->consuming_instance) || /* we have a consuming connection check inactivity watchdog timer */
-          (kConnectionObjectTransportClassTriggerDirectionServer ==
-           ConnectionObjectGetTransportClassTriggerDirection(connection_object) ) ) /* all server connections have to maintain an inactivity watchdog timer */
-      {
-        if(elapsed_time >= connection_object->inactivity_watchdog_timer) {
-          /* we have a timed out connection perform watchdog time out action*/
-          OPENER_TRACE_INFO(">>>>>>>>>>Connection ConnNr: %u timed out\n",
-                            connection_object->connection_serial_number);
-          g_connection_manager_stats.connection_timeouts++;  /* Increment timeout counter */
-          OPENER_ASSERT(NULL != connection_object->connection_timeout_function);
-          connection_object->connection_timeout_function(connection_object);
-        } else {
-          connection_object->inactivity_watchdog_timer -= elapsed_time;
-          connection_object->last_package_watchdog_timer -= elapsed_time;
-        }
-      }
-      /* only if the connection has not timed out check if data is to be send */
-      if(kConnectionObjectStateEstablished ==
-         ConnectionObjectGetState(connection_object) ) {
-        /* client connection */
-        if( (0 != ConnectionObjectGetExpectedPacketRate(connection_object) )
-            && (kEipInvalidSocket !=
-                connection_object->socket[kUdpCommuncationDirectionProducing]) ) /* only produce for the master connection */
-        {
-          if(kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
-             ConnectionObjectGetTransportClassTriggerProductionTrigger(
-               connection_object) ) {
-            /* non cyclic connections have to decrement production inhibit timer */
-            if(elapsed_time <= connection_object->production_inhibit_timer) {
-              //The connection is allowed to send again
-            } else {
-              connection_object->production_inhibit_timer -= elapsed_time;
-            }
-          }
+/** @brief Timer queue callback processing the expired deadlines of a connection
+ *
+ * The watchdog deadlines are moved on every received package without touching
+ * the queue, so the timer may fire early. Then it is just rescheduled.
+ *
+ * @param timer The connection_timer of the connection
+ * @param actual_time Current time
+ */
+static void HandleConnectionTimer(TimerQueueEntry *const timer,
+                                  const MilliSeconds actual_time) {
+  CipConnectionObject *const connection_object = timer->data;
 
-          if(connection_object->transmission_trigger_timer <= elapsed_time) { /* need to send package */
-            OPENER_ASSERT(
-              NULL != connection_object->connection_send_data_function);
-            EipStatus eip_status =
-              connection_object->connection_send_data_function(connection_object);
-            if(eip_status == kEipStatusError) {
-              OPENER_TRACE_ERR(
-                "sending of UDP data in manage Connection failed\n");
-            }
-            /* add the RPI to the timer value */
-            connection_object->transmission_trigger_timer +=
-              ConnectionObjectGetRequestedPacketInterval(connection_object);
-            /* decrecment the elapsed time from timer value, if less than timer value */
-            if (connection_object->transmission_trigger_timer > elapsed_time) {
-              connection_object->transmission_trigger_timer -= elapsed_time;
-            } else {  /* elapsed time was longer than RPI */
-              connection_object->transmission_trigger_timer = 0;
-              OPENER_TRACE_INFO("elapsed time: %lu ms was longer than RPI: %u ms\n",
-                                elapsed_time,
-                                ConnectionObjectGetRequestedPacketInterval(connection_object));
-            }
-            if(kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
-               ConnectionObjectGetTransportClassTriggerProductionTrigger(
-                 connection_object) ) {
-              /* non cyclic connections have to reload the production inhibit timer */
-              ConnectionObjectResetProductionInhibitTimer(connection_object);
-            }
-          } else {
-            connection_object->transmission_trigger_timer -= elapsed_time;
-          }
-        }
-      }
+  if(kConnectionObjectStateEstablished !=
+     ConnectionObjectGetState(connection_object) ) {
+    return;
+  }
+
+  if( ConnectionHasInactivityWatchdog(connection_object) &&
+      TimerQueueDeadlineReached(connection_object->inactivity_watchdog_deadline,
+                                actual_time) ) {
+    /* we have a timed out connection perform watchdog time out action*/
+    OPENER_TRACE_INFO(">>>>>>>>>>Connection ConnNr: %u timed out\n",
+                      connection_object->connection_serial_number);
+    g_connection_manager_stats.connection_timeouts++;  /* Increment timeout counter */
+    OPENER_ASSERT(NULL != connection_object->connection_timeout_function);
+    connection_object->connection_timeout_function(connection_object);
+  }
+
+  /* only if the connection has not timed out check if data is to be send */
+  if( (kConnectionObjectStateEstablished ==
+       ConnectionObjectGetState(connection_object) )
+      && ConnectionIsProducing(connection_object)
+      && TimerQueueDeadlineReached(
+        connection_object->transmission_trigger_deadline, actual_time) ) {
+    OPENER_ASSERT(NULL != connection_object->connection_send_data_function);
+    EipStatus eip_status =
+      connection_object->connection_send_data_function(connection_object);
+    if(eip_status == kEipStatusError) {
+      OPENER_TRACE_ERR("sending of UDP data in manage Connection failed\n");
+    } else {
+      CipDiagnosticsRecordProduction(connection_object,
+                                     connection_object->transmission_trigger_deadline);
+    }
+
+    /* add the RPI to the deadline, this keeps the phase of the production */
+    MilliSeconds requested_packet_interval =
+      connection_object->production_interval;
+    if(0 == requested_packet_interval) {
+      requested_packet_interval = kOpenerTimerTickInMilliSeconds;
+    }
+    MilliSeconds next_deadline =
+      connection_object->transmission_trigger_deadline +
+      requested_packet_interval;
+    if( TimerQueueDeadlineReached(next_deadline, actual_time) ) {
+      /* we were late for more than one RPI, skip the missed productions but stay on the RPI grid */
+      const MilliSeconds missed_intervals = (actual_time - next_deadline) /
+                                            requested_packet_interval + 1;
+      OPENER_TRACE_INFO("production was late by %lu ms, RPI: %lu ms\n",
+                        (unsigned long) (actual_time -
+                                         connection_object->transmission_trigger_deadline),
+                        (unsigned long) requested_packet_interval);
+      next_deadline += missed_intervals * requested_packet_interval;
+    }
+    connection_object->transmission_trigger_deadline = next_deadline;
+
+    if(kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
+       ConnectionObjectGetTransportClassTriggerProductionTrigger(
+         connection_object) ) {
+      /* non cyclic connections have to reload the production inhibit timer */
+      ConnectionObjectResetProductionInhibitTimer(connection_object);
     }
-    node = node->next;
   }
-  return kEipStatusOk;
+
+  UpdateConnectionTimer(connection_object);
+}
+
+void UpdateConnectionTimer(CipConnectionObject *const connection_object) {
+  if(kConnectionObjectStateEstablished !=
+     ConnectionObjectGetState(connection_object) ) {
+    NetworkHandlerCancelTimer(&connection_object->connection_timer);
+    return;
+  }
+
+  bool has_deadline = false;
+  MilliSeconds deadline = 0;
+  if( ConnectionHasInactivityWatchdog(connection_object) ) {
+    deadline = connection_object->inactivity_watchdog_deadline;
+    has_deadline = true;
+  }
+  if( ConnectionIsProducing(connection_object) ) {
+    if( !has_deadline ||
+        !TimerQueueDeadlineReached(deadline,
+                                   connection_object->transmission_trigger_deadline) )
+    {
+      deadline = connection_object->transmission_trigger_deadline;
+    }
+    has_deadline = true;
+  }
+
+  if(has_deadline) {
+    NetworkHandlerScheduleTimer(&connection_object->connection_timer,
+                                deadline);
+  } else {
+    NetworkHandlerCancelTimer(&connection_object->connection_timer);
+  }
 }
 
 /** @brief Assembles the Forward Open Response
@@ -1283,10 +1427,11 @@ EipStatus AssembleForwardOpenResponse(CipConnectionObject *connection_object,
                    &message_router_response->message);
 
   if(kCipErrorSuccess == general_status) {
-    /* set the actual packet rate to requested packet rate */
+    /* actual packet intervals, T->O as produced with millisecond resolution */
     AddDintToMessage(connection_object->o_to_t_requested_packet_interval,
                      &message_router_response->message);
-    AddDintToMessage(connection_object->t_to_o_requested_packet_interval,
+    AddDintToMessage(ConnectionObjectGetTToOActualPacketInterval(
+                       connection_object),
                      &message_router_response->message);
   }
 
@@ -1370,37 +1515,147 @@ EipStatus AssembleForwardCloseResponse(EipUint16 connection_serial_number,
   return kEipStatusOkSend;
 }
 
+/** @brief Calculates the key of a connection in one of the active connection indexes
+ *
+ *  @param connection_object The connection to calculate the key for
+ *  @param index The index the key is used for
+ *  @return The key, equal connections in the sense of the index have equal keys
+ */
+static CipUdint ConnectionIndexGetKey(
+  const CipConnectionObject *const connection_object,
+  const ConnectionObjectIndex index) {
+  switch(index) {
+    case kConnectionObjectIndexConsumedConnectionId:
+      return ConnectionObjectGetCipConsumedConnectionID(connection_object);
+    case kConnectionObjectIndexConnectionTriad:
+      return connection_object->originator_serial_number ^
+             ( (CipUdint) connection_object->originator_vendor_id << 16 ) ^
+             connection_object->connection_serial_number;
+    case kConnectionObjectIndexProducedInstance:
+      return connection_object->produced_path.instance_id;
+    default:
+      OPENER_ASSERT(false);
+      return 0;
+  }
+}
+
+/** @brief Returns the head of the hash bucket of a key
+ *
+ *  @param index The index to look up
+ *  @param key The key as returned by ConnectionIndexGetKey()
+ *  @return Pointer to the first connection of the bucket
+ */
+static CipConnectionObject **ConnectionIndexGetBucket(
+  const ConnectionObjectIndex index,
+  const CipUdint key) {
+  /* multiplicative hashing, connection IDs differ in the upper bits too */
+  const CipUdint hash = (CipUdint) (key * 2654435761U);
+  return &g_active_connection_index[index][(hash >> 16) %
+                                           OPENER_CONNECTION_INDEX_SIZE];
+}
+
+/** @brief Adds a connection to all active connection indexes
+ *
+ *  The connection is inserted at the head of the buckets, so the lookups find
+ *  the most recently added of several matching connections, like a walk of the
+ *  active connection list does.
+ *
+ *  @param connection_object The connection to be added
+ */
+static void ConnectionIndexInsert(CipConnectionObject *const connection_object)
+{
+  for(ConnectionObjectIndex index = 0; index < kConnectionObjectNumberOfIndexes;
+      index++) {
+    CipConnectionObject **const bucket = ConnectionIndexGetBucket(index,
+                                                                  ConnectionIndexGetKey(
+                                                                    connection_object,
+                                                                    index) );
+    connection_object->index_next[index] = *bucket;
+    *bucket = connection_object;
+  }
+}
+
+/** @brief Unlinks a connection from one hash bucket
+ *
+ *  @param link The head of the bucket
+ *  @param connection_object The connection to be unlinked
+ *  @param index The index the bucket belongs to
+ *  @return true if the connection has been found in the bucket
+ */
+static bool ConnectionIndexUnlink(CipConnectionObject **link,
+                                  const CipConnectionObject *const connection_object,
+                                  const ConnectionObjectIndex index) {
+  for(; NULL != *link; link = &( (*link)->index_next[index] ) ) {
+    if(connection_object == *link) {
+      *link = connection_object->index_next[index];
+      return true;
+    }
+  }
+  return false;
+}
+
+/** @brief Removes a connection from all active connection indexes
+ *
+ *  @param connection_object The connection to be removed
+ */
+static void ConnectionIndexRemove(CipConnectionObject *const connection_object)
+{
+  for(ConnectionObjectIndex index = 0; index < kConnectionObjectNumberOfIndexes;
+      index++) {
+    if( !ConnectionIndexUnlink(ConnectionIndexGetBucket(index,
+                                                        ConnectionIndexGetKey(
+                                                          connection_object,
+                                                          index) ),
+                               connection_object, index) ) {
+      /* the key has been changed while the connection was active, search all
+       * buckets so no dangling entry remains */
+      OPENER_TRACE_WARN("Connection not found in its index bucket\n");
+      for(size_t i = 0; i < OPENER_CONNECTION_INDEX_SIZE; i++) {
+        if( ConnectionIndexUnlink(&g_active_connection_index[index][i],
+                                  connection_object, index) ) {
+          break;
+        }
+      }
+    }
+    connection_object->index_next[index] = NULL;
+  }
+}
+
 CipConnectionObject *GetConnectedObject(const EipUint32 connection_id) {
-  DoublyLinkedListNode *iterator = connection_list.first;
+  CipConnectionObject *iterator = *ConnectionIndexGetBucket(
+    kConnectionObjectIndexConsumedConnectionId,
+    connection_id);
 
   while(NULL != iterator) {
     if(kConnectionObjectStateEstablished ==
-       ConnectionObjectGetState(iterator->data)
+       ConnectionObjectGetState(iterator)
        && connection_id ==
-       ConnectionObjectGetCipConsumedConnectionID(iterator->data) ) {
-      return iterator->data;
+       ConnectionObjectGetCipConsumedConnectionID(iterator) ) {
+      return iterator;
     }
-    iterator = iterator->next;
+    iterator =
+      iterator->index_next[kConnectionObjectIndexConsumedConnectionId];
   }
   return NULL;
 }
 
 CipConnectionObject *GetConnectedOutputAssembly(
   const EipUint32 output_assembly_id) {
-  DoublyLinkedListNode *iterator = connection_list.first;
+  CipConnectionObject *iterator = *ConnectionIndexGetBucket(
+    kConnectionObjectIndexProducedInstance,
+    output_assembly_id);
 
   while(NULL != iterator) {
     if(kConnectionObjectInstanceTypeIOExclusiveOwner ==
-       ConnectionObjectGetInstanceType(iterator->data)
+       ConnectionObjectGetInstanceType(iterator)
        && (kConnectionObjectStateEstablished ==
-           ConnectionObjectGetState(iterator->data)
+           ConnectionObjectGetState(iterator)
            || kConnectionObjectStateTimedOut ==
-           ConnectionObjectGetState(iterator->data) )
-       && output_assembly_id ==
-       ( (CipConnectionObject *) iterator->data )->produced_path.instance_id) {
-      return iterator->data;
+           ConnectionObjectGetState(iterator) )
+       && output_assembly_id == iterator->produced_path.instance_id) {
+      return iterator;
     }
-    iterator = iterator->next;
+    iterator = iterator->index_next[kConnectionObjectIndexProducedInstance];
   }
   return NULL;
 }
@@ -1408,16 +1663,19 @@ CipConnectionObject *GetConnectedOutputAssembly(
 CipConnectionObject *CheckForExistingConnection(
   const CipConnectionObject *const connection_object) {
 
-  DoublyLinkedListNode *iterator = connection_list.first;
+  CipConnectionObject *iterator = *ConnectionIndexGetBucket(
+    kConnectionObjectIndexConnectionTriad,
+    ConnectionIndexGetKey(connection_object,
+                          kConnectionObjectIndexConnectionTriad) );
 
   while(NULL != iterator) {
     if(kConnectionObjectStateEstablished ==
-       ConnectionObjectGetState(iterator->data) ) {
-      if(EqualConnectionTriad(connection_object, iterator->data) ) {
-        return iterator->data;
+       ConnectionObjectGetState(iterator) ) {
+      if(EqualConnectionTriad(connection_object, iterator) ) {
+        return iterator;
       }
     }
-    iterator = iterator->next;
+    iterator = iterator->index_next[kConnectionObjectIndexConnectionTriad];
   }
 
   return NULL;
@@ -1852,11 +2110,10 @@ void CloseConnection(CipConnectionObject *RESTRICT connection_object) {
   if(kConnectionObjectTransportClassTriggerTransportClass3 !=
      ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
   {
-    /* only close the UDP connection for not class 3 connections */
-    CloseUdpSocket(connection_object->socket[kUdpCommuncationDirectionConsuming]);
+    /* the IO messaging socket is shared by all IO connections and stays
+     * open, the connection only drops its reference */
     connection_object->socket[kUdpCommuncationDirectionConsuming] =
       kEipInvalidSocket;
-    CloseUdpSocket(connection_object->socket[kUdpCommuncationDirectionProducing]);
     connection_object->socket[kUdpCommuncationDirectionProducing] =
       kEipInvalidSocket;
   }
@@ -1865,17 +2122,30 @@ void CloseConnection(CipConnectionObject *RESTRICT connection_object) {
 
 }
 
-void AddNewActiveConnection(CipConnectionObject *const connection_object) {
-  DoublyLinkedListInsertAtHead(&connection_list, connection_object);
+EipStatus AddNewActiveConnection(CipConnectionObject *const connection_object)
+{
+  if(NULL == DoublyLinkedListInsertAtHead(&connection_list,
+                                          connection_object) ) {
+    OPENER_TRACE_ERR("No free node in the active connection list\n");
+    return kEipStatusError;
+  }
+  /* the index keys must not change while the connection is active */
+  ConnectionIndexInsert(connection_object);
   ConnectionObjectSetState(connection_object,
                            kConnectionObjectStateEstablished);
+  TimerQueueEntryInitialize(&connection_object->connection_timer,
+                            HandleConnectionTimer, connection_object);
+  UpdateConnectionTimer(connection_object);
+  return kEipStatusOk;
 }
 
 void RemoveFromActiveConnections(CipConnectionObject *const connection_object) {
+  NetworkHandlerCancelTimer(&connection_object->connection_timer);
   for(DoublyLinkedListNode *iterator = connection_list.first; iterator != NULL;
       iterator = iterator->next) {
     if(iterator->data == connection_object) {
       DoublyLinkedListRemoveNode(&connection_list, &iterator);
+      ConnectionIndexRemove(connection_object);
       return;
     }
   } OPENER_TRACE_ERR("Connection not found in active connection list\n");
@@ -1942,17 +2212,11 @@ EipStatus TriggerConnections(unsigned int output_assembly,
   while(NULL != node) {
     CipConnectionObject *connection_object = node->data;
     if( (output_assembly == connection_object->consumed_path.instance_id) &&
-        (input_assembly == connection_object->produced_path.instance_id) ) {
-      if(
-        kConnectionObjectTransportClassTriggerProductionTriggerApplicationObject
-        == ConnectionObjectGetTransportClassTriggerProductionTrigger(
-          connection_object) ) {
-        /* produce at the next allowed occurrence */
-        connection_object->transmission_trigger_timer =
-          connection_object->production_inhibit_time;
-        status = kEipStatusOk;
-      }
-      break;
+        (input_assembly == connection_object->produced_path.instance_id) &&
+        ConnectionIsApplicationTriggered(connection_object) ) {
+      /* several connections may use the same pair of connection points */
+      ScheduleTriggeredProduction(connection_object);
+      status = kEipStatusOk;
     }
     node = node->next;
   }
@@ -1983,10 +2247,22 @@ void CheckForTimedOutConnectionsAndCloseTCPConnections(
   }
 }
 
+void ConnectionManagerSetCpuUtilization(const CipUint utilization) {
+  g_connection_manager_stats.cpu_utilization = utilization;
+}
+
+void ConnectionManagerCountProducedFrame(
+  const CipUint number_of_payload_copies) {
+  g_connection_manager_stats.produced_frames++;
+  g_connection_manager_stats.produced_payload_copies +=
+    number_of_payload_copies;
+}
+
 void InitializeConnectionManagerData() {
   memset(g_connection_management_list,
          0,
          g_kNumberOfConnectableObjects * sizeof(ConnectionManagementHandling) );
+  memset(g_active_connection_index, 0, sizeof(g_active_connection_index) );
   InitializeClass3ConnectionData();
   InitializeIoConnectionData();
   
@@ -1995,6 +2271,4 @@ void InitializeConnectionManagerData() {
   g_connection_manager_stats.max_buff_size = 4096;  /* 4KB typical buffer size */
   g_connection_manager_stats.buff_size_remaining = 4096;
   g_connection_manager_stats.cpu_utilization = 0;
-  
-  /* CPU utilization reporting disabled; attribute remains 0 */
 }
@@ -159,6 +159,15 @@ typedef enum {
 #define SEQ_LEQ16(a, b) ( (short)( (a) - (b) ) <= 0 )
 #define SEQ_GEQ16(a, b) ( (short)( (a) - (b) ) >= 0 )
 
+/** @brief Number of hash buckets of each active connection index
+ *
+ * The indexes are used to look up the connection of a received I/O datagram
+ * and to check a Forward_Open for duplicates without walking all connections.
+ */
+#ifndef OPENER_CONNECTION_INDEX_SIZE
+#define OPENER_CONNECTION_INDEX_SIZE 32
+#endif
+
 /** @brief Connection Manager class code */
 static const CipUint kCipConnectionManagerClassCode = 0x06U;
 
@@ -209,8 +218,10 @@ EipBool8 IsConnectedOutputAssembly(const CipInstanceNum instance_number);
  * production inhibit, etc).
  *
  * @param connection_object pointer to the connection object to be added.
+ * @return kEipStatusOk on success, kEipStatusError if no connection list node
+ * is left
  */
-void AddNewActiveConnection(CipConnectionObject *const connection_object);
+EipStatus AddNewActiveConnection(CipConnectionObject *const connection_object);
 
 /** @brief Removes connection from the list of active connections
  *
@@ -218,6 +229,30 @@ void AddNewActiveConnection(CipConnectionObject *const connection_object);
  */
 void RemoveFromActiveConnections(CipConnectionObject *const connection_object);
 
+/** @brief (Re)schedule the timer of an established connection to its earliest deadline
+ *
+ * Has to be called whenever the transmission trigger deadline is moved to an
+ * earlier point in time or the producing socket of the connection changes.
+ * Cancels the timer if the connection is not established.
+ *
+ * @param connection_object The connection whose deadlines changed
+ */
+void UpdateConnectionTimer(CipConnectionObject *const connection_object);
+
+/** @brief Sets the CPU utilization reported in attribute 11
+ *
+ * @param utilization Utilization of the OpENer task in 0.1 % (0-1000)
+ */
+void ConnectionManagerSetCpuUtilization(const CipUint utilization);
+
+/** @brief Counts a produced I/O frame in the connection manager statistics
+ *
+ * @param number_of_payload_copies Copies of the assembly data made before the
+ * frame was handed to the IP stack
+ */
+void ConnectionManagerCountProducedFrame(
+  const CipUint number_of_payload_copies);
+
 
 CipUdint GetConnectionId(void);
 
@@ -11,6 +11,7 @@
 #include "endianconv.h"
 #include "trace.h"
 #include "cipconnectionmanager.h"
+#include "generic_networkhandler.h"
 #include "stdlib.h"
 
 #define CIP_CONNECTION_OBJECT_STATE_NON_EXISTENT 0U
@@ -60,28 +61,38 @@ DoublyLinkedList connection_list;
 CipConnectionObject explicit_connection_object_pool[
   OPENER_CIP_NUM_EXPLICIT_CONNS];
 
-DoublyLinkedListNode *CipConnectionObjectListArrayAllocator() {
-  enum {
-    kNodesAmount = OPENER_CIP_NUM_EXPLICIT_CONNS +
-                   OPENER_CIP_NUM_INPUT_ONLY_CONNS +
-                   OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS +
-                   OPENER_CIP_NUM_LISTEN_ONLY_CONNS
-  };
-  static DoublyLinkedListNode nodes[kNodesAmount] = { 0 };
-  for(size_t i = 0; i < kNodesAmount; ++i) {
-    if(nodes[i].previous == NULL && nodes[i].next == NULL &&
-       nodes[i].data == NULL) {
-      return &nodes[i];
-    }
+/** @brief Number of connection list nodes, one per connection of any type */
+enum {
+  kConnectionListNodesAmount = OPENER_CIP_NUM_EXPLICIT_CONNS +
+                               OPENER_CIP_NUM_INPUT_ONLY_CONNS +
+                               OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS +
+                               OPENER_CIP_NUM_LISTEN_ONLY_CONNS
+};
+
+static DoublyLinkedListNode g_connection_list_nodes[kConnectionListNodesAmount];
+
+/** @brief Slab handing out the nodes of the connection list */
+static SlabAllocator g_connection_list_node_pool;
+
+SlabAllocator *CipConnectionObjectGetListNodePool(void) {
+  if(NULL == g_connection_list_node_pool.storage) {
+    SlabAllocatorInitialize(&g_connection_list_node_pool,
+                            g_connection_list_nodes,
+                            sizeof(g_connection_list_nodes[0]),
+                            kConnectionListNodesAmount);
   }
-  return NULL;
+  return &g_connection_list_node_pool;
+}
+
+DoublyLinkedListNode *CipConnectionObjectListArrayAllocator() {
+  return SlabAllocatorAllocate( CipConnectionObjectGetListNodePool() );
 }
 
 void CipConnectionObjectListArrayFree(DoublyLinkedListNode **node) {
 
   if(NULL != node) {
     if(NULL != *node) {
-      memset(*node, 0, sizeof(DoublyLinkedListNode) );
+      SlabAllocatorFree(CipConnectionObjectGetListNodePool(), *node);
       *node = NULL;
     } else {
       OPENER_TRACE_ERR("Attempt to delete NULL pointer to node\n");
@@ -444,16 +455,20 @@ CipUint ConnectionObjectGetExpectedPacketRate(
 
 CipUint ConnectionObjectGetRequestedPacketInterval(
   const CipConnectionObject *const connection_object) {
-  CipUdint remainder_to_resolution =
-    (connection_object->t_to_o_requested_packet_interval) %
-    (kOpenerTimerTickInMilliSeconds * 1000);
-  if(0 == remainder_to_resolution) { /* Value can be represented in multiples of the timer resolution */
-    return (CipUint) (connection_object->t_to_o_requested_packet_interval /
-                      1000);
-  } else {
-    return (CipUint) (connection_object->t_to_o_requested_packet_interval /
-                      1000 - remainder_to_resolution / 1000);
+  CipUdint interval = connection_object->t_to_o_requested_packet_interval /
+                      1000;
+  if(0 == interval) {
+    interval = 1;
+  } else if(interval > UINT16_MAX) {
+    interval = UINT16_MAX;
   }
+  return (CipUint) interval;
+}
+
+CipUdint ConnectionObjectGetTToOActualPacketInterval(
+  const CipConnectionObject *const connection_object) {
+  return (CipUdint) ConnectionObjectGetRequestedPacketInterval(
+    connection_object) * 1000;
 }
 
 void ConnectionObjectSetExpectedPacketRate(
@@ -588,24 +603,30 @@ void ConnectionObjectSetInitialInactivityWatchdogTimerValue(
   const uint64_t calculated_timeout_value =
     ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
       connection_object);
-  connection_object->inactivity_watchdog_timer =
+  const uint64_t timeout_value =
     (calculated_timeout_value >
      kMinimumInitialTimeoutValue) ? calculated_timeout_value :
     kMinimumInitialTimeoutValue;
+  connection_object->inactivity_watchdog_deadline = g_actual_time +
+                                                    (MilliSeconds) timeout_value;
 }
 
 void ConnectionObjectResetInactivityWatchdogTimerValue(
   CipConnectionObject *const connection_object) {
-  connection_object->inactivity_watchdog_timer =
+  const uint64_t timeout_value =
     ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
       connection_object);
+  connection_object->inactivity_watchdog_deadline = g_actual_time +
+                                                    (MilliSeconds) timeout_value;
 }
 
 void ConnectionObjectResetLastPackageInactivityTimerValue(
   CipConnectionObject *const connection_object) {
-  connection_object->last_package_watchdog_timer =
+  const uint64_t timeout_value =
     ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
       connection_object);
+  connection_object->last_package_watchdog_deadline = g_actual_time +
+                                                      (MilliSeconds) timeout_value;
 }
 
 uint64_t ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
@@ -912,8 +933,8 @@ void ConnectionObjectResetSequenceCounts(
 
 void ConnectionObjectResetProductionInhibitTimer(
   CipConnectionObject *const connection_object) {
-  connection_object->production_inhibit_timer =
-    connection_object->production_inhibit_time;
+  connection_object->production_inhibit_deadline = g_actual_time +
+                                                   connection_object->production_inhibit_time;
 }
 
 void ConnectionObjectGeneralConfiguration(
@@ -947,7 +968,10 @@ void ConnectionObjectGeneralConfiguration(
 
   ConnectionObjectResetProductionInhibitTimer(connection_object);
 
-  connection_object->transmission_trigger_timer = 0;
+  /* produce right after the connection has been established */
+  connection_object->transmission_trigger_deadline = g_actual_time;
+  connection_object->production_interval =
+    ConnectionObjectGetRequestedPacketInterval(connection_object);
 }
 
 bool ConnectionObjectEqualOriginator(const CipConnectionObject *const object1,
@@ -14,6 +14,8 @@
 #include "doublylinkedlist.h"
 #include "cipelectronickey.h"
 #include "cipepath.h"
+#include "timerqueue.h"
+#include "slaballocator.h"
 
 #define CIP_CONNECTION_OBJECT_CODE 0x05
 
@@ -96,8 +98,37 @@ typedef enum {
   kConnectionObjectSocketTypeConsuming = 1
 } ConnectionObjectSocketType;
 
+/** @brief Maximum length of the header of a produced I/O frame: item count,
+ * sequenced address item, connected data item header, sequence count and
+ * run/idle header */
+#define kConnectionObjectProducedFrameHeaderMaximumLength 24
+
+/** @brief Pre-built header of the produced (T->O) I/O frame
+ *
+ * The header only depends on parameters fixed at connection establishment, so
+ * it is built once and only the variable parts are patched for every
+ * production. An offset of 0 means the field is not part of the frame.
+ */
+typedef struct {
+  CipOctet header[kConnectionObjectProducedFrameHeaderMaximumLength];
+  CipUint header_length; /**< 0 if the template has not been built yet */
+  CipUint payload_length; /**< assembly data length the template was built for */
+  CipBool has_run_idle_header; /**< run/idle header setting the template was built for */
+  CipUint eip_sequence_offset; /**< sequence number of the sequenced address item */
+  CipUint cip_sequence_offset; /**< class 1 sequence count */
+  CipUint run_idle_offset; /**< 32 bit run/idle header */
+} CipConnectionProducedFrameTemplate;
+
 typedef struct cip_connection_object CipConnectionObject;
 
+/** @brief Hash indexes over the active connections, see AddNewActiveConnection() */
+typedef enum {
+  kConnectionObjectIndexConsumedConnectionId = 0, /**< keyed by the CIP consumed connection ID */
+  kConnectionObjectIndexConnectionTriad, /**< keyed by the connection triad */
+  kConnectionObjectIndexProducedInstance, /**< keyed by the produced assembly instance */
+  kConnectionObjectNumberOfIndexes
+} ConnectionObjectIndex;
+
 typedef EipStatus (*CipConnectionStateHandler)(CipConnectionObject *RESTRICT
                                                const connection_object,
                                                ConnectionObjectState new_state);
@@ -135,10 +166,22 @@ struct cip_connection_object {
   CipUint requested_produced_connection_size;
   CipUint requested_consumed_connection_size;
 
-  uint64_t transmission_trigger_timer;
-  uint64_t inactivity_watchdog_timer;
-  uint64_t last_package_watchdog_timer;
-  uint64_t production_inhibit_timer;
+  /* Absolute deadlines based on GetMilliSeconds(), compared with TimerQueueDeadlineReached() */
+  MilliSeconds transmission_trigger_deadline; /**< next production of the connection */
+  MilliSeconds inactivity_watchdog_deadline; /**< inactivity watchdog timeout */
+  MilliSeconds last_package_watchdog_deadline; /**< watchdog timeout based on the last received package */
+  MilliSeconds production_inhibit_deadline; /**< earliest allowed production of a non cyclic connection */
+  MilliSeconds production_interval; /**< interval of the cyclic production, the
+                                       fastest RPI of all consumers for the
+                                       master of a shared multicast production */
+  EipUint32 produced_data_revision; /**< data revision of the producing
+                                       assembly at the last production */
+
+  TimerQueueEntry connection_timer; /**< fires at the earliest of the watchdog and transmission deadline */
+
+  /** next active connection in the same hash bucket of each index, only valid
+   * while the connection is in the active connection list */
+  CipConnectionObject *index_next[kConnectionObjectNumberOfIndexes];
 
   CipUint connection_serial_number;
   CipUint originator_vendor_id;
@@ -192,17 +235,30 @@ struct cip_connection_object {
   ConnectionSendDataFunction connection_send_data_function;
   ConnectionReceiveDataFunction connection_receive_data_function;
 
-  ENIPMessage last_reply_sent;
+  CipConnectionProducedFrameTemplate produced_frame_template; /**< header of produced I/O frames, see SendConnectedData() */
+
+  CipOctet last_reply_sent[PC_OPENER_ETHERNET_BUFFER_SIZE]; /**< last explicit reply, resent for a repeated request */
+  size_t last_reply_sent_length; /**< 0 if no reply is stored */
   CipBool is_large_forward_open;
 };
 
 /** @brief Extern declaration of the global connection list */
 extern DoublyLinkedList connection_list;
 
+/** @brief Takes a node of the connection list from the node pool
+ *
+ * @return The node, or NULL if all nodes are in use
+ */
 DoublyLinkedListNode *CipConnectionObjectListArrayAllocator(
   );
 void CipConnectionObjectListArrayFree(DoublyLinkedListNode **node);
 
+/** @brief Returns the pool of connection list nodes, e.g. for its statistics
+ *
+ * @return The slab the connection list nodes are taken from
+ */
+SlabAllocator *CipConnectionObjectGetListNodePool(void);
+
 /** @brief Array allocator
  *
  */
@@ -268,9 +324,25 @@ void ConnectionObjectSetConsumedConnectionSize(
 CipUint ConnectionObjectGetExpectedPacketRate(
   const CipConnectionObject *const connection_object);
 
+/**
+ * @brief Gets the T->O production interval in milliseconds
+ *
+ * The productions are scheduled on absolute millisecond deadlines, so the RPI
+ * is only rounded down to whole milliseconds (at least 1 ms) instead of to the
+ * timer tick.
+ */
 CipUint ConnectionObjectGetRequestedPacketInterval(
   const CipConnectionObject *const connection_object);
 
+/**
+ * @brief Gets the T->O actual packet interval in microseconds
+ *
+ * The interval the connection is produced at, as reported to the originator
+ * in the Forward_Open response.
+ */
+CipUdint ConnectionObjectGetTToOActualPacketInterval(
+  const CipConnectionObject *const connection_object);
+
 /**
  * @brief Sets the expected packet rate according to the rules of the CIP specification
  *
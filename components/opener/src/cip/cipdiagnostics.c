@@ -0,0 +1,330 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#include <string.h>
+
+#include "cipdiagnostics.h"
+
+#include "opener_user_conf.h"
+#include "opener_api.h"
+#include "cipcommon.h"
+#include "cipmessagerouter.h"
+#include "ciperror.h"
+#include "endianconv.h"
+#include "networkhandler.h"
+#include "generic_networkhandler.h"
+#include "timerqueue.h"
+#include "trace.h"
+
+const CipUdint kCipDiagnosticsBucketLimits[CIP_DIAGNOSTICS_NUMBER_OF_BUCKETS -
+                                           1] = {
+  100, 250, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 250000
+};
+
+static CipDiagnosticsHistogram g_service_histograms[
+  OPENER_DIAGNOSTICS_NUMBER_OF_SERVICE_HISTOGRAMS];
+
+static CipDiagnosticsHistogram g_connection_histograms[
+  OPENER_DIAGNOSTICS_NUMBER_OF_CONNECTION_HISTOGRAMS];
+
+/** @brief State of the explicit request currently processed */
+static struct {
+  bool active; /**< a request from TCP is processed */
+  bool service_noted; /**< the message router has seen a CIP service */
+  CipUsint service; /**< CIP service of the request */
+  MicroSeconds receive_time; /**< time the request was read from the socket */
+} g_explicit_request;
+
+static void EncodeCipDiagnosticsBuckets(const void *const data,
+                                        ENIPMessage *const outgoing_message) {
+  const CipUdint *const buckets = data;
+  for(size_t i = 0; i < CIP_DIAGNOSTICS_NUMBER_OF_BUCKETS; ++i) {
+    EncodeCipUdint(&buckets[i], outgoing_message);
+  }
+}
+
+static void EncodeCipDiagnosticsBucketLimits(const void *const data,
+                                             ENIPMessage *const outgoing_message)
+{
+  const CipUdint *const limits = data;
+  for(size_t i = 0; i < CIP_DIAGNOSTICS_NUMBER_OF_BUCKETS - 1; ++i) {
+    EncodeCipUdint(&limits[i], outgoing_message);
+  }
+}
+
+static void EncodeCipDiagnosticsPhaseTotals(const void *const data,
+                                            ENIPMessage *const outgoing_message)
+{
+  const CipUlint *const totals = data;
+  for(size_t i = 0; i < kNetworkHandlerNumberOfPhases; ++i) {
+    EncodeCipUlint(&totals[i], outgoing_message);
+  }
+}
+
+static void EncodeCipDiagnosticsPhaseWindow(const void *const data,
+                                            ENIPMessage *const outgoing_message)
+{
+  const CipUdint *const window = data;
+  for(size_t i = 0; i < kNetworkHandlerNumberOfPhases; ++i) {
+    EncodeCipUdint(&window[i], outgoing_message);
+  }
+}
+
+static void ClearHistogramSamples(CipDiagnosticsHistogram *const histogram) {
+  histogram->count = 0;
+  histogram->minimum = 0;
+  histogram->maximum = 0;
+  histogram->total = 0;
+  memset(histogram->buckets, 0, sizeof(histogram->buckets) );
+}
+
+static void RecordSample(CipDiagnosticsHistogram *const histogram,
+                         const MicroSeconds latency,
+                         const MicroSeconds now) {
+  const CipUdint value = (latency > UINT32_MAX) ? UINT32_MAX :
+                         (CipUdint) latency;
+
+  size_t bucket = 0;
+  while(bucket < CIP_DIAGNOSTICS_NUMBER_OF_BUCKETS - 1 &&
+        value > kCipDiagnosticsBucketLimits[bucket]) {
+    bucket++;
+  }
+  histogram->buckets[bucket]++;
+
+  if(0 == histogram->count || value < histogram->minimum) {
+    histogram->minimum = value;
+  }
+  if(value > histogram->maximum) {
+    histogram->maximum = value;
+  }
+  histogram->count++;
+  histogram->total += value;
+  histogram->last_update = now;
+}
+
+/** @brief Find the histogram for a key, or assign an unused or the least
+ * recently updated one to it */
+static CipDiagnosticsHistogram *GetHistogram(
+  CipDiagnosticsHistogram *const histograms,
+  const size_t number_of_histograms,
+  const CipDiagnosticsHistogramType type,
+  const CipUdint key,
+  const void *const owner) {
+  CipDiagnosticsHistogram *replacement = NULL;
+
+  for(size_t i = 0; i < number_of_histograms; ++i) {
+    CipDiagnosticsHistogram *const histogram = &histograms[i];
+    if(type == histogram->type && key == histogram->key &&
+       owner == histogram->owner) {
+      return histogram;
+    }
+    if(NULL == replacement ||
+       (kCipDiagnosticsHistogramTypeUnused != replacement->type &&
+        (kCipDiagnosticsHistogramTypeUnused == histogram->type ||
+         histogram->last_update < replacement->last_update) ) ) {
+      replacement = histogram;
+    }
+  }
+
+  if(NULL != replacement) {
+    ClearHistogramSamples(replacement);
+    replacement->type = type;
+    replacement->key = key;
+    replacement->rpi = 0;
+    replacement->owner = owner;
+  }
+  return replacement;
+}
+
+void CipDiagnosticsExplicitRequestBegin(const MicroSeconds receive_time) {
+  g_explicit_request.active = true;
+  g_explicit_request.service_noted = false;
+  g_explicit_request.receive_time = receive_time;
+}
+
+void CipDiagnosticsExplicitRequestNoteService(const CipUsint service) {
+  g_explicit_request.service_noted = true;
+  g_explicit_request.service = service;
+}
+
+void CipDiagnosticsExplicitRequestEnd(const bool reply_sent) {
+  if(g_explicit_request.active && g_explicit_request.service_noted &&
+     reply_sent) {
+    const MicroSeconds now = GetMicroSeconds();
+    CipDiagnosticsHistogram *const histogram = GetHistogram(
+      g_service_histograms, OPENER_DIAGNOSTICS_NUMBER_OF_SERVICE_HISTOGRAMS,
+      kCipDiagnosticsHistogramTypeExplicitService,
+      g_explicit_request.service, NULL);
+    RecordSample(histogram, now - g_explicit_request.receive_time, now);
+  }
+  g_explicit_request.active = false;
+  g_explicit_request.service_noted = false;
+}
+
+void CipDiagnosticsRecordProduction(
+  const CipConnectionObject *const connection_object,
+  const MilliSeconds deadline) {
+  const MicroSeconds now = GetMicroSeconds();
+  /* the deadline wraps with GetMilliSeconds(), so the lateness is taken in
+   * that time base and only the sub millisecond part from the microseconds */
+  const MilliSeconds now_milliseconds = (MilliSeconds) (now / 1000ULL);
+  const MicroSeconds lateness =
+    TimerQueueDeadlineReached(deadline, now_milliseconds) ?
+    (MicroSeconds) (MilliSeconds) (now_milliseconds - deadline) * 1000ULL +
+    now % 1000ULL : 0;
+
+  CipDiagnosticsHistogram *const histogram = GetHistogram(
+    g_connection_histograms, OPENER_DIAGNOSTICS_NUMBER_OF_CONNECTION_HISTOGRAMS,
+    kCipDiagnosticsHistogramTypeIoProduction,
+    connection_object->cip_produced_connection_id, connection_object);
+  histogram->rpi = ConnectionObjectGetTToORequestedPacketInterval(
+    connection_object);
+  RecordSample(histogram, lateness, now);
+}
+
+const CipDiagnosticsHistogram *CipDiagnosticsGetServiceHistograms(void) {
+  return g_service_histograms;
+}
+
+const CipDiagnosticsHistogram *CipDiagnosticsGetConnectionHistograms(void) {
+  return g_connection_histograms;
+}
+
+void CipDiagnosticsReset(void) {
+  for(size_t i = 0; i < OPENER_DIAGNOSTICS_NUMBER_OF_SERVICE_HISTOGRAMS; ++i) {
+    ClearHistogramSamples(&g_service_histograms[i]);
+  }
+  for(size_t i = 0; i < OPENER_DIAGNOSTICS_NUMBER_OF_CONNECTION_HISTOGRAMS;
+      ++i) {
+    ClearHistogramSamples(&g_connection_histograms[i]);
+  }
+}
+
+/** @brief Reset service: clears the histogram of an instance, or all
+ * histograms if sent to the class */
+static EipStatus CipDiagnosticsResetService(CipInstance *RESTRICT const instance,
+                                            CipMessageRouterRequest *const message_router_request,
+                                            CipMessageRouterResponse *const message_router_response,
+                                            const struct sockaddr *originator_address,
+                                            const CipSessionHandle encapsulation_session)
+{
+  /* Suppress unused parameter compiler warning. */
+  (void)originator_address;
+  (void)encapsulation_session;
+
+  if(0 == instance->instance_number) {
+    CipDiagnosticsReset();
+    NetworkResetLoadStatistics();
+  } else {
+    ClearHistogramSamples( (CipDiagnosticsHistogram *) instance->data );
+  }
+
+  InitializeENIPMessage(&message_router_response->message);
+  message_router_response->reply_service =
+    (0x80 | message_router_request->service);
+  message_router_response->general_status = kCipErrorSuccess;
+  message_router_response->size_of_additional_status = 0;
+  return kEipStatusOkSend;
+}
+
+static void InsertHistogramAttributes(CipInstance *const instance,
+                                      CipDiagnosticsHistogram *const histogram)
+{
+  instance->data = histogram;
+  InsertAttribute(instance, 1, kCipUsint, EncodeCipUsint, NULL,
+                  (void *) &histogram->type, kGetableSingleAndAll);
+  InsertAttribute(instance, 2, kCipUdint, EncodeCipUdint, NULL,
+                  (void *) &histogram->key, kGetableSingleAndAll);
+  InsertAttribute(instance, 3, kCipUdint, EncodeCipUdint, NULL,
+                  (void *) &histogram->rpi, kGetableSingleAndAll);
+  InsertAttribute(instance, 4, kCipUdint, EncodeCipUdint, NULL,
+                  (void *) &histogram->count, kGetableSingleAndAll);
+  InsertAttribute(instance, 5, kCipUdint, EncodeCipUdint, NULL,
+                  (void *) &histogram->minimum, kGetableSingleAndAll);
+  InsertAttribute(instance, 6, kCipUdint, EncodeCipUdint, NULL,
+                  (void *) &histogram->maximum, kGetableSingleAndAll);
+  InsertAttribute(instance, 7, kCipUlint, EncodeCipUlint, NULL,
+                  (void *) &histogram->total, kGetableSingleAndAll);
+  InsertAttribute(instance, 8, kCipAny, EncodeCipDiagnosticsBuckets, NULL,
+                  (void *) histogram->buckets, kGetableSingleAndAll);
+}
+
+EipStatus CipDiagnosticsInit(void) {
+  memset(g_service_histograms, 0, sizeof(g_service_histograms) );
+  memset(g_connection_histograms, 0, sizeof(g_connection_histograms) );
+  memset(&g_explicit_request, 0, sizeof(g_explicit_request) );
+
+  CipClass *diagnostics_class = NULL;
+
+  if( ( diagnostics_class = CreateCipClass(kCipDiagnosticsClassCode,
+                                           8, /* # non-default class attributes */
+                                           15, /* # highest class attribute number */
+                                           3, /* # class services */
+                                           8, /* # instance attributes */
+                                           8, /* # highest instance attribute number */
+                                           3, /* # instance services */
+                                           OPENER_DIAGNOSTICS_NUMBER_OF_SERVICE_HISTOGRAMS
+                                           + OPENER_DIAGNOSTICS_NUMBER_OF_CONNECTION_HISTOGRAMS, /* # instances */
+                                           "Latency Diagnostics",
+                                           1, /* # class revision */
+                                           NULL /* # function pointer for initialization */
+                                           ) ) == 0 ) {
+    return kEipStatusError;
+  }
+
+  InsertAttribute( (CipInstance *) diagnostics_class, 8, kCipAny,
+                   EncodeCipDiagnosticsBucketLimits, NULL,
+                   (void *) kCipDiagnosticsBucketLimits, kGetableSingle );
+
+  /* load of the network handler loop, see NetworkHandlerLoadStatistics */
+  NetworkHandlerLoadStatistics *const load =
+    (NetworkHandlerLoadStatistics *) NetworkGetLoadStatistics();
+  InsertAttribute( (CipInstance *) diagnostics_class, 9, kCipAny,
+                   EncodeCipDiagnosticsPhaseTotals, NULL,
+                   (void *) load->total, kGetableSingle );
+  InsertAttribute( (CipInstance *) diagnostics_class, 10, kCipAny,
+                   EncodeCipDiagnosticsPhaseWindow, NULL,
+                   (void *) load->window, kGetableSingle );
+  InsertAttribute( (CipInstance *) diagnostics_class, 11, kCipUdint,
+                   EncodeCipUdint, NULL,
+                   (void *) &load->window_length, kGetableSingle );
+  InsertAttribute( (CipInstance *) diagnostics_class, 12, kCipUint,
+                   EncodeCipUint, NULL,
+                   (void *) &load->utilization, kGetableSingle );
+  InsertAttribute( (CipInstance *) diagnostics_class, 13, kCipUint,
+                   EncodeCipUint, NULL,
+                   (void *) &load->peak_utilization, kGetableSingle );
+  InsertAttribute( (CipInstance *) diagnostics_class, 14, kCipUdint,
+                   EncodeCipUdint, NULL,
+                   (void *) &load->cycles, kGetableSingle );
+  InsertAttribute( (CipInstance *) diagnostics_class, 15, kCipUdint,
+                   EncodeCipUdint, NULL,
+                   (void *) &load->maximum_cycle_busy_time, kGetableSingle );
+  InsertService(diagnostics_class->class_instance.cip_class, kReset,
+                &CipDiagnosticsResetService, "Reset");
+
+  /* instances 1..n hold the service histograms, the connection histograms follow */
+  for(CipInstanceNum i = 0; i < OPENER_DIAGNOSTICS_NUMBER_OF_SERVICE_HISTOGRAMS;
+      ++i) {
+    InsertHistogramAttributes(GetCipInstance(diagnostics_class, i + 1),
+                              &g_service_histograms[i]);
+  }
+  for(CipInstanceNum i = 0;
+      i < OPENER_DIAGNOSTICS_NUMBER_OF_CONNECTION_HISTOGRAMS; ++i) {
+    InsertHistogramAttributes(GetCipInstance(diagnostics_class,
+                                             OPENER_DIAGNOSTICS_NUMBER_OF_SERVICE_HISTOGRAMS
+                                             + i + 1),
+                              &g_connection_histograms[i]);
+  }
+
+  InsertService(diagnostics_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(diagnostics_class, kGetAttributeAll, &GetAttributeAll,
+                "GetAttributeAll");
+  InsertService(diagnostics_class, kReset, &CipDiagnosticsResetService,
+                "Reset");
+
+  return kEipStatusOk;
+}
@@ -0,0 +1,147 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_CIPDIAGNOSTICS_H_
+#define OPENER_CIPDIAGNOSTICS_H_
+
+/** @file cipdiagnostics.h
+ *  @brief Public interface of the vendor specific Latency Diagnostics Object
+ *
+ *  The object keeps fixed bucket latency histograms
+ *  - per CIP service for explicit requests, measured from the reception of
+ *    the request on the TCP socket until the reply was handed to send()
+ *  - per producing I/O connection, measured from the scheduled production
+ *    deadline until the frame was handed to the IP stack
+ *
+ *  Each histogram is one instance of the object:
+ *
+ *  Instance attributes
+ *  - #1 USINT Type, see CipDiagnosticsHistogramType
+ *  - #2 UDINT Key, CIP service code or produced connection ID
+ *  - #3 UDINT T->O RPI in microseconds, 0 for explicit services
+ *  - #4 UDINT Number of samples
+ *  - #5 UDINT Minimum latency in microseconds
+ *  - #6 UDINT Maximum latency in microseconds
+ *  - #7 ULINT Sum of all latencies in microseconds
+ *  - #8 ARRAY of UDINT Sample counts per bucket
+ *
+ *  Class attribute #8 holds the upper bucket limits in microseconds, the last
+ *  bucket takes all larger samples.
+ *
+ *  The class attributes #9 to #15 report the load of the network handler loop
+ *  for sizing RPIs and connection counts, see NetworkHandlerLoadStatistics.
+ *  The arrays have one entry per NetworkHandlerPhase (select, TCP, UDP,
+ *  connection timers, ManageConnections, timeout checkers, other):
+ *  - #9 ARRAY of ULINT Time per phase since the last reset in microseconds
+ *  - #10 ARRAY of UDINT Time per phase in the last load window in microseconds
+ *  - #11 UDINT Length of the last load window in microseconds
+ *  - #12 UINT Utilization of the last load window in 0.1 %
+ *  - #13 UINT Peak utilization of a load window in 0.1 %
+ *  - #14 UDINT Number of passes through the network handler loop
+ *  - #15 UDINT Longest busy time of a single pass in microseconds
+ *
+ *  The Reset service clears one histogram if sent to an instance, or all
+ *  histograms and the load statistics if sent to the class.
+ */
+
+#include "typedefs.h"
+#include "ciptypes.h"
+#include "cipconnectionobject.h"
+
+/** @brief Latency Diagnostics Object class code (vendor specific range) */
+static const CipUint kCipDiagnosticsClassCode = 0x64U;
+
+#ifndef OPENER_DIAGNOSTICS_NUMBER_OF_SERVICE_HISTOGRAMS
+/** @brief Number of CIP services for which explicit request latencies are kept */
+#define OPENER_DIAGNOSTICS_NUMBER_OF_SERVICE_HISTOGRAMS 8
+#endif
+
+#ifndef OPENER_DIAGNOSTICS_NUMBER_OF_CONNECTION_HISTOGRAMS
+/** @brief Number of producing connections for which production latencies are
+ * kept, the least recently updated histogram is reused for a new connection */
+#define OPENER_DIAGNOSTICS_NUMBER_OF_CONNECTION_HISTOGRAMS 8
+#endif
+
+/** @brief Number of buckets of each histogram */
+#define CIP_DIAGNOSTICS_NUMBER_OF_BUCKETS 12
+
+/** @brief Type of a latency histogram (instance attribute #1) */
+typedef enum {
+  kCipDiagnosticsHistogramTypeUnused = 0, /**< Histogram not assigned yet */
+  kCipDiagnosticsHistogramTypeExplicitService = 1, /**< Explicit requests of one CIP service */
+  kCipDiagnosticsHistogramTypeIoProduction = 2 /**< Productions of one I/O connection */
+} CipDiagnosticsHistogramType;
+
+/** @brief A latency histogram, instance of the Latency Diagnostics Object */
+typedef struct {
+  CipUsint type; /**< Attr. #1: CipDiagnosticsHistogramType */
+  CipUdint key; /**< Attr. #2: CIP service code or produced connection ID */
+  CipUdint rpi; /**< Attr. #3: T->O RPI in microseconds */
+  CipUdint count; /**< Attr. #4: number of samples */
+  CipUdint minimum; /**< Attr. #5: minimum latency in microseconds */
+  CipUdint maximum; /**< Attr. #6: maximum latency in microseconds */
+  CipUlint total; /**< Attr. #7: sum of all latencies in microseconds */
+  CipUdint buckets[CIP_DIAGNOSTICS_NUMBER_OF_BUCKETS]; /**< Attr. #8: samples per bucket */
+  const void *owner; /**< connection object the histogram is assigned to */
+  MicroSeconds last_update; /**< time of the last sample */
+} CipDiagnosticsHistogram;
+
+/** @brief Upper limits of all but the last bucket in microseconds */
+extern const CipUdint kCipDiagnosticsBucketLimits[CIP_DIAGNOSTICS_NUMBER_OF_BUCKETS - 1];
+
+/* public functions */
+
+/** @brief Create and initialize the Latency Diagnostics Object */
+EipStatus CipDiagnosticsInit(void);
+
+/** @brief Start the measurement of an explicit request received on TCP
+ *
+ *  @param receive_time Time the request was read from the socket
+ */
+void CipDiagnosticsExplicitRequestBegin(const MicroSeconds receive_time);
+
+/** @brief Note the CIP service of the explicit request currently processed
+ *
+ *  Called by the message router. For nested requests the innermost service
+ *  is the one accounted for.
+ *
+ *  @param service CIP service code of the request
+ */
+void CipDiagnosticsExplicitRequestNoteService(const CipUsint service);
+
+/** @brief Finish the measurement of the current explicit request
+ *
+ *  @param reply_sent true if a reply was handed to send(), false if no reply
+ *  was sent and the request is not to be accounted for
+ */
+void CipDiagnosticsExplicitRequestEnd(const bool reply_sent);
+
+/** @brief Account for the production of an I/O connection
+ *
+ *  @param connection_object The producing connection
+ *  @param deadline The scheduled production deadline that triggered the
+ *  production, in the time base of GetMilliSeconds()
+ */
+void CipDiagnosticsRecordProduction(
+  const CipConnectionObject *const connection_object,
+  const MilliSeconds deadline);
+
+/** @brief Get the histograms of the explicit services
+ *
+ *  @return Array of OPENER_DIAGNOSTICS_NUMBER_OF_SERVICE_HISTOGRAMS histograms
+ */
+const CipDiagnosticsHistogram *CipDiagnosticsGetServiceHistograms(void);
+
+/** @brief Get the histograms of the producing connections
+ *
+ *  @return Array of OPENER_DIAGNOSTICS_NUMBER_OF_CONNECTION_HISTOGRAMS histograms
+ */
+const CipDiagnosticsHistogram *CipDiagnosticsGetConnectionHistograms(void);
+
+/** @brief Clear all histograms */
+void CipDiagnosticsReset(void);
+
+#endif /* OPENER_CIPDIAGNOSTICS_H_ */
@@ -54,6 +54,9 @@ void CloseIoConnection(CipConnectionObject *RESTRICT connection_object);
 
 void HandleIoConnectionTimeOut(CipConnectionObject *connection_object);
 
+/* Adapt the production of a shared multicast connection to its consumers */
+static void UpdateMulticastProductionInterval(const EipUint32 input_point);
+
 /** @brief  Send the data from the produced CIP Object of the connection via the socket of the connection object
  *   on UDP.
  *      @param connection_object  pointer to the connection object
@@ -124,6 +127,11 @@ EipUint16 ProcessProductionInhibitTime(
           kConnectionManagerExtendedStatusCodeProductionInhibitTimerGreaterThanRpi;
       }
     }
+  } else if( 256 ==
+             ConnectionObjectGetProductionInhibitTime(io_connection_object) ) {
+    /* change-of-state and application triggered connections without PIT
+     * segment may produce on every change */
+    ConnectionObjectSetProductionInhibitTime(io_connection_object, 0);
   }
   return kConnectionManagerExtendedStatusCodeSuccess;
 }
@@ -219,11 +227,16 @@ EipUint16 SetupIoConnectionTargetToOriginatorConnectionPoint(
     if(io_connection_object->produced_path.instance_id ==
        iterator->produced_path.instance_id) {
       //Check parameters
+#if !defined(OPENER_IO_MULTICAST_RATE_GROUPING) || \
+      0 == OPENER_IO_MULTICAST_RATE_GROUPING
+      /* with rate grouping the production follows the fastest consumer, see
+       * UpdateMulticastProductionInterval() */
       if( ConnectionObjectGetTToORequestedPacketInterval(io_connection_object)
           !=
           ConnectionObjectGetTToORequestedPacketInterval(iterator) ) {
         return kConnectionManagerExtendedStatusCodeErrorRpiValuesNotAcceptable;
       }
+#endif
       if( ConnectionObjectGetTToOConnectionSizeType(io_connection_object) !=
           ConnectionObjectGetTToOConnectionSizeType(iterator) ) {
         return
@@ -250,7 +263,15 @@ EipUint16 SetupIoConnectionTargetToOriginatorConnectionPoint(
       }
 
       if( ConnectionObjectGetProductionInhibitTime(io_connection_object) !=
-          ConnectionObjectGetProductionInhibitTime(iterator) ) {
+          ConnectionObjectGetProductionInhibitTime(iterator)
+#if defined(OPENER_IO_MULTICAST_RATE_GROUPING) && \
+      0 != OPENER_IO_MULTICAST_RATE_GROUPING
+          /* cyclic connections derive the PIT from their RPI */
+          && kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
+          ConnectionObjectGetTransportClassTriggerProductionTrigger(
+            io_connection_object)
+#endif
+          ) {
         return
           kConnectionManagerExtendedStatusCodeMismatchedTToOProductionInhibitTimeSegment;
       }
@@ -395,7 +416,18 @@ CipError EstablishIoConnection(
     return cip_error;
   }
 
-  AddNewActiveConnection(io_connection_object);
+  if(kEipStatusOk != AddNewActiveConnection(io_connection_object) ) {
+    /* the connection never became active, the shared IO socket stays open */
+    ConnectionObjectInitializeEmpty(io_connection_object);
+    *extended_error =
+      kConnectionManagerExtendedStatusCodeErrorNoMoreConnectionsAvailable;
+    return kCipErrorConnectionFailure;
+  }
+  if(kConnectionObjectConnectionTypeMulticast ==
+     target_to_originator_connection_type) {
+    UpdateMulticastProductionInterval(
+      io_connection_object->produced_path.instance_id);
+  }
   CheckIoConnectionEvent(io_connection_object->consumed_path.instance_id,
                          io_connection_object->produced_path.instance_id,
                          kIoConnectionEventOpened);
@@ -551,6 +583,16 @@ EipStatus OpenProducingMulticastConnection(
       existing_connection_object->socket[kUdpCommuncationDirectionProducing];
     existing_connection_object->socket[kUdpCommuncationDirectionProducing] =
       kEipInvalidSocket;
+    /* the consumers already listening see a continuous production */
+    connection_object->eip_level_sequence_count_producing =
+      existing_connection_object->eip_level_sequence_count_producing;
+    connection_object->sequence_count_producing =
+      existing_connection_object->sequence_count_producing;
+    connection_object->produced_data_revision =
+      existing_connection_object->produced_data_revision;
+    connection_object->transmission_trigger_deadline =
+      existing_connection_object->transmission_trigger_deadline;
+    UpdateConnectionTimer(existing_connection_object);
   } else { /* this connection will not produce the data */
     connection_object->socket[kUdpCommuncationDirectionProducing] =
       kEipInvalidSocket;
@@ -730,6 +772,63 @@ EipUint16 HandleConfigData(CipConnectionObject *connection_object) {
   return connection_manager_status;
 }
 
+/** @brief Set the production interval of a shared multicast production
+ *
+ * All consumers of a multicast T->O connection receive the frames of its
+ * master connection, only the master produces. The master produces with the
+ * fastest RPI of the established consumers, so each consumer gets at least
+ * one frame per RPI it requested, and this RPI is returned as its API. When a
+ * faster consumer joins, the pending production is moved forward, when it
+ * leaves, the master falls back to the remaining consumers' rate.
+ *
+ * @param input_point the produced input assembly
+ */
+static void UpdateMulticastProductionInterval(const EipUint32 input_point) {
+  CipConnectionObject *const master = GetExistingProducerIoConnection(true,
+                                                                      input_point);
+  if(NULL == master) {
+    return;
+  }
+
+  MilliSeconds production_interval = 0;
+  const DoublyLinkedListNode *node = connection_list.first;
+  while(NULL != node) {
+    const CipConnectionObject *const consumer = node->data;
+    if(ConnectionObjectIsTypeIOConnection(consumer) &&
+       kConnectionObjectStateEstablished ==
+       ConnectionObjectGetState(consumer) &&
+       input_point == consumer->produced_path.instance_id &&
+       kConnectionObjectConnectionTypeMulticast ==
+       ConnectionObjectGetTToOConnectionType(consumer) ) {
+      const MilliSeconds requested_packet_interval =
+        ConnectionObjectGetRequestedPacketInterval(consumer);
+      if(0 == production_interval ||
+         requested_packet_interval < production_interval) {
+        production_interval = requested_packet_interval;
+      }
+    }
+    node = node->next;
+  }
+  if(0 == production_interval ||
+     production_interval == master->production_interval) {
+    return;
+  }
+
+  OPENER_TRACE_INFO("multicast production of %" PRIu32
+                    " changes from %lu to %lu ms\n",
+                    input_point,
+                    (unsigned long) master->production_interval,
+                    (unsigned long) production_interval);
+  master->production_interval = production_interval;
+  const MilliSeconds next_deadline = g_actual_time + production_interval;
+  if( !TimerQueueDeadlineReached(master->transmission_trigger_deadline,
+                                 next_deadline) ) {
+    /* a faster consumer joined, it must not wait for the slower RPI */
+    master->transmission_trigger_deadline = next_deadline;
+  }
+  UpdateConnectionTimer(master);
+}
+
 /*
  * Returns POSIX OK (0) on successful transfer, otherwise non-zero to
  * trigger closing of connections and sockets associated with object.
@@ -755,8 +854,13 @@ static int transfer_master_connection(CipConnectionObject *connection_object) {
     connection_object->eip_level_sequence_count_producing;
   active->sequence_count_producing =
     connection_object->sequence_count_producing;
-  active->transmission_trigger_timer =
-    connection_object->transmission_trigger_timer;
+  active->produced_data_revision = connection_object->produced_data_revision;
+  active->transmission_trigger_deadline =
+    connection_object->transmission_trigger_deadline;
+  /* the frame template is built on the first production of the new master */
+  active->produced_frame_template.header_length = 0;
+  /* the new master is producing from now on */
+  UpdateConnectionTimer(active);
 
   return 0;
 }
@@ -793,7 +897,11 @@ void CloseIoConnection(CipConnectionObject *RESTRICT connection_object) {
     }
   }
 
+  const EipUint32 input_point = connection_object->produced_path.instance_id;
   CloseCommunicationChannelsAndRemoveFromActiveConnectionsList(connection_object);
+  if(kConnectionObjectConnectionTypeMulticast == conn_type) {
+    UpdateMulticastProductionInterval(input_point);
+  }
 }
 
 /* Always sync any changes with CloseIoConnection() */
@@ -809,8 +917,8 @@ void HandleIoConnectionTimeOut(CipConnectionObject *connection_object) {
                          kIoConnectionEventTimedOut);
   ConnectionObjectSetState(connection_object, kConnectionObjectStateTimedOut);
 
-  if(connection_object->last_package_watchdog_timer ==
-     connection_object->inactivity_watchdog_timer) {
+  if(connection_object->last_package_watchdog_deadline ==
+     connection_object->inactivity_watchdog_deadline) {
     CheckForTimedOutConnectionsAndCloseTCPConnections(connection_object,
                                                       CloseEncapsulationSessionBySockAddr);
   }
@@ -848,85 +956,197 @@ void HandleIoConnectionTimeOut(CipConnectionObject *connection_object) {
   }
 
   ConnectionObjectSetState(connection_object, kConnectionObjectStateTimedOut);
+  if(kConnectionObjectConnectionTypeMulticast == conn_type) {
+    UpdateMulticastProductionInterval(
+      connection_object->produced_path.instance_id);
+  }
 }
 
-EipStatus SendConnectedData(CipConnectionObject *connection_object) {
-
-  /* TODO think of adding an own send buffer to each connection object in order to preset up the whole message on connection opening and just change the variable data items e.g., sequence number */
-
-  CipCommonPacketFormatData *common_packet_format_data =
-    &g_common_packet_format_data_item;
-  /* TODO think on adding a CPF data item to the S_CIP_ConnectionObject in order to remove the code here or even better allocate memory in the connection object for storing the message to send and just change the application data*/
+/** @brief Writes a little endian UINT into a produced frame template */
+static void SetUintInFrameTemplate(CipOctet *const field,
+                                   const CipUint value) {
+  field[0] = (CipOctet) value;
+  field[1] = (CipOctet) (value >> 8);
+}
 
-  connection_object->eip_level_sequence_count_producing++;
+/** @brief Writes a little endian UDINT into a produced frame template */
+static void SetUdintInFrameTemplate(CipOctet *const field,
+                                    const CipUdint value) {
+  field[0] = (CipOctet) value;
+  field[1] = (CipOctet) (value >> 8);
+  field[2] = (CipOctet) (value >> 16);
+  field[3] = (CipOctet) (value >> 24);
+}
 
-  /* assembleCPFData */
-  common_packet_format_data->item_count = 2;
-  if( kConnectionObjectTransportClassTriggerTransportClass0 !=
-      ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
-  /* use Sequenced Address Items if not Connection Class 0 */
-  {
-    common_packet_format_data->address_item.type_id =
-      kCipItemIdSequencedAddressItem;
-    common_packet_format_data->address_item.length = 8;
-    common_packet_format_data->address_item.data.sequence_number =
-      connection_object->eip_level_sequence_count_producing;
+/** @brief Builds the header of the produced I/O frames of a connection
+ *
+ * @param connection_object The producing connection
+ * @param payload_length Length of the produced assembly data
+ * @param has_run_idle_header True if a run/idle header has to be sent
+ */
+static void BuildProducedFrameTemplate(
+  CipConnectionObject *const connection_object,
+  const CipUint payload_length,
+  const CipBool has_run_idle_header) {
+  CipConnectionProducedFrameTemplate *const frame_template =
+    &connection_object->produced_frame_template;
+  const ConnectionObjectTransportClassTriggerTransportClass transport_class =
+    ConnectionObjectGetTransportClassTriggerTransportClass(connection_object);
+
+  /* encode directly into the template */
+  ENIPMessage message;
+  ENIPMessageAttachBuffer(&message, frame_template->header,
+                          sizeof(frame_template->header) );
+
+  AddIntToMessage(2, &message); /* item count */
+  if(kConnectionObjectTransportClassTriggerTransportClass0 != transport_class) {
+    /* use Sequenced Address Items if not Connection Class 0 */
+    AddIntToMessage(kCipItemIdSequencedAddressItem, &message);
+    AddIntToMessage(8, &message);
+    AddDintToMessage(connection_object->cip_produced_connection_id, &message);
+    frame_template->eip_sequence_offset = message.used_message_length;
+    AddDintToMessage(0, &message);
   } else {
-    common_packet_format_data->address_item.type_id =
-      kCipItemIdConnectionAddress;
-    common_packet_format_data->address_item.length = 4;
+    AddIntToMessage(kCipItemIdConnectionAddress, &message);
+    AddIntToMessage(4, &message);
+    AddDintToMessage(connection_object->cip_produced_connection_id, &message);
+    frame_template->eip_sequence_offset = 0;
+  }
 
+  CipUint data_item_length = payload_length;
+  if(kConnectionObjectTransportClassTriggerTransportClass1 == transport_class) {
+    data_item_length += 2;
+  }
+  if(has_run_idle_header) {
+    data_item_length += 4;
   }
-  common_packet_format_data->address_item.data.connection_identifier =
-    connection_object->cip_produced_connection_id;
+  AddIntToMessage(kCipItemIdConnectedDataItem, &message);
+  AddIntToMessage(data_item_length, &message);
 
-  common_packet_format_data->data_item.type_id = kCipItemIdConnectedDataItem;
+  frame_template->cip_sequence_offset = 0;
+  if(kConnectionObjectTransportClassTriggerTransportClass1 == transport_class) {
+    frame_template->cip_sequence_offset = message.used_message_length;
+    AddIntToMessage(0, &message);
+  }
+  frame_template->run_idle_offset = 0;
+  if(has_run_idle_header) {
+    frame_template->run_idle_offset = message.used_message_length;
+    AddDintToMessage(0, &message);
+  }
 
-  CipByteArray *producing_instance_attributes =
-    (CipByteArray *) connection_object->producing_instance->attributes->data;
-  common_packet_format_data->data_item.length = 0;
+  OPENER_ASSERT(message.used_message_length <=
+                kConnectionObjectProducedFrameHeaderMaximumLength);
+  frame_template->header_length = message.used_message_length;
+  frame_template->payload_length = payload_length;
+  frame_template->has_run_idle_header = has_run_idle_header;
+}
 
-  /* notify the application that data will be sent immediately after the call */
-  if( BeforeAssemblyDataSend(connection_object->producing_instance) ) {
-    /* the data has changed increase sequence counter */
-    connection_object->sequence_count_producing++;
-  }
+#if defined(OPENER_IO_ZERO_COPY_PRODUCING) && 0 != OPENER_IO_ZERO_COPY_PRODUCING
+/** @brief Copies the data of the producing assembly into the frame of the IP stack
+ *
+ * @param destination Payload area of the frame
+ * @param source The producing assembly instance
+ * @param length Length of the assembly data
+ */
+static void CopyProducedAssemblyData(CipOctet *const destination,
+                                     const void *const source,
+                                     const size_t length) {
+  AssemblyReadSnapshot(source, 0, destination, length);
+}
+#endif
 
-  /* set AddressInfo Items to invalid Type */
-  common_packet_format_data->address_info_item[0].type_id = 0;
-  common_packet_format_data->address_info_item[1].type_id = 0;
+EipStatus SendConnectedData(CipConnectionObject *connection_object) {
 
-  ENIPMessage outgoing_message;
-  InitializeENIPMessage(&outgoing_message);
-  AssembleIOMessage(common_packet_format_data, &outgoing_message);
+  /* The CPF header of the frame is built once per connection, see
+   * BuildProducedFrameTemplate(). Here only the sequence numbers and the run/idle
+   * header are patched in place and the assembly data is appended. */
+  connection_object->eip_level_sequence_count_producing++;
 
-  MoveMessageNOctets(-2, &outgoing_message);
-  common_packet_format_data->data_item.length =
-    producing_instance_attributes->length;
+  /* changes marked by the application since the last production of this
+   * connection, a production without them is a heartbeat */
+  const EipUint32 data_revision = AssemblyGetDataRevision(
+    connection_object->producing_instance);
+  const bool data_marked_changed = data_revision !=
+                                   connection_object->produced_data_revision;
+  connection_object->produced_data_revision = data_revision;
 
-  if( kConnectionObjectTransportClassTriggerTransportClass1 ==
-      ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
-  {
-    common_packet_format_data->data_item.length += 2;
-    AddIntToMessage(common_packet_format_data->data_item.length,
-                    &outgoing_message);
-    AddIntToMessage(connection_object->sequence_count_producing,
-                    &outgoing_message);
-  } else {
-    AddIntToMessage(common_packet_format_data->data_item.length,
-                    &outgoing_message);
+  /* notify the application that data will be sent immediately after the call */
+  if( BeforeAssemblyDataSend(connection_object->producing_instance) ||
+      data_marked_changed ) {
+    /* the data has changed increase sequence counter */
+    connection_object->sequence_count_producing++;
   }
 
-  memcpy(outgoing_message.current_message_position,
-         producing_instance_attributes->data,
-         producing_instance_attributes->length);
+  CipByteArray *producing_instance_attributes =
+    (CipByteArray *) connection_object->producing_instance->attributes->data;
+  const CipBool has_run_idle_header = s_produce_run_idle &&
+                                      (0 <
+                                       producing_instance_attributes->length);
+
+  CipConnectionProducedFrameTemplate *const frame_template =
+    &connection_object->produced_frame_template;
+  if( (0 == frame_template->header_length) ||
+      (producing_instance_attributes->length !=
+       frame_template->payload_length) ||
+      (has_run_idle_header != frame_template->has_run_idle_header) ) {
+    BuildProducedFrameTemplate(connection_object,
+                               producing_instance_attributes->length,
+                               has_run_idle_header);
+  }
 
-  outgoing_message.current_message_position +=
-    producing_instance_attributes->length;
-  outgoing_message.used_message_length += producing_instance_attributes->length;
+  if(0 != frame_template->eip_sequence_offset) {
+    SetUdintInFrameTemplate(
+      &frame_template->header[frame_template->eip_sequence_offset],
+      connection_object->eip_level_sequence_count_producing);
+  }
+  if(0 != frame_template->cip_sequence_offset) {
+    SetUintInFrameTemplate(
+      &frame_template->header[frame_template->cip_sequence_offset],
+      connection_object->sequence_count_producing);
+  }
+  if(0 != frame_template->run_idle_offset) {
+    SetUdintInFrameTemplate(
+      &frame_template->header[frame_template->run_idle_offset],
+      g_run_idle_state);
+  }
 
-  return SendUdpData(&connection_object->remote_address,
-                     &outgoing_message);
+#if defined(OPENER_IO_ZERO_COPY_PRODUCING) && 0 != OPENER_IO_ZERO_COPY_PRODUCING
+  /* header and data are written directly into the buffer of the IP stack */
+  ConnectionManagerCountProducedFrame(1);
+  return SendUdpFrame(&connection_object->remote_address,
+                      frame_template->header,
+                      frame_template->header_length,
+                      CopyProducedAssemblyData,
+                      connection_object->producing_instance,
+                      producing_instance_attributes->length);
+#else
+  ENIPMessage outgoing_message;
+  if( kEipStatusOk !=
+      ENIPMessageAllocateBuffer(&outgoing_message,
+                                frame_template->header_length +
+                                producing_instance_attributes->length) ) {
+    OPENER_TRACE_ERR("no send buffer for the produced I/O frame\n");
+    return kEipStatusError;
+  }
+  memcpy(outgoing_message.message_buffer, frame_template->header,
+         frame_template->header_length);
+  AssemblyReadSnapshot(connection_object->producing_instance, 0,
+                       &outgoing_message.message_buffer[frame_template->
+                                                        header_length],
+                       producing_instance_attributes->length);
+
+  outgoing_message.used_message_length = frame_template->header_length +
+                                         producing_instance_attributes->length;
+  outgoing_message.current_message_position =
+    &outgoing_message.message_buffer[outgoing_message.used_message_length];
+
+  /* the data is copied into the message and again by the socket layer */
+  ConnectionManagerCountProducedFrame(2);
+  const EipStatus status = SendUdpData(&connection_object->remote_address,
+                                       &outgoing_message);
+  ENIPMessageFreeBuffer(&outgoing_message);
+  return status;
+#endif
 }
 
 EipStatus HandleReceivedIoConnectionData(CipConnectionObject *connection_object,
@@ -991,7 +1211,11 @@ EipStatus HandleReceivedIoConnectionData(CipConnectionObject *connection_object,
 CipError OpenCommunicationChannels(CipConnectionObject *connection_object) {
 
   CipError cip_error = kCipErrorSuccess;
-  CreateUdpSocket();
+  /* all IO connections share the one IO messaging socket */
+  if(kEipInvalidSocket == CreateUdpSocket() ) {
+    OPENER_TRACE_ERR("no UDP socket for IO messaging available\n");
+    return kCipErrorConnectionFailure;
+  }
 
   CipCommonPacketFormatData *common_packet_format_data =
     &g_common_packet_format_data_item;
@@ -1043,15 +1267,12 @@ CipError OpenCommunicationChannels(CipConnectionObject *connection_object) {
 
 void CloseCommunicationChannelsAndRemoveFromActiveConnectionsList(
   CipConnectionObject *connection_object) {
-  if(kEipInvalidSocket !=
-     connection_object->socket[kUdpCommuncationDirectionConsuming]) {
-    CloseUdpSocket(connection_object->socket[kUdpCommuncationDirectionConsuming]);
-  }
-
-  if(kEipInvalidSocket !=
-     connection_object->socket[kUdpCommuncationDirectionProducing]) {
-    CloseUdpSocket(connection_object->socket[kUdpCommuncationDirectionProducing]);
-  }
+  /* the sockets refer to the IO messaging socket shared by all connections,
+   * closing it here would silence the remaining connections */
+  connection_object->socket[kUdpCommuncationDirectionConsuming] =
+    kEipInvalidSocket;
+  connection_object->socket[kUdpCommuncationDirectionProducing] =
+    kEipInvalidSocket;
 
   RemoveFromActiveConnections(connection_object);
   ConnectionObjectInitializeEmpty(connection_object);
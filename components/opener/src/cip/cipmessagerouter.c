@@ -3,12 +3,16 @@
  * All rights reserved.
  *
  ******************************************************************************/
+#include <stdlib.h>
+
 #include "opener_api.h"
 #include "cipcommon.h"
 #include "endianconv.h"
 #include "ciperror.h"
 #include "trace.h"
 #include "enipmessage.h"
+#include "cipdiagnostics.h"
+#include "cpf.h"
 
 #include "cipmessagerouter.h"
 
@@ -29,6 +33,20 @@ typedef struct cip_message_router_object {
 /** @brief Pointer to first registered object in MessageRouter*/
 CipMessageRouterObject *g_first_object = NULL;
 
+/** @brief Registered objects sorted by class code for binary search
+ *
+ * Built by CipMessageRouterBuildDispatchTables(), NULL before that or if no
+ * memory was available. The class registry list stays the owner of the nodes.
+ */
+static CipMessageRouterObject **g_class_dispatch_table = NULL;
+
+/** @brief Number of entries in g_class_dispatch_table */
+static size_t g_class_dispatch_table_size = 0;
+
+/** @brief Set once the dispatch tables have been built, later changes of the
+ * object model keep them up to date from then on */
+static bool g_dispatch_tables_built = false;
+
 /** @brief Register a CIP Class to the message router
  *  @param cip_class Pointer to a class object to be registered.
  *  @return kEipStatusOk on success
@@ -36,6 +54,11 @@ CipMessageRouterObject *g_first_object = NULL;
  */
 EipStatus RegisterCipClass(CipClass *cip_class);
 
+/** @brief (Re)build the sorted class table from the class registry list
+ *  @return kEipStatusOk on success, kEipStatusError if no memory was available
+ */
+static EipStatus BuildClassDispatchTable(void);
+
 /** @brief Create Message Router Request structure out of the received data.
  *
  * Parses the UCMM header consisting of: service, IOI size, IOI, data into a request structure
@@ -112,6 +135,24 @@ EipStatus CipMessageRouterInit() {
  *      NULL .. Class not registered
  */
 CipMessageRouterObject *GetRegisteredObject(EipUint32 class_id) {
+  if(NULL != g_class_dispatch_table) {
+    size_t lower = 0;
+    size_t upper = g_class_dispatch_table_size;
+    while(lower < upper) {
+      const size_t middle = lower + (upper - lower) / 2;
+      CipMessageRouterObject *const object = g_class_dispatch_table[middle];
+      if(object->cip_class->class_code == class_id) {
+        return object;
+      }
+      if(object->cip_class->class_code < class_id) {
+        lower = middle + 1;
+      } else {
+        upper = middle;
+      }
+    }
+    return NULL;
+  }
+
   CipMessageRouterObject *object = g_first_object; /* get pointer to head of class registration list */
 
   while(NULL != object) /* for each entry in list*/
@@ -143,6 +184,23 @@ CipInstance *GetCipInstance(const CipClass *RESTRICT const cip_class,
     return (CipInstance *) cip_class; /* if the instance number is zero, return the class object itself*/
 
   }
+  if(NULL != cip_class->instance_table) {
+    size_t lower = 0;
+    size_t upper = cip_class->instance_table_size;
+    while(lower < upper) {
+      const size_t middle = lower + (upper - lower) / 2;
+      CipInstance *const instance = cip_class->instance_table[middle];
+      if(instance->instance_number == instance_number) {
+        return instance;
+      }
+      if(instance->instance_number < instance_number) {
+        lower = middle + 1;
+      } else {
+        upper = middle;
+      }
+    }
+    return NULL;
+  }
   /* pointer to linked list of instances from the class object*/
   for(CipInstance *instance = cip_class->instances; instance;
       instance = instance->next)                                                         /* follow the list*/
@@ -171,9 +229,169 @@ EipStatus RegisterCipClass(CipClass *cip_class) {
   (*message_router_object)->cip_class = cip_class; /* fill in the new node*/
   (*message_router_object)->next = NULL;
 
+  if(g_dispatch_tables_built) {
+    /* a class created after the stack initialization */
+    (void)BuildClassDispatchTable();
+    CipMessageRouterUpdateInstanceTable(cip_class);
+  }
+
+  return kEipStatusOk;
+}
+
+static int CompareRegisteredObjects(const void *first,
+                                    const void *second) {
+  const CipUdint first_code =
+    (*(CipMessageRouterObject *const *) first)->cip_class->class_code;
+  const CipUdint second_code =
+    (*(CipMessageRouterObject *const *) second)->cip_class->class_code;
+  return (first_code > second_code) - (first_code < second_code);
+}
+
+static int CompareInstances(const void *first,
+                            const void *second) {
+  const CipInstanceNum first_number =
+    (*(CipInstance *const *) first)->instance_number;
+  const CipInstanceNum second_number =
+    (*(CipInstance *const *) second)->instance_number;
+  return (first_number > second_number) - (first_number < second_number);
+}
+
+static EipStatus BuildClassDispatchTable(void) {
+  CipFree(g_class_dispatch_table);
+  g_class_dispatch_table = NULL;
+  g_class_dispatch_table_size = 0;
+
+  size_t number_of_classes = 0;
+  for(CipMessageRouterObject *object = g_first_object; NULL != object;
+      object = object->next) {
+    number_of_classes++;
+  }
+  if(0 == number_of_classes) {
+    return kEipStatusOk;
+  }
+
+  CipMessageRouterObject **table = CipCalloc(number_of_classes,
+                                             sizeof(CipMessageRouterObject *) );
+  if(NULL == table) {
+    OPENER_TRACE_WARN("No memory for the class dispatch table\n");
+    return kEipStatusError;
+  }
+  size_t index = 0;
+  for(CipMessageRouterObject *object = g_first_object; NULL != object;
+      object = object->next) {
+    table[index++] = object;
+  }
+  qsort(table, number_of_classes, sizeof(CipMessageRouterObject *),
+        CompareRegisteredObjects);
+
+  g_class_dispatch_table = table;
+  g_class_dispatch_table_size = number_of_classes;
   return kEipStatusOk;
 }
 
+void CipMessageRouterUpdateInstanceTable(CipClass *const cip_class) {
+  if(!g_dispatch_tables_built) {
+    return;
+  }
+
+  CipFree(cip_class->instance_table);
+  cip_class->instance_table = NULL;
+  cip_class->instance_table_size = 0;
+
+  size_t number_of_instances = 0;
+  for(CipInstance *instance = cip_class->instances; NULL != instance;
+      instance = instance->next) {
+    number_of_instances++;
+  }
+  if(0 == number_of_instances) {
+    return;
+  }
+
+  CipInstance **table = CipCalloc(number_of_instances, sizeof(CipInstance *) );
+  if(NULL == table) {
+    OPENER_TRACE_WARN("No memory for the instance table of class '%s'\n",
+                      cip_class->class_name);
+    return; /* GetCipInstance() walks the instance list instead */
+  }
+  size_t index = 0;
+  for(CipInstance *instance = cip_class->instances; NULL != instance;
+      instance = instance->next) {
+    table[index++] = instance;
+  }
+  qsort(table, number_of_instances, sizeof(CipInstance *), CompareInstances);
+
+  cip_class->instance_table = table;
+  cip_class->instance_table_size = (EipUint16) number_of_instances;
+}
+
+EipStatus CipMessageRouterBuildDispatchTables(void) {
+  g_dispatch_tables_built = true;
+  EipStatus status = BuildClassDispatchTable();
+  for(CipMessageRouterObject *object = g_first_object; NULL != object;
+      object = object->next) {
+    CipMessageRouterUpdateInstanceTable(object->cip_class);
+  }
+  return status;
+}
+
+/** @brief Encoded length of an attribute, SIZE_MAX if it is not known up front */
+static size_t GetAttributeResponseLength(
+  const CipAttributeStruct *const attribute) {
+  if(NULL == attribute || NULL == attribute->data) {
+    return 0;
+  }
+  if(kCipAny == attribute->type) {
+    return SIZE_MAX; /* structured attributes with their own encoder */
+  }
+  return GetCipDataTypeLength(attribute->type, attribute->data);
+}
+
+/** @brief Largest response data a request can produce
+ *
+ * Only the Get services return attribute data that may not fit into a small
+ * reply buffer, all other services reply with a few bytes.
+ *
+ * @param cip_class The addressed class
+ * @param message_router_request The parsed request
+ * @return Upper bound of the response data length, SIZE_MAX if unknown
+ */
+static size_t GetMaximumResponseDataLength(
+  const CipClass *const cip_class,
+  const CipMessageRouterRequest *const message_router_request) {
+  const CipInstance *const instance = GetCipInstance(cip_class,
+                                                     message_router_request->request_path.instance_number);
+  if(NULL == instance) {
+    return 0;
+  }
+  switch(message_router_request->service) {
+    case kGetAttributeSingle:
+      return GetAttributeResponseLength(GetCipAttribute(instance,
+                                                        message_router_request->request_path.attribute_number) );
+    case kGetAttributeAll: {
+      size_t length = 0;
+      for(EipUint16 attribute_number = 1;
+          attribute_number <= instance->cip_class->highest_attribute_number;
+          attribute_number++) {
+        if( (instance->cip_class->get_all_bit_mask[CalculateIndex(
+                                                     attribute_number)]) &
+            (1 << (attribute_number % 8) ) ) {
+          const size_t attribute_length = GetAttributeResponseLength(
+            GetCipAttribute(instance, attribute_number) );
+          if(SIZE_MAX == attribute_length) {
+            return SIZE_MAX;
+          }
+          length += attribute_length;
+        }
+      }
+      return length;
+    }
+    case kGetAttributeList:
+      return SIZE_MAX;
+    default:
+      return 0;
+  }
+}
+
 EipStatus NotifyMessageRouter(EipUint8 *data,
                               int data_length,
                               CipMessageRouterResponse *message_router_response,
@@ -195,6 +413,7 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
     message_router_response->reply_service =
       (0x80 | g_message_router_request.service);
   } else {
+    CipDiagnosticsExplicitRequestNoteService(g_message_router_request.service);
     /* forward request to appropriate Object if it is registered*/
     CipMessageRouterObject *registered_object = GetRegisteredObject(
       g_message_router_request.request_path.class_id);
@@ -207,6 +426,18 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
       message_router_response->reserved = 0;
       message_router_response->reply_service =
         (0x80 | g_message_router_request.service);
+    } else if(kEipStatusOk !=
+              EnlargeMessageRouterResponse(message_router_response,
+                                           GetMaximumResponseDataLength(
+                                             registered_object->cip_class,
+                                             &g_message_router_request) ) ) {
+      OPENER_TRACE_WARN(
+        "NotifyMessageRouter: no message buffer for a large reply\n");
+      message_router_response->general_status = kCipErrorResourceUnavailable;
+      message_router_response->size_of_additional_status = 0;
+      message_router_response->reserved = 0;
+      message_router_response->reply_service =
+        (0x80 | g_message_router_request.service);
     } else {
       /* call notify function from Object with ClassID (gMRRequest.RequestPath.ClassID)
          object will or will not make an reply into gMRResponse*/
@@ -288,6 +519,7 @@ void DeleteAllClasses(void) {
       }
       CipFree(instance_to_delete);
     }
+    CipFree(message_router_object_to_delete->cip_class->instance_table);
 
     /* free meta class data*/
     CipClass *meta_class =
@@ -312,4 +544,9 @@ void DeleteAllClasses(void) {
     CipFree(message_router_object_to_delete);
   }
   g_first_object = NULL;
+
+  CipFree(g_class_dispatch_table);
+  g_class_dispatch_table = NULL;
+  g_class_dispatch_table_size = 0;
+  g_dispatch_tables_built = false;
 }
@@ -50,4 +50,25 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
  */
 EipStatus RegisterCipClass(CipClass *cip_class);
 
+/** @brief Build the lookup tables used to dispatch explicit requests
+ *
+ *  Creates a table of all registered classes sorted by class code and for
+ *  each class a table of its instances sorted by instance number, so that
+ *  class and instance resolution are binary searches instead of list walks.
+ *  Called once CipStackInit() has created all objects. Classes registered
+ *  and instances added or deleted afterwards update the tables.
+ *
+ *  @return kEipStatusOk on success, kEipStatusError if no memory was
+ *          available, the lookups then fall back to walking the lists
+ */
+EipStatus CipMessageRouterBuildDispatchTables(void);
+
+/** @brief Rebuild the instance table of a class after its instances changed
+ *
+ *  Does nothing before CipMessageRouterBuildDispatchTables() has been called.
+ *
+ *  @param cip_class The class whose instances were added or deleted
+ */
+void CipMessageRouterUpdateInstanceTable(CipClass *const cip_class);
+
 #endif /* OPENER_CIPMESSAGEROUTER_H_ */
@@ -288,6 +288,8 @@ typedef struct {
                                                             If SizeOfAdditionalStatus is 0. there is no
                                                             Additional Status */
   ENIPMessage message;   /* The constructed message */
+  ENIPMessage *reply;   /**< Outgoing message holding the response buffer, see
+                           EnlargeMessageRouterResponse() */
 } CipMessageRouterResponse;
 
 /** @brief self-describing data encoding for CIP types */
@@ -383,6 +385,9 @@ typedef struct cip_class {
 
   EipUint16 number_of_services;   /**< number of services supported */
   CipInstance *instances;   /**< pointer to the list of instances */
+  CipInstance **instance_table;   /**< instances sorted by instance number,
+                                     built by the message router for lookups */
+  EipUint16 instance_table_size;   /**< number of entries in instance_table */
   struct cip_service_struct *services;   /**< pointer to the array of services */
   char *class_name;   /**< class name */
   /** Is called in GetAttributeSingle* before the response is assembled from
@@ -29,10 +29,72 @@ const EipUint16 kSequencedAddressItemLength = 8;
 
 CipCommonPacketFormatData g_common_packet_format_data_item; /**< CPF global data items */
 
-static void InitializeMessageRouterResponse(
-  CipMessageRouterResponse *const message_router_response) {
+/* Largest part of a reply in front of the message router response data: the
+ * encapsulation header, interface handle and timeout, item count, a sequenced
+ * address item, the data item header with sequence number and the reply header
+ * with the additional status */
+static const size_t kReplyHeadroom = ENCAPSULATION_HEADER_LENGTH + 4 + 2 + 2 +
+                                     12 + 6 + 4 + 2 * MAX_SIZE_OF_ADD_STATUS;
+/* Behind the response data: both socket address info items */
+static const size_t kReplyTailroom = 2 * (4 + 16);
+
+/** @brief Initializes a message router response inside the outgoing message
+ *
+ * The response is encoded behind the headroom of the outgoing message buffer
+ * and moved to its final place by AssembleLinearMessage(), so a request only
+ * holds one pool buffer and the response can never outgrow the reply.
+ *
+ * @param message_router_response The response to initialize
+ * @param outgoing_message The message the response will be assembled into
+ * @return kEipStatusOk on success, kEipStatusError if the outgoing message is
+ * too small for a reply
+ */
+static EipStatus InitializeMessageRouterResponse(
+  CipMessageRouterResponse *const message_router_response,
+  ENIPMessage *const outgoing_message) {
   memset(message_router_response, 0, sizeof(*message_router_response) );
-  InitializeENIPMessage(&message_router_response->message);
+  if(outgoing_message->message_buffer_size <=
+     kReplyHeadroom + kReplyTailroom) {
+    return kEipStatusError;
+  }
+  ENIPMessageAttachBuffer(&message_router_response->message,
+                          &outgoing_message->message_buffer[kReplyHeadroom],
+                          outgoing_message->message_buffer_size -
+                          kReplyHeadroom - kReplyTailroom);
+  message_router_response->reply = outgoing_message;
+  return kEipStatusOk;
+}
+
+EipStatus EnlargeMessageRouterResponse(
+  CipMessageRouterResponse *const message_router_response,
+  const size_t data_length) {
+  ENIPMessage *const outgoing_message = message_router_response->reply;
+  if(data_length <= message_router_response->message.message_buffer_size) {
+    return kEipStatusOk;
+  }
+  if(NULL == outgoing_message || !outgoing_message->message_buffer_is_pooled) {
+    return kEipStatusOk; /* caller owned buffers are kept */
+  }
+  size_t buffer_size = OPENER_MAXIMUM_MESSAGE_SIZE;
+  if(data_length < OPENER_MAXIMUM_MESSAGE_SIZE - kReplyHeadroom -
+     kReplyTailroom) {
+    buffer_size = kReplyHeadroom + data_length + kReplyTailroom;
+  }
+  if(buffer_size <= outgoing_message->message_buffer_size) {
+    return kEipStatusOk; /* already the largest buffer there is */
+  }
+  ENIPMessage enlarged_message;
+  if(kEipStatusOk !=
+     ENIPMessageAllocateBuffer(&enlarged_message, buffer_size) ) {
+    return kEipStatusError;
+  }
+  ENIPMessageFreeBuffer(outgoing_message);
+  *outgoing_message = enlarged_message;
+  ENIPMessageAttachBuffer(&message_router_response->message,
+                          &outgoing_message->message_buffer[kReplyHeadroom],
+                          outgoing_message->message_buffer_size -
+                          kReplyHeadroom - kReplyTailroom);
+  return kEipStatusOk;
 }
 
 EipStatus NotifyCommonPacketFormat(const EncapsulationData *const received_data,
@@ -40,7 +102,12 @@ EipStatus NotifyCommonPacketFormat(const EncapsulationData *const received_data,
                                    ENIPMessage *const outgoing_message) {
   EipStatus return_value = kEipStatusError;
   CipMessageRouterResponse message_router_response;
-  InitializeMessageRouterResponse(&message_router_response);
+  if( kEipStatusOk !=
+      InitializeMessageRouterResponse(&message_router_response,
+                                      outgoing_message) ) {
+    OPENER_TRACE_ERR("notifyCPF: outgoing message too small for a reply\n");
+    return kEipStatusError;
+  }
 
   if(kEipStatusError
      == (return_value =
@@ -144,12 +211,19 @@ EipStatus NotifyConnectedCommonPacketFormat(
             "Class 3 sequence number: %" PRIu32 ", last sequence number: %u\n",
             g_common_packet_format_data_item.address_item.data.sequence_number,
             (unsigned int)connection_object->sequence_count_consuming);
-          if(connection_object->sequence_count_consuming ==
-             g_common_packet_format_data_item.address_item.data.sequence_number)
+          /* Replies which did not fit into the reply cache of the connection
+           * are not stored, the repeated request is processed again. */
+          if( (connection_object->sequence_count_consuming ==
+               g_common_packet_format_data_item.address_item.data.sequence_number)
+              && (0 != connection_object->last_reply_sent_length)
+              && (connection_object->last_reply_sent_length <=
+                  outgoing_message->message_buffer_size) )
           {
-            memcpy(outgoing_message,
-                   &(connection_object->last_reply_sent),
-                   sizeof(ENIPMessage) );
+            memcpy(outgoing_message->message_buffer,
+                   connection_object->last_reply_sent,
+                   connection_object->last_reply_sent_length);
+            outgoing_message->used_message_length =
+              connection_object->last_reply_sent_length;
             outgoing_message->current_message_position =
               outgoing_message->message_buffer;
             /* Regenerate encapsulation header for new message */
@@ -170,7 +244,13 @@ EipStatus NotifyConnectedCommonPacketFormat(
           ConnectionObjectResetInactivityWatchdogTimerValue(connection_object);
 
           CipMessageRouterResponse message_router_response;
-          InitializeMessageRouterResponse(&message_router_response);
+          if( kEipStatusOk !=
+              InitializeMessageRouterResponse(&message_router_response,
+                                              outgoing_message) ) {
+            OPENER_TRACE_ERR(
+              "notifyConnectedCPF: outgoing message too small for a reply\n");
+            return kEipStatusError;
+          }
           return_value = NotifyMessageRouter(buffer,
                                              g_common_packet_format_data_item.data_item.length - 2,
                                              &message_router_response,
@@ -198,9 +278,15 @@ EipStatus NotifyConnectedCommonPacketFormat(
                                         kEncapsulationProtocolSuccess,
                                         outgoing_message);
             outgoing_message->current_message_position = pos;
-            memcpy(&connection_object->last_reply_sent,
-                   outgoing_message,
-                   sizeof(ENIPMessage) );
+            connection_object->last_reply_sent_length = 0;
+            if(outgoing_message->used_message_length <=
+               sizeof(connection_object->last_reply_sent) ) {
+              memcpy(connection_object->last_reply_sent,
+                     outgoing_message->message_buffer,
+                     outgoing_message->used_message_length);
+              connection_object->last_reply_sent_length =
+                outgoing_message->used_message_length;
+            }
             return_value = kEipStatusOkSend;
           }
         } else {
@@ -572,9 +658,11 @@ void EncodeUnconnectedDataItemLength(
 void EncodeMessageRouterResponseData(
   const CipMessageRouterResponse *const message_router_response,
   ENIPMessage *const outgoing_message) {
-  memcpy(outgoing_message->current_message_position,
-         message_router_response->message.message_buffer,
-         message_router_response->message.used_message_length);
+  /* the response is encoded in the same buffer behind the headroom, see
+   * InitializeMessageRouterResponse() */
+  memmove(outgoing_message->current_message_position,
+          message_router_response->message.message_buffer,
+          message_router_response->message.used_message_length);
 
   outgoing_message->current_message_position +=
     message_router_response->message.used_message_length;
@@ -71,6 +71,23 @@ typedef struct {
   SocketAddressInfoItem address_info_item[2];
 } CipCommonPacketFormatData;
 
+/** @ingroup ENCAP
+ * @brief Moves a message router response to a larger reply buffer
+ *
+ * Replies start out in a small buffer of the message buffer pool. The message
+ * router calls this before a service that returns more data than fits, so
+ * the reply moves to a large buffer before anything has been encoded.
+ *
+ * @param message_router_response The response, nothing encoded yet
+ * @param data_length Needed length of the response data
+ * @return kEipStatusOk if the response data fits, the largest buffer is
+ * already used or the buffer is caller owned, kEipStatusError if no larger
+ * buffer is available
+ */
+EipStatus EnlargeMessageRouterResponse(
+  CipMessageRouterResponse *const message_router_response,
+  const size_t data_length);
+
 /** @ingroup ENCAP
  * Parse the CPF data from a received unconnected explicit message and
  * hand the data on to the message router
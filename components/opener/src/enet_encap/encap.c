@@ -60,18 +60,58 @@ typedef enum {
 
 #define ENCAP_NUMBER_OF_SUPPORTED_DELAYED_ENCAP_MESSAGES 2 /**< According to EIP spec at least 2 delayed message requests should be supported */
 
+/** Size of the CIP Identity item without the product name: item id, item
+ * length, protocol version, socket address, vendor id, device type, product
+ * code, revision, status, serial number, name length and state */
+#define ENCAP_LIST_IDENTITY_ITEM_FIXED_LENGTH (2 + 2 + 2 + 16 + 2 + 2 + 2 + 2 + 2 + 4 + 1 + 1)
+
+/** Largest possible CIP Identity item, the product name is a SHORT_STRING */
+#define ENCAP_LIST_IDENTITY_ITEM_MAXIMUM_LENGTH (ENCAP_LIST_IDENTITY_ITEM_FIXED_LENGTH + UINT8_MAX)
+
+/** Size of the ListServices command specific data: item count and one
+ * Communications service item */
+#define ENCAP_LIST_SERVICES_DATA_LENGTH (2 + 2 + 2 + 2 + 2 + 16)
+
 /* Encapsulation layer data  */
 
-/** @brief Delayed Encapsulation Message structure */
+/** @brief Delayed Encapsulation Message structure
+ *
+ * Only ListIdentity responses are delayed. The response is assembled from the
+ * cached identity item when it is sent, so only the data of the request that
+ * goes into the reply header is kept here.
+ */
 typedef struct {
   EipInt32 time_out; /**< time out in milli seconds */
   int socket; /**< associated socket */
   struct sockaddr_in receiver;
-  ENIPMessage outgoing_message;
+  CipOctet sender_context[8]; /**< sender context of the request */
 } DelayedEncapsulationMessage;
 
+/** @brief Pre-encoded CIP Identity item of the ListIdentity response
+ *
+ * The item is re-encoded only if one of the values it was encoded from and
+ * which can change at runtime differs from the copy kept here.
+ */
+typedef struct {
+  bool valid;
+  CipWord status;
+  CipUsint state;
+  CipUdint serial_number;
+  CipUdint ip_address;
+  CipUsint product_name_length;
+  CipOctet product_name[UINT8_MAX];
+  size_t item_length;
+  CipOctet item[ENCAP_LIST_IDENTITY_ITEM_MAXIMUM_LENGTH];
+} ListIdentityCache;
+
 EncapsulationServiceInformation g_service_information;
 
+static ListIdentityCache g_list_identity_cache;
+
+/** @brief Pre-encoded command specific data of the ListServices response,
+ * g_service_information does not change after EncapsulationInit() */
+static CipOctet g_list_services_data[ENCAP_LIST_SERVICES_DATA_LENGTH];
+
 int g_registered_sessions[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
 
 DelayedEncapsulationMessage g_delayed_encapsulation_messages[ENCAP_NUMBER_OF_SUPPORTED_DELAYED_ENCAP_MESSAGES];
@@ -96,6 +136,10 @@ SessionStatus CheckRegisteredSessions(const EncapsulationData *const receive_dat
 
 void DetermineDelayTime(const EipByte *buffer_start, DelayedEncapsulationMessage *const delayed_message_buffer);
 
+static void EncodeListServicesData(void);
+
+static const ListIdentityCache *GetListIdentityCache(void);
+
 /*   @brief Initializes session list and interface information. */
 void EncapsulationInit(void) {
 
@@ -121,6 +165,9 @@ void EncapsulationInit(void) {
   g_service_information.encapsulation_protocol_version = 1;
   g_service_information.capability_flags = kCapabilityFlagsCipTcp | kCapabilityFlagsCipUdpClass0or1;
   snprintf((char*) g_service_information.name_of_service, sizeof(g_service_information.name_of_service), "Communications");
+  EncodeListServicesData();
+
+  EncapsulationInvalidateListIdentityCache();
 }
 
 EipStatus HandleReceivedExplictTcpData(int socket, EipUint8 *buffer, size_t length, int *number_of_remaining_bytes, struct sockaddr *originator_address,
@@ -300,15 +347,26 @@ void HandleReceivedListServicesCommand(const EncapsulationData *const receive_da
   /* Protocol status */
   outgoing_message);
 
-  /* Command specific data copy Interface data to msg for sending */
-  AddIntToMessage(1, outgoing_message); // Item count
-  AddIntToMessage(g_service_information.type_code, outgoing_message);
-  AddIntToMessage((EipUint16) (g_service_information.length - 4), outgoing_message);
-  AddIntToMessage(g_service_information.encapsulation_protocol_version, outgoing_message);
-  AddIntToMessage(g_service_information.capability_flags, outgoing_message);
-  memcpy(outgoing_message->current_message_position, g_service_information.name_of_service, sizeof(g_service_information.name_of_service));
-  outgoing_message->current_message_position += sizeof(g_service_information.name_of_service);
-  outgoing_message->used_message_length += sizeof(g_service_information.name_of_service);
+  /* Command specific data, encoded once in EncapsulationInit() */
+  memcpy(outgoing_message->current_message_position, g_list_services_data, sizeof(g_list_services_data));
+  outgoing_message->current_message_position += sizeof(g_list_services_data);
+  outgoing_message->used_message_length += sizeof(g_list_services_data);
+}
+
+/** @brief Encode the item count and Communications service item of the
+ * ListServices response into g_list_services_data */
+static void EncodeListServicesData(void) {
+  ENIPMessage message;
+  ENIPMessageAttachBuffer(&message, g_list_services_data, sizeof(g_list_services_data));
+
+  AddIntToMessage(1, &message); // Item count
+  AddIntToMessage(g_service_information.type_code, &message);
+  AddIntToMessage((EipUint16) (g_service_information.length - 4), &message);
+  AddIntToMessage(g_service_information.encapsulation_protocol_version, &message);
+  AddIntToMessage(g_service_information.capability_flags, &message);
+  memcpy(message.current_message_position, g_service_information.name_of_service, sizeof(g_service_information.name_of_service));
+  message.used_message_length += sizeof(g_service_information.name_of_service);
+  OPENER_ASSERT(sizeof(g_list_services_data) == message.used_message_length);
 }
 
 void HandleReceivedListInterfacesCommand(const EncapsulationData *const receive_data, ENIPMessage *const outgoing_message) {
@@ -332,14 +390,10 @@ void HandleReceivedListIdentityCommandUdp(const int socket,
                                           const EncapsulationData *const receive_data)
 {
   DelayedEncapsulationMessage *delayed_message_buffer = NULL;
-  ENIPMessage *p_outgoing_message = NULL;
 
   for(size_t i = 0; i < ENCAP_NUMBER_OF_SUPPORTED_DELAYED_ENCAP_MESSAGES; i++) {
     if(kEipInvalidSocket == g_delayed_encapsulation_messages[i].socket) {
       delayed_message_buffer = &(g_delayed_encapsulation_messages[i]);
-
-      p_outgoing_message = &(delayed_message_buffer->outgoing_message);
-      InitializeENIPMessage(p_outgoing_message);
       break;
     }
   }
@@ -347,10 +401,9 @@ void HandleReceivedListIdentityCommandUdp(const int socket,
   if(NULL != delayed_message_buffer) {
     delayed_message_buffer->socket = socket;
     memcpy((&delayed_message_buffer->receiver), from_address, sizeof(struct sockaddr_in));
+    memcpy(delayed_message_buffer->sender_context, receive_data->sender_context, sizeof(delayed_message_buffer->sender_context));
 
     DetermineDelayTime(receive_data->communication_buffer_start, delayed_message_buffer);
-
-    EncapsulateListIdentityResponseMessage(receive_data, p_outgoing_message);
   }
 }
 
@@ -389,17 +442,51 @@ void EncodeListIdentityCipIdentityItem(ENIPMessage *const outgoing_message) {
   AddSintToMessage(g_identity.state, outgoing_message);
 }
 
+void EncapsulationInvalidateListIdentityCache(void) {
+  g_list_identity_cache.valid = false;
+}
+
+/** @brief Return the cached CIP Identity item, re-encode it first if any of
+ * the values it depends on changed since it was encoded */
+static const ListIdentityCache *GetListIdentityCache(void) {
+  ListIdentityCache *const cache = &g_list_identity_cache;
+
+  if(cache->valid && cache->status == g_identity.status && cache->state == g_identity.state
+    && cache->serial_number == g_identity.serial_number && cache->ip_address == g_tcpip.interface_configuration.ip_address
+    && cache->product_name_length == g_identity.product_name.length
+    && 0 == memcmp(cache->product_name, g_identity.product_name.string, g_identity.product_name.length)) {
+    return cache;
+  }
+
+  cache->status = g_identity.status;
+  cache->state = g_identity.state;
+  cache->serial_number = g_identity.serial_number;
+  cache->ip_address = g_tcpip.interface_configuration.ip_address;
+  cache->product_name_length = (CipUsint) g_identity.product_name.length;
+  memcpy(cache->product_name, g_identity.product_name.string, g_identity.product_name.length);
+
+  ENIPMessage message;
+  ENIPMessageAttachBuffer(&message, cache->item, sizeof(cache->item));
+  EncodeListIdentityCipIdentityItem(&message);
+  cache->item_length = message.used_message_length;
+  cache->valid = true;
+
+  return cache;
+}
+
 void EncapsulateListIdentityResponseMessage(const EncapsulationData *const receive_data, ENIPMessage *const outgoing_message) {
 
-  const CipUint kEncapsulationCommandListIdentityLength = ListIdentityGetCipIdentityItemLength() + sizeof(CipUint) + sizeof(CipUint) + sizeof(CipUint); /* Last element is item count */
+  const ListIdentityCache *const cache = GetListIdentityCache();
+  const CipUint kEncapsulationCommandListIdentityLength = (CipUint) (cache->item_length + sizeof(CipUint)); /* Last element is item count */
 
   GenerateEncapsulationHeader(receive_data, kEncapsulationCommandListIdentityLength, 0,
   /* Session handle will be ignored by receiver */
   kEncapsulationProtocolSuccess, outgoing_message);
 
   AddIntToMessage(1, outgoing_message); /* Item count: one item */
-  EncodeListIdentityCipIdentityItem(outgoing_message);
-
+  memcpy(outgoing_message->current_message_position, cache->item, cache->item_length);
+  outgoing_message->current_message_position += cache->item_length;
+  outgoing_message->used_message_length += cache->item_length;
 }
 
 void DetermineDelayTime(const EipByte *buffer_start, DelayedEncapsulationMessage *const delayed_message_buffer) {
@@ -687,9 +774,16 @@ void ManageEncapsulationMessages(const MilliSeconds elapsed_time) {
     if(kEipInvalidSocket != g_delayed_encapsulation_messages[i].socket) {
       g_delayed_encapsulation_messages[i].time_out -= elapsed_time;
       if(0 >= g_delayed_encapsulation_messages[i].time_out) {
-        /* If delay is reached or passed, send the UDP message */
-        sendto(g_delayed_encapsulation_messages[i].socket, (char*) g_delayed_encapsulation_messages[i].outgoing_message.message_buffer,
-          g_delayed_encapsulation_messages[i].outgoing_message.used_message_length, 0, (struct sockaddr*) &(g_delayed_encapsulation_messages[i].receiver),
+        /* If delay is reached or passed, assemble the response from the
+         * cached identity item and send the UDP message */
+        EncapsulationData request = { .command_code = kEncapsulationCommandListIdentity };
+        memcpy(request.sender_context, g_delayed_encapsulation_messages[i].sender_context, sizeof(request.sender_context));
+        CipOctet buffer[ENCAPSULATION_HEADER_LENGTH + sizeof(CipUint) + ENCAP_LIST_IDENTITY_ITEM_MAXIMUM_LENGTH];
+        ENIPMessage outgoing_message;
+        ENIPMessageAttachBuffer(&outgoing_message, buffer, sizeof(buffer));
+        EncapsulateListIdentityResponseMessage(&request, &outgoing_message);
+        sendto(g_delayed_encapsulation_messages[i].socket, (char*) outgoing_message.message_buffer,
+          outgoing_message.used_message_length, 0, (struct sockaddr*) &(g_delayed_encapsulation_messages[i].receiver),
           sizeof(struct sockaddr));
         g_delayed_encapsulation_messages[i].socket = kEipInvalidSocket;
       }
@@ -79,6 +79,16 @@ void EncapsulationShutDown(void);
  */
 void ManageEncapsulationMessages(const MilliSeconds elapsed_time);
 
+/** @ingroup ENCAP
+ * @brief Discard the cached ListIdentity item
+ *
+ * The encoded CIP Identity item is cached and re-encoded automatically when
+ * the identity status or state, the serial number, the IP address or the
+ * product name change. Call this after changing any other identity value
+ * that is reported by ListIdentity at runtime.
+ */
+void EncapsulationInvalidateListIdentityCache(void);
+
 CipSessionHandle GetSessionFromSocket(const int socket_handle);
 
 void RemoveSession(const int socket);
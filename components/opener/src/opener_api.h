@@ -17,6 +17,7 @@
 #define OPENER_OPENER_API_H_
 
 #include <assert.h>
+#include <signal.h>
 #include <stdbool.h>
 
 #include "typedefs.h"
@@ -66,7 +67,7 @@ EipStatus IfaceGetMacAddress(TcpIpInterface *iface,
  *
  * @param  iface      address specifying the network interface
  * @param  timeout    in seconds; max: INT_MAX/10, -1: wait for ever
- * @param  abort_wait stop waiting if this parameter becomes zero
+ * @param  abort_wait stop waiting if this parameter becomes non zero
  * @return            kEipStatusOk on success,
  *                    kEipStatusError on error with @p errno set
  *
@@ -77,7 +78,7 @@ EipStatus IfaceGetMacAddress(TcpIpInterface *iface,
  */
 EipStatus IfaceWaitForIp(TcpIpInterface *const iface,
                          int timeout,
-                         volatile int *const abort_wait);
+                         volatile sig_atomic_t *const abort_wait);
 
 #if defined(STM32) || defined(ESP32)  /** STM32 or ESP32 target, the hostname is linked to the network interface */
 /** @ingroup CIP_API
@@ -581,6 +582,11 @@ int DecodeCipShortString(CipShortString *const data,
  * @param data_length   length of the assembly object's data
  * @return pointer to the instance of the created assembly object. NULL on error
  *
+ * At most OPENER_ASSEMBLY_NUMBER_OF_INSTANCES assembly objects can be created.
+ * Their data outlives a shutdown of the stack, so other tasks can keep using
+ * AssemblyUpdateData() and AssemblyReadData(). When the stack is initialized
+ * again an assembly object has to be created with the same data and length.
+ *
  * Assembly Objects for Configuration Data:
  *
  * The CIP stack treats configuration assembly objects the same way as any other
@@ -594,6 +600,90 @@ CipInstance *CreateAssemblyObject(const CipInstanceNum instance_number,
                                   EipByte *const data,
                                   const EipUint16 data_length);
 
+/** @ingroup CIP_API
+ * @brief Mark a byte range of an assembly object's data as changed
+ *
+ * Change-of-state and application triggered connections producing the assembly
+ * are produced at the next tick, but not before their production inhibit time
+ * has passed. Without changes they only produce a heartbeat at their RPI. All
+ * producing connections increment their CIP sequence count on the next
+ * production after a change.
+ *
+ * A connection always carries the whole assembly, the range is only checked
+ * against the assembly's size. Can be called from any task. Data written
+ * directly into the assembly's buffer is not protected against concurrent
+ * readers, tasks other than the OpENer task should use AssemblyUpdateData().
+ *
+ * @param instance_number instance number of the assembly object
+ * @param offset first changed byte
+ * @param length number of changed bytes
+ * @return kEipStatusOk on success, kEipStatusError if the assembly does not
+ * exist or the range exceeds its data
+ */
+EipStatus AssemblyMarkDataChanged(const CipInstanceNum instance_number,
+                                  const size_t offset,
+                                  const size_t length);
+
+/** @ingroup CIP_API
+ * @brief Copy data into an assembly object and mark it changed if it differs
+ *
+ * Convenience for applications sampling values periodically, unchanged samples
+ * do not trigger any production. See AssemblyMarkDataChanged(). The range is
+ * published as a whole, readers see either the old or the new data. Writers
+ * are serialized by a short critical section and never wait for readers.
+ *
+ * @param instance_number instance number of the assembly object
+ * @param offset first byte to be written
+ * @param data new data
+ * @param length number of bytes to be written
+ * @return kEipStatusOk on success, kEipStatusError if the assembly does not
+ * exist or the range exceeds its data
+ */
+EipStatus AssemblyUpdateData(const CipInstanceNum instance_number,
+                             const size_t offset,
+                             const EipUint8 *const data,
+                             const size_t length);
+
+/** @ingroup CIP_API
+ * @brief Update selected bits of an assembly object and mark it changed if
+ * any of them differ
+ *
+ * Like AssemblyUpdateData(), but only the bits set in @p mask are taken from
+ * @p data. The read-modify-write happens inside the writer's critical section,
+ * so bits updated concurrently by other writers are not lost.
+ *
+ * @param instance_number instance number of the assembly object
+ * @param offset first byte to be updated
+ * @param data new bit values
+ * @param mask bits of each byte to be updated
+ * @param length number of bytes to be updated
+ * @return kEipStatusOk on success, kEipStatusError if the assembly does not
+ * exist or the range exceeds its data
+ */
+EipStatus AssemblyUpdateDataMasked(const CipInstanceNum instance_number,
+                                   const size_t offset,
+                                   const EipUint8 *const data,
+                                   const EipUint8 *const mask,
+                                   const size_t length);
+
+/** @ingroup CIP_API
+ * @brief Copy a consistent snapshot of a byte range of an assembly object
+ *
+ * Never blocks: writers publish their data with AssemblyUpdateData() under a
+ * sequence lock and the copy is repeated if a writer was active meanwhile.
+ *
+ * @param instance_number instance number of the assembly object
+ * @param offset first byte to be read
+ * @param data buffer receiving the bytes
+ * @param length number of bytes to be read
+ * @return kEipStatusOk on success, kEipStatusError if the assembly does not
+ * exist or the range exceeds its data
+ */
+EipStatus AssemblyReadData(const CipInstanceNum instance_number,
+                           const size_t offset,
+                           EipUint8 *const data,
+                           const size_t length);
+
 typedef struct cip_connection_object CipConnectionObject;
 
 /** @ingroup CIP_API
@@ -787,13 +877,15 @@ EipStatus HandleReceivedConnectedData(const EipUint8 *const received_data,
                                       struct sockaddr_in *from_address);
 
 /** @ingroup CIP_API
- * @brief Check if any of the connection timers (TransmissionTrigger or
- * WatchdogTimeout) have timed out.
+ * @brief Run the periodic tasks of the stack (application handler, delayed
+ * encapsulation messages).
  *
- * If the a timeout occurs the function performs the necessary action. This
- * function should be called periodically once every @ref kOpenerTimerTickInMilliSeconds
+ * This function should be called periodically once every @ref kOpenerTimerTickInMilliSeconds
  * milliseconds. In order to simplify the algorithm if more time was lapsed, the elapsed
  * time since the last call of the function is given as a parameter.
+ * The TransmissionTrigger and WatchdogTimeout timers of the connections are
+ * not handled here, they are driven by absolute deadlines in the network
+ * handler's timer queue.
  *
  * @param elapsed_time Elapsed time in milliseconds since the last call of ManageConnections
  *
@@ -812,7 +904,8 @@ EipStatus ManageConnections(MilliSeconds elapsed_time);
  * be invoked from void HandleApplication(void).
  *
  * The connection can only be triggered if the application is established and it
- * is of application application triggered type.
+ * is of application triggered or change-of-state type. Applications which
+ * only want to signal new data should use AssemblyMarkDataChanged() instead.
  *
  * @param output_assembly_id the output assembly connection point of the
  * connection
@@ -902,7 +995,8 @@ EipStatus AfterAssemblyDataReceived(CipInstance *instance);
  *
  * Within this function the user can update the data of the assembly object
  * before it gets sent. The application can inform the application if data has
- * changed.
+ * changed. Changes already marked with AssemblyMarkDataChanged() do not have to
+ * be reported again.
  * @param instance instance of assembly object that should send data.
  * @return data has changed:
  *          - true assembly data has changed
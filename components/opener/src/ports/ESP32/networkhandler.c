@@ -12,9 +12,49 @@
 #include "opener_user_conf.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
+
+#if defined(OPENER_IO_ZERO_COPY_PRODUCING) && 0 != OPENER_IO_ZERO_COPY_PRODUCING
+#include <string.h>
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/tcpip.h"
+#include "generic_networkhandler.h"
+#include "ciptcpipinterface.h"
+#endif
+
+/* MODIFICATION: Use the 64 bit esp_timer as monotonic time base
+ * Added by: Adam G. Sweeney <agsweeney@gmail.com>
+ * Rationale: The FreeRTOS tick count only has a resolution of one tick (10 ms at
+ * CONFIG_FREERTOS_HZ=100), which is too coarse for the deadline driven network
+ * handler loop.
+ */
+MicroSeconds GetMicroSeconds(void) {
+  return (MicroSeconds)esp_timer_get_time();
+}
 
 MilliSeconds GetMilliSeconds(void) {
-  return (MilliSeconds)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+  return (MilliSeconds)(esp_timer_get_time() / 1000);
+}
+
+const void *GetCurrentTaskId(void) {
+  return xTaskGetCurrentTaskHandle();
+}
+
+/* MODIFICATION: Spinlock based critical section for the assembly writers
+ * Added by: Adam G. Sweeney <agsweeney@gmail.com>
+ * Rationale: A writer can neither be preempted nor migrate while it holds the
+ * section, so the I/O readers on the other core only retry for the duration of
+ * a short copy and no priority inversion is possible.
+ */
+static portMUX_TYPE s_critical_section_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void EnterCriticalSectionPlatform(void) {
+  portENTER_CRITICAL(&s_critical_section_lock);
+}
+
+void LeaveCriticalSectionPlatform(void) {
+  portEXIT_CRITICAL(&s_critical_section_lock);
 }
 
 EipStatus NetworkHandlerInitializePlatform(void) {
@@ -49,3 +89,76 @@ int SetQosOnSocket(const int socket,
   return setsockopt(socket, IPPROTO_IP, IP_TOS, &set_tos, sizeof(set_tos));
 }
 
+
+/* MODIFICATION: Zero copy producing path for I/O connections
+ * Added by: Adam G. Sweeney <agsweeney@gmail.com>
+ * Rationale: With the socket API the assembly data of every produced frame is
+ * copied into an ENIPMessage and again into a pbuf by the socket layer. Here the
+ * frame is written straight into a PBUF_RAM pbuf and sent with udp_sendto().
+ * A chain with a PBUF_REF payload would not save the copy, the ESP-IDF netif
+ * glue flattens chained pbufs before transmission.
+ */
+#if defined(OPENER_IO_ZERO_COPY_PRODUCING) && 0 != OPENER_IO_ZERO_COPY_PRODUCING
+
+#if !LWIP_TCPIP_CORE_LOCKING
+#error "OPENER_IO_ZERO_COPY_PRODUCING requires CONFIG_LWIP_TCPIP_CORE_LOCKING"
+#endif
+
+/** Send only PCB, never bound so that it does not take datagrams away from the
+ * I/O messaging socket listening on the same port */
+static struct udp_pcb *s_io_producing_pcb = NULL;
+
+EipStatus SendUdpFramePlatform(const CipUdint ip_address,
+                               const CipUint port,
+                               const CipUsint dscp,
+                               const CipOctet *const header,
+                               const size_t header_length,
+                               UdpPayloadCopyFunction copy_payload,
+                               const void *const payload,
+                               const size_t payload_length) {
+  if(header_length + payload_length > 0xFFFF) {
+    return kEipStatusError;
+  }
+  EipStatus status = kEipStatusError;
+
+  LOCK_TCPIP_CORE();
+  if(NULL == s_io_producing_pcb) {
+    s_io_producing_pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+    if(NULL != s_io_producing_pcb) {
+      /* udp_sendto() only binds a PCB without a local port */
+      s_io_producing_pcb->local_port = kOpenerEipIoUdpPort;
+    }
+  }
+
+  struct pbuf *frame = NULL;
+  if(NULL != s_io_producing_pcb) {
+    frame = pbuf_alloc(PBUF_TRANSPORT,
+                       (u16_t)(header_length + payload_length),
+                       PBUF_RAM);
+  }
+  if(NULL != frame) {
+    memcpy(frame->payload, header, header_length);
+    copy_payload( (CipOctet *)frame->payload + header_length, payload,
+                  payload_length );
+
+    s_io_producing_pcb->tos = (u8_t)(dscp << 2);
+    udp_set_multicast_ttl(s_io_producing_pcb, g_tcpip.mcast_ttl_value);
+    ip_addr_t local_address = IPADDR4_INIT(g_network_status.ip_address);
+    udp_set_multicast_netif_addr(s_io_producing_pcb,
+                                 ip_2_ip4(&local_address) );
+
+    ip_addr_t destination = IPADDR4_INIT(ip_address);
+    if( ERR_OK == udp_sendto(s_io_producing_pcb, frame, &destination,
+                             lwip_ntohs(port) ) ) {
+      status = kEipStatusOk;
+    }
+    pbuf_free(frame);
+  }
+  UNLOCK_TCPIP_CORE();
+
+  if(kEipStatusOk != status) {
+    OPENER_TRACE_ERR("networkhandler: could not send I/O frame with udp_sendto\n");
+  }
+  return status;
+}
+#endif
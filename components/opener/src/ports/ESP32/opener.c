@@ -23,6 +23,34 @@
 #define OPENER_STACK_SIZE			  8192  // Increased from 2000 to prevent stack overflow
 
 static void opener_thread(void *argument);
+
+#ifdef OPENER_TRACE_BINARY
+/* MODIFICATION: Background decoding of the binary traces
+ * Added by: Adam G. Sweeney <agsweeney@gmail.com>
+ * Rationale: The traces are only stored by the OpENer task. This low priority
+ * task formats them and writes them to the console, so the UART is never
+ * written from the networking task.
+ */
+#define OPENER_TRACE_DECODER_PRIO       1
+#define OPENER_TRACE_DECODER_STACK_SIZE 3072
+#define OPENER_TRACE_DECODER_INTERVAL_MS 50
+
+static TaskHandle_t opener_trace_decoder_handle = NULL;
+
+static void opener_trace_write_line(const char *const text) {
+  fputs(text, stderr);
+}
+
+static void opener_trace_decoder_thread(void *argument) {
+  (void) argument;
+  while (1) {
+    if (TraceBufferGetConsoleOutput()) {
+      TraceBufferDrainText(opener_trace_write_line);
+    }
+    vTaskDelay(pdMS_TO_TICKS(OPENER_TRACE_DECODER_INTERVAL_MS));
+  }
+}
+#endif
 static SemaphoreHandle_t opener_init_mutex = NULL;
 static bool opener_initialized = false;
 TaskHandle_t opener_task_handle = NULL;
@@ -53,6 +81,14 @@ void opener_init(struct netif *netif) {
 
   EipStatus eip_status = 0;
 
+#ifdef OPENER_TRACE_BINARY
+  if (opener_trace_decoder_handle == NULL) {
+    xTaskCreate(opener_trace_decoder_thread, "OpENer_trace",
+                OPENER_TRACE_DECODER_STACK_SIZE, NULL,
+                OPENER_TRACE_DECODER_PRIO, &opener_trace_decoder_handle);
+  }
+#endif
+
   if (IfaceLinkIsUp(netif)) {
     DoublyLinkedListInitialize(&connection_list,
                                CipConnectionObjectListArrayAllocator,
@@ -127,6 +163,10 @@ static void opener_thread(void *argument) {
   }
   NetworkHandlerFinish();
   ShutdownCipStack();
+#ifdef OPENER_TRACE_BINARY
+  /* the task is recreated on the next link up, free the ring for it */
+  TraceBufferReleaseTask();
+#endif
   
   // Mark as not initialized and clear task handle atomically
   if (opener_init_mutex != NULL) {
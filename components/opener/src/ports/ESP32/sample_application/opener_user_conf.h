@@ -9,6 +9,7 @@
 #include <assert.h>
 
 #undef O_NONBLOCK
+#include "sdkconfig.h"
 #include "typedefs.h"
 #include "lwip/opt.h"
 #include "lwip/arch.h"
@@ -68,6 +69,33 @@
   #define OPENER_ETHLINK_IFACE_CTRL_ENABLE 0
 #endif
 
+/* MODIFICATION: Optional zero copy producing path for I/O connections
+ * Added by: Adam G. Sweeney <agsweeney@gmail.com>
+ * Rationale: Selected with CONFIG_OPENER_IO_ZERO_COPY_PRODUCING, see
+ * SendUdpFramePlatform() in the ESP32 networkhandler.c.
+ */
+#if defined(CONFIG_OPENER_IO_ZERO_COPY_PRODUCING)
+  #define OPENER_IO_ZERO_COPY_PRODUCING 1
+#endif
+
+#ifndef OPENER_IO_ZERO_COPY_PRODUCING
+  #define OPENER_IO_ZERO_COPY_PRODUCING 0
+#endif
+
+/* MODIFICATION: Multicast T->O productions shared between different RPIs
+ * Added by: Adam G. Sweeney <agsweeney@gmail.com>
+ * Rationale: Selected with CONFIG_OPENER_IO_MULTICAST_RATE_GROUPING, HMIs and
+ * historians join the multicast production of the PLC at their own RPI
+ * without an extra production, see UpdateMulticastProductionInterval().
+ */
+#if defined(CONFIG_OPENER_IO_MULTICAST_RATE_GROUPING)
+  #define OPENER_IO_MULTICAST_RATE_GROUPING 1
+#endif
+
+#ifndef OPENER_IO_MULTICAST_RATE_GROUPING
+  #define OPENER_IO_MULTICAST_RATE_GROUPING 0
+#endif
+
 #define OPENER_CIP_NUM_APPLICATION_SPECIFIC_CONNECTABLE_OBJECTS 1
 
 #define OPENER_CIP_NUM_EXPLICIT_CONNS 6
@@ -86,11 +114,35 @@
 
 #define PC_OPENER_ETHERNET_BUFFER_SIZE 512
 
+/* MODIFICATION: Pooled message buffers for large explicit messages
+ * Added by: Adam G. Sweeney <agsweeney@gmail.com>
+ * Rationale: Messages up to 4 KB, e.g. Large_Forward_Open connections or bulk
+ * reads of large assemblies, are handled in buffers taken from a bounded pool
+ * instead of PC_OPENER_ETHERNET_BUFFER_SIZE sized stack arrays.
+ */
+#define OPENER_MESSAGE_BUFFER_POOL_LARGE_BUFFER_SIZE 4096
+#define OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_LARGE_BUFFERS 6
+#define OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_SMALL_BUFFERS 8
+
 static const MilliSeconds kOpenerTimerTickInMilliSeconds = 10;
 
 #define OPENER_WITH_TRACES
 #define OPENER_TRACE_LEVEL (OPENER_TRACE_LEVEL_ERROR | OPENER_TRACE_LEVEL_WARNING)
 
+/* MODIFICATION: Binary deferred tracing
+ * Added by: Adam G. Sweeney <agsweeney@gmail.com>
+ * Rationale: fprintf() formats the message and blocks on the UART inside the
+ * OpENer task. With OPENER_TRACE_BINARY the traces only store their format ID,
+ * a timestamp and the raw arguments in a per-task ring (see tracebuffer.h).
+ * A low priority task decodes them to the console, or they are read as a
+ * binary dump over the web UI (GET /api/trace/dump) and decoded on a host with
+ * tools/opener_trace_decode.py. This makes OPENER_TRACE_LEVEL_STATE and
+ * OPENER_TRACE_LEVEL_INFO cheap enough to be left enabled.
+ */
+#define OPENER_TRACE_BINARY
+#define OPENER_TRACE_BUFFER_NUMBER_OF_RINGS 3
+#define OPENER_TRACE_BUFFER_RING_SIZE 1024
+
 #ifndef OPENER_UNIT_TEST
 
 #ifdef OPENER_WITH_TRACES
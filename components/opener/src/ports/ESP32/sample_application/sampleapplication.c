@@ -20,7 +20,6 @@
 #include "driver/gpio.h"
 #include "esp_system.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
 #include "nvtcpip.h"
 #include "cipethernetlink.h"
 #include "generic_networkhandler.h"
@@ -37,6 +36,8 @@ static void ConfigureStatusLed(void);
 #define DEMO_APP_INPUT_ASSEMBLY_NUM                100
 #define DEMO_APP_OUTPUT_ASSEMBLY_NUM               150
 #define DEMO_APP_CONFIG_ASSEMBLY_NUM               151
+#define DEMO_APP_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM  152
+#define DEMO_APP_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM 153
 EipUint8 g_assembly_data064[32];
 EipUint8 g_assembly_data096[32];
 EipUint8 g_assembly_data097[10];
@@ -46,15 +47,8 @@ static bool restart_pending = false;
 static EipUint32 s_active_io_connections = 0;
 static bool s_io_activity_seen = false;
 
-/* Mutexes for thread-safe access */
-static SemaphoreHandle_t s_assembly_mutex = NULL;  // Protects assembly data arrays
-
-// Export mutex for webui_api.c and modbus_register_map.c
-SemaphoreHandle_t sample_application_get_assembly_mutex(void)
-{
-    return s_assembly_mutex;
-}
-
+/* Tasks other than the OpENer task access the assembly data only with
+ * AssemblyReadData() and AssemblyUpdateData(), see cipassembly.c */
 
 static void IdentityEnter(CipIdentityState state,
                           CipIdentityExtendedStatus ext_status) {
@@ -160,25 +154,28 @@ EipStatus ApplicationInitialization(void) {
   CreateAssemblyObject( DEMO_APP_CONFIG_ASSEMBLY_NUM, g_assembly_data097,
                        sizeof(g_assembly_data097));
 
+  /* Heartbeat output assemblies for the input only and listen only
+   * connections (Connection2 and Connection3 in the EDS). Sharing the output
+   * assembly of the exclusive owner would make every request match the
+   * exclusive owner connection point. */
+  CreateAssemblyObject( DEMO_APP_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM, NULL, 0);
+  CreateAssemblyObject( DEMO_APP_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM, NULL, 0);
+
   ConfigureExclusiveOwnerConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
   DEMO_APP_INPUT_ASSEMBLY_NUM,
                                          DEMO_APP_CONFIG_ASSEMBLY_NUM);
-  ConfigureInputOnlyConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
+  ConfigureInputOnlyConnectionPoint(0,
+                                    DEMO_APP_HEARTBEAT_INPUT_ONLY_ASSEMBLY_NUM,
                                     DEMO_APP_INPUT_ASSEMBLY_NUM,
                                     DEMO_APP_CONFIG_ASSEMBLY_NUM);
-  ConfigureListenOnlyConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
+  ConfigureListenOnlyConnectionPoint(0,
+                                     DEMO_APP_HEARTBEAT_LISTEN_ONLY_ASSEMBLY_NUM,
                                      DEMO_APP_INPUT_ASSEMBLY_NUM,
                                      DEMO_APP_CONFIG_ASSEMBLY_NUM);
   CipRunIdleHeaderSetO2T(false);
   CipRunIdleHeaderSetT2O(false);
   ConfigureStatusLed();
 
-  /* Initialize mutexes */
-  s_assembly_mutex = xSemaphoreCreateMutex();
-  if (s_assembly_mutex == NULL) {
-    OPENER_TRACE_ERR("Failed to create assembly mutex\n");
-  }
-
 #if defined(OPENER_ETHLINK_CNTRS_ENABLE) && 0 != OPENER_ETHLINK_CNTRS_ENABLE
   {
     CipClass *p_eth_link_class = GetCipClass(kCipEthernetLinkClassCode);
@@ -268,7 +265,9 @@ EipStatus AfterAssemblyDataReceived(CipInstance *instance) {
 EipBool8 BeforeAssemblyDataSend(CipInstance *instance) {
   (void) instance;
   IdentityNoteIoActivity();
-  return true;
+  /* writers of the input assembly mark their changes with
+   * AssemblyUpdateData(), a production without them is a heartbeat */
+  return false;
 }
 
 EipStatus ResetDevice(void) {
@@ -0,0 +1,196 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "generic_networkhandler.h"
+#include "opener_api.h"
+#include "cipcommon.h"
+#include "cipethernetlink.h"
+#include "cipqos.h"
+#include "ciptcpipinterface.h"
+#include "trace.h"
+#include "networkconfig.h"
+#include "doublylinkedlist.h"
+#include "cipconnectionobject.h"
+#include "nvdata.h"
+#include "nvtcpip.h"
+
+/******************************************************************************/
+/** @brief Signal handler function for ending stack execution
+ *
+ * @param signal the signal we received
+ */
+static void LeaveStack(int signal);
+
+void SampleApplicationNotifyLinkUp(void);
+
+#ifdef OPENER_TRACE_BINARY
+/** @brief Interval at which the trace decoder thread drains the trace buffer */
+#define TRACE_DECODER_INTERVAL_US 50000
+
+/** @brief Flag ending the trace decoder thread */
+static volatile int g_end_trace_decoder = 0;
+
+static void WriteTraceLine(const char *const text) {
+  fputs(text, stderr);
+}
+
+/******************************************************************************/
+/** @brief Decodes the binary traces to stderr outside of the event loop
+ *
+ * @param argument unused
+ */
+static void *TraceDecoderThread(void *argument) {
+  (void)argument;
+  while(!g_end_trace_decoder) {
+    if(TraceBufferGetConsoleOutput() ) {
+      TraceBufferDrainText(WriteTraceLine);
+    }
+    usleep(TRACE_DECODER_INTERVAL_US);
+  }
+  TraceBufferDrainText(WriteTraceLine);
+  return NULL;
+}
+#endif
+
+/*****************************************************************************/
+/** @brief Flag indicating if the stack should end its execution
+ */
+volatile sig_atomic_t g_end_stack = 0;
+
+/******************************************************************************/
+int main(int argc,
+         char *arg[]) {
+
+  if(argc != 2) {
+    fprintf(stderr, "Wrong number of command line parameters!\n");
+    fprintf(stderr, "Usage: %s [interface name]\n", arg[0]);
+    fprintf(stderr, "\te.g. ./OpENer eth1\n");
+    exit(EXIT_FAILURE);
+  }
+
+  TcpIpInterface *const iface = arg[1];
+
+#ifdef OPENER_TRACE_BINARY
+  pthread_t trace_decoder;
+  if(0 != pthread_create(&trace_decoder, NULL, TraceDecoderThread, NULL) ) {
+    fprintf(stderr, "Could not start the trace decoder thread.\n");
+    exit(EXIT_FAILURE);
+  }
+#endif
+
+  DoublyLinkedListInitialize(&connection_list,
+                             CipConnectionObjectListArrayAllocator,
+                             CipConnectionObjectListArrayFree);
+
+  /* Fetch MAC address from the platform. This tests also if the interface
+   *  is present. */
+  uint8_t iface_mac[6];
+  if(kEipStatusError == IfaceGetMacAddress(iface, iface_mac) ) {
+    fprintf(stderr, "Network interface %s not found.\n", iface);
+    exit(EXIT_FAILURE);
+  }
+
+  /* for a real device the serial number should be unique per device */
+  SetDeviceSerialNumber(123456789);
+
+  /* unique_connection_id should be sufficiently random or incremented and
+   *  stored in non-volatile memory each time the device boots. */
+  srand( (unsigned int)time(NULL) ^ (unsigned int)getpid() );
+  EipUint16 unique_connection_id = (EipUint16)rand();
+
+  /* Setup the CIP Layer. All objects are initialized with the default
+   *  values for the attribute contents. */
+  EipStatus eip_status = CipStackInit(unique_connection_id);
+
+  CipEthernetLinkSetMac(iface_mac);
+
+  /* The current host name is used as a default. This value is kept in the
+   *  case NvdataLoad() needs to recreate the TCP/IP object's settings from
+   *  the defaults on the first start without a valid TCP/IP configuration
+   *  file. */
+  GetHostName(&g_tcpip.hostname);
+
+  /* The CIP objects are now created and initialized with their default
+   *  values. After that any NV data values are loaded to change the
+   *  attribute contents to the stored configuration. The files are kept in
+   *  the nvdata/ directory below the working directory. */
+  if(kEipStatusError == NvdataLoad() ) {
+    OPENER_TRACE_WARN("Loading of some NV data failed. Maybe the first start?\n");
+  }
+  (void)NvTcpipLoad(&g_tcpip);
+
+  /* Bring up the network interface or wait for it to come up. The host
+   *  owns the interface configuration, OpENer only reads it. */
+  eip_status = IfaceWaitForIp(iface, -1, &g_end_stack);
+  if(kEipStatusOk == eip_status) {
+    eip_status = IfaceGetConfiguration(iface, &g_tcpip.interface_configuration);
+    if(eip_status < 0) {
+      OPENER_TRACE_WARN("Problems getting interface configuration\n");
+    }
+    SampleApplicationNotifyLinkUp();
+  }
+
+  /* Register the NV data callbacks after the configuration has been
+   *  applied, so the interface configuration read above is not stored. */
+  CipClass *p_class = GetCipClass(kCipQoSClassCode);
+  if(NULL != p_class) {
+    InsertGetSetCallback(p_class, NvQosSetCallback, kNvDataFunc);
+  }
+  p_class = GetCipClass(kCipTcpIpInterfaceClassCode);
+  if(NULL != p_class) {
+    InsertGetSetCallback(p_class, NvTcpipSetCallback, kNvDataFunc);
+  }
+
+  /* Setup Network Handles */
+  eip_status = NetworkHandlerInitialize();
+  if(kEipStatusOk == eip_status) {
+    g_end_stack = 0;
+    /* Set the signal handlers after the network handler has been set up, a
+     *  signal ends the stack execution gracefully. */
+    signal(SIGHUP, LeaveStack);
+    signal(SIGINT, LeaveStack);
+    signal(SIGTERM, LeaveStack);
+    /* A peer closing its TCP connection must not kill the process, send()
+     *  reports the error instead. */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* The event loop. Put other processing you need done continually in
+     *  here */
+    while(!g_end_stack) {
+      if(kEipStatusOk != NetworkHandlerProcessCyclic() ) {
+        OPENER_TRACE_ERR("Error in NetworkHandler loop! Exiting OpENer!\n");
+        break;
+      }
+    }
+
+    /* clean up network state */
+    NetworkHandlerFinish();
+  } else {
+    OPENER_TRACE_ERR("NetworkHandlerInitialize error %d\n", eip_status);
+  }
+
+  /* close remaining sessions and connections, clean up used data */
+  ShutdownCipStack();
+
+#ifdef OPENER_TRACE_BINARY
+  g_end_trace_decoder = 1;
+  pthread_join(trace_decoder, NULL);
+#endif
+
+  return (kEipStatusOk == eip_status) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void LeaveStack(int signal) {
+  (void)signal;
+  g_end_stack = 1;
+}
@@ -0,0 +1,171 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include "networkconfig.h"
+#include "cipstring.h"
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "trace.h"
+#include "opener_api.h"
+
+/** @brief Runs an interface ioctl on a temporary socket
+ *
+ *  @param iface Name of the network interface
+ *  @param request The SIOCGIF* request
+ *  @param interface_request Filled with the interface name and the result
+ *  @return kEipStatusOk on success, kEipStatusError with errno set on failure
+ */
+static EipStatus IfaceIoctl(TcpIpInterface *iface,
+                            const unsigned long request,
+                            struct ifreq *const interface_request) {
+  if(strlen(iface) >= sizeof(interface_request->ifr_name) ) {
+    errno = ENAMETOOLONG;
+    return kEipStatusError;
+  }
+  memset(interface_request, 0, sizeof(*interface_request) );
+  strcpy(interface_request->ifr_name, iface);
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if(fd < 0) {
+    return kEipStatusError;
+  }
+  int result = ioctl(fd, request, interface_request);
+  int saved_errno = errno;
+  close(fd);
+  errno = saved_errno;
+  return (0 == result) ? kEipStatusOk : kEipStatusError;
+}
+
+bool IfaceLinkIsUp(TcpIpInterface *iface) {
+  struct ifreq interface_request;
+  if(kEipStatusOk != IfaceIoctl(iface, SIOCGIFFLAGS, &interface_request) ) {
+    return false;
+  }
+  return 0 != (interface_request.ifr_flags & IFF_RUNNING);
+}
+
+EipStatus IfaceGetMacAddress(TcpIpInterface *iface,
+                             uint8_t *const physical_address) {
+  struct ifreq interface_request;
+  EipStatus status = IfaceIoctl(iface, SIOCGIFHWADDR, &interface_request);
+  if(kEipStatusOk == status) {
+    memcpy(physical_address, &interface_request.ifr_hwaddr.sa_data, 6);
+  }
+  return status;
+}
+
+static EipStatus GetIpAndNetmaskFromInterface(
+  TcpIpInterface *iface,
+  CipTcpIpInterfaceConfiguration *iface_cfg) {
+  struct ifreq interface_request;
+
+  if(kEipStatusOk != IfaceIoctl(iface, SIOCGIFADDR, &interface_request) ) {
+    return kEipStatusError;
+  }
+  iface_cfg->ip_address =
+    ( (struct sockaddr_in *)&interface_request.ifr_addr )->sin_addr.s_addr;
+
+  if(kEipStatusOk != IfaceIoctl(iface, SIOCGIFNETMASK, &interface_request) ) {
+    return kEipStatusError;
+  }
+  iface_cfg->network_mask =
+    ( (struct sockaddr_in *)&interface_request.ifr_netmask )->sin_addr.s_addr;
+
+  return kEipStatusOk;
+}
+
+/** @brief Reads the default gateway of the interface from /proc/net/route */
+static EipStatus GetGatewayFromRoute(TcpIpInterface *iface,
+                                     CipTcpIpInterfaceConfiguration *iface_cfg)
+{
+  FILE *file_handle = fopen("/proc/net/route", "r");
+  if(NULL == file_handle) {
+    return kEipStatusError;
+  }
+
+  char line[256];
+  iface_cfg->gateway = 0;
+  while(NULL != fgets(line, sizeof(line), file_handle) ) {
+    char interface_name[IF_NAMESIZE + 1];
+    unsigned long destination = 0;
+    unsigned long gateway = 0;
+    if(3 == sscanf(line, "%16s %lx %lx", interface_name, &destination,
+                   &gateway) &&
+       0 == strcmp(interface_name, iface) && 0 == destination) {
+      /* /proc/net/route shows the addresses in network byte order */
+      iface_cfg->gateway = (CipUdint)gateway;
+      break;
+    }
+  }
+  fclose(file_handle);
+  return kEipStatusOk;
+}
+
+EipStatus IfaceGetConfiguration(TcpIpInterface *iface,
+                                CipTcpIpInterfaceConfiguration *iface_cfg) {
+  CipTcpIpInterfaceConfiguration local_cfg;
+  EipStatus status;
+
+  memset(&local_cfg, 0x00, sizeof local_cfg);
+
+  status = GetIpAndNetmaskFromInterface(iface, &local_cfg);
+  if(kEipStatusOk == status) {
+    status = GetGatewayFromRoute(iface, &local_cfg);
+  }
+  if(kEipStatusOk == status) {
+    /* name servers and domain name are not read, they are left empty */
+    ClearCipString(&iface_cfg->domain_name);
+    *iface_cfg = local_cfg;
+  }
+  return status;
+}
+
+EipStatus IfaceWaitForIp(TcpIpInterface *const iface,
+                         int timeout,
+                         volatile sig_atomic_t *const abort_wait) {
+  CipTcpIpInterfaceConfiguration local_cfg;
+  EipStatus status;
+
+  timeout *= 10; /* polling interval is 100 ms */
+  do {
+    memset(&local_cfg, 0x00, sizeof local_cfg);
+    status = GetIpAndNetmaskFromInterface(iface, &local_cfg);
+    if(kEipStatusOk == status && 0 != local_cfg.ip_address) {
+      return kEipStatusOk;
+    }
+    if(0 == timeout) {
+      break;
+    }
+    if(0 < timeout) {
+      timeout--;
+    }
+    usleep(100000);
+  } while(0 == *abort_wait);
+
+  return kEipStatusError;
+}
+
+void GetHostName(CipString *hostname) {
+  char name_buf[HOST_NAME_MAX + 1];
+
+  if(0 != gethostname(name_buf, sizeof name_buf) ) {
+    OPENER_TRACE_WARN("gethostname() failed: %d\n", errno);
+    return;
+  }
+  name_buf[HOST_NAME_MAX] = '\0';
+  SetCipStringByCstr(hostname, name_buf);
+}
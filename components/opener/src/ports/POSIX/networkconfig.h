@@ -0,0 +1,21 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_NETWORKCONFIG_H_
+#define OPENER_NETWORKCONFIG_H_
+
+#include <stdbool.h>
+
+#include "opener_api.h"
+
+/** @brief Checks if the network interface is up and running
+ *
+ *  @param iface Name of the network interface, e.g. "eth0"
+ *  @return true if the interface exists and is running
+ */
+bool IfaceLinkIsUp(TcpIpInterface *iface);
+
+#endif /* OPENER_NETWORKCONFIG_H_ */
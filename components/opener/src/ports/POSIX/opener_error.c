@@ -0,0 +1,32 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#undef _GNU_SOURCE /* Force the use of the XSI compliant strerror_r() function. */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opener_error.h"
+
+const int kErrorMessageBufferSize = 255;
+
+int GetSocketErrorNumber(void) {
+  return errno;
+}
+
+char *GetErrorMessage(int error_number) {
+  char *error_message = malloc(kErrorMessageBufferSize);
+  if(0 != strerror_r(error_number, error_message, kErrorMessageBufferSize) ) {
+    error_message[0] = '\0';
+  }
+  return error_message;
+}
+
+void FreeErrorMessage(char *error_message) {
+  free(error_message);
+}
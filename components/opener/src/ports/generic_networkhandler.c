@@ -23,6 +23,8 @@
 #include "ciptcpipinterface.h"
 #include "opener_user_conf.h"
 #include "cipqos.h"
+#include "cipdiagnostics.h"
+#include "timerqueue.h"
 
 #define MAX_NO_OF_TCP_SOCKETS 10
 
@@ -59,6 +61,9 @@
 
 SocketTimer g_timestamps[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
 
+/** Receive buffers of the accepted TCP sockets */
+static SocketReceiveBuffer g_receive_buffers[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
+
 //EipUint8 g_ethernet_communication_buffer[PC_OPENER_ETHERNET_BUFFER_SIZE]; /**< communication buffer */
 /* global vars */
 fd_set master_socket;
@@ -81,25 +86,76 @@ NetworkStatus g_network_status;
  */
 TimeoutCheckerFunction timeout_checker_array[OPENER_TIMEOUT_CHECKER_ARRAY_SIZE];
 
+/** @brief Size of the socket handler array: the three listener sockets, one
+ *  TCP socket per session and one UDP socket per I/O connection
+ */
+#define OPENER_SOCKET_HANDLER_ARRAY_SIZE \
+  (3 + OPENER_NUMBER_OF_SUPPORTED_SESSIONS + \
+   OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS + \
+   OPENER_CIP_NUM_INPUT_ONLY_CONNS * \
+   OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH + \
+   OPENER_CIP_NUM_LISTEN_ONLY_CONNS * \
+   OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH)
+
+/** @brief Registered sockets and their handlers, only these are passed to select()
+ *  and only the ones reported ready are dispatched
+ */
+static NetworkSocketHandler g_socket_handlers[OPENER_SOCKET_HANDLER_ARRAY_SIZE];
+
+/** @brief One past the highest used element of g_socket_handlers */
+static size_t g_socket_handlers_used;
+
+/** @brief Size of the network handler timer queue: the network handler's own
+ *  timers and one timer per connection
+ */
+#define OPENER_NETWORK_TIMER_QUEUE_SIZE \
+  (8 + OPENER_CIP_NUM_EXPLICIT_CONNS + \
+   OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS + \
+   OPENER_CIP_NUM_INPUT_ONLY_CONNS * \
+   OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH + \
+   OPENER_CIP_NUM_LISTEN_ONLY_CONNS * \
+   OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH)
+
+/** @brief Upper bound for the interval of the encapsulation inactivity check,
+ *  so changes of the timeout value are picked up in time
+ */
+#define OPENER_ENCAPSULATION_INACTIVITY_CHECK_INTERVAL 1000U
+
+static TimerQueueEntry *g_network_timer_queue_storage[
+  OPENER_NETWORK_TIMER_QUEUE_SIZE];
+static TimerQueue g_network_timer_queue; /**< deadline queue driving the select() timeout */
+static TimerQueueEntry g_connection_manager_timer; /**< ManageConnections() and timeout checkers */
+static TimerQueueEntry g_encapsulation_inactivity_timer; /**< earliest session inactivity timeout */
+
 /** @brief handle any connection request coming in the TCP server socket.
  *
+ *  @param socket_handle The TCP listener socket
  */
-void CheckAndHandleTcpListenerSocket(void);
+void CheckAndHandleTcpListenerSocket(const int socket_handle);
 
 /** @brief Checks and processes request received via the UDP unicast socket, currently the implementation is port-specific
  *
+ *  @param socket_handle The UDP unicast listener socket
  */
-void CheckAndHandleUdpUnicastSocket(void);
+void CheckAndHandleUdpUnicastSocket(const int socket_handle);
 
 /** @brief Checks and handles incoming messages via UDP broadcast
  *
+ *  @param socket_handle The UDP global broadcast listener socket
  */
-void CheckAndHandleUdpGlobalBroadcastSocket(void);
+void CheckAndHandleUdpGlobalBroadcastSocket(const int socket_handle);
 
 /** @brief check if on the UDP consuming socket data has been received and if yes handle it correctly
  *
+ *  @param socket_handle The UDP I/O messaging socket which became readable
  */
-void CheckAndHandleConsumingUdpSocket(void);
+void CheckAndHandleConsumingUdpSocket(const int socket_handle);
+
+/** @brief Checks and handles data on an accepted TCP socket, closes the socket and its session on error
+ *
+ *  @param socket_handle The TCP socket which became readable
+ */
+void CheckAndHandleTcpClientSocket(const int socket_handle);
 
 /** @brief Handles data on an established TCP connection, processed connection is given by socket
  *
@@ -110,9 +166,39 @@ EipStatus HandleDataOnTcpSocket(int socket);
 
 void CheckEncapsulationInactivity(int socket_handle);
 
+/** @brief Timer queue callback running ManageConnections() and the registered timeout checkers
+ *
+ *  @param timer The expired timer entry
+ *  @param actual_time Current time
+ */
+static void HandleConnectionManagerTimer(TimerQueueEntry *const timer,
+                                         const MilliSeconds actual_time);
+
+/** @brief Timer queue callback checking the encapsulation inactivity of all sessions
+ *
+ *  Reschedules itself to the earliest point in time a session may time out.
+ *
+ *  @param timer The expired timer entry
+ *  @param actual_time Current time
+ */
+static void HandleEncapsulationInactivityTimer(TimerQueueEntry *const timer,
+                                               const MilliSeconds actual_time);
+
 void RemoveSocketTimerFromList(const int socket_handle);
 
 static NetworkInterfaceCounters g_network_interface_counters;
+static NetworkUdpIoReceiveStatistics g_udp_io_receive_statistics;
+static NetworkHandlerLoadStatistics g_load_statistics;
+
+/** @brief Time per phase in the current load window */
+static MicroSeconds g_load_window_time[kNetworkHandlerNumberOfPhases];
+static MicroSeconds g_load_window_start; /**< start of the current load window */
+static MicroSeconds g_load_last_stamp; /**< end of the last accounted phase */
+
+#if defined(OPENER_IO_ZERO_COPY_PRODUCING) && 0 != OPENER_IO_ZERO_COPY_PRODUCING
+/** DSCP of the I/O messaging socket, applied to frames sent by SendUdpFrame() */
+static CipUsint s_io_messaging_dscp = 0;
+#endif
 
 static void NetworkCountersRecordRx(size_t bytes, EipBool8 is_multicast) {
   g_network_interface_counters.in_octets += (CipUdint)bytes;
@@ -148,6 +234,23 @@ static void NetworkCountersRecordTxDiscard(void) {
   g_network_interface_counters.out_discards++;
 }
 
+static void UdpIoReceiveStatisticsRecordBatch(
+  const CipUdint number_of_datagrams) {
+  if(0 == number_of_datagrams) {
+    g_udp_io_receive_statistics.empty_wakeups++;
+    return;
+  }
+  g_udp_io_receive_statistics.batches++;
+  g_udp_io_receive_statistics.datagrams += number_of_datagrams;
+  g_udp_io_receive_statistics.last_batch_size = number_of_datagrams;
+  if(number_of_datagrams > g_udp_io_receive_statistics.maximum_batch_size) {
+    g_udp_io_receive_statistics.maximum_batch_size = number_of_datagrams;
+  }
+  if(number_of_datagrams >= OPENER_UDP_IO_RECEIVE_BATCH_BUDGET) {
+    g_udp_io_receive_statistics.budget_exhausted++;
+  }
+}
+
 const NetworkInterfaceCounters *NetworkGetInterfaceCounters(void) {
   return &g_network_interface_counters;
 }
@@ -156,6 +259,81 @@ void NetworkResetInterfaceCounters(void) {
   memset(&g_network_interface_counters, 0, sizeof(g_network_interface_counters));
 }
 
+const NetworkUdpIoReceiveStatistics *NetworkGetUdpIoReceiveStatistics(void) {
+  return &g_udp_io_receive_statistics;
+}
+
+void NetworkResetUdpIoReceiveStatistics(void) {
+  memset(&g_udp_io_receive_statistics, 0,
+         sizeof(g_udp_io_receive_statistics));
+}
+
+/** @brief Accounts the time since the end of the last accounted phase to a phase
+ *
+ *  @param phase The phase which ended
+ *  @return The end of the phase
+ */
+static MicroSeconds LoadStatisticsAccount(const NetworkHandlerPhase phase) {
+  const MicroSeconds now = GetMicroSeconds();
+  const MicroSeconds elapsed = now - g_load_last_stamp;
+  g_load_statistics.total[phase] += elapsed;
+  g_load_window_time[phase] += elapsed;
+  g_load_last_stamp = now;
+  return now;
+}
+
+/** @brief Finishes a pass through NetworkHandlerProcessCyclic() and rolls the
+ *  current window up if it is complete
+ *
+ *  @param busy_time Time of the pass not spent in select()
+ */
+static void LoadStatisticsFinishCycle(const MicroSeconds busy_time) {
+  g_load_statistics.cycles++;
+  const CipUdint cycle_busy_time =
+    (busy_time > UINT32_MAX) ? UINT32_MAX : (CipUdint) busy_time;
+  if(cycle_busy_time > g_load_statistics.maximum_cycle_busy_time) {
+    g_load_statistics.maximum_cycle_busy_time = cycle_busy_time;
+  }
+
+  const MicroSeconds window_length = g_load_last_stamp - g_load_window_start;
+  if(window_length < OPENER_NETWORK_LOAD_WINDOW_MS * 1000ULL) {
+    return;
+  }
+
+  for(size_t i = 0; i < kNetworkHandlerNumberOfPhases; ++i) {
+    g_load_statistics.window[i] = (CipUdint) g_load_window_time[i];
+    g_load_window_time[i] = 0;
+  }
+  g_load_statistics.window_length = (CipUdint) window_length;
+  g_load_statistics.utilization = (CipUint) (
+    (window_length - g_load_statistics.window[kNetworkHandlerPhaseSelect]) *
+    1000ULL / window_length);
+  if(g_load_statistics.utilization > g_load_statistics.peak_utilization) {
+    g_load_statistics.peak_utilization = g_load_statistics.utilization;
+  }
+  g_load_window_start = g_load_last_stamp;
+
+  ConnectionManagerSetCpuUtilization(g_load_statistics.utilization);
+}
+
+const NetworkHandlerLoadStatistics *NetworkGetLoadStatistics(void) {
+  return &g_load_statistics;
+}
+
+void NetworkResetLoadStatistics(void) {
+  memset(&g_load_statistics, 0, sizeof(g_load_statistics) );
+  memset(g_load_window_time, 0, sizeof(g_load_window_time) );
+  g_load_window_start = GetMicroSeconds();
+  g_load_last_stamp = g_load_window_start;
+}
+
+/** @brief Tells if a socket handler serves a TCP socket, all others serve UDP sockets */
+static bool IsTcpSocketHandler(
+  const NetworkSocketHandlerFunction handler_function) {
+  return CheckAndHandleTcpListenerSocket == handler_function ||
+         CheckAndHandleTcpClientSocket == handler_function;
+}
+
 /*************************************************
 * Function implementations from now on
 *************************************************/
@@ -167,6 +345,8 @@ EipStatus NetworkHandlerInitialize(void) {
   }
 
   SocketTimerArrayInitialize(g_timestamps, OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+  SocketReceiveBufferArrayInitialize(g_receive_buffers,
+                                     OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
   /* Activate the current DSCP values to become the used set of values. */
   CipQosUpdateUsedSetQosValues();
   /* Make sure the multicast configuration matches the current IP address. */
@@ -181,6 +361,12 @@ EipStatus NetworkHandlerInitialize(void) {
   /* clear the master and temp sets */
   FD_ZERO(&master_socket);
   FD_ZERO(&read_socket);
+  highest_socket_handle = 0;
+  for(size_t i = 0; i < OPENER_SOCKET_HANDLER_ARRAY_SIZE; i++) {
+    g_socket_handlers[i].socket = kEipInvalidSocket;
+    g_socket_handlers[i].handler_function = NULL;
+  }
+  g_socket_handlers_used = 0;
 
   /* create a new TCP socket */
   if( ( g_network_status.tcp_listener =
@@ -399,21 +585,37 @@ EipStatus NetworkHandlerInitialize(void) {
     return kEipStatusError;
   }
 
-  /* add the listener socket to the master set */
-  FD_SET(g_network_status.tcp_listener, &master_socket);
-  FD_SET(g_network_status.udp_unicast_listener, &master_socket);
-  FD_SET(g_network_status.udp_global_broadcast_listener, &master_socket);
+  /* add the listener sockets to the master set */
+  NetworkHandlerRegisterSocket(g_network_status.tcp_listener,
+                               CheckAndHandleTcpListenerSocket);
+  NetworkHandlerRegisterSocket(g_network_status.udp_unicast_listener,
+                               CheckAndHandleUdpUnicastSocket);
+  NetworkHandlerRegisterSocket(g_network_status.udp_global_broadcast_listener,
+                               CheckAndHandleUdpGlobalBroadcastSocket);
 
-  /* keep track of the biggest file descriptor */
-  highest_socket_handle = GetMaxSocket(g_network_status.tcp_listener,
-                                       g_network_status.udp_global_broadcast_listener,
-                                       0,
-                                       g_network_status.udp_unicast_listener);
+  /* the IO messaging socket is created with the first IO connection */
+  g_network_status.udp_io_messaging = kEipInvalidSocket;
 
   g_last_time = GetMilliSeconds(); /* initialize time keeping */
+  NetworkResetLoadStatistics();
+  g_actual_time = g_last_time;
   g_network_status.elapsed_time = 0;
   NetworkResetInterfaceCounters();
 
+  /* the periodic jobs are driven by absolute deadlines instead of accumulating
+   * the time spent in select() */
+  TimerQueueInitialize(&g_network_timer_queue, g_network_timer_queue_storage,
+                       OPENER_NETWORK_TIMER_QUEUE_SIZE);
+  TimerQueueEntryInitialize(&g_connection_manager_timer,
+                            HandleConnectionManagerTimer, NULL);
+  TimerQueueEntryInitialize(&g_encapsulation_inactivity_timer,
+                            HandleEncapsulationInactivityTimer, NULL);
+  NetworkHandlerScheduleTimer(&g_connection_manager_timer,
+                              g_last_time + kOpenerTimerTickInMilliSeconds);
+  NetworkHandlerScheduleTimer(&g_encapsulation_inactivity_timer,
+                              g_last_time +
+                              OPENER_ENCAPSULATION_INACTIVITY_CHECK_INTERVAL);
+
   return kEipStatusOk;
 }
 
@@ -426,6 +628,13 @@ void CloseTcpSocket(int socket_handle) {
   OPENER_TRACE_STATE("Closing TCP socket %d\n", socket_handle);
   ShutdownSocketPlatform(socket_handle);
   RemoveSocketTimerFromList(socket_handle);
+  SocketReceiveBuffer *receive_buffer =
+    SocketReceiveBufferArrayGetSocketReceiveBuffer(g_receive_buffers,
+                                                   OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+                                                   socket_handle);
+  if(NULL != receive_buffer) {
+    SocketReceiveBufferClear(receive_buffer);
+  }
   CloseSocket(socket_handle);
 }
 
@@ -439,6 +648,88 @@ void RemoveSocketTimerFromList(const int socket_handle) {
   }
 }
 
+EipStatus NetworkHandlerRegisterSocket(const int socket_handle,
+                                       NetworkSocketHandlerFunction handler_function)
+{
+  if(kEipInvalidSocket == socket_handle || NULL == handler_function) {
+    return kEipStatusError;
+  }
+
+  NetworkSocketHandler *free_socket_handler = NULL;
+  for(size_t i = 0; i < OPENER_SOCKET_HANDLER_ARRAY_SIZE; i++) {
+    if(socket_handle == g_socket_handlers[i].socket) {
+      /* already registered, only update the handler */
+      g_socket_handlers[i].handler_function = handler_function;
+      return kEipStatusOk;
+    }
+    if(NULL == free_socket_handler &&
+       kEipInvalidSocket == g_socket_handlers[i].socket) {
+      free_socket_handler = &g_socket_handlers[i];
+    }
+  }
+
+  if(NULL == free_socket_handler) {
+    OPENER_TRACE_ERR("networkhandler: no free socket handler for socket %d\n",
+                     socket_handle);
+    return kEipStatusError;
+  }
+
+  free_socket_handler->socket = socket_handle;
+  free_socket_handler->handler_function = handler_function;
+  const size_t index = (size_t) (free_socket_handler - g_socket_handlers);
+  if(index >= g_socket_handlers_used) {
+    g_socket_handlers_used = index + 1;
+  }
+
+  FD_SET(socket_handle, &master_socket);
+  /* keep track of the biggest file descriptor */
+  if(socket_handle > highest_socket_handle) {
+    OPENER_TRACE_INFO("New highest socket: %d\n", socket_handle);
+    highest_socket_handle = socket_handle;
+  }
+  return kEipStatusOk;
+}
+
+void NetworkHandlerUnregisterSocket(const int socket_handle) {
+  if(kEipInvalidSocket == socket_handle) {
+    return;
+  }
+  FD_CLR(socket_handle, &master_socket);
+
+  /* Entries are only invalidated and never moved, so removing a socket from
+   * within a socket handler does not disturb the dispatch loop. */
+  int highest_registered_socket = 0;
+  size_t used = 0;
+  for(size_t i = 0; i < g_socket_handlers_used; i++) {
+    if(socket_handle == g_socket_handlers[i].socket) {
+      g_socket_handlers[i].socket = kEipInvalidSocket;
+      g_socket_handlers[i].handler_function = NULL;
+    }
+    if(kEipInvalidSocket != g_socket_handlers[i].socket) {
+      used = i + 1;
+      if(g_socket_handlers[i].socket > highest_registered_socket) {
+        highest_registered_socket = g_socket_handlers[i].socket;
+      }
+    }
+  }
+  g_socket_handlers_used = used;
+  highest_socket_handle = highest_registered_socket;
+}
+
+EipStatus NetworkHandlerScheduleTimer(TimerQueueEntry *const timer,
+                                      const MilliSeconds deadline) {
+  if(kEipStatusOk !=
+     TimerQueueSchedule(&g_network_timer_queue, timer, deadline) ) {
+    OPENER_TRACE_ERR("networkhandler: timer queue full\n");
+    return kEipStatusError;
+  }
+  return kEipStatusOk;
+}
+
+void NetworkHandlerCancelTimer(TimerQueueEntry *const timer) {
+  TimerQueueCancel(&g_network_timer_queue, timer);
+}
+
 EipBool8 CheckSocketSet(int socket) {
   EipBool8 return_value = false;
   if( FD_ISSET(socket, &read_socket) ) {
@@ -453,7 +744,7 @@ EipBool8 CheckSocketSet(int socket) {
   return return_value;
 }
 
-void CheckAndHandleTcpListenerSocket(void) {
+void CheckAndHandleTcpListenerSocket(const int socket_handle) {
   int new_socket = kEipInvalidSocket;
   /* see if this is a connection request to the TCP listener*/
   if( true == CheckSocketSet(g_network_status.tcp_listener) ) {
@@ -498,11 +789,24 @@ void CheckAndHandleTcpListenerSocket(void) {
 
     OPENER_ASSERT(socket_timer != NULL);
 
-    FD_SET(new_socket, &master_socket);
+    SocketReceiveBuffer *receive_buffer =
+      SocketReceiveBufferArrayGetEmptySocketReceiveBuffer(g_receive_buffers,
+                                                          OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+    if(NULL == receive_buffer) {
+      OPENER_TRACE_ERR(
+        "networkhandler: no receive buffer left for new TCP socket %d\n",
+        new_socket);
+      CloseTcpSocket(new_socket);
+      return;
+    }
+    SocketReceiveBufferSetSocket(receive_buffer, new_socket);
+
     /* add newfd to master set */
-    if(new_socket > highest_socket_handle) {
-      OPENER_TRACE_INFO("New highest socket: %d\n", new_socket);
-      highest_socket_handle = new_socket;
+    if(kEipStatusOk !=
+       NetworkHandlerRegisterSocket(new_socket, CheckAndHandleTcpClientSocket) )
+    {
+      CloseTcpSocket(new_socket);
+      return;
     }
 
     OPENER_TRACE_STATE("networkhandler: opened new TCP connection on fd %d\n",
@@ -511,25 +815,35 @@ void CheckAndHandleTcpListenerSocket(void) {
 }
 
 EipStatus NetworkHandlerProcessCyclic(void) {
+  /* the time since the end of the last pass belongs to the caller's loop */
+  const MicroSeconds cycle_start = LoadStatisticsAccount(
+    kNetworkHandlerPhaseOther);
 
   read_socket = master_socket;
 
-  g_time_value.tv_sec = 0;
-  g_time_value.tv_usec =
-    (g_network_status.elapsed_time <
-     kOpenerTimerTickInMilliSeconds ? kOpenerTimerTickInMilliSeconds -
-     g_network_status.elapsed_time : 0)
-    * 1000; /* 10 ms */
-
+  /* sleep until the next deadline in the timer queue is reached */
+  g_actual_time = GetMilliSeconds();
+  const MilliSeconds wait_time = TimerQueueGetTimeUntilNextDeadline(
+    &g_network_timer_queue,
+    g_actual_time,
+    kOpenerTimerTickInMilliSeconds);
+  g_time_value.tv_sec = wait_time / 1000;
+  g_time_value.tv_usec = (wait_time % 1000) * 1000;
+
+  const MicroSeconds select_start = LoadStatisticsAccount(
+    kNetworkHandlerPhaseOther);
   int ready_socket = select(highest_socket_handle + 1,
                             &read_socket,
                             0,
                             0,
                             &g_time_value);
+  const MicroSeconds select_end = LoadStatisticsAccount(
+    kNetworkHandlerPhaseSelect);
 
   if(ready_socket == kEipInvalidSocket) {
     if(EINTR == errno) /* we have somehow been interrupted. The default behavior is to go back into the select loop. */
     {
+      LoadStatisticsFinishCycle(select_start - cycle_start);
       return kEipStatusOk;
     } else {
       int error_code = GetSocketErrorNumber();
@@ -542,64 +856,110 @@ EipStatus NetworkHandlerProcessCyclic(void) {
     }
   }
 
-  if(ready_socket > 0) {
+  g_actual_time = GetMilliSeconds();
 
-    CheckAndHandleTcpListenerSocket();
-    CheckAndHandleUdpUnicastSocket();
-    CheckAndHandleUdpGlobalBroadcastSocket();
-    CheckAndHandleConsumingUdpSocket();
-
-    for(int socket = 0; socket <= highest_socket_handle; socket++) {
-      if( true == CheckSocketSet(socket) ) {
-        /* if it is still checked it is a TCP receive */
-        if( kEipStatusError == HandleDataOnTcpSocket(socket) ) /* if error */
-        {
-          CloseTcpSocket(socket);
-          RemoveSession(socket); /* clean up session and close the socket */
-        }
+  if(ready_socket > 0) {
+    /* only walk the registered sockets and dispatch the ready ones */
+    for(size_t i = 0; i < g_socket_handlers_used && 0 < ready_socket; i++) {
+      const int socket_handle = g_socket_handlers[i].socket;
+      NetworkSocketHandlerFunction handler_function =
+        g_socket_handlers[i].handler_function;
+      if( (kEipInvalidSocket != socket_handle) &&
+          FD_ISSET(socket_handle, &read_socket) ) {
+        ready_socket--;
+        handler_function(socket_handle);
+        LoadStatisticsAccount(IsTcpSocketHandler(handler_function) ?
+                              kNetworkHandlerPhaseTcp :
+                              kNetworkHandlerPhaseUdp);
       }
     }
   }
 
-  for(int socket = 0; socket <= highest_socket_handle; socket++) {
-    CheckEncapsulationInactivity(socket);
+  /* fire all timers whose deadline has been reached */
+  g_actual_time = GetMilliSeconds();
+  TimerQueueProcessExpired(&g_network_timer_queue, g_actual_time);
+  const MicroSeconds cycle_end = LoadStatisticsAccount(
+    kNetworkHandlerPhaseConnectionTimers);
+
+  LoadStatisticsFinishCycle( (select_start - cycle_start) +
+                             (cycle_end - select_end) );
+  return kEipStatusOk;
+}
+
+static void HandleConnectionManagerTimer(TimerQueueEntry *const timer,
+                                         const MilliSeconds actual_time) {
+  /* timers fired before this one in the same pass */
+  LoadStatisticsAccount(kNetworkHandlerPhaseConnectionTimers);
+
+  g_network_status.elapsed_time = actual_time - g_last_time;
+  g_last_time = actual_time;
+
+  /* call manage_connections() in connection manager every kOpenerTimerTickInMilliSeconds ms */
+  ManageConnections(g_network_status.elapsed_time);
+  LoadStatisticsAccount(kNetworkHandlerPhaseManageConnections);
+
+  /* Call timeout checker functions registered in timeout_checker_array */
+  for (size_t i = 0; i < OPENER_TIMEOUT_CHECKER_ARRAY_SIZE; i++) {
+    if (NULL != timeout_checker_array[i]) {
+      (timeout_checker_array[i])(g_network_status.elapsed_time);
+    }
   }
+  LoadStatisticsAccount(kNetworkHandlerPhaseTimeoutCheckers);
 
-  /* Check if all connections from one originator times out */
-  //CheckForTimedOutConnectionsAndCloseTCPConnections();
-  //OPENER_TRACE_INFO("Socket Loop done\n");
-  g_actual_time = GetMilliSeconds();
-  g_network_status.elapsed_time += g_actual_time - g_last_time;
-  g_last_time = g_actual_time;
-  //OPENER_TRACE_INFO("Elapsed time: %u\n", g_network_status.elapsed_time);
+  g_network_status.elapsed_time = 0;
 
-  /* check if we had been not able to update the connection manager for several kOpenerTimerTickInMilliSeconds.
-   * This should compensate the jitter of the windows timer
-   */
-  if(g_network_status.elapsed_time >= kOpenerTimerTickInMilliSeconds) {
-    /* call manage_connections() in connection manager every kOpenerTimerTickInMilliSeconds ms */
-    ManageConnections(g_network_status.elapsed_time);
-
-    /* Call timeout checker functions registered in timeout_checker_array */
-    for (size_t i = 0; i < OPENER_TIMEOUT_CHECKER_ARRAY_SIZE; i++) {
-      if (NULL != timeout_checker_array[i]) {
-        (timeout_checker_array[i])(g_network_status.elapsed_time);
+  /* Keep the phase of the tick. If we fell behind by more than a tick the
+   * elapsed time already covers the missed ticks, so resynchronize instead of
+   * calling ManageConnections() in a burst. */
+  MilliSeconds next_deadline = timer->deadline + kOpenerTimerTickInMilliSeconds;
+  if( TimerQueueDeadlineReached(next_deadline, actual_time) ) {
+    next_deadline = actual_time + kOpenerTimerTickInMilliSeconds;
+  }
+  NetworkHandlerScheduleTimer(timer, next_deadline);
+}
+
+static void HandleEncapsulationInactivityTimer(TimerQueueEntry *const timer,
+                                               const MilliSeconds actual_time)
+{
+  MilliSeconds next_check = OPENER_ENCAPSULATION_INACTIVITY_CHECK_INTERVAL;
+
+  if(0 < g_tcpip.encapsulation_inactivity_timeout) { //*< Encapsulation inactivity timeout is enabled
+    const MilliSeconds timeout =
+      (MilliSeconds) (1000UL * g_tcpip.encapsulation_inactivity_timeout);
+    for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; i++) {
+      const int socket_handle = g_timestamps[i].socket;
+      if(kEipInvalidSocket == socket_handle) {
+        continue;
+      }
+      CheckEncapsulationInactivity(socket_handle);
+      /* socket is still alive, so its remaining time is below the timeout */
+      if(socket_handle == g_timestamps[i].socket) {
+        const MilliSeconds idle_time = actual_time -
+                                       SocketTimerGetLastUpdate(
+          &g_timestamps[i]);
+        const MilliSeconds remaining_time = timeout - idle_time;
+        if(remaining_time < next_check) {
+          next_check = remaining_time;
+        }
       }
     }
-
-    g_network_status.elapsed_time = 0;
   }
-  return kEipStatusOk;
+
+  NetworkHandlerScheduleTimer(timer, actual_time + next_check);
 }
 
 EipStatus NetworkHandlerFinish(void) {
   CloseTcpSocket(g_network_status.tcp_listener);
   CloseUdpSocket(g_network_status.udp_unicast_listener);
   CloseUdpSocket(g_network_status.udp_global_broadcast_listener);
+  if(kEipInvalidSocket != g_network_status.udp_io_messaging) {
+    CloseUdpSocket(g_network_status.udp_io_messaging);
+    g_network_status.udp_io_messaging = kEipInvalidSocket;
+  }
   return kEipStatusOk;
 }
 
-void CheckAndHandleUdpGlobalBroadcastSocket(void) {
+void CheckAndHandleUdpGlobalBroadcastSocket(const int socket_handle) {
   /* see if this is an unsolicited inbound UDP message */
   if( true == CheckSocketSet(g_network_status.udp_global_broadcast_listener) ) {
     struct sockaddr_in from_address = { 0 };
@@ -639,7 +999,12 @@ void CheckAndHandleUdpGlobalBroadcastSocket(void) {
     const EipUint8 *receive_buffer = &incoming_message[0];
     int remaining_bytes = 0;
     ENIPMessage outgoing_message;
-    InitializeENIPMessage(&outgoing_message);
+    if( kEipStatusOk !=
+        ENIPMessageAllocateBuffer(&outgoing_message,
+                                  PC_OPENER_ETHERNET_BUFFER_SIZE) ) {
+      NetworkCountersRecordRxDiscard();
+      return;
+    }
     EipStatus need_to_send = HandleReceivedExplictUdpData(
       g_network_status.udp_unicast_listener,
       /* sending from unicast port, due to strange behavior of the broadcast port */
@@ -666,6 +1031,7 @@ void CheckAndHandleUdpGlobalBroadcastSocket(void) {
           "networkhandler: UDP response was not fully sent\n");
       }
     }
+    ENIPMessageFreeBuffer(&outgoing_message);
     if(remaining_bytes > 0) {
       OPENER_TRACE_ERR("Request on broadcast UDP port had too many data (%d)",
                        remaining_bytes);
@@ -673,7 +1039,7 @@ void CheckAndHandleUdpGlobalBroadcastSocket(void) {
   }
 }
 
-void CheckAndHandleUdpUnicastSocket(void) {
+void CheckAndHandleUdpUnicastSocket(const int socket_handle) {
   /* see if this is an unsolicited inbound UDP message */
   if( true == CheckSocketSet(g_network_status.udp_unicast_listener) ) {
 
@@ -719,7 +1085,12 @@ void CheckAndHandleUdpUnicastSocket(void) {
     EipUint8 *receive_buffer = &incoming_message[0];
     int remaining_bytes = 0;
     ENIPMessage outgoing_message;
-    InitializeENIPMessage(&outgoing_message);
+    if( kEipStatusOk !=
+        ENIPMessageAllocateBuffer(&outgoing_message,
+                                  PC_OPENER_ETHERNET_BUFFER_SIZE) ) {
+      NetworkCountersRecordRxDiscard();
+      return;
+    }
     EipStatus need_to_send = HandleReceivedExplictUdpData(
       g_network_status.udp_unicast_listener,
       &from_address,
@@ -750,6 +1121,7 @@ void CheckAndHandleUdpUnicastSocket(void) {
         NetworkCountersRecordTx(outgoing_message.used_message_length, false);
       }
     }
+    ENIPMessageFreeBuffer(&outgoing_message);
     if (remaining_bytes > 0) {
       OPENER_TRACE_ERR(
         "Request on broadcast UDP port had too many data (%d)",
@@ -799,222 +1171,315 @@ EipStatus SendUdpData(const struct sockaddr_in *const address,
   return kEipStatusOk;
 }
 
-EipStatus HandleDataOnTcpSocket(int socket) {
-  OPENER_TRACE_INFO("Entering HandleDataOnTcpSocket for socket: %d\n", socket);
-  int remaining_bytes = 0;
-  long data_sent = PC_OPENER_ETHERNET_BUFFER_SIZE;
-
-  /* We will handle just one EIP packet here the rest is done by the select
-   * method which will inform us if more data is available in the socket
-     because of the current implementation of the main loop this may not be
-     the fastest way and a loop here with a non blocking socket would better
-     fit*/
+#if defined(OPENER_IO_ZERO_COPY_PRODUCING) && 0 != OPENER_IO_ZERO_COPY_PRODUCING
+EipStatus SendUdpFrame(const struct sockaddr_in *const address,
+                       const CipOctet *const header,
+                       const size_t header_length,
+                       UdpPayloadCopyFunction copy_payload,
+                       const void *const payload,
+                       const size_t payload_length) {
+  if( kEipStatusOk != SendUdpFramePlatform(address->sin_addr.s_addr,
+                                            address->sin_port,
+                                            s_io_messaging_dscp,
+                                            header,
+                                            header_length,
+                                            copy_payload,
+                                            payload,
+                                            payload_length) ) {
+    OPENER_TRACE_ERR("networkhandler: error in SendUdpFrame\n");
+    NetworkCountersRecordTxError();
+    return kEipStatusError;
+  }
 
-  /*Check how many data is here -- read the first four bytes from the connection */
-  CipOctet incoming_message[PC_OPENER_ETHERNET_BUFFER_SIZE] = { 0 };
+  NetworkCountersRecordTx(header_length + payload_length, false);
+  return kEipStatusOk;
+}
+#endif
 
-  long number_of_read_bytes = recv(socket, NWBUF_CAST incoming_message, 4, 0); /*TODO we may have to set the socket to a non blocking socket */
+void CheckAndHandleTcpClientSocket(const int socket_handle) {
+  if( true == CheckSocketSet(socket_handle) ) {
+    if( kEipStatusError == HandleDataOnTcpSocket(socket_handle) ) { /* if error */
+      CloseTcpSocket(socket_handle);
+      RemoveSession(socket_handle); /* clean up session and close the socket */
+    }
+  }
+}
 
-  SocketTimer *const socket_timer = SocketTimerArrayGetSocketTimer(g_timestamps,
-                                                                   OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
-                                                                   socket);
-  if(number_of_read_bytes == 0) {
-    OPENER_TRACE_ERR(
-      "networkhandler: socket: %d - connection closed by client.\n",
-      socket);
-    RemoveSocketTimerFromList(socket);
-    RemoveSession(socket);
+/** @brief Answers a request with the encapsulation status "insufficient memory"
+ *
+ * Used if no message buffer is available for the reply. The reply consists
+ * of the encapsulation header only and is encoded on the stack.
+ *
+ *  @param socket The socket the request was received on
+ *  @param frame The encapsulation frame of the request
+ *  @return kEipStatusOk if the reply was sent, else kEipStatusError
+ */
+static EipStatus SendInsufficientMemoryReply(const int socket,
+                                             const CipOctet *const frame) {
+  CipOctet reply_buffer[ENCAPSULATION_HEADER_LENGTH];
+  ENIPMessage reply;
+  ENIPMessageAttachBuffer(&reply, reply_buffer, sizeof(reply_buffer) );
+
+  const CipOctet *request_position = frame;
+  AddIntToMessage(GetUintFromMessage(&request_position), &reply); /* command */
+  AddIntToMessage(0, &reply); /* no command specific data */
+  request_position += 2;
+  AddDintToMessage(GetUdintFromMessage(&request_position), &reply); /* session handle */
+  AddDintToMessage(kEncapsulationProtocolInsufficientMemory, &reply);
+  request_position += 4;
+  memcpy(reply.current_message_position, request_position, 8); /* sender context */
+  reply.current_message_position += 8;
+  reply.used_message_length += 8;
+  AddDintToMessage(0, &reply); /* options */
+
+  long data_sent = send(socket,
+                        (char *) reply.message_buffer,
+                        reply.used_message_length,
+                        MSG_NOSIGNAL);
+  if(data_sent != reply.used_message_length) {
+    NetworkCountersRecordTxError();
     return kEipStatusError;
   }
-  if(number_of_read_bytes < 0) {
+  NetworkCountersRecordTx( (size_t)data_sent, false );
+  return kEipStatusOk;
+}
+
+/** @brief Handles one complete encapsulation frame received on a TCP socket
+ *
+ *  @param socket The socket the frame was received on
+ *  @param frame The complete encapsulation frame
+ *  @param frame_length Length of the frame
+ *  @param socket_timer The socket timer of the socket, may be NULL
+ *  @param receive_time Time the frame was read from the socket
+ *  @return kEipStatusOk on success, or kEipStatusError if the session has to
+ *  be closed
+ */
+static EipStatus HandleTcpFrame(const int socket,
+                                CipOctet *const frame,
+                                const size_t frame_length,
+                                SocketTimer *const socket_timer,
+                                const MicroSeconds receive_time) {
+  int remaining_bytes = 0;
+
+  OPENER_TRACE_INFO("Data received on TCP: %" PRIuSZT "\n", frame_length);
+  NetworkCountersRecordRx(frame_length, false);
+
+  /* most replies fit into a small buffer, the message router moves the reply
+   * to a large one for requests returning more data */
+  ENIPMessage outgoing_message;
+  if( kEipStatusOk !=
+      ENIPMessageAllocateBuffer(&outgoing_message,
+                                PC_OPENER_ETHERNET_BUFFER_SIZE) ) {
+    /* TCP is not repeated by the originator, it has to get an answer */
+    OPENER_TRACE_WARN("networkhandler: no message buffer for a reply on %d\n",
+                      socket);
+    NetworkCountersRecordRxDiscard();
+    return SendInsufficientMemoryReply(socket, frame);
+  }
+
+  g_current_active_tcp_socket = socket;
+  CipDiagnosticsExplicitRequestBegin(receive_time);
+
+  struct sockaddr sender_address;
+  memset( &sender_address, 0, sizeof(sender_address) );
+  socklen_t fromlen = sizeof(sender_address);
+  if(getpeername(socket, (struct sockaddr *) &sender_address, &fromlen) < 0) {
     int error_code = GetSocketErrorNumber();
-    if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
-      return kEipStatusOk;
-    }
     char *error_message = GetErrorMessage(error_code);
-    OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
+    OPENER_TRACE_ERR("networkhandler: could not get peername: %d - %s\n",
                      error_code,
                      error_message);
     FreeErrorMessage(error_message);
-    return kEipStatusError;
   }
 
-  const EipUint8 *read_buffer = &incoming_message[2]; /* at this place EIP stores the data length */
-  EipUint16 reported_length = GetUintFromMessage(&read_buffer);
-  
-  // Prevent integer overflow: check if reported_length would cause overflow
-  if (reported_length > (PC_OPENER_ETHERNET_BUFFER_SIZE + 4)) {
-    OPENER_TRACE_ERR("Invalid packet length reported: %u (max: %u)\n",
-                     reported_length, PC_OPENER_ETHERNET_BUFFER_SIZE);
-    return kEipStatusError;
+  EipStatus need_to_send = HandleReceivedExplictTcpData(socket,
+                                                        frame,
+                                                        frame_length,
+                                                        &remaining_bytes,
+                                                        &sender_address,
+                                                        &outgoing_message);
+  if(NULL != socket_timer) {
+    SocketTimerSetLastUpdate(socket_timer, g_actual_time);
   }
-  
-  size_t data_size = reported_length + ENCAPSULATION_HEADER_LENGTH - 4; /* -4 is for the 4 bytes we have already read*/
-  /* (NOTE this advances the buffer pointer) */
-  if( (PC_OPENER_ETHERNET_BUFFER_SIZE - 4) < data_size ) { /*TODO can this be handled in a better way?*/
-    OPENER_TRACE_ERR(
-      "too large packet received will be ignored, will drop the data\n");
-    /* Currently we will drop the whole packet */
 
-    do {
-      OPENER_TRACE_INFO(
-        "Entering consumption loop, remaining data to receive: %ld\n",
-        data_sent);
-      number_of_read_bytes = recv(socket,
-                                  NWBUF_CAST & incoming_message[0],
-                                  data_sent,
-                                  0);
-
-      if(number_of_read_bytes == 0) /* got error or connection closed by client */
-      {
-        int error_code = GetSocketErrorNumber();
-        char *error_message = GetErrorMessage(error_code);
-        OPENER_TRACE_ERR(
-          "networkhandler: socket: %d - connection closed by client: %d - %s\n",
-          socket,
-          error_code,
-          error_message);
-        FreeErrorMessage(error_message);
-        RemoveSocketTimerFromList(socket);
-        return kEipStatusError;
-      }
-      if(number_of_read_bytes < 0) {
-        int error_code = GetSocketErrorNumber();
-        char *error_message = GetErrorMessage(error_code);
-        if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
-          return kEipStatusOk;
-        } OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
-                           error_code,
-                           error_message);
-        FreeErrorMessage(error_message);
-        return kEipStatusError;
-      }
-      data_size -= number_of_read_bytes;
-      if( (data_size < PC_OPENER_ETHERNET_BUFFER_SIZE) && (data_size != 0) ) {
-        data_sent = data_size;
-      }
-    } while(0 < data_size);
-    SocketTimerSetLastUpdate(socket_timer, g_actual_time);
-    return kEipStatusOk;
+  g_current_active_tcp_socket = kEipInvalidSocket;
+
+  if(remaining_bytes != 0) {
+    OPENER_TRACE_WARN(
+      "Warning: received packet was to long: %d Bytes left!\n",
+      remaining_bytes);
   }
 
-  number_of_read_bytes = recv(socket,
-                              NWBUF_CAST & incoming_message[4],
-                              data_size,
-                              0);
+  if(need_to_send > 0) {
+    OPENER_TRACE_INFO("TCP reply: send %" PRIuSZT " bytes on %d\n",
+                      outgoing_message.used_message_length,
+                      socket);
 
-  if(0 == number_of_read_bytes) /* got error or connection closed by client */
-  {
-    int error_code = GetSocketErrorNumber();
-    char *error_message = GetErrorMessage(error_code);
-    OPENER_TRACE_ERR(
-      "networkhandler: socket: %d - connection closed by client: %d - %s\n",
-      socket,
-      error_code,
-      error_message);
-    FreeErrorMessage(error_message);
-    RemoveSocketTimerFromList(socket);
-    RemoveSession(socket);
-    return kEipStatusError;
+    long data_sent = send(socket,
+                          (char *) outgoing_message.message_buffer,
+                          outgoing_message.used_message_length,
+                          MSG_NOSIGNAL);
+    SocketTimerSetLastUpdate(socket_timer, g_actual_time);
+    if(data_sent != outgoing_message.used_message_length) {
+      OPENER_TRACE_WARN(
+        "TCP response was not fully sent: exp %" PRIuSZT ", sent %ld\n",
+        outgoing_message.used_message_length,
+        data_sent);
+      NetworkCountersRecordTxDiscard();
+    }
+    if (data_sent > 0) {
+      NetworkCountersRecordTx((size_t)data_sent, false);
+    } else {
+      NetworkCountersRecordTxError();
+    }
+    CipDiagnosticsExplicitRequestEnd(data_sent > 0);
+  } else {
+    CipDiagnosticsExplicitRequestEnd(false);
   }
-  if(number_of_read_bytes < 0) {
-    int error_code = GetSocketErrorNumber();
-    char *error_message = GetErrorMessage(error_code);
-    if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
-      return kEipStatusOk;
-    } OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
-                       error_code,
-                       error_message);
-    FreeErrorMessage(error_message);
+  ENIPMessageFreeBuffer(&outgoing_message);
+  return kEipStatusOk;
+}
+
+EipStatus HandleDataOnTcpSocket(int socket) {
+  OPENER_TRACE_INFO("Entering HandleDataOnTcpSocket for socket: %d\n", socket);
+
+  /* The received bytes are accumulated in the receive buffer of the socket
+   * until a complete encapsulation frame is available, so frames split over
+   * several TCP segments are reassembled across select() wakeups. All complete
+   * frames in the buffer are handled in one call. */
+  SocketReceiveBuffer *const receive_buffer =
+    SocketReceiveBufferArrayGetSocketReceiveBuffer(g_receive_buffers,
+                                                   OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+                                                   socket);
+  if(NULL == receive_buffer) {
+    OPENER_TRACE_ERR("networkhandler: no receive buffer for socket: %d\n",
+                     socket);
     return kEipStatusError;
   }
 
-  if( (unsigned) number_of_read_bytes == data_size ) {
-    /*we got the right amount of data */
-    data_size += 4;
-    /*TODO handle partial packets*/
-    OPENER_TRACE_INFO("Data received on TCP: %" PRIuSZT "\n", data_size);
-    NetworkCountersRecordRx(data_size, false);
-
-    g_current_active_tcp_socket = socket;
+  SocketTimer *const socket_timer = SocketTimerArrayGetSocketTimer(g_timestamps,
+                                                                   OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+                                                                   socket);
 
-    struct sockaddr sender_address;
-    memset( &sender_address, 0, sizeof(sender_address) );
-    socklen_t fromlen = sizeof(sender_address);
-    if(getpeername(socket, (struct sockaddr *) &sender_address, &fromlen) < 0) {
+  size_t free_length = 0;
+  long number_of_read_bytes = 0;
+  do {
+    free_length = SocketReceiveBufferGetFreeLength(receive_buffer);
+    if(0 == free_length) {
+      break; /* nothing to read into, a recv() of 0 bytes would look like a close */
+    }
+    /* the session socket stays blocking for send(), only the reads must not
+     * wait for a peer whose data exactly filled the buffer on the last call */
+    number_of_read_bytes = recv(socket,
+                                NWBUF_CAST & receive_buffer->data[
+                                  receive_buffer->used_length],
+                                free_length,
+                                MSG_DONTWAIT);
+    if(number_of_read_bytes == 0) {
+      OPENER_TRACE_ERR(
+        "networkhandler: socket: %d - connection closed by client.\n",
+        socket);
+      RemoveSocketTimerFromList(socket);
+      RemoveSession(socket);
+      return kEipStatusError;
+    }
+    if(number_of_read_bytes < 0) {
       int error_code = GetSocketErrorNumber();
+      if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
+        return kEipStatusOk;
+      }
       char *error_message = GetErrorMessage(error_code);
-      OPENER_TRACE_ERR("networkhandler: could not get peername: %d - %s\n",
+      OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
                        error_code,
                        error_message);
       FreeErrorMessage(error_message);
+      return kEipStatusError;
     }
+    receive_buffer->used_length += (size_t)number_of_read_bytes;
+    const MicroSeconds receive_time = GetMicroSeconds();
+
+    size_t frame_start = 0;
+    while(frame_start < receive_buffer->used_length) {
+      const size_t buffered_length = receive_buffer->used_length - frame_start;
+
+      if(0 != receive_buffer->discard_length) {
+        /* drop the rest of a frame too large for the receive buffer */
+        const size_t dropped_length =
+          (receive_buffer->discard_length < buffered_length) ?
+          receive_buffer->discard_length : buffered_length;
+        receive_buffer->discard_length -= dropped_length;
+        frame_start += dropped_length;
+        if(0 == receive_buffer->discard_length) {
+          SocketTimerSetLastUpdate(socket_timer, g_actual_time);
+        }
+        continue;
+      }
 
-    ENIPMessage outgoing_message;
-    InitializeENIPMessage(&outgoing_message);
-    EipStatus need_to_send = HandleReceivedExplictTcpData(socket,
-                                                          incoming_message,
-                                                          data_size,
-                                                          &remaining_bytes,
-                                                          &sender_address,
-                                                          &outgoing_message);
-    if(NULL != socket_timer) {
-      SocketTimerSetLastUpdate(socket_timer, g_actual_time);
-    }
-
-    g_current_active_tcp_socket = kEipInvalidSocket;
+      if(buffered_length < ENCAPSULATION_HEADER_LENGTH) {
+        break;
+      }
+      const EipUint8 *read_buffer = &receive_buffer->data[frame_start + 2]; /* at this place EIP stores the data length */
+      const size_t frame_length = GetUintFromMessage(&read_buffer) +
+                                  ENCAPSULATION_HEADER_LENGTH;
 
-    if(remaining_bytes != 0) {
-      OPENER_TRACE_WARN(
-        "Warning: received packet was to long: %d Bytes left!\n",
-        remaining_bytes);
-    }
+      if(frame_length > OPENER_MAXIMUM_MESSAGE_SIZE) {
+        OPENER_TRACE_ERR(
+          "too large packet received will be ignored, will drop the data\n");
+        NetworkCountersRecordRxDiscard();
+        receive_buffer->discard_length = frame_length;
+        continue;
+      }
+      if(buffered_length < frame_length) {
+        /* move the partial frame to the front, the buffer is only enlarged
+         * once the frame has filled it, not on the length in the header */
+        SocketReceiveBufferConsume(receive_buffer, frame_start);
+        frame_start = 0;
+        if( (receive_buffer->used_length == receive_buffer->size) &&
+            (kEipStatusOk !=
+             SocketReceiveBufferReserve(receive_buffer, frame_length) ) ) {
+          OPENER_TRACE_WARN(
+            "no receive buffer for a frame of %u bytes, closing socket %d\n",
+            (unsigned) frame_length,
+            socket);
+          NetworkCountersRecordRxDiscard();
+          return kEipStatusError;
+        }
+        break; /* wait for the rest of the frame */
+      }
 
-    if(need_to_send > 0) {
-      OPENER_TRACE_INFO("TCP reply: send %" PRIuSZT " bytes on %d\n",
-                        outgoing_message.used_message_length,
-                        socket);
-
-      data_sent = send(socket,
-                       (char *) outgoing_message.message_buffer,
-                       outgoing_message.used_message_length,
-                       MSG_NOSIGNAL);
-      SocketTimerSetLastUpdate(socket_timer, g_actual_time);
-      if(data_sent != outgoing_message.used_message_length) {
-        OPENER_TRACE_WARN(
-          "TCP response was not fully sent: exp %" PRIuSZT ", sent %ld\n",
-          outgoing_message.used_message_length,
-          data_sent);
-        NetworkCountersRecordTxDiscard();
+      if( kEipStatusOk !=
+          HandleTcpFrame(socket, &receive_buffer->data[frame_start],
+                         frame_length, socket_timer, receive_time) ) {
+        return kEipStatusError;
       }
-      if (data_sent > 0) {
-        NetworkCountersRecordTx((size_t)data_sent, false);
-      } else {
-        NetworkCountersRecordTxError();
+      if(socket != receive_buffer->socket) {
+        return kEipStatusOk; /* the session has been closed by the request */
       }
+      frame_start += frame_length;
     }
+    SocketReceiveBufferConsume(receive_buffer, frame_start);
+    /* a filled up buffer may not have taken all data available on the socket */
+  } while( (size_t)number_of_read_bytes == free_length );
 
-    return kEipStatusOk;
-  } else {
-    /* we got a fragmented packet currently we cannot handle this will
-     * for this we would need a network buffer per TCP socket
-     *
-     * However with typical packet sizes of EIP this shouldn't be a big issue.
-     */
-    /*TODO handle fragmented packets */
-  }
-  return kEipStatusError;
+  return kEipStatusOk;
 }
 
 /** @brief Create the UDP socket for the implicit IO messaging, one socket handles all connections
+ *
+ * The socket is created with the first IO connection and kept open afterwards,
+ * further calls return the existing socket.
  *
  * @return the socket handle if successful, else kEipInvalidSocket */
 int CreateUdpSocket(void) {
 
+  if(kEipInvalidSocket != g_network_status.udp_io_messaging) {
+    return g_network_status.udp_io_messaging;
+  }
+
   /* create a new UDP socket */
-  g_network_status.udp_io_messaging = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  int udp_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
 
-  if (g_network_status.udp_io_messaging == kEipInvalidSocket) {
+  if (udp_socket == kEipInvalidSocket) {
     int error_code = GetSocketErrorNumber();
     char *error_message = GetErrorMessage(error_code);
     OPENER_TRACE_ERR("networkhandler: cannot create UDP socket: %d- %s\n",
@@ -1024,23 +1489,22 @@ int CreateUdpSocket(void) {
     return kEipInvalidSocket;
   }
 
-  if (SetSocketToNonBlocking(g_network_status.udp_io_messaging) < 0) {
+  if (SetSocketToNonBlocking(udp_socket) < 0) {
     OPENER_TRACE_ERR(
       "networkhandler udp_io_messaging: error setting socket to non-blocking on new socket\n");
-    CloseUdpSocket(g_network_status.udp_io_messaging);
+    CloseUdpSocket(udp_socket);
     OPENER_ASSERT(false);/* This should never happen! */
     return kEipInvalidSocket;
   }
 
-  OPENER_TRACE_INFO("networkhandler: UDP socket %d\n",
-                    g_network_status.udp_io_messaging);
+  OPENER_TRACE_INFO("networkhandler: UDP socket %d\n", udp_socket);
 
   int option_value = 1;
-  if (setsockopt( g_network_status.udp_io_messaging, SOL_SOCKET, SO_REUSEADDR,
+  if (setsockopt( udp_socket, SOL_SOCKET, SO_REUSEADDR,
                   (char *)&option_value, sizeof(option_value) ) < 0) {
     OPENER_TRACE_ERR(
       "error setting socket option SO_REUSEADDR on UDP socket\n");
-    CloseUdpSocket(g_network_status.udp_io_messaging);
+    CloseUdpSocket(udp_socket);
     return kEipInvalidSocket;
   }
 
@@ -1051,7 +1515,7 @@ int CreateUdpSocket(void) {
     .sin_port = htons(kOpenerEipIoUdpPort)
   };
 
-  if (bind( g_network_status.udp_io_messaging, (struct sockaddr *)&source_addr,
+  if (bind( udp_socket, (struct sockaddr *)&source_addr,
             sizeof(source_addr) ) < 0) {
     int error_code = GetSocketErrorNumber();
     char *error_message = GetErrorMessage(error_code);
@@ -1059,18 +1523,19 @@ int CreateUdpSocket(void) {
                      error_code,
                      error_message);
     FreeErrorMessage(error_message);
-    CloseUdpSocket(g_network_status.udp_io_messaging);
+    CloseUdpSocket(udp_socket);
     return kEipInvalidSocket;
   }
 
   /* add new socket to the master list */
-  FD_SET(g_network_status.udp_io_messaging, &master_socket);
-
-  if (g_network_status.udp_io_messaging > highest_socket_handle) {
-    OPENER_TRACE_INFO("New highest socket: %d\n",
-                      g_network_status.udp_io_messaging);
-    highest_socket_handle = g_network_status.udp_io_messaging;
+  if (kEipStatusOk !=
+      NetworkHandlerRegisterSocket(udp_socket,
+                                   CheckAndHandleConsumingUdpSocket) ) {
+    CloseUdpSocket(udp_socket);
+    return kEipInvalidSocket;
   }
+
+  g_network_status.udp_io_messaging = udp_socket;
   return g_network_status.udp_io_messaging;
 }
 
@@ -1078,6 +1543,9 @@ int CreateUdpSocket(void) {
  *
  * @return 0 if successful, else the error code */
 int SetQos(CipUsint qos_for_socket) {
+#if defined(OPENER_IO_ZERO_COPY_PRODUCING) && 0 != OPENER_IO_ZERO_COPY_PRODUCING
+  s_io_messaging_dscp = CipQosGetDscpPriority(qos_for_socket);
+#endif
   if (SetQosOnSocket( g_network_status.udp_io_messaging,
                       CipQosGetDscpPriority(qos_for_socket) ) !=
       0) { /* got error */
@@ -1145,81 +1613,106 @@ EipUint32 GetPeerAddress(void) {
   return peer_address.sin_addr.s_addr;
 }
 
-void CheckAndHandleConsumingUdpSocket(void) {
-  DoublyLinkedListNode *iterator = connection_list.first;
-
-  CipConnectionObject *current_connection_object = NULL;
-
-  /* see a message of the registered UDP socket has been received     */
-  while(NULL != iterator) {
-    current_connection_object = (CipConnectionObject *) iterator->data;
-    iterator = iterator->next; /* do this at the beginning as the close function may can make the entry invalid */
-
-    if( (kEipInvalidSocket !=
-         current_connection_object->socket[kUdpCommuncationDirectionConsuming])
-        && ( true ==
-             CheckSocketSet(current_connection_object->socket[
-                              kUdpCommuncationDirectionConsuming
-                            ]) ) ) {
-      #if NETWORK_VERBOSE_LOGGING
-      OPENER_TRACE_INFO("Processing UDP consuming message\n");
-      #endif
-      struct sockaddr_in from_address = { 0 };
-      socklen_t from_address_length = sizeof(from_address);
-      CipOctet incoming_message[PC_OPENER_ETHERNET_BUFFER_SIZE] = { 0 };
-
-      int received_size = recvfrom(g_network_status.udp_io_messaging,
-                                   NWBUF_CAST incoming_message,
-                                   sizeof(incoming_message),
-                                   0,
-                                   (struct sockaddr *) &from_address,
-                                   &from_address_length);
-      if(0 == received_size) {
-        NetworkCountersRecordRxDiscard();
-        NetworkCountersRecordRxError();
-        int error_code = GetSocketErrorNumber();
-        char *error_message = GetErrorMessage(error_code);
-        OPENER_TRACE_ERR(
-          "networkhandler: socket: %d - connection closed by client: %d - %s\n",
-          current_connection_object->socket[
-            kUdpCommuncationDirectionConsuming],
-          error_code,
-          error_message);
-        FreeErrorMessage(error_message);
-        current_connection_object->connection_close_function(
-          current_connection_object);
-        continue;
+/** @brief Gets the largest O->T datagram of the connections consuming from a UDP socket
+ *
+ *  @param socket_handle The UDP socket to check
+ *  @return Size of the largest expected datagram in bytes, 0 if no connection
+ *  consumes from the socket
+ */
+static size_t GetLargestConsumedDatagramSize(const int socket_handle) {
+  /* item count, sequenced address item and connected data item header */
+  const size_t kCommonPacketFormatOverhead = 2 + 12 + 4;
+  size_t largest_datagram_size = 0;
+  for(const DoublyLinkedListNode *iterator = connection_list.first;
+      NULL != iterator; iterator = iterator->next) {
+    const CipConnectionObject *const connection_object = iterator->data;
+    if(socket_handle ==
+       connection_object->socket[kUdpCommuncationDirectionConsuming]) {
+      const size_t datagram_size = kCommonPacketFormatOverhead +
+                                   ConnectionObjectGetOToTConnectionSize(
+        connection_object);
+      if(datagram_size > largest_datagram_size) {
+        largest_datagram_size = datagram_size;
       }
+    }
+  }
+  return largest_datagram_size;
+}
+
+void CheckAndHandleConsumingUdpSocket(const int socket_handle) {
+  if( true != CheckSocketSet(socket_handle) ) {
+    return;
+  }
 
-      if(0 > received_size) {
-        int error_code = GetSocketErrorNumber();
-        if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
-          return; // No fatal error, resume execution
-        } 
+  /* if nobody consumes from this socket (anymore) the datagrams are dropped,
+   * so select() does not report the socket over and over again */
+  const size_t largest_datagram_size = GetLargestConsumedDatagramSize(
+    socket_handle);
+  const bool is_consumed = 0 != largest_datagram_size;
+
+  /* taken from the pool in the size of the largest expected frame, usually a
+   * small buffer. One spare byte makes a longer datagram show up truncated
+   * with a wrong length, which its connection rejects. */
+  size_t incoming_message_size = 0;
+  CipOctet *const incoming_message = MessageBufferPoolAllocate(
+    largest_datagram_size + 1,
+    &incoming_message_size);
+  if(NULL == incoming_message) {
+    return; /* select() reports the socket again */
+  }
+
+  /* All O->T datagrams share this socket, so drain everything queued up to
+   * the budget instead of one datagram per select() cycle. Whatever is left
+   * after the budget is reported by the next select(). */
+  CipUdint number_of_datagrams = 0;
+  while(number_of_datagrams < OPENER_UDP_IO_RECEIVE_BATCH_BUDGET) {
+    struct sockaddr_in from_address = { 0 };
+    socklen_t from_address_length = sizeof(from_address);
+
+    int received_size = recvfrom(socket_handle,
+                                 NWBUF_CAST incoming_message,
+                                 incoming_message_size,
+                                 0,
+                                 (struct sockaddr *) &from_address,
+                                 &from_address_length);
+    if(0 > received_size) {
+      int error_code = GetSocketErrorNumber();
+      if(OPENER_SOCKET_WOULD_BLOCK != error_code) {
+        /* the socket is shared by all connections, a failing connection is
+         * detected by its inactivity watchdog */
         NetworkCountersRecordRxError();
         char *error_message = GetErrorMessage(error_code);
         OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
-                           error_code,
-                           error_message);
+                         error_code,
+                         error_message);
         FreeErrorMessage(error_message);
-        current_connection_object->connection_close_function(
-          current_connection_object);
-        continue;
       }
+      break;
+    }
 
-      NetworkCountersRecordRx((size_t)received_size, false);
-      HandleReceivedConnectedData(incoming_message, received_size,
-                                  &from_address);
-
+    number_of_datagrams++;
+    if( (0 == received_size) || !is_consumed ) {
+      NetworkCountersRecordRxDiscard();
+      continue;
     }
+
+    #if NETWORK_VERBOSE_LOGGING
+    OPENER_TRACE_INFO("Processing UDP consuming message\n");
+    #endif
+    NetworkCountersRecordRx((size_t)received_size, false);
+    HandleReceivedConnectedData(incoming_message, received_size,
+                                &from_address);
   }
+
+  MessageBufferPoolFree(incoming_message);
+  UdpIoReceiveStatisticsRecordBatch(number_of_datagrams);
 }
 
 void CloseSocket(const int socket_handle) {
   OPENER_TRACE_INFO("networkhandler: closing socket %d\n", socket_handle);
 
   if(kEipInvalidSocket != socket_handle) {
-    FD_CLR(socket_handle, &master_socket);
+    NetworkHandlerUnregisterSocket(socket_handle);
     CloseSocketPlatform(socket_handle);
   } OPENER_TRACE_INFO("networkhandler: closing socket done %d\n",
                       socket_handle);
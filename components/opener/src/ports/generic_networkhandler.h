@@ -30,6 +30,8 @@
 #include "networkhandler.h"
 #include "appcontype.h"
 #include "socket_timer.h"
+#include "socket_receive_buffer.h"
+#include "timerqueue.h"
 
 /*The port to be used per default for I/O messages on UDP.*/
 extern const uint16_t kOpenerEipIoUdpPort;
@@ -86,8 +88,88 @@ typedef struct {
   CipUdint out_errors;
 } NetworkInterfaceCounters;
 
+/** @brief Maximum number of datagrams read from the UDP I/O socket per wakeup
+ *
+ *  Bounds the time spent in the consuming socket handler when a burst of
+ *  O->T datagrams is queued, so the connection timers are not delayed.
+ */
+#ifndef OPENER_UDP_IO_RECEIVE_BATCH_BUDGET
+#define OPENER_UDP_IO_RECEIVE_BATCH_BUDGET 16
+#endif
+
+/** @brief Statistics of the batched receive on the UDP I/O socket
+ *
+ *  The batch sizes show how many O->T datagrams were queued in the socket
+ *  when it was serviced.
+ */
+typedef struct {
+  CipUdint batches; /**< wakeups which received at least one datagram */
+  CipUdint datagrams; /**< datagrams received in all batches */
+  CipUdint last_batch_size; /**< datagrams received in the last batch */
+  CipUdint maximum_batch_size; /**< largest batch since the last reset */
+  CipUdint budget_exhausted; /**< batches stopped by OPENER_UDP_IO_RECEIVE_BATCH_BUDGET */
+  CipUdint empty_wakeups; /**< wakeups which did not receive a datagram */
+} NetworkUdpIoReceiveStatistics;
+
+/** @brief Length of the window over which the load of the network handler
+ *  is rolled up into a utilization figure, in milliseconds
+ */
+#ifndef OPENER_NETWORK_LOAD_WINDOW_MS
+#define OPENER_NETWORK_LOAD_WINDOW_MS 1000U
+#endif
+
+/** @brief Phases of the network handler loop accounted by the load statistics
+ *
+ *  Every microsecond of the OpENer task is accounted to exactly one phase,
+ *  so the phase times of a window add up to the window length.
+ */
+typedef enum {
+  kNetworkHandlerPhaseSelect = 0, /**< waiting in select(), the idle time */
+  kNetworkHandlerPhaseTcp, /**< TCP listener and client socket handlers */
+  kNetworkHandlerPhaseUdp, /**< UDP listener and I/O socket handlers */
+  kNetworkHandlerPhaseConnectionTimers, /**< connection timers (production, watchdogs) and session inactivity timer */
+  kNetworkHandlerPhaseManageConnections, /**< ManageConnections() */
+  kNetworkHandlerPhaseTimeoutCheckers, /**< registered timeout checker functions */
+  kNetworkHandlerPhaseOther, /**< loop overhead and time spent outside NetworkHandlerProcessCyclic() */
+  kNetworkHandlerNumberOfPhases
+} NetworkHandlerPhase;
+
+/** @brief Load statistics of the network handler loop
+ *
+ *  The utilization is the share of the wall clock time the OpENer task did
+ *  not wait in select(). It also contains the time the task was preempted
+ *  while it was busy.
+ */
+typedef struct {
+  CipUlint total[kNetworkHandlerNumberOfPhases]; /**< time per phase since the last reset in microseconds */
+  CipUdint window[kNetworkHandlerNumberOfPhases]; /**< time per phase in the last completed window in microseconds */
+  CipUdint window_length; /**< length of the last completed window in microseconds */
+  CipUint utilization; /**< busy share of the last completed window in 0.1 % */
+  CipUint peak_utilization; /**< highest utilization of a window since the last reset in 0.1 % */
+  CipUdint cycles; /**< passes through NetworkHandlerProcessCyclic() since the last reset */
+  CipUdint maximum_cycle_busy_time; /**< longest busy time of a single pass in microseconds */
+} NetworkHandlerLoadStatistics;
+
+/** @brief Function handling a readable socket
+ *
+ *  @param socket_handle The socket which has been reported readable by select()
+ */
+typedef void (*NetworkSocketHandlerFunction)(const int socket_handle);
+
+/** @brief Registry entry associating a socket with its handler
+ *
+ */
+typedef struct {
+  int socket; /**< registered socket or kEipInvalidSocket if unused */
+  NetworkSocketHandlerFunction handler_function; /**< called if socket is readable */
+} NetworkSocketHandler;
+
 const NetworkInterfaceCounters *NetworkGetInterfaceCounters(void);
 void NetworkResetInterfaceCounters(void);
+const NetworkUdpIoReceiveStatistics *NetworkGetUdpIoReceiveStatistics(void);
+void NetworkResetUdpIoReceiveStatistics(void);
+const NetworkHandlerLoadStatistics *NetworkGetLoadStatistics(void);
+void NetworkResetLoadStatistics(void);
 
 /** @brief The platform independent part of network handler initialization routine
  *
@@ -95,6 +177,43 @@ void NetworkResetInterfaceCounters(void);
  */
 EipStatus NetworkHandlerInitialize(void);
 
+/** @brief Adds a socket to the select() set and registers its handler
+ *
+ *  Registering an already registered socket updates its handler.
+ *
+ *  @param socket_handle The socket to watch for incoming data
+ *  @param handler_function Function called when the socket is readable
+ *  @return kEipStatusOk on success, kEipStatusError if no handler slot is left
+ */
+EipStatus NetworkHandlerRegisterSocket(const int socket_handle,
+                                       NetworkSocketHandlerFunction handler_function);
+
+/** @brief Removes a socket from the select() set and its handler from the registry
+ *
+ *  Safe to be called from within a socket handler.
+ *
+ *  @param socket_handle The socket to be removed
+ */
+void NetworkHandlerUnregisterSocket(const int socket_handle);
+
+/** @brief Schedules or reschedules a timer in the network handler's deadline queue
+ *
+ *  The select() timeout is derived from the earliest deadline in the queue.
+ *  The expired function is called from NetworkHandlerProcessCyclic().
+ *
+ *  @param timer Initialized timer entry, see TimerQueueEntryInitialize()
+ *  @param deadline Absolute expiry time based on GetMilliSeconds()
+ *  @return kEipStatusOk on success, kEipStatusError if the queue is full
+ */
+EipStatus NetworkHandlerScheduleTimer(TimerQueueEntry *const timer,
+                                      const MilliSeconds deadline);
+
+/** @brief Removes a timer from the network handler's deadline queue
+ *
+ *  @param timer The timer entry to be removed
+ */
+void NetworkHandlerCancelTimer(TimerQueueEntry *const timer);
+
 void CloseUdpSocket(int socket_handle);
 
 void CloseTcpSocket(int socket_handle);
@@ -122,6 +241,28 @@ int GetMaxSocket(int socket1,
                  int socket3,
                  int socket4);
 
+#if defined(OPENER_IO_ZERO_COPY_PRODUCING) && 0 != OPENER_IO_ZERO_COPY_PRODUCING
+/** @brief Sends an I/O frame without assembling it in an ENIPMessage first
+ *
+ * The frame is handed to SendUdpFramePlatform(), which writes header and payload
+ * directly into a buffer of the IP stack.
+ *
+ * @param address Destination of the frame
+ * @param header Encapsulation header of the frame
+ * @param header_length Length of header
+ * @param copy_payload Function copying the payload into the frame
+ * @param payload Source of the payload, passed to copy_payload
+ * @param payload_length Length of payload
+ * @return kEipStatusOk on success
+ */
+EipStatus SendUdpFrame(const struct sockaddr_in *const address,
+                       const CipOctet *const header,
+                       const size_t header_length,
+                       UdpPayloadCopyFunction copy_payload,
+                       const void *const payload,
+                       const size_t payload_length);
+#endif
+
 /** @brief Set the Qos the socket for implicit IO messaging
  *
  * @return 0 if successful, else the error code */
@@ -58,6 +58,26 @@ MicroSeconds GetMicroSeconds(void);
  */
 MilliSeconds GetMilliSeconds(void);
 
+/** @brief Returns a value identifying the calling task or thread
+ *
+ * Used by the binary trace buffer to give each task its own ring. The value
+ * has to be unique among the running tasks and must not be 0.
+ *
+ *  @return Identifier of the calling task
+ */
+const void *GetCurrentTaskId(void);
+
+/** @brief Enters a critical section shared by all tasks
+ *
+ * Serializes the writers of assembly data. It is only held while a few bytes
+ * are copied, no blocking calls are allowed inside. The section is not
+ * recursive.
+ */
+void EnterCriticalSectionPlatform(void);
+
+/** @brief Leaves the critical section entered with EnterCriticalSectionPlatform() */
+void LeaveCriticalSectionPlatform(void);
+
 /** @brief Sets QoS on socket
  *
  * A wrapper function - needs a platform dependent implementation to set QoS on a socket
@@ -71,4 +91,42 @@ MilliSeconds GetMilliSeconds(void);
 int SetQosOnSocket(const int socket,
                    CipUsint qos_value);
 
+/** @brief Copies the payload of an I/O frame into the buffer of the IP stack
+ *
+ * @param destination Payload area of the frame
+ * @param source Source of the payload as given to SendUdpFramePlatform()
+ * @param length Length of the payload
+ */
+typedef void (*UdpPayloadCopyFunction)(CipOctet *const destination,
+                                       const void *const source,
+                                       const size_t length);
+
+/** @brief Sends an I/O frame with the raw UDP API of the IP stack
+ *
+ * Only needed if OPENER_IO_ZERO_COPY_PRODUCING is enabled. Header and payload
+ * are written directly into a stack owned packet buffer and handed to the stack
+ * without passing through the socket layer, so the payload is copied only once.
+ * The payload is copied with copy_payload, which takes a consistent snapshot
+ * of the assembly data.
+ *
+ * @param ip_address Destination IP address in network byte order
+ * @param port Destination UDP port in network byte order
+ * @param dscp DSCP value to be used for the frame
+ * @param header Encapsulation header of the frame
+ * @param header_length Length of header
+ * @param copy_payload Function copying the payload into the frame
+ * @param payload Source of the payload, passed to copy_payload
+ * @param payload_length Length of payload
+ *
+ * @return kEipStatusOk if the frame was handed to the stack, otherwise kEipStatusError
+ */
+EipStatus SendUdpFramePlatform(const CipUdint ip_address,
+                               const CipUint port,
+                               const CipUsint dscp,
+                               const CipOctet *const header,
+                               const size_t header_length,
+                               UdpPayloadCopyFunction copy_payload,
+                               const void *const payload,
+                               const size_t payload_length);
+
 #endif /* OPENER_NETWORKHANDLER_H_ */
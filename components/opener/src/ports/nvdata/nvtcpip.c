@@ -7,8 +7,8 @@
 /** @file nvtcpip.c
  *  @brief This file implements the functions to handle TCP/IP object's NV data.
  *
- *  This is only a code skeleton. The real load and store operation is NOT
- *  implemented.
+ *  The ESP32 port keeps the data in NVS. Other ports store it in a
+ *  configuration file through conffile.c.
  */
 #include "nvtcpip.h"
 
@@ -18,6 +18,8 @@
 #include "ciptcpipinterface.h"
 #include "cipstring.h"
 #include "trace.h"
+
+#if defined(ESP32)
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
@@ -289,3 +291,129 @@ EipStatus NvTcpipStore(const CipTcpIpObject *p_tcp_ip) {
 
   return kEipStatusOk;
 }
+
+#else /* defined(ESP32) */
+
+#include <stdio.h>
+
+#include "conffile.h"
+
+#define TCPIP_CFG_NAME  "tcpip.cfg"
+
+/** @brief Reads one line into a CipString, without the line end
+ *
+ *  @param  p_file      the configuration file
+ *  @param  cip_string  the string to set, cleared for an empty line
+ *  @return kEipStatusOk: success; kEipStatusError: failure
+ */
+static EipStatus NvTcpipReadString(FILE *p_file,
+                                   CipString *const cip_string) {
+  char line[256];
+  if (NULL == fgets(line, sizeof line, p_file) ) {
+    return kEipStatusError;
+  }
+  line[strcspn(line, "\r\n")] = '\0';
+  ClearCipString(cip_string);
+  if ('\0' != line[0] && NULL == SetCipStringByCstr(cip_string, line) ) {
+    return kEipStatusError;
+  }
+  return kEipStatusOk;
+}
+
+/** @brief Load NV data of the TCP/IP object from file
+ *
+ *  @param  p_tcp_ip pointer to the TCP/IP object's data structure
+ *  @return kEipStatusOk: success; kEipStatusError: failure
+ */
+EipStatus NvTcpipLoad(CipTcpIpObject *p_tcp_ip) {
+  FILE  *p_file = ConfFileOpen(false, TCPIP_CFG_NAME);
+  if (NULL == p_file) {
+    return kEipStatusError;
+  }
+
+  CipTcpIpObject tcp_ip = *p_tcp_ip;
+  CipString hostname = { 0 };
+  CipString domain_name = { 0 };
+  unsigned int select_acd = 0;
+
+  /* Read input data */
+  int rd_cnt = fscanf(p_file,
+                      " %" SCNx32 ", %" SCNx32 ", %" SCNx32 ", %" SCNx32
+                      ", %" SCNx32 ", %" SCNx32 ", %u\n",
+                      &tcp_ip.config_control,
+                      &tcp_ip.interface_configuration.ip_address,
+                      &tcp_ip.interface_configuration.network_mask,
+                      &tcp_ip.interface_configuration.gateway,
+                      &tcp_ip.interface_configuration.name_server,
+                      &tcp_ip.interface_configuration.name_server_2,
+                      &select_acd);
+  EipStatus eip_status = (7 == rd_cnt) ? kEipStatusOk : kEipStatusError;
+  if (kEipStatusOk == eip_status) {
+    tcp_ip.select_acd = (0 != select_acd);
+    eip_status = NvTcpipReadString(p_file, &hostname);
+  }
+  if (kEipStatusOk == eip_status) {
+    eip_status = NvTcpipReadString(p_file, &domain_name);
+  }
+
+  /* Need to try to close all stuff in any case. */
+  eip_status =
+    ( kEipStatusError ==
+      ConfFileClose(&p_file) ) ? kEipStatusError : eip_status;
+
+  /* the object is only touched if everything was read */
+  if (kEipStatusOk == eip_status) {
+    ClearCipString(&tcp_ip.hostname);
+    ClearCipString(&tcp_ip.interface_configuration.domain_name);
+    tcp_ip.hostname = hostname;
+    tcp_ip.interface_configuration.domain_name = domain_name;
+    *p_tcp_ip = tcp_ip;
+  } else {
+    ClearCipString(&hostname);
+    ClearCipString(&domain_name);
+  }
+  return eip_status;
+}
+
+/** @brief Store NV data of the TCP/IP object to file
+ *
+ *  @param  p_tcp_ip pointer to the TCP/IP object's data structure
+ *  @return kEipStatusOk: success; kEipStatusError: failure
+ */
+EipStatus NvTcpipStore(const CipTcpIpObject *p_tcp_ip) {
+  FILE  *p_file = ConfFileOpen(true, TCPIP_CFG_NAME);
+  if (NULL == p_file) {
+    return kEipStatusError;
+  }
+
+  EipStatus eip_status = kEipStatusOk;
+  const CipTcpIpInterfaceConfiguration *const cfg =
+    &p_tcp_ip->interface_configuration;
+  /* Print output data */
+  if ( 0 >= fprintf(p_file,
+                    " %" PRIx32 ", %" PRIx32 ", %" PRIx32 ", %" PRIx32
+                    ", %" PRIx32 ", %" PRIx32 ", %u\n%.*s\n%.*s\n",
+                    p_tcp_ip->config_control,
+                    cfg->ip_address,
+                    cfg->network_mask,
+                    cfg->gateway,
+                    cfg->name_server,
+                    cfg->name_server_2,
+                    p_tcp_ip->select_acd ? 1u : 0u,
+                    (int)p_tcp_ip->hostname.length,
+                    (NULL != p_tcp_ip->hostname.string) ?
+                    (const char *)p_tcp_ip->hostname.string : "",
+                    (int)cfg->domain_name.length,
+                    (NULL != cfg->domain_name.string) ?
+                    (const char *)cfg->domain_name.string : "") ) {
+    eip_status = kEipStatusError;
+  }
+
+  /* Need to try to close all stuff in any case. */
+  eip_status =
+    ( kEipStatusError ==
+      ConfFileClose(&p_file) ) ? kEipStatusError : eip_status;
+  return eip_status;
+}
+
+#endif /* defined(ESP32) */
@@ -0,0 +1,116 @@
+/*******************************************************************************
+ * Copyright (c) 2016, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "socket_receive_buffer.h"
+
+#include <string.h>
+
+#include "trace.h"
+#include "messagebufferpool.h"
+
+/** @brief Number of receive buffers holding a pooled buffer */
+static size_t s_number_of_pooled_receive_buffers = 0;
+
+/** @brief Returns a pooled buffer and switches back to the embedded buffer */
+static void SocketReceiveBufferReleasePooledData(
+  SocketReceiveBuffer *const receive_buffer) {
+  if (receive_buffer->data != receive_buffer->embedded_data) {
+    MessageBufferPoolFree(receive_buffer->data);
+    s_number_of_pooled_receive_buffers--;
+  }
+  receive_buffer->data = receive_buffer->embedded_data;
+  receive_buffer->size = sizeof(receive_buffer->embedded_data);
+}
+
+void SocketReceiveBufferSetSocket(SocketReceiveBuffer *const receive_buffer,
+                                  const int socket) {
+  receive_buffer->socket = socket;
+  receive_buffer->used_length = 0;
+  receive_buffer->discard_length = 0;
+  SocketReceiveBufferReleasePooledData(receive_buffer);
+  OPENER_TRACE_INFO("Adds socket %d to socket receive buffers\n", socket);
+}
+
+void SocketReceiveBufferClear(SocketReceiveBuffer *const receive_buffer) {
+  receive_buffer->socket = kEipInvalidSocket;
+  receive_buffer->used_length = 0;
+  receive_buffer->discard_length = 0;
+  SocketReceiveBufferReleasePooledData(receive_buffer);
+}
+
+size_t SocketReceiveBufferGetFreeLength(
+  const SocketReceiveBuffer *const receive_buffer) {
+  return receive_buffer->size - receive_buffer->used_length;
+}
+
+EipStatus SocketReceiveBufferReserve(SocketReceiveBuffer *const receive_buffer,
+                                     const size_t size) {
+  if (size <= receive_buffer->size) {
+    return kEipStatusOk;
+  }
+  const bool is_pooled = receive_buffer->data != receive_buffer->embedded_data;
+  if (!is_pooled && s_number_of_pooled_receive_buffers >=
+      OPENER_MAXIMUM_NUMBER_OF_POOLED_RECEIVE_BUFFERS) {
+    return kEipStatusError;
+  }
+  size_t new_size = 0;
+  CipOctet *const new_data = MessageBufferPoolAllocate(size, &new_size);
+  if (NULL == new_data) {
+    return kEipStatusError;
+  }
+  memcpy(new_data, receive_buffer->data, receive_buffer->used_length);
+  if (is_pooled) {
+    MessageBufferPoolFree(receive_buffer->data);
+  } else {
+    s_number_of_pooled_receive_buffers++;
+  }
+  receive_buffer->data = new_data;
+  receive_buffer->size = new_size;
+  return kEipStatusOk;
+}
+
+void SocketReceiveBufferConsume(SocketReceiveBuffer *const receive_buffer,
+                                const size_t length) {
+  OPENER_ASSERT(length <= receive_buffer->used_length);
+  receive_buffer->used_length -= length;
+  if (0 != receive_buffer->used_length) {
+    memmove(receive_buffer->data, &receive_buffer->data[length],
+            receive_buffer->used_length);
+  } else {
+    SocketReceiveBufferReleasePooledData(receive_buffer);
+  }
+}
+
+void SocketReceiveBufferArrayInitialize(
+  SocketReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length) {
+  for (size_t i = 0; i < array_length; ++i) {
+    if (NULL == array_of_receive_buffers[i].data) {
+      array_of_receive_buffers[i].data = array_of_receive_buffers[i].embedded_data;
+    }
+    SocketReceiveBufferClear(&array_of_receive_buffers[i]);
+  }
+}
+
+SocketReceiveBuffer *SocketReceiveBufferArrayGetSocketReceiveBuffer(
+  SocketReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length,
+  const int socket) {
+  for (size_t i = 0; i < array_length; ++i) {
+    if (socket == array_of_receive_buffers[i].socket) {
+      return &array_of_receive_buffers[i];
+    }
+  }
+  return NULL;
+}
+
+SocketReceiveBuffer *SocketReceiveBufferArrayGetEmptySocketReceiveBuffer(
+  SocketReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length) {
+  return SocketReceiveBufferArrayGetSocketReceiveBuffer(array_of_receive_buffers,
+                                                        array_length,
+                                                        kEipInvalidSocket);
+}
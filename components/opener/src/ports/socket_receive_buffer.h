@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * Copyright (c) 2016, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef SRC_PORTS_SOCKET_RECEIVE_BUFFER_H_
+#define SRC_PORTS_SOCKET_RECEIVE_BUFFER_H_
+
+#include "typedefs.h"
+#include "opener_user_conf.h"
+#include "messagebufferpool.h"
+
+/** @brief Number of pooled buffers all sockets may hold for large frames
+ *
+ * A frame is held until it has been received completely, the rest of the
+ * message buffer pool is left for the replies.
+ */
+#ifndef OPENER_MAXIMUM_NUMBER_OF_POOLED_RECEIVE_BUFFERS
+  #define OPENER_MAXIMUM_NUMBER_OF_POOLED_RECEIVE_BUFFERS \
+  ( (OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_LARGE_BUFFERS + 1) / 2)
+#endif
+
+/** @brief Receive buffer of a TCP socket
+ *
+ * Accumulates the received bytes of a socket across several reads until a
+ * complete encapsulation frame is available. Complete frames are consumed from
+ * the front of the buffer, the bytes of a trailing partial frame are moved to
+ * the start.
+ *
+ * Frames up to PC_OPENER_ETHERNET_BUFFER_SIZE bytes are received into the
+ * buffer embedded in the entry. For larger frames a buffer is taken from the
+ * message buffer pool once the embedded buffer is full, and returned once it
+ * has been emptied.
+ */
+typedef struct socket_receive_buffer {
+  int socket;       /**< key */
+  size_t used_length;       /**< number of buffered bytes */
+  size_t discard_length;       /**< bytes of an oversized frame still to be dropped */
+  CipOctet *data;       /**< buffered bytes, embedded_data or a pooled buffer */
+  size_t size;       /**< size of data */
+  CipOctet embedded_data[PC_OPENER_ETHERNET_BUFFER_SIZE];       /**< buffer for regular sized frames */
+} SocketReceiveBuffer;
+
+/** @brief
+ * Sets socket of a Socket Receive Buffer
+ *
+ * @param receive_buffer Socket Receive Buffer to be set
+ * @param socket Socket handle
+ */
+void SocketReceiveBufferSetSocket(SocketReceiveBuffer *const receive_buffer,
+                                  const int socket);
+
+/** @brief
+ * Clears a Socket Receive Buffer entry and drops all buffered bytes
+ *
+ * @param receive_buffer Socket Receive Buffer to be cleared
+ */
+void SocketReceiveBufferClear(SocketReceiveBuffer *const receive_buffer);
+
+/** @brief
+ * Gets the free space at the end of the buffered bytes
+ *
+ * @param receive_buffer Socket Receive Buffer
+ * @return Number of bytes which can be received into the buffer
+ */
+size_t SocketReceiveBufferGetFreeLength(
+  const SocketReceiveBuffer *const receive_buffer);
+
+/** @brief
+ * Enlarges the buffer to hold at least size bytes
+ *
+ * @param receive_buffer Socket Receive Buffer
+ * @param size Needed size of the buffer
+ * @return kEipStatusOk on success, kEipStatusError if no large enough buffer
+ * is available or OPENER_MAXIMUM_NUMBER_OF_POOLED_RECEIVE_BUFFERS are in use
+ */
+EipStatus SocketReceiveBufferReserve(SocketReceiveBuffer *const receive_buffer,
+                                     const size_t size);
+
+/** @brief
+ * Removes bytes from the front of the buffer
+ *
+ * @param receive_buffer Socket Receive Buffer
+ * @param length Number of bytes to be removed, at most the buffered length
+ */
+void SocketReceiveBufferConsume(SocketReceiveBuffer *const receive_buffer,
+                                const size_t length);
+
+/** @brief
+ * Initializes an array of Socket Receive Buffer entries
+ *
+ * @param array_of_receive_buffers The array of Socket Receive Buffer entries to be initialized
+ * @param array_length the length of the array
+ */
+void SocketReceiveBufferArrayInitialize(
+  SocketReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length);
+
+/** @brief
+ * Get the Socket Receive Buffer entry with the specified socket value
+ *
+ * @param array_of_receive_buffers The Socket Receive Buffer array
+ * @param array_length The Socket Receive Buffer array length
+ * @param socket The socket value to be searched for
+ *
+ * @return The Socket Receive Buffer if found, otherwise NULL
+ */
+SocketReceiveBuffer *SocketReceiveBufferArrayGetSocketReceiveBuffer(
+  SocketReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length,
+  const int socket);
+
+/** @brief
+ * Get an empty Socket Receive Buffer entry
+ *
+ * @param array_of_receive_buffers The Socket Receive Buffer array
+ * @param array_length The Socket Receive Buffer array length
+ *
+ * @return An empty Socket Receive Buffer entry, or NULL if non is available
+ */
+SocketReceiveBuffer *SocketReceiveBufferArrayGetEmptySocketReceiveBuffer(
+  SocketReceiveBuffer *const array_of_receive_buffers,
+  const size_t array_length);
+
+#endif /* SRC_PORTS_SOCKET_RECEIVE_BUFFER_H_ */
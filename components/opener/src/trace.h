@@ -45,13 +45,26 @@
 /* @def OPENER_TRACE_ENABLED Can be used for conditional code compilation */
 #define OPENER_TRACE_ENABLED
 
+/** @def OPENER_TRACE_OUTPUT(level, ...) Write a trace message of a level.
+ *  If OPENER_TRACE_BINARY is defined the message is stored unformatted in the
+ *  trace buffer and decoded later, see tracebuffer.h, otherwise it is printed
+ *  with LOG_TRACE().
+ */
+#ifdef OPENER_TRACE_BINARY
+#include "tracebuffer.h"
+#define OPENER_TRACE_OUTPUT(level, ...) TRACE_BUFFER_RECORD(level, __VA_ARGS__)
+#else
+#define OPENER_TRACE_OUTPUT(level, ...) LOG_TRACE(__VA_ARGS__)
+#endif
+
 /** @def OPENER_TRACE_ERR(...) Trace error messages.
  *  In order to activate this trace level set the OPENER_TRACE_LEVEL_ERROR flag
  *  in OPENER_TRACE_LEVEL.
  */
 #define OPENER_TRACE_ERR(...)                                                  \
   do {                                                                         \
-    if (OPENER_TRACE_LEVEL_ERROR & OPENER_TRACE_LEVEL) {LOG_TRACE(__VA_ARGS__);} \
+    if (OPENER_TRACE_LEVEL_ERROR & OPENER_TRACE_LEVEL) {                       \
+      OPENER_TRACE_OUTPUT(OPENER_TRACE_LEVEL_ERROR, __VA_ARGS__);}             \
   } while (0)
 
 /** @def OPENER_TRACE_WARN(...) Trace warning messages.
@@ -60,8 +73,8 @@
  */
 #define OPENER_TRACE_WARN(...)                           \
   do {                                                   \
-    if (OPENER_TRACE_LEVEL_WARNING & OPENER_TRACE_LEVEL) { \
-      LOG_TRACE(__VA_ARGS__);}                            \
+    if (OPENER_TRACE_LEVEL_WARNING & OPENER_TRACE_LEVEL) {                     \
+      OPENER_TRACE_OUTPUT(OPENER_TRACE_LEVEL_WARNING, __VA_ARGS__);}           \
   } while (0)
 
 /** @def OPENER_TRACE_STATE(...) Trace state messages.
@@ -70,7 +83,8 @@
  */
 #define OPENER_TRACE_STATE(...)                                                \
   do {                                                                         \
-    if (OPENER_TRACE_LEVEL_STATE & OPENER_TRACE_LEVEL) {LOG_TRACE(__VA_ARGS__);} \
+    if (OPENER_TRACE_LEVEL_STATE & OPENER_TRACE_LEVEL) {                       \
+      OPENER_TRACE_OUTPUT(OPENER_TRACE_LEVEL_STATE, __VA_ARGS__);}             \
   } while (0)
 
 /** @def OPENER_TRACE_INFO(...) Trace information messages.
@@ -79,7 +93,8 @@
  */
 #define OPENER_TRACE_INFO(...)                                                \
   do {                                                                        \
-    if (OPENER_TRACE_LEVEL_INFO & OPENER_TRACE_LEVEL) {LOG_TRACE(__VA_ARGS__);} \
+    if (OPENER_TRACE_LEVEL_INFO & OPENER_TRACE_LEVEL) {                        \
+      OPENER_TRACE_OUTPUT(OPENER_TRACE_LEVEL_INFO, __VA_ARGS__);}              \
   } while (0)
 
 #else
@@ -38,6 +38,11 @@ DoublyLinkedListNode *DoublyLinkedListNodeCreate(
   NodeMemoryAllocator const
   allocator) {
   DoublyLinkedListNode *new_node = (DoublyLinkedListNode *)allocator();
+  if(NULL == new_node) {
+    return NULL;
+  }
+  new_node->previous = NULL;
+  new_node->next = NULL;
   new_node->data = (void *)data;
   return new_node;
 }
@@ -48,11 +53,14 @@ void DoublyLinkedListNodeDestroy(const DoublyLinkedList *const list,
   list->deallocator(node);
 }
 
-void DoublyLinkedListInsertAtHead(DoublyLinkedList *const list,
-                                  const void *const data) {
+DoublyLinkedListNode *DoublyLinkedListInsertAtHead(DoublyLinkedList *const list,
+                                                   const void *const data) {
   OPENER_ASSERT(list->allocator != NULL);
   DoublyLinkedListNode *new_node = DoublyLinkedListNodeCreate(data,
                                                               list->allocator);
+  if(NULL == new_node) {
+    return NULL;
+  }
   if(NULL == list->first) {
     list->first = new_node;
     list->last = new_node;
@@ -61,13 +69,17 @@ void DoublyLinkedListInsertAtHead(DoublyLinkedList *const list,
     list->first->previous = new_node;
     list->first = new_node;
   }
+  return new_node;
 }
 
-void DoublyLinkedListInsertAtTail(DoublyLinkedList *const list,
-                                  const void *const data) {
+DoublyLinkedListNode *DoublyLinkedListInsertAtTail(DoublyLinkedList *const list,
+                                                   const void *const data) {
   OPENER_ASSERT(list->allocator != NULL);
   DoublyLinkedListNode *new_node = DoublyLinkedListNodeCreate(data,
                                                               list->allocator);
+  if(NULL == new_node) {
+    return NULL;
+  }
   if(NULL == list->last) {
     list->first = new_node;
     list->last = new_node;
@@ -76,38 +88,47 @@ void DoublyLinkedListInsertAtTail(DoublyLinkedList *const list,
     list->last->next = new_node;
     list->last = new_node;
   }
+  return new_node;
 }
 
-void DoublyLinkedListInsertBeforeNode(DoublyLinkedList *const list,
-                                      DoublyLinkedListNode *node,
-                                      void *data) {
+DoublyLinkedListNode *DoublyLinkedListInsertBeforeNode(
+  DoublyLinkedList *const list,
+  DoublyLinkedListNode *node,
+  void *data) {
   OPENER_ASSERT(list->allocator != NULL);
   if(list->first == node) {
-    DoublyLinkedListInsertAtHead(list, data);
-  } else {
-    DoublyLinkedListNode *new_node = DoublyLinkedListNodeCreate(data,
-                                                                list->allocator);
-    new_node->previous = node->previous;
-    new_node->next = node;
-    node->previous = new_node;
-    new_node->previous->next = new_node;
+    return DoublyLinkedListInsertAtHead(list, data);
   }
+  DoublyLinkedListNode *new_node = DoublyLinkedListNodeCreate(data,
+                                                              list->allocator);
+  if(NULL == new_node) {
+    return NULL;
+  }
+  new_node->previous = node->previous;
+  new_node->next = node;
+  node->previous = new_node;
+  new_node->previous->next = new_node;
+  return new_node;
 }
 
-void DoublyLinkedListInsertAfterNode(DoublyLinkedList *const list,
-                                     DoublyLinkedListNode *node,
-                                     void *data) {
+DoublyLinkedListNode *DoublyLinkedListInsertAfterNode(
+  DoublyLinkedList *const list,
+  DoublyLinkedListNode *node,
+  void *data) {
   OPENER_ASSERT(list->allocator != NULL);
   if(list->last == node) {
-    DoublyLinkedListInsertAtTail(list, data);
-  } else {
-    DoublyLinkedListNode *new_node = DoublyLinkedListNodeCreate(data,
-                                                                list->allocator);
-    new_node->previous = node;
-    new_node->next = node->next;
-    node->next->previous = new_node;
-    node->next = new_node;
+    return DoublyLinkedListInsertAtTail(list, data);
   }
+  DoublyLinkedListNode *new_node = DoublyLinkedListNodeCreate(data,
+                                                              list->allocator);
+  if(NULL == new_node) {
+    return NULL;
+  }
+  new_node->previous = node;
+  new_node->next = node->next;
+  node->next->previous = new_node;
+  node->next = new_node;
+  return new_node;
 }
 
 void DoublyLinkedListRemoveNode(DoublyLinkedList *const list,
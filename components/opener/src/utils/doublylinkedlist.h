@@ -41,25 +41,34 @@ void DoublyLinkedListInitialize(DoublyLinkedList *list,
 
 void DoublyLinkedListDestroy(DoublyLinkedList *list);
 
+/** @brief Creates an unlinked node holding data
+ *
+ *  @return The node, or NULL if the allocator has no free node
+ */
 DoublyLinkedListNode *DoublyLinkedListNodeCreate(const void *const data,
                                                  NodeMemoryAllocator const allocator);
 
 void DoublyLinkedListNodeDestroy(const DoublyLinkedList *const list,
                                  DoublyLinkedListNode **node);
 
-void DoublyLinkedListInsertAtHead(DoublyLinkedList *const list,
-                                  const void *const data);
+/* The insert functions return the new node, or NULL if the allocator of the
+ * list has no free node. The list is unchanged in that case. */
+
+DoublyLinkedListNode *DoublyLinkedListInsertAtHead(DoublyLinkedList *const list,
+                                                   const void *const data);
 
-void DoublyLinkedListInsertAtTail(DoublyLinkedList *const list,
-                                  const void *const data);
+DoublyLinkedListNode *DoublyLinkedListInsertAtTail(DoublyLinkedList *const list,
+                                                   const void *const data);
 
-void DoublyLinkedListInsertBeforeNode(DoublyLinkedList *const list,
-                                      DoublyLinkedListNode *node,
-                                      void *data);
+DoublyLinkedListNode *DoublyLinkedListInsertBeforeNode(
+  DoublyLinkedList *const list,
+  DoublyLinkedListNode *node,
+  void *data);
 
-void DoublyLinkedListInsertAfterNode(DoublyLinkedList *const list,
-                                     DoublyLinkedListNode *node,
-                                     void *data);
+DoublyLinkedListNode *DoublyLinkedListInsertAfterNode(
+  DoublyLinkedList *const list,
+  DoublyLinkedListNode *node,
+  void *data);
 
 void DoublyLinkedListRemoveNode(DoublyLinkedList *const list,
                                 DoublyLinkedListNode **pointer_to_node_pointer);
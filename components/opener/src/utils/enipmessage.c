@@ -8,6 +8,42 @@
 #include "string.h"
 
 void InitializeENIPMessage(ENIPMessage *const message) {
-  memset(message, 0, sizeof(ENIPMessage) );
+  OPENER_ASSERT(NULL != message->message_buffer);
+  memset(message->message_buffer, 0, message->message_buffer_size);
   message->current_message_position = message->message_buffer;
+  message->used_message_length = 0;
+}
+
+void ENIPMessageAttachBuffer(ENIPMessage *const message,
+                             CipOctet *const buffer,
+                             const size_t buffer_size) {
+  message->message_buffer = buffer;
+  message->message_buffer_size = buffer_size;
+  message->message_buffer_is_pooled = false;
+  InitializeENIPMessage(message);
+}
+
+EipStatus ENIPMessageAllocateBuffer(ENIPMessage *const message,
+                                    const size_t minimum_size) {
+  size_t buffer_size = 0;
+  CipOctet *const buffer = MessageBufferPoolAllocate(minimum_size,
+                                                     &buffer_size);
+  if(NULL == buffer) {
+    memset(message, 0, sizeof(ENIPMessage) );
+    return kEipStatusError;
+  }
+  ENIPMessageAttachBuffer(message, buffer, buffer_size);
+  message->message_buffer_is_pooled = true;
+  return kEipStatusOk;
+}
+
+void ENIPMessageFreeBuffer(ENIPMessage *const message) {
+  if(message->message_buffer_is_pooled) {
+    MessageBufferPoolFree(message->message_buffer);
+  }
+  message->message_buffer = NULL;
+  message->message_buffer_size = 0;
+  message->current_message_position = NULL;
+  message->used_message_length = 0;
+  message->message_buffer_is_pooled = false;
 }
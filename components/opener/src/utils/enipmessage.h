@@ -7,13 +7,56 @@
 #define SRC_CIP_ENIPMESSAGE_H_
 
 #include "opener_user_conf.h"
+#include "messagebufferpool.h"
 
+/** @brief An encapsulation message under construction
+ *
+ * The message does not contain its buffer. A buffer is either attached with
+ * ENIPMessageAttachBuffer() or taken from the message buffer pool with
+ * ENIPMessageAllocateBuffer(), which allows messages larger than
+ * PC_OPENER_ETHERNET_BUFFER_SIZE without large arrays on the stack.
+ */
 typedef struct enip_message {
-  CipOctet message_buffer[PC_OPENER_ETHERNET_BUFFER_SIZE];
+  CipOctet *message_buffer; /**< buffer holding the message */
+  size_t message_buffer_size; /**< size of message_buffer */
   CipOctet *current_message_position;
   size_t used_message_length;
+  bool message_buffer_is_pooled; /**< message_buffer belongs to the message buffer pool */
 } ENIPMessage;
 
+/** @brief Clears the buffer of a message and resets the write position
+ *
+ *  The message needs to have a buffer.
+ *
+ *  @param message The message to initialize
+ */
 void InitializeENIPMessage(ENIPMessage *const message);
 
+/** @brief Uses a caller owned buffer for a message and initializes it
+ *
+ *  @param message The message
+ *  @param buffer The buffer to be used
+ *  @param buffer_size Size of buffer
+ */
+void ENIPMessageAttachBuffer(ENIPMessage *const message,
+                             CipOctet *const buffer,
+                             const size_t buffer_size);
+
+/** @brief Takes a buffer for a message from the message buffer pool and initializes it
+ *
+ *  @param message The message
+ *  @param minimum_size Needed size of the buffer
+ *  @return kEipStatusOk on success, kEipStatusError if no buffer is available
+ */
+EipStatus ENIPMessageAllocateBuffer(ENIPMessage *const message,
+                                    const size_t minimum_size);
+
+/** @brief Returns a buffer taken with ENIPMessageAllocateBuffer() to the pool
+ *
+ *  Does nothing for attached buffers.
+ *
+ *  @param message The message
+ */
+void ENIPMessageFreeBuffer(ENIPMessage *const message);
+
 #endif /* SRC_CIP_ENIPMESSAGE_H_ */
@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "messagebufferpool.h"
+
+#include "trace.h"
+
+/** @brief One size class of the pool, free buffers are kept on a stack */
+typedef struct {
+  CipOctet *storage; /**< number_of_buffers * buffer_size bytes */
+  size_t buffer_size; /**< size of one buffer */
+  size_t number_of_buffers; /**< number of buffers in storage */
+  size_t *free_stack; /**< indices of the free buffers */
+  size_t number_of_free_buffers; /**< number of valid entries in free_stack */
+  bool initialized; /**< free_stack has been filled */
+} MessageBufferPoolClass;
+
+static CipOctet g_small_buffer_storage[
+  OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_SMALL_BUFFERS *
+  PC_OPENER_ETHERNET_BUFFER_SIZE];
+static size_t g_small_buffer_free_stack[
+  OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_SMALL_BUFFERS];
+
+static CipOctet g_large_buffer_storage[
+  OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_LARGE_BUFFERS *
+  OPENER_MESSAGE_BUFFER_POOL_LARGE_BUFFER_SIZE];
+static size_t g_large_buffer_free_stack[
+  OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_LARGE_BUFFERS];
+
+/** size classes, ordered by ascending buffer size */
+static MessageBufferPoolClass g_message_buffer_pool[] = {
+  { g_small_buffer_storage, PC_OPENER_ETHERNET_BUFFER_SIZE,
+    OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_SMALL_BUFFERS,
+    g_small_buffer_free_stack, 0, false },
+  { g_large_buffer_storage, OPENER_MESSAGE_BUFFER_POOL_LARGE_BUFFER_SIZE,
+    OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_LARGE_BUFFERS,
+    g_large_buffer_free_stack, 0, false }
+};
+
+#define MESSAGE_BUFFER_POOL_NUMBER_OF_CLASSES \
+  ( sizeof(g_message_buffer_pool) / sizeof(g_message_buffer_pool[0]) )
+
+static CipUdint g_message_buffer_pool_allocation_failures = 0;
+
+static void MessageBufferPoolClassInitialize(
+  MessageBufferPoolClass *const pool_class) {
+  for(size_t i = 0; i < pool_class->number_of_buffers; ++i) {
+    /* hand out the first buffer first */
+    pool_class->free_stack[i] = pool_class->number_of_buffers - 1 - i;
+  }
+  pool_class->number_of_free_buffers = pool_class->number_of_buffers;
+  pool_class->initialized = true;
+}
+
+CipOctet *MessageBufferPoolAllocate(const size_t minimum_size,
+                                    size_t *const buffer_size) {
+  for(size_t i = 0; i < MESSAGE_BUFFER_POOL_NUMBER_OF_CLASSES; ++i) {
+    MessageBufferPoolClass *const pool_class = &g_message_buffer_pool[i];
+    if(false == pool_class->initialized) {
+      MessageBufferPoolClassInitialize(pool_class);
+    }
+    if( (pool_class->buffer_size >= minimum_size) &&
+        (0 < pool_class->number_of_free_buffers) ) {
+      pool_class->number_of_free_buffers--;
+      const size_t index =
+        pool_class->free_stack[pool_class->number_of_free_buffers];
+      *buffer_size = pool_class->buffer_size;
+      return &pool_class->storage[index * pool_class->buffer_size];
+    }
+  }
+  g_message_buffer_pool_allocation_failures++;
+  OPENER_TRACE_WARN("No message buffer of %u bytes available\n",
+                    (unsigned) minimum_size);
+  *buffer_size = 0;
+  return NULL;
+}
+
+void MessageBufferPoolFree(CipOctet *const buffer) {
+  if(NULL == buffer) {
+    return;
+  }
+  for(size_t i = 0; i < MESSAGE_BUFFER_POOL_NUMBER_OF_CLASSES; ++i) {
+    MessageBufferPoolClass *const pool_class = &g_message_buffer_pool[i];
+    const size_t pool_class_size = pool_class->number_of_buffers *
+                                   pool_class->buffer_size;
+    if( (buffer >= pool_class->storage) &&
+        (buffer < pool_class->storage + pool_class_size) ) {
+      const size_t index = (size_t)(buffer - pool_class->storage) /
+                           pool_class->buffer_size;
+      OPENER_ASSERT(pool_class->number_of_free_buffers <
+                    pool_class->number_of_buffers);
+      pool_class->free_stack[pool_class->number_of_free_buffers] = index;
+      pool_class->number_of_free_buffers++;
+      return;
+    }
+  }
+  OPENER_ASSERT(false); /* not a buffer of the pool */
+}
+
+CipUdint MessageBufferPoolGetNumberOfAllocationFailures(void) {
+  return g_message_buffer_pool_allocation_failures;
+}
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef SRC_UTILS_MESSAGEBUFFERPOOL_H_
+#define SRC_UTILS_MESSAGEBUFFERPOOL_H_
+
+/**
+ * @file messagebufferpool.h
+ *
+ * Bounded pool of message buffers in two size classes
+ *
+ * Small buffers have PC_OPENER_ETHERNET_BUFFER_SIZE bytes and serve the common
+ * short messages. Large buffers have OPENER_MESSAGE_BUFFER_POOL_LARGE_BUFFER_SIZE
+ * bytes and are only taken if a message does not fit into a small buffer. All
+ * buffers are statically allocated, the pool never uses the heap.
+ */
+
+#include <stddef.h>
+
+#include "opener_user_conf.h"
+#include "typedefs.h"
+
+#ifndef OPENER_MESSAGE_BUFFER_POOL_LARGE_BUFFER_SIZE
+  #define OPENER_MESSAGE_BUFFER_POOL_LARGE_BUFFER_SIZE \
+  PC_OPENER_ETHERNET_BUFFER_SIZE
+#endif
+
+#ifndef OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_SMALL_BUFFERS
+  #define OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_SMALL_BUFFERS 8
+#endif
+
+#ifndef OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_LARGE_BUFFERS
+  #define OPENER_MESSAGE_BUFFER_POOL_NUMBER_OF_LARGE_BUFFERS 4
+#endif
+
+/** @brief Largest message which can be handled, in bytes */
+#define OPENER_MAXIMUM_MESSAGE_SIZE \
+  ( (OPENER_MESSAGE_BUFFER_POOL_LARGE_BUFFER_SIZE > \
+     PC_OPENER_ETHERNET_BUFFER_SIZE) ? \
+    OPENER_MESSAGE_BUFFER_POOL_LARGE_BUFFER_SIZE : \
+    PC_OPENER_ETHERNET_BUFFER_SIZE )
+
+/** @brief Takes the smallest free buffer holding at least minimum_size bytes
+ *
+ *  @param minimum_size Needed size of the buffer
+ *  @param buffer_size Set to the size of the returned buffer
+ *  @return The buffer, or NULL if no buffer of sufficient size is free
+ */
+CipOctet *MessageBufferPoolAllocate(const size_t minimum_size,
+                                    size_t *const buffer_size);
+
+/** @brief Returns a buffer taken with MessageBufferPoolAllocate() to the pool
+ *
+ *  @param buffer The buffer to return, NULL is ignored
+ */
+void MessageBufferPoolFree(CipOctet *const buffer);
+
+/** @brief Returns the number of failed allocations since start up */
+CipUdint MessageBufferPoolGetNumberOfAllocationFailures(void);
+
+#endif /* SRC_UTILS_MESSAGEBUFFERPOOL_H_ */
@@ -0,0 +1,79 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "slaballocator.h"
+
+#include <string.h>
+
+#include "opener_user_conf.h"
+#include "trace.h"
+
+/** @brief Returns the element following a free element in the free list */
+static void *SlabAllocatorGetNextFree(const void *const element) {
+  void *next = NULL;
+  memcpy( &next, element, sizeof(next) );
+  return next;
+}
+
+/** @brief Links a free element in front of next */
+static void SlabAllocatorSetNextFree(void *const element,
+                                     void *const next) {
+  memcpy( element, &next, sizeof(next) );
+}
+
+void SlabAllocatorInitialize(SlabAllocator *const slab,
+                             void *const storage,
+                             const size_t element_size,
+                             const CipUdint capacity) {
+  OPENER_ASSERT(element_size >= sizeof(void *) );
+  slab->storage = storage;
+  slab->element_size = element_size;
+  slab->capacity = capacity;
+  slab->used = 0;
+  slab->high_water_mark = 0;
+  slab->number_of_exhaustions = 0;
+  slab->free_list = NULL;
+  /* chain backwards, so the elements are handed out in storage order */
+  for(CipUdint i = capacity; i > 0; i--) {
+    CipOctet *const element = (CipOctet *) storage + (i - 1) * element_size;
+    SlabAllocatorSetNextFree(element, slab->free_list);
+    slab->free_list = element;
+  }
+}
+
+void *SlabAllocatorAllocate(SlabAllocator *const slab) {
+  void *const element = slab->free_list;
+  if(NULL == element) {
+    slab->number_of_exhaustions++;
+    OPENER_TRACE_WARN("slab allocator: all %" PRIu32 " elements in use\n",
+                      slab->capacity);
+    return NULL;
+  }
+  slab->free_list = SlabAllocatorGetNextFree(element);
+  memset(element, 0, slab->element_size);
+  slab->used++;
+  if(slab->used > slab->high_water_mark) {
+    slab->high_water_mark = slab->used;
+  }
+  return element;
+}
+
+void SlabAllocatorFree(SlabAllocator *const slab,
+                       void *const element) {
+  if(NULL == element) {
+    return;
+  }
+  const CipOctet *const first = slab->storage;
+  OPENER_ASSERT( (const CipOctet *) element >= first &&
+                 (const CipOctet *) element <
+                 first + slab->capacity * slab->element_size &&
+                 0 == ( (const CipOctet *) element - first ) %
+                 slab->element_size );
+  OPENER_ASSERT(0 < slab->used);
+  SlabAllocatorSetNextFree(element, slab->free_list);
+  slab->free_list = element;
+  slab->used--;
+}
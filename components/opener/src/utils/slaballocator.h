@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef SRC_UTILS_SLABALLOCATOR_H_
+#define SRC_UTILS_SLABALLOCATOR_H_
+
+/**
+ * @file slaballocator.h
+ *
+ * Fixed size element allocator on caller provided storage
+ *
+ * The free elements are chained through their own memory, so allocation and
+ * release take constant time and need no bookkeeping per element. The slab
+ * keeps a high-water mark and counts failed allocations, so pools can be sized
+ * from measured peaks.
+ *
+ * A DoublyLinkedList gets its nodes from a slab by wrapping
+ * SlabAllocatorAllocate() and SlabAllocatorFree() in its NodeMemoryAllocator
+ * and NodeMemoryDeallocator, see CipConnectionObjectListArrayAllocator().
+ */
+
+#include <stddef.h>
+
+#include "typedefs.h"
+
+typedef struct {
+  void *storage; /**< capacity elements of element_size bytes */
+  size_t element_size; /**< size of one element, at least sizeof(void *) */
+  CipUdint capacity; /**< number of elements in storage */
+  void *free_list; /**< first free element, NULL if the slab is exhausted */
+  CipUdint used; /**< number of currently allocated elements */
+  CipUdint high_water_mark; /**< maximum of used since initialization */
+  CipUdint number_of_exhaustions; /**< failed allocations since initialization */
+} SlabAllocator;
+
+/** @brief Initializes a slab with all elements free
+ *
+ *  @param slab The slab to initialize
+ *  @param storage Storage of capacity elements, suitably aligned for the element type
+ *  @param element_size Size of one element, at least sizeof(void *)
+ *  @param capacity Number of elements in storage
+ */
+void SlabAllocatorInitialize(SlabAllocator *const slab,
+                             void *const storage,
+                             const size_t element_size,
+                             const CipUdint capacity);
+
+/** @brief Takes a zeroed element from the slab
+ *
+ *  @param slab The slab to allocate from
+ *  @return The element, or NULL if all elements are in use
+ */
+void *SlabAllocatorAllocate(SlabAllocator *const slab);
+
+/** @brief Returns an element taken with SlabAllocatorAllocate() to the slab
+ *
+ *  @param slab The slab the element has been taken from
+ *  @param element The element to return, NULL is ignored
+ */
+void SlabAllocatorFree(SlabAllocator *const slab,
+                       void *const element);
+
+#endif /* SRC_UTILS_SLABALLOCATOR_H_ */
@@ -0,0 +1,179 @@
+/*******************************************************************************
+ * Copyright (c) 2017, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "timerqueue.h"
+
+#include "opener_user_conf.h"
+#include <stdio.h>  // Needed to define NULL
+
+/** @brief Wrap-around safe "earlier than" comparison of two deadlines */
+static bool TimerQueueDeadlineIsBefore(const MilliSeconds first,
+                                       const MilliSeconds second) {
+  return 0 > (long) (first - second);
+}
+
+static void TimerQueuePlace(TimerQueue *const queue,
+                            TimerQueueEntry *const entry,
+                            const size_t index) {
+  queue->heap[index] = entry;
+  entry->heap_position = index + 1;
+}
+
+static void TimerQueueSiftUp(TimerQueue *const queue,
+                             size_t index) {
+  TimerQueueEntry *const entry = queue->heap[index];
+  while(0 < index) {
+    const size_t parent = (index - 1) / 2;
+    if( !TimerQueueDeadlineIsBefore(entry->deadline,
+                                    queue->heap[parent]->deadline) ) {
+      break;
+    }
+    TimerQueuePlace(queue, queue->heap[parent], index);
+    index = parent;
+  }
+  TimerQueuePlace(queue, entry, index);
+}
+
+static void TimerQueueSiftDown(TimerQueue *const queue,
+                               size_t index) {
+  TimerQueueEntry *const entry = queue->heap[index];
+  while(true) {
+    size_t child = 2 * index + 1;
+    if(child >= queue->count) {
+      break;
+    }
+    if( (child + 1 < queue->count) &&
+        TimerQueueDeadlineIsBefore(queue->heap[child + 1]->deadline,
+                                   queue->heap[child]->deadline) ) {
+      child++;
+    }
+    if( !TimerQueueDeadlineIsBefore(queue->heap[child]->deadline,
+                                    entry->deadline) ) {
+      break;
+    }
+    TimerQueuePlace(queue, queue->heap[child], index);
+    index = child;
+  }
+  TimerQueuePlace(queue, entry, index);
+}
+
+void TimerQueueInitialize(TimerQueue *const queue,
+                          TimerQueueEntry **const storage,
+                          const size_t capacity) {
+  queue->heap = storage;
+  queue->capacity = capacity;
+  queue->count = 0;
+}
+
+void TimerQueueEntryInitialize(TimerQueueEntry *const entry,
+                               TimerQueueExpiredFunction expired_function,
+                               void *const data) {
+  entry->deadline = 0;
+  entry->expired_function = expired_function;
+  entry->data = data;
+  entry->heap_position = 0;
+}
+
+EipStatus TimerQueueSchedule(TimerQueue *const queue,
+                             TimerQueueEntry *const entry,
+                             const MilliSeconds deadline) {
+  if( TimerQueueContains(queue, entry) ) {
+    const bool is_earlier = TimerQueueDeadlineIsBefore(deadline,
+                                                       entry->deadline);
+    entry->deadline = deadline;
+    if(is_earlier) {
+      TimerQueueSiftUp(queue, entry->heap_position - 1);
+    } else {
+      TimerQueueSiftDown(queue, entry->heap_position - 1);
+    }
+    return kEipStatusOk;
+  }
+
+  if(queue->count >= queue->capacity) {
+    return kEipStatusError;
+  }
+  entry->deadline = deadline;
+  TimerQueuePlace(queue, entry, queue->count);
+  queue->count++;
+  TimerQueueSiftUp(queue, queue->count - 1);
+  return kEipStatusOk;
+}
+
+void TimerQueueCancel(TimerQueue *const queue,
+                      TimerQueueEntry *const entry) {
+  if( !TimerQueueContains(queue, entry) ) {
+    /* also drops a stale position of a copied entry */
+    entry->heap_position = 0;
+    return;
+  }
+  const size_t index = entry->heap_position - 1;
+
+  queue->count--;
+  entry->heap_position = 0;
+  if(index == queue->count) {
+    queue->heap[index] = NULL;
+    return;
+  }
+  /* move the last element into the gap and restore the heap property */
+  TimerQueueEntry *const last = queue->heap[queue->count];
+  queue->heap[queue->count] = NULL;
+  TimerQueuePlace(queue, last, index);
+  if( (0 < index) &&
+      TimerQueueDeadlineIsBefore(last->deadline,
+                                 queue->heap[(index - 1) / 2]->deadline) ) {
+    TimerQueueSiftUp(queue, index);
+  } else {
+    TimerQueueSiftDown(queue, index);
+  }
+}
+
+bool TimerQueueContains(const TimerQueue *const queue,
+                        const TimerQueueEntry *const entry) {
+  /* check the back reference, the position alone may be stale after a copy */
+  return (0 < entry->heap_position) &&
+         (entry->heap_position <= queue->count) &&
+         (queue->heap[entry->heap_position - 1] == entry);
+}
+
+TimerQueueEntry *TimerQueuePeek(const TimerQueue *const queue) {
+  return (0 < queue->count) ? queue->heap[0] : NULL;
+}
+
+MilliSeconds TimerQueueGetTimeUntilNextDeadline(const TimerQueue *const queue,
+                                                const MilliSeconds actual_time,
+                                                const MilliSeconds maximum_wait_time)
+{
+  const TimerQueueEntry *const next = TimerQueuePeek(queue);
+  if(NULL == next) {
+    return maximum_wait_time;
+  }
+  if( TimerQueueDeadlineReached(next->deadline, actual_time) ) {
+    return 0;
+  }
+  const MilliSeconds time_until_deadline = next->deadline - actual_time;
+  return (time_until_deadline <
+          maximum_wait_time) ? time_until_deadline : maximum_wait_time;
+}
+
+size_t TimerQueueProcessExpired(TimerQueue *const queue,
+                                const MilliSeconds actual_time) {
+  size_t number_of_expired_entries = 0;
+  TimerQueueEntry *next = NULL;
+  while( NULL != ( next = TimerQueuePeek(queue) ) &&
+         TimerQueueDeadlineReached(next->deadline, actual_time) ) {
+    TimerQueueCancel(queue, next);
+    number_of_expired_entries++;
+    if(NULL != next->expired_function) {
+      next->expired_function(next, actual_time);
+    }
+  }
+  return number_of_expired_entries;
+}
+
+bool TimerQueueDeadlineReached(const MilliSeconds deadline,
+                               const MilliSeconds actual_time) {
+  return !TimerQueueDeadlineIsBefore(actual_time, deadline);
+}
@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * Copyright (c) 2017, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef SRC_UTILS_TIMERQUEUE_H_
+#define SRC_UTILS_TIMERQUEUE_H_
+
+/**
+ * @file timerqueue.h
+ *
+ * The public interface for a deadline ordered timer queue
+ *
+ * The queue is a binary min-heap of caller owned timer entries keyed by an
+ * absolute deadline in milliseconds. It does not allocate memory, the heap
+ * storage is handed in on initialization. Deadlines are compared wrap-around
+ * safe, so a free running millisecond counter can be used as time base.
+ *
+ * A zero initialized entry is not scheduled, so entries can be embedded in
+ * objects which are initialized with memset() or copied with memcpy().
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "typedefs.h"
+
+typedef struct timer_queue_entry TimerQueueEntry;
+
+/** @brief Function called when the deadline of an entry has been reached
+ *
+ * The entry is already removed from the queue when the function is called, so
+ * it may be rescheduled from within the call.
+ *
+ *  @param entry The expired entry
+ *  @param actual_time The time the queue has been expired with
+ */
+typedef void (*TimerQueueExpiredFunction)(TimerQueueEntry *const entry,
+                                          const MilliSeconds actual_time);
+
+typedef struct timer_queue_entry {
+  MilliSeconds deadline; /**< absolute time at which the entry expires */
+  TimerQueueExpiredFunction expired_function; /**< called on expiry */
+  void *data; /**< user data, not touched by the queue */
+  size_t heap_position; /**< index in the heap plus one, 0 if not scheduled */
+} TimerQueueEntry;
+
+typedef struct {
+  TimerQueueEntry **heap; /**< storage for the heap, provided by the user */
+  size_t capacity; /**< number of elements in heap */
+  size_t count; /**< number of scheduled entries */
+} TimerQueue;
+
+/** @brief Initializes an empty timer queue
+ *
+ *  @param queue The queue to initialize
+ *  @param storage Array of capacity pointers used as heap storage
+ *  @param capacity Maximum number of concurrently scheduled entries
+ */
+void TimerQueueInitialize(TimerQueue *const queue,
+                          TimerQueueEntry **const storage,
+                          const size_t capacity);
+
+/** @brief Initializes a timer entry, the entry is not scheduled afterwards
+ *
+ *  @param entry The entry to initialize
+ *  @param expired_function Function to be called on expiry
+ *  @param data User data stored in the entry
+ */
+void TimerQueueEntryInitialize(TimerQueueEntry *const entry,
+                               TimerQueueExpiredFunction expired_function,
+                               void *const data);
+
+/** @brief Schedules an entry or moves an already scheduled entry to a new deadline
+ *
+ *  @param queue The queue to schedule in
+ *  @param entry The entry to be scheduled
+ *  @param deadline The absolute expiry time of the entry
+ *  @return kEipStatusOk on success, kEipStatusError if the queue is full
+ */
+EipStatus TimerQueueSchedule(TimerQueue *const queue,
+                             TimerQueueEntry *const entry,
+                             const MilliSeconds deadline);
+
+/** @brief Removes an entry from the queue, does nothing if it is not scheduled
+ *
+ *  @param queue The queue to remove the entry from
+ *  @param entry The entry to be removed
+ */
+void TimerQueueCancel(TimerQueue *const queue,
+                      TimerQueueEntry *const entry);
+
+/** @brief Checks if an entry is currently scheduled in the queue
+ *
+ *  @param queue The queue to check
+ *  @param entry The entry to check
+ *  @return true if the entry is part of the queue
+ */
+bool TimerQueueContains(const TimerQueue *const queue,
+                        const TimerQueueEntry *const entry);
+
+/** @brief Returns the entry with the earliest deadline without removing it
+ *
+ *  @param queue The queue to inspect
+ *  @return The earliest entry or NULL if the queue is empty
+ */
+TimerQueueEntry *TimerQueuePeek(const TimerQueue *const queue);
+
+/** @brief Calculates the time until the earliest deadline is reached
+ *
+ *  @param queue The queue to inspect
+ *  @param actual_time The current time
+ *  @param maximum_wait_time Returned if the queue is empty or the earliest
+ *  deadline is further away
+ *  @return Time to wait in milliseconds, 0 if an entry already expired
+ */
+MilliSeconds TimerQueueGetTimeUntilNextDeadline(const TimerQueue *const queue,
+                                                const MilliSeconds actual_time,
+                                                const MilliSeconds maximum_wait_time);
+
+/** @brief Removes all expired entries in deadline order and calls their expired functions
+ *
+ *  @param queue The queue to process
+ *  @param actual_time The current time
+ *  @return Number of expired entries
+ */
+size_t TimerQueueProcessExpired(TimerQueue *const queue,
+                                const MilliSeconds actual_time);
+
+/** @brief Wrap-around safe check if a deadline has been reached
+ *
+ *  @param deadline The deadline to check
+ *  @param actual_time The current time
+ *  @return true if actual_time is at or past deadline
+ */
+bool TimerQueueDeadlineReached(const MilliSeconds deadline,
+                               const MilliSeconds actual_time);
+
+#endif /* SRC_UTILS_TIMERQUEUE_H_ */
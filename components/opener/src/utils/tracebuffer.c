@@ -0,0 +1,580 @@
+/*******************************************************************************
+ * Copyright (c) 2017, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include "tracebuffer.h"
+
+#if defined(OPENER_TRACE_BINARY)
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "networkhandler.h"
+
+#define TRACE_BUFFER_RING_MASK (OPENER_TRACE_BUFFER_RING_SIZE - 1U)
+
+/** @brief Maximum length of a decoded trace line */
+#define TRACE_BUFFER_TEXT_LINE_SIZE 256
+
+/** @brief Number of format IDs remembered while writing a binary dump */
+#define TRACE_BUFFER_DUMP_FORMAT_CACHE_SIZE 32
+
+/* layout of the descriptor word of a record */
+#define TRACE_BUFFER_DESCRIPTOR_LEVEL_SHIFT 0
+#define TRACE_BUFFER_DESCRIPTOR_ARGUMENTS_SHIFT 8
+#define TRACE_BUFFER_DESCRIPTOR_SIZE_SHIFT 16
+#define TRACE_BUFFER_DESCRIPTOR_TYPES_SHIFT 32
+
+/** @brief A ring written by a single task and read by a single reader */
+typedef struct {
+  atomic_uintptr_t owner; /**< task owning the ring, 0 if unused */
+  atomic_uint head; /**< next word to be written, only changed by the owner */
+  atomic_uint tail; /**< next word to be read, only changed by the reader */
+  CipUdint dropped; /**< records dropped as the ring was full */
+  uint64_t words[OPENER_TRACE_BUFFER_RING_SIZE];
+} TraceBufferRing;
+
+/** @brief A record copied out of a ring */
+typedef struct {
+  const char *format;
+  uint64_t timestamp;
+  CipUsint level;
+  size_t number_of_arguments;
+  uint64_t words[OPENER_TRACE_BUFFER_MAX_RECORD_SIZE];
+  size_t size;
+} TraceBufferReadRecord;
+
+static TraceBufferRing g_trace_rings[OPENER_TRACE_BUFFER_NUMBER_OF_RINGS];
+
+static atomic_uint g_trace_records;
+static atomic_uint g_trace_dropped_without_ring;
+static atomic_flag g_trace_reader_active = ATOMIC_FLAG_INIT;
+static atomic_bool g_trace_console_output = true;
+
+static TraceBufferStatistics g_trace_statistics;
+
+static void TraceBufferAddArgument(TraceBufferRecord *const record,
+                                   const TraceBufferArgumentType type,
+                                   const uint64_t value) {
+  if(OPENER_TRACE_BUFFER_MAX_ARGUMENTS <= record->number_of_arguments) {
+    return;
+  }
+  record->words[2] |= (uint64_t) type <<
+                      (TRACE_BUFFER_DESCRIPTOR_TYPES_SHIFT + 4 *
+                       record->number_of_arguments);
+  record->words[record->size++] = value;
+  record->number_of_arguments++;
+}
+
+void TraceBufferRecordBegin(TraceBufferRecord *const record,
+                            const CipUsint level,
+                            const char *const format) {
+  record->words[0] = (uintptr_t) format;
+  record->words[1] = GetMicroSeconds();
+  record->words[2] = (uint64_t) level << TRACE_BUFFER_DESCRIPTOR_LEVEL_SHIFT;
+  record->size = 3;
+  record->number_of_arguments = 0;
+}
+
+void TraceBufferAddSigned(TraceBufferRecord *const record,
+                          const long long value) {
+  TraceBufferAddArgument(record, kTraceBufferArgumentSigned, (uint64_t) value);
+}
+
+void TraceBufferAddUnsigned(TraceBufferRecord *const record,
+                            const unsigned long long value) {
+  TraceBufferAddArgument(record, kTraceBufferArgumentUnsigned, value);
+}
+
+void TraceBufferAddDouble(TraceBufferRecord *const record,
+                          const double value) {
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits) );
+  TraceBufferAddArgument(record, kTraceBufferArgumentDouble, bits);
+}
+
+void TraceBufferAddPointer(TraceBufferRecord *const record,
+                           const void *const value) {
+  TraceBufferAddArgument(record, kTraceBufferArgumentPointer,
+                         (uintptr_t) value);
+}
+
+void TraceBufferAddString(TraceBufferRecord *const record,
+                          const char *const value) {
+  if(NULL == value) {
+    TraceBufferAddPointer(record, value);
+    return;
+  }
+  if(OPENER_TRACE_BUFFER_MAX_ARGUMENTS <= record->number_of_arguments) {
+    return;
+  }
+  size_t length = 0;
+  while(OPENER_TRACE_BUFFER_MAX_STRING_LENGTH > length &&
+        '\0' != value[length]) {
+    length++;
+  }
+  TraceBufferAddArgument(record, kTraceBufferArgumentString, length);
+  const size_t words = (length + 7) / 8;
+  if(0 < words) {
+    record->words[record->size + words - 1] = 0;
+    memcpy(&record->words[record->size], value, length);
+    record->size += words;
+  }
+}
+
+/** @brief Find the ring of the calling task or claim an unused one */
+static TraceBufferRing *TraceBufferGetRing(void) {
+  const uintptr_t task = (uintptr_t) GetCurrentTaskId();
+  for(size_t i = 0; i < OPENER_TRACE_BUFFER_NUMBER_OF_RINGS; ++i) {
+    if(task == atomic_load_explicit(&g_trace_rings[i].owner,
+                                    memory_order_relaxed) ) {
+      return &g_trace_rings[i];
+    }
+  }
+  for(size_t i = 0; i < OPENER_TRACE_BUFFER_NUMBER_OF_RINGS; ++i) {
+    uintptr_t unused = 0;
+    if(atomic_compare_exchange_strong(&g_trace_rings[i].owner, &unused,
+                                      task) ) {
+      return &g_trace_rings[i];
+    }
+  }
+  return NULL;
+}
+
+void TraceBufferRecordCommit(const TraceBufferRecord *const record) {
+  TraceBufferRing *const ring = TraceBufferGetRing();
+  if(NULL == ring) {
+    atomic_fetch_add_explicit(&g_trace_dropped_without_ring, 1,
+                              memory_order_relaxed);
+    return;
+  }
+
+  const unsigned int head = atomic_load_explicit(&ring->head,
+                                                 memory_order_relaxed);
+  const unsigned int tail = atomic_load_explicit(&ring->tail,
+                                                 memory_order_acquire);
+  if(OPENER_TRACE_BUFFER_RING_SIZE - (head - tail) < record->size) {
+    ring->dropped++;
+    return;
+  }
+
+  const uint64_t descriptor = record->words[2] |
+                              (uint64_t) record->number_of_arguments <<
+                              TRACE_BUFFER_DESCRIPTOR_ARGUMENTS_SHIFT |
+                              (uint64_t) record->size <<
+                              TRACE_BUFFER_DESCRIPTOR_SIZE_SHIFT;
+  for(size_t i = 0; i < record->size; ++i) {
+    ring->words[(head + i) & TRACE_BUFFER_RING_MASK] =
+      (2 == i) ? descriptor : record->words[i];
+  }
+  atomic_store_explicit(&ring->head, head + (unsigned int) record->size,
+                        memory_order_release);
+  atomic_fetch_add_explicit(&g_trace_records, 1, memory_order_relaxed);
+}
+
+void TraceBufferReleaseTask(void) {
+  const uintptr_t task = (uintptr_t) GetCurrentTaskId();
+  for(size_t i = 0; i < OPENER_TRACE_BUFFER_NUMBER_OF_RINGS; ++i) {
+    uintptr_t owner = task;
+    if(atomic_compare_exchange_strong(&g_trace_rings[i].owner, &owner, 0) ) {
+      return;
+    }
+  }
+}
+
+/** @brief Copies the oldest record of a ring without removing it
+ *
+ *  @param ring The ring to read from
+ *  @param record Receives the record
+ *  @return true if the ring held a record
+ */
+static bool TraceBufferPeekRecord(TraceBufferRing *const ring,
+                                  TraceBufferReadRecord *const record) {
+  const unsigned int tail = atomic_load_explicit(&ring->tail,
+                                                 memory_order_relaxed);
+  const unsigned int head = atomic_load_explicit(&ring->head,
+                                                 memory_order_acquire);
+  if(head == tail) {
+    return false;
+  }
+  const uint64_t descriptor = ring->words[(tail + 2) & TRACE_BUFFER_RING_MASK];
+  record->size = (size_t) (descriptor >> TRACE_BUFFER_DESCRIPTOR_SIZE_SHIFT) &
+                 0xFFFFU;
+  for(size_t i = 0; i < record->size; ++i) {
+    record->words[i] = ring->words[(tail + i) & TRACE_BUFFER_RING_MASK];
+  }
+  record->format = (const char *) (uintptr_t) record->words[0];
+  record->timestamp = record->words[1];
+  record->level = (CipUsint) (descriptor >> TRACE_BUFFER_DESCRIPTOR_LEVEL_SHIFT);
+  record->number_of_arguments =
+    (size_t) (descriptor >> TRACE_BUFFER_DESCRIPTOR_ARGUMENTS_SHIFT) & 0xFFU;
+  return true;
+}
+
+static void TraceBufferConsumeRecord(TraceBufferRing *const ring,
+                                     const TraceBufferReadRecord *const record)
+{
+  const unsigned int tail = atomic_load_explicit(&ring->tail,
+                                                 memory_order_relaxed);
+  const unsigned int head = atomic_load_explicit(&ring->head,
+                                                 memory_order_relaxed);
+  if(head - tail > g_trace_statistics.maximum_fill_level) {
+    g_trace_statistics.maximum_fill_level = head - tail;
+  }
+  atomic_store_explicit(&ring->tail, tail + (unsigned int) record->size,
+                        memory_order_release);
+}
+
+static TraceBufferArgumentType TraceBufferGetArgumentType(
+  const TraceBufferReadRecord *const record,
+  const size_t argument) {
+  return (TraceBufferArgumentType) ( (record->words[2] >>
+                                      (TRACE_BUFFER_DESCRIPTOR_TYPES_SHIFT + 4 *
+                                       argument) ) & 0x0FU );
+}
+
+/** @brief Iterates the arguments of a read record */
+typedef struct {
+  const TraceBufferReadRecord *record;
+  size_t argument; /**< next argument */
+  size_t word; /**< word of the next argument */
+} TraceBufferArgumentIterator;
+
+static bool TraceBufferNextArgument(TraceBufferArgumentIterator *const iterator,
+                                    TraceBufferArgumentType *const type,
+                                    uint64_t *const value,
+                                    const char **const string) {
+  if(iterator->argument >= iterator->record->number_of_arguments) {
+    return false;
+  }
+  *type = TraceBufferGetArgumentType(iterator->record, iterator->argument);
+  *value = iterator->record->words[iterator->word++];
+  *string = NULL;
+  if(kTraceBufferArgumentString == *type) {
+    *string = (const char *) &iterator->record->words[iterator->word];
+    iterator->word += (*value + 7) / 8;
+  }
+  iterator->argument++;
+  return true;
+}
+
+/** @brief Formats one conversion of a format string with a recorded argument */
+static int TraceBufferFormatConversion(char *const text,
+                                       const size_t size,
+                                       const char *const conversion,
+                                       const size_t conversion_length,
+                                       TraceBufferArgumentIterator *const
+                                       iterator) {
+  /* flags, width and precision are kept, the length modifier is replaced */
+  char specification[32];
+  size_t length = 0;
+  specification[length++] = '%';
+  size_t position = 1;
+  int star_values[2] = { 0, 0 };
+  size_t stars = 0;
+  while(position < conversion_length - 1 &&
+        NULL == strchr("hljztL", conversion[position]) &&
+        length < sizeof(specification) - 4) {
+    if('*' == conversion[position] && stars < 2) {
+      TraceBufferArgumentType type;
+      uint64_t value;
+      const char *string;
+      if(TraceBufferNextArgument(iterator, &type, &value, &string) ) {
+        star_values[stars] = (int) value;
+      }
+      stars++;
+    }
+    specification[length++] = conversion[position++];
+  }
+  size_t integer_bits = 32;
+  if(position < conversion_length - 1) {
+    if('h' == conversion[position]) {
+      integer_bits = ('h' == conversion[position + 1]) ? 8 : 16;
+    } else if('l' == conversion[position]) {
+      integer_bits = ('l' == conversion[position + 1]) ?
+                     64 : sizeof(long) * 8;
+    } else if('z' == conversion[position] || 't' == conversion[position]) {
+      integer_bits = sizeof(size_t) * 8;
+    } else if('j' == conversion[position]) {
+      integer_bits = 64;
+    }
+  }
+  const char conversion_character = conversion[conversion_length - 1];
+
+  TraceBufferArgumentType type = kTraceBufferArgumentUnsigned;
+  uint64_t value = 0;
+  const char *string = NULL;
+  if(!TraceBufferNextArgument(iterator, &type, &value, &string) ) {
+    return snprintf(text, size, "<?>");
+  }
+
+#define TRACE_BUFFER_SNPRINTF(argument) \
+  ( (0 == stars) ? snprintf(text, size, specification, argument) : \
+    (1 == stars) ? snprintf(text, size, specification, star_values[0], \
+                            argument) : \
+    snprintf(text, size, specification, star_values[0], star_values[1], \
+             argument) )
+
+  switch(conversion_character) {
+    case 'd':
+    case 'i': {
+      specification[length++] = 'l';
+      specification[length++] = 'l';
+      specification[length++] = conversion_character;
+      specification[length] = '\0';
+      long long signed_value = (long long) value;
+      if(64 > integer_bits) {
+        const uint64_t sign = 1ULL << (integer_bits - 1);
+        value &= (sign << 1) - 1;
+        signed_value = (long long) ( (value ^ sign) - sign );
+      }
+      return TRACE_BUFFER_SNPRINTF(signed_value);
+    }
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      specification[length++] = 'l';
+      specification[length++] = 'l';
+      specification[length++] = conversion_character;
+      specification[length] = '\0';
+      if(64 > integer_bits) {
+        value &= (1ULL << integer_bits) - 1;
+      }
+      return TRACE_BUFFER_SNPRINTF( (unsigned long long) value );
+    case 'c':
+      specification[length++] = 'c';
+      specification[length] = '\0';
+      return TRACE_BUFFER_SNPRINTF( (int) (char) value );
+    case 's': {
+      if(kTraceBufferArgumentString != type) {
+        return (0 == value) ? snprintf(text, size, "(null)") :
+               snprintf(text, size, "<%p>", (void *) (uintptr_t) value);
+      }
+      /* the copy in the record is not zero terminated if it fills its last word */
+      char copy[OPENER_TRACE_BUFFER_MAX_STRING_LENGTH + 1];
+      memcpy(copy, string, (size_t) value);
+      copy[value] = '\0';
+      specification[length++] = 's';
+      specification[length] = '\0';
+      return TRACE_BUFFER_SNPRINTF(copy);
+    }
+    case 'p':
+      specification[length++] = 'p';
+      specification[length] = '\0';
+      return TRACE_BUFFER_SNPRINTF( (void *) (uintptr_t) value );
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A': {
+      specification[length++] = conversion_character;
+      specification[length] = '\0';
+      double double_value = 0.0;
+      if(kTraceBufferArgumentDouble == type) {
+        memcpy(&double_value, &value, sizeof(double_value) );
+      } else if(kTraceBufferArgumentSigned == type) {
+        double_value = (double) (long long) value;
+      } else {
+        double_value = (double) value;
+      }
+      return TRACE_BUFFER_SNPRINTF(double_value);
+    }
+    default:
+      return snprintf(text, size, "<?>");
+  }
+#undef TRACE_BUFFER_SNPRINTF
+}
+
+/** @brief Decodes a record into text the way printf() would have printed it */
+static void TraceBufferFormatRecord(const TraceBufferReadRecord *const record,
+                                    char *const text,
+                                    const size_t size) {
+  TraceBufferArgumentIterator iterator = { record, 0, 3 };
+  size_t used = (size_t) snprintf(text, size, "[%" PRIu64 ".%06" PRIu64 "] ",
+                                  (uint64_t) (record->timestamp / 1000000U),
+                                  (uint64_t) (record->timestamp % 1000000U) );
+  const char *format = record->format;
+  while('\0' != *format && used < size - 1) {
+    if('%' != *format) {
+      text[used++] = *format++;
+      continue;
+    }
+    if('%' == format[1]) {
+      text[used++] = '%';
+      format += 2;
+      continue;
+    }
+    size_t conversion_length = 1;
+    while('\0' != format[conversion_length] &&
+          NULL == strchr("diouxXcspfFeEgGaA", format[conversion_length]) ) {
+      conversion_length++;
+    }
+    if('\0' == format[conversion_length]) {
+      break;
+    }
+    conversion_length++;
+    const int written = TraceBufferFormatConversion(&text[used], size - used,
+                                                    format,
+                                                    conversion_length,
+                                                    &iterator);
+    if(0 < written) {
+      used += (size_t) written;
+    }
+    if(used >= size) {
+      used = size - 1;
+    }
+    format += conversion_length;
+  }
+  text[used] = '\0';
+}
+
+size_t TraceBufferDrainText(TraceBufferTextOutputFunction output) {
+  if(atomic_flag_test_and_set(&g_trace_reader_active) ) {
+    return 0;
+  }
+  size_t number_of_records = 0;
+  TraceBufferReadRecord record;
+  char text[TRACE_BUFFER_TEXT_LINE_SIZE];
+  for(size_t i = 0; i < OPENER_TRACE_BUFFER_NUMBER_OF_RINGS; ++i) {
+    while(TraceBufferPeekRecord(&g_trace_rings[i], &record) ) {
+      TraceBufferFormatRecord(&record, text, sizeof(text) );
+      TraceBufferConsumeRecord(&g_trace_rings[i], &record);
+      output(text);
+      number_of_records++;
+    }
+  }
+  atomic_flag_clear(&g_trace_reader_active);
+  return number_of_records;
+}
+
+static CipOctet *TraceBufferPutLittleEndian(CipOctet *buffer,
+                                            uint64_t value,
+                                            const size_t size) {
+  for(size_t i = 0; i < size; ++i) {
+    *buffer++ = (CipOctet) value;
+    value >>= 8;
+  }
+  return buffer;
+}
+
+/** @brief Size of a record in the binary dump, without its format entry */
+static size_t TraceBufferDumpRecordSize(const TraceBufferReadRecord *const
+                                        record) {
+  size_t size = 1 + 8 + 8 + 3;
+  TraceBufferArgumentIterator iterator = { record, 0, 3 };
+  TraceBufferArgumentType type;
+  uint64_t value;
+  const char *string;
+  while(TraceBufferNextArgument(&iterator, &type, &value, &string) ) {
+    size += (kTraceBufferArgumentString == type) ? 2 + value : 9;
+  }
+  return size;
+}
+
+size_t TraceBufferDrainBinary(CipOctet *const buffer,
+                              const size_t size) {
+  if(OPENER_TRACE_BUFFER_DUMP_HEADER_SIZE > size ||
+     atomic_flag_test_and_set(&g_trace_reader_active) ) {
+    return 0;
+  }
+
+  const TraceBufferStatistics *const statistics = TraceBufferGetStatistics();
+  CipOctet *position = buffer;
+  memcpy(position, OPENER_TRACE_BUFFER_DUMP_MAGIC, 4);
+  position += 4;
+  *position++ = 1; /* version */
+  *position++ = (CipOctet) sizeof(long);
+  *position++ = (CipOctet) sizeof(void *);
+  *position++ = 0;
+  position = TraceBufferPutLittleEndian(position, statistics->dropped, 4);
+
+  const char *formats[TRACE_BUFFER_DUMP_FORMAT_CACHE_SIZE];
+  size_t number_of_formats = 0;
+  size_t next_format = 0;
+  TraceBufferReadRecord record;
+  bool full = false;
+  for(size_t i = 0; i < OPENER_TRACE_BUFFER_NUMBER_OF_RINGS && !full; ++i) {
+    while(TraceBufferPeekRecord(&g_trace_rings[i], &record) ) {
+      bool format_known = false;
+      for(size_t j = 0; j < number_of_formats; ++j) {
+        format_known |= (formats[j] == record.format);
+      }
+      const size_t format_length = strlen(record.format);
+      const size_t needed = TraceBufferDumpRecordSize(&record) +
+                            (format_known ? 0 : 1 + 8 + 2 + format_length);
+      if(needed > size - (size_t) (position - buffer) ) {
+        full = true;
+        break;
+      }
+      if(!format_known) {
+        *position++ = kTraceBufferDumpEntryFormat;
+        position = TraceBufferPutLittleEndian(position, record.words[0], 8);
+        position = TraceBufferPutLittleEndian(position, format_length, 2);
+        memcpy(position, record.format, format_length);
+        position += format_length;
+        formats[next_format] = record.format;
+        next_format = (next_format + 1) % TRACE_BUFFER_DUMP_FORMAT_CACHE_SIZE;
+        if(number_of_formats < TRACE_BUFFER_DUMP_FORMAT_CACHE_SIZE) {
+          number_of_formats++;
+        }
+      }
+      *position++ = kTraceBufferDumpEntryRecord;
+      position = TraceBufferPutLittleEndian(position, record.words[0], 8);
+      position = TraceBufferPutLittleEndian(position, record.timestamp, 8);
+      *position++ = record.level;
+      *position++ = (CipOctet) i;
+      *position++ = (CipOctet) record.number_of_arguments;
+      TraceBufferArgumentIterator iterator = { &record, 0, 3 };
+      TraceBufferArgumentType type;
+      uint64_t value;
+      const char *string;
+      while(TraceBufferNextArgument(&iterator, &type, &value, &string) ) {
+        *position++ = (CipOctet) type;
+        if(kTraceBufferArgumentString == type) {
+          *position++ = (CipOctet) value;
+          memcpy(position, string, (size_t) value);
+          position += value;
+        } else {
+          position = TraceBufferPutLittleEndian(position, value, 8);
+        }
+      }
+      TraceBufferConsumeRecord(&g_trace_rings[i], &record);
+    }
+  }
+  atomic_flag_clear(&g_trace_reader_active);
+  return (size_t) (position - buffer);
+}
+
+void TraceBufferSetConsoleOutput(const bool enabled) {
+  atomic_store(&g_trace_console_output, enabled);
+}
+
+bool TraceBufferGetConsoleOutput(void) {
+  return atomic_load(&g_trace_console_output);
+}
+
+const TraceBufferStatistics *TraceBufferGetStatistics(void) {
+  g_trace_statistics.records = atomic_load_explicit(&g_trace_records,
+                                                    memory_order_relaxed);
+  g_trace_statistics.dropped = atomic_load_explicit(
+    &g_trace_dropped_without_ring, memory_order_relaxed);
+  g_trace_statistics.rings_in_use = 0;
+  for(size_t i = 0; i < OPENER_TRACE_BUFFER_NUMBER_OF_RINGS; ++i) {
+    g_trace_statistics.dropped += g_trace_rings[i].dropped;
+    if(0 != atomic_load_explicit(&g_trace_rings[i].owner,
+                                 memory_order_relaxed) ) {
+      g_trace_statistics.rings_in_use++;
+    }
+  }
+  return &g_trace_statistics;
+}
+
+#endif /* defined(OPENER_TRACE_BINARY) */
@@ -0,0 +1,261 @@
+/*******************************************************************************
+ * Copyright (c) 2017, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef SRC_UTILS_TRACEBUFFER_H_
+#define SRC_UTILS_TRACEBUFFER_H_
+
+/**
+ * @file tracebuffer.h
+ *
+ * The public interface of the binary deferred trace buffer
+ *
+ * If OPENER_TRACE_BINARY is defined the OPENER_TRACE_* macros do not format
+ * their message. They store the address of the format string as format ID,
+ * a microsecond timestamp and the raw arguments in a ring buffer of the
+ * calling task. Each task writing traces claims one of
+ * OPENER_TRACE_BUFFER_NUMBER_OF_RINGS rings, so a ring has a single writer
+ * and writing needs no lock. A full ring drops the record and counts it.
+ *
+ * The records are decoded off the hot path, either to text by
+ * TraceBufferDrainText() in a background task, or into a self contained
+ * binary dump by TraceBufferDrainBinary() which is decoded on a host.
+ *
+ * The argument types are taken from the C types of the arguments at compile
+ * time. Strings are copied into the record, truncated to
+ * OPENER_TRACE_BUFFER_MAX_STRING_LENGTH characters. A trace takes at most
+ * OPENER_TRACE_BUFFER_MAX_ARGUMENTS arguments after the format string.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "typedefs.h"
+#ifndef OPENER_INSTALL_AS_LIB
+#include "opener_user_conf.h"
+#endif
+
+#ifndef OPENER_TRACE_BUFFER_NUMBER_OF_RINGS
+/** @brief Number of rings, i.e. of tasks which can write traces */
+#define OPENER_TRACE_BUFFER_NUMBER_OF_RINGS 3
+#endif
+
+#ifndef OPENER_TRACE_BUFFER_RING_SIZE
+/** @brief Size of each ring in 64 bit words, must be a power of two */
+#define OPENER_TRACE_BUFFER_RING_SIZE 512
+#endif
+
+#ifndef OPENER_TRACE_BUFFER_MAX_STRING_LENGTH
+/** @brief Maximum number of characters of a string argument kept in a record */
+#define OPENER_TRACE_BUFFER_MAX_STRING_LENGTH 24
+#endif
+
+/** @brief Maximum number of arguments after the format string */
+#define OPENER_TRACE_BUFFER_MAX_ARGUMENTS 8
+
+/** @brief Identifies a binary dump created by TraceBufferDrainBinary() */
+#define OPENER_TRACE_BUFFER_DUMP_MAGIC "OTB1"
+
+/** @brief Size of the header of a binary dump */
+#define OPENER_TRACE_BUFFER_DUMP_HEADER_SIZE 12
+
+/** @brief Type of a recorded argument, also used in the binary dump */
+typedef enum {
+  kTraceBufferArgumentSigned = 1, /**< signed integer, sign extended to 64 bit */
+  kTraceBufferArgumentUnsigned = 2, /**< unsigned integer */
+  kTraceBufferArgumentDouble = 3, /**< float or double, stored as double */
+  kTraceBufferArgumentPointer = 4, /**< any pointer but a string */
+  kTraceBufferArgumentString = 5 /**< copy of a string */
+} TraceBufferArgumentType;
+
+/** @brief Type of an entry of the binary dump */
+typedef enum {
+  kTraceBufferDumpEntryFormat = 1, /**< format string of a format ID */
+  kTraceBufferDumpEntryRecord = 2 /**< a trace record */
+} TraceBufferDumpEntryType;
+
+/** @brief Number of 64 bit words of a record: format ID, timestamp,
+ *  descriptor and the arguments */
+#define OPENER_TRACE_BUFFER_MAX_RECORD_SIZE \
+  (3 + OPENER_TRACE_BUFFER_MAX_ARGUMENTS * \
+   (1 + (OPENER_TRACE_BUFFER_MAX_STRING_LENGTH + 7) / 8) )
+
+/** @brief A trace record while it is assembled on the stack of the caller */
+typedef struct {
+  uint64_t words[OPENER_TRACE_BUFFER_MAX_RECORD_SIZE]; /**< the record */
+  size_t size; /**< used words */
+  size_t number_of_arguments; /**< arguments added so far */
+} TraceBufferRecord;
+
+/** @brief Statistics of the trace buffer */
+typedef struct {
+  CipUdint records; /**< records written */
+  CipUdint dropped; /**< records dropped as the ring was full or no ring was left */
+  CipUdint rings_in_use; /**< rings claimed by a task */
+  CipUdint maximum_fill_level; /**< highest fill level of a ring in words */
+} TraceBufferStatistics;
+
+/** @brief Function receiving a decoded trace line
+ *
+ *  @param text The zero terminated line
+ */
+typedef void (*TraceBufferTextOutputFunction)(const char *const text);
+
+void TraceBufferRecordBegin(TraceBufferRecord *const record,
+                            const CipUsint level,
+                            const char *const format);
+
+void TraceBufferAddSigned(TraceBufferRecord *const record,
+                          const long long value);
+
+void TraceBufferAddUnsigned(TraceBufferRecord *const record,
+                            const unsigned long long value);
+
+void TraceBufferAddDouble(TraceBufferRecord *const record,
+                          const double value);
+
+void TraceBufferAddPointer(TraceBufferRecord *const record,
+                           const void *const value);
+
+void TraceBufferAddString(TraceBufferRecord *const record,
+                          const char *const value);
+
+/** @brief Stores an assembled record in the ring of the calling task
+ *
+ *  Never blocks. The record is dropped if the ring is full or no ring is
+ *  left for the calling task.
+ *
+ *  @param record The assembled record
+ */
+void TraceBufferRecordCommit(const TraceBufferRecord *const record);
+
+/** @brief Returns the ring of the calling task to the pool
+ *
+ *  Has to be called by a task writing traces before it ends. Records not
+ *  read yet stay in the ring.
+ */
+void TraceBufferReleaseTask(void);
+
+/** @brief Reads all pending records and hands them to output decoded to text
+ *
+ *  Only one reader is served at a time, a concurrent call returns 0.
+ *
+ *  @param output Function receiving one line per record
+ *  @return Number of records read
+ */
+size_t TraceBufferDrainText(TraceBufferTextOutputFunction output);
+
+/** @brief Reads pending records into a binary dump
+ *
+ *  The dump starts with a header of OPENER_TRACE_BUFFER_DUMP_HEADER_SIZE
+ *  bytes: the magic OPENER_TRACE_BUFFER_DUMP_MAGIC, the version, the size of
+ *  long and of a pointer on the target, one reserved byte and the number of
+ *  dropped records as UDINT. Entries follow, each starting with a
+ *  TraceBufferDumpEntryType byte:
+ *  - Format: format ID (ULINT), length (UINT), the format string
+ *  - Record: format ID (ULINT), timestamp in microseconds (ULINT), trace
+ *    level (USINT), ring (USINT), number of arguments (USINT), then per
+ *    argument its TraceBufferArgumentType (USINT) followed by a ULINT or,
+ *    for strings, a length (USINT) and the characters
+ *
+ *  The format string of a format ID precedes its first record in the dump.
+ *  All numbers are little endian. Records which do not fit into the buffer
+ *  stay in the rings. Only one reader is served at a time.
+ *
+ *  @param buffer Buffer receiving the dump
+ *  @param size Size of buffer
+ *  @return Used size of buffer, 0 if a concurrent reader is active or the
+ *  buffer is smaller than the header
+ */
+size_t TraceBufferDrainBinary(CipOctet *const buffer,
+                              const size_t size);
+
+/** @brief Enables or disables decoding to the console by the background task
+ *
+ *  @param enabled true to decode the records to the console, false to keep
+ *  them in the rings for a binary dump
+ */
+void TraceBufferSetConsoleOutput(const bool enabled);
+
+bool TraceBufferGetConsoleOutput(void);
+
+const TraceBufferStatistics *TraceBufferGetStatistics(void);
+
+/** @def TRACE_BUFFER_ADD_ARGUMENT(record, argument)
+ *  Adds an argument to a record, selecting the type by the C type
+ */
+#define TRACE_BUFFER_ADD_ARGUMENT(record, argument) \
+  _Generic( (argument), \
+            _Bool: TraceBufferAddUnsigned, \
+            char: TraceBufferAddSigned, \
+            signed char: TraceBufferAddSigned, \
+            unsigned char: TraceBufferAddUnsigned, \
+            short: TraceBufferAddSigned, \
+            unsigned short: TraceBufferAddUnsigned, \
+            int: TraceBufferAddSigned, \
+            unsigned int: TraceBufferAddUnsigned, \
+            long: TraceBufferAddSigned, \
+            unsigned long: TraceBufferAddUnsigned, \
+            long long: TraceBufferAddSigned, \
+            unsigned long long: TraceBufferAddUnsigned, \
+            float: TraceBufferAddDouble, \
+            double: TraceBufferAddDouble, \
+            char *: TraceBufferAddString, \
+            const char *: TraceBufferAddString, \
+            default: TraceBufferAddPointer)(record, argument);
+
+/* TRACE_BUFFER_ADD_ARGUMENTS_n adds the n - 1 arguments following the format */
+#define TRACE_BUFFER_ADD_ARGUMENTS_1(record, format)
+#define TRACE_BUFFER_ADD_ARGUMENTS_2(record, format, a1) \
+  TRACE_BUFFER_ADD_ARGUMENT(record, a1)
+#define TRACE_BUFFER_ADD_ARGUMENTS_3(record, format, a1, ...) \
+  TRACE_BUFFER_ADD_ARGUMENT(record, a1) \
+  TRACE_BUFFER_ADD_ARGUMENTS_2(record, format, __VA_ARGS__)
+#define TRACE_BUFFER_ADD_ARGUMENTS_4(record, format, a1, ...) \
+  TRACE_BUFFER_ADD_ARGUMENT(record, a1) \
+  TRACE_BUFFER_ADD_ARGUMENTS_3(record, format, __VA_ARGS__)
+#define TRACE_BUFFER_ADD_ARGUMENTS_5(record, format, a1, ...) \
+  TRACE_BUFFER_ADD_ARGUMENT(record, a1) \
+  TRACE_BUFFER_ADD_ARGUMENTS_4(record, format, __VA_ARGS__)
+#define TRACE_BUFFER_ADD_ARGUMENTS_6(record, format, a1, ...) \
+  TRACE_BUFFER_ADD_ARGUMENT(record, a1) \
+  TRACE_BUFFER_ADD_ARGUMENTS_5(record, format, __VA_ARGS__)
+#define TRACE_BUFFER_ADD_ARGUMENTS_7(record, format, a1, ...) \
+  TRACE_BUFFER_ADD_ARGUMENT(record, a1) \
+  TRACE_BUFFER_ADD_ARGUMENTS_6(record, format, __VA_ARGS__)
+#define TRACE_BUFFER_ADD_ARGUMENTS_8(record, format, a1, ...) \
+  TRACE_BUFFER_ADD_ARGUMENT(record, a1) \
+  TRACE_BUFFER_ADD_ARGUMENTS_7(record, format, __VA_ARGS__)
+#define TRACE_BUFFER_ADD_ARGUMENTS_9(record, format, a1, ...) \
+  TRACE_BUFFER_ADD_ARGUMENT(record, a1) \
+  TRACE_BUFFER_ADD_ARGUMENTS_8(record, format, __VA_ARGS__)
+
+#define TRACE_BUFFER_SELECT(_1, _2, _3, _4, _5, _6, _7, _8, _9, name, ...) name
+#define TRACE_BUFFER_FORMAT(format, ...) format
+
+/** @def TRACE_BUFFER_RECORD(level, format, ...)
+ *  Writes a trace with printf style format and arguments into the trace buffer
+ */
+#define TRACE_BUFFER_RECORD(level, ...) \
+  do { \
+    TraceBufferRecord trace_buffer_record; \
+    TraceBufferRecordBegin(&trace_buffer_record, level, \
+                           TRACE_BUFFER_FORMAT(__VA_ARGS__, 0) ); \
+    TRACE_BUFFER_SELECT(__VA_ARGS__, \
+                        TRACE_BUFFER_ADD_ARGUMENTS_9, \
+                        TRACE_BUFFER_ADD_ARGUMENTS_8, \
+                        TRACE_BUFFER_ADD_ARGUMENTS_7, \
+                        TRACE_BUFFER_ADD_ARGUMENTS_6, \
+                        TRACE_BUFFER_ADD_ARGUMENTS_5, \
+                        TRACE_BUFFER_ADD_ARGUMENTS_4, \
+                        TRACE_BUFFER_ADD_ARGUMENTS_3, \
+                        TRACE_BUFFER_ADD_ARGUMENTS_2, \
+                        TRACE_BUFFER_ADD_ARGUMENTS_1, \
+                        0)(&trace_buffer_record, __VA_ARGS__) \
+    TraceBufferRecordCommit(&trace_buffer_record); \
+  } while(0)
+
+#endif /* SRC_UTILS_TRACEBUFFER_H_ */
@@ -25,7 +25,12 @@
 #include "system_config.h"
 #include "driver/i2c_master.h"
 #include "modbus_tcp.h"
+#include "modbus_metrics.h"
+#include "opener_api.h"
 #include "ciptcpipinterface.h"
+#include "generic_networkhandler.h"
+#include "cipdiagnostics.h"
+#include "tracebuffer.h"
 #include "nvtcpip.h"
 #include "log_buffer.h"
 #include "esp_log.h"
@@ -42,9 +47,12 @@
 #include <stdlib.h>
 
 // Forward declarations for assembly access
+// The data is only read with AssemblyReadData(), which never blocks the EtherNet/IP I/O path
 extern uint8_t g_assembly_data064[32];
 extern uint8_t g_assembly_data096[32];
 extern uint8_t g_assembly_data097[10];
+#define INPUT_ASSEMBLY_NUM 100   // g_assembly_data064
+#define OUTPUT_ASSEMBLY_NUM 150  // g_assembly_data096
 
 // Forward declaration for MPU6050 enabled state setter
 extern void sample_application_set_mpu6050_enabled(bool enabled);
@@ -54,10 +62,6 @@ extern void sample_application_set_lsm6ds3_enabled(bool enabled);
 extern esp_err_t sample_application_calibrate_lsm6ds3(uint32_t samples, uint32_t sample_delay_ms);
 extern bool sample_application_get_lsm6ds3_calibration_status(float *gyro_offset_mdps);
 
-
-// Forward declaration for assembly mutex access
-extern SemaphoreHandle_t sample_application_get_assembly_mutex(void);
-
 static const char *TAG = "webui_api";
 
 // Cache for MPU6050 enabled state and byte offset to avoid frequent NVS reads
@@ -685,6 +689,97 @@ static esp_err_t api_post_modbus_handler(httpd_req_t *req)
     return send_json_response(req, response, ESP_OK);
 }
 
+// Size of the buffer a binary Modbus metrics snapshot is written to
+#define MODBUS_METRICS_SNAPSHOT_BUFFER_SIZE 1024
+
+// GET /api/modbus/metrics - Get per function code request counts and service time histograms
+static esp_err_t api_get_modbus_metrics_handler(httpd_req_t *req)
+{
+    modbus_metrics_t snapshot;
+    modbus_metrics_get(&snapshot);
+    const modbus_metrics_t *metrics = &snapshot;
+    
+    cJSON *json = cJSON_CreateObject();
+    cJSON *limits = cJSON_CreateArray();
+    for (int i = 0; i < MODBUS_METRICS_NUMBER_OF_BUCKETS - 1; i++) {
+        cJSON_AddItemToArray(limits, cJSON_CreateNumber(modbus_metrics_bucket_limits_us[i]));
+    }
+    cJSON_AddItemToObject(json, "bucket_limits_us", limits);
+    cJSON_AddNumberToObject(json, "bytes_in", (double)metrics->bytes_in);
+    cJSON_AddNumberToObject(json, "bytes_out", (double)metrics->bytes_out);
+    cJSON_AddNumberToObject(json, "protocol_errors", metrics->protocol_errors);
+    
+    cJSON *connections = cJSON_CreateObject();
+    cJSON_AddNumberToObject(connections, "current", metrics->connections_current);
+    cJSON_AddNumberToObject(connections, "peak", metrics->connections_peak);
+    cJSON_AddNumberToObject(connections, "accepted", metrics->connections_accepted);
+    cJSON_AddNumberToObject(connections, "closed", metrics->connections_closed);
+    cJSON_AddNumberToObject(connections, "evicted", metrics->connections_evicted);
+    cJSON_AddNumberToObject(connections, "rejected", metrics->connections_rejected);
+    cJSON_AddNumberToObject(connections, "timed_out", metrics->connections_timed_out);
+    cJSON_AddItemToObject(json, "connections", connections);
+    
+    cJSON *functions = cJSON_CreateArray();
+    for (int i = 0; i < MODBUS_METRICS_NUMBER_OF_FUNCTIONS; i++) {
+        const modbus_function_metrics_t *function = &metrics->functions[i];
+        if (function->requests == 0) {
+            continue;
+        }
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "function_code", function->function_code);
+        cJSON_AddNumberToObject(item, "requests", function->requests);
+        cJSON_AddNumberToObject(item, "exceptions", function->exceptions);
+        cJSON_AddNumberToObject(item, "responses", function->responses);
+        cJSON_AddNumberToObject(item, "min_us", function->min_us);
+        cJSON_AddNumberToObject(item, "max_us", function->max_us);
+        cJSON_AddNumberToObject(item, "mean_us",
+                                function->responses > 0 ? (double)function->total_us / function->responses : 0);
+        cJSON *buckets = cJSON_CreateArray();
+        for (int j = 0; j < MODBUS_METRICS_NUMBER_OF_BUCKETS; j++) {
+            cJSON_AddItemToArray(buckets, cJSON_CreateNumber(function->buckets[j]));
+        }
+        cJSON_AddItemToObject(item, "buckets", buckets);
+        cJSON_AddItemToArray(functions, item);
+    }
+    cJSON_AddItemToObject(json, "functions", functions);
+    
+    return send_json_response(req, json, ESP_OK);
+}
+
+// POST /api/modbus/metrics/reset - Clear the Modbus metrics
+static esp_err_t api_post_modbus_metrics_reset_handler(httpd_req_t *req)
+{
+    modbus_metrics_reset();
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "status", "ok");
+    cJSON_AddStringToObject(response, "message", "Modbus metrics cleared");
+    
+    return send_json_response(req, response, ESP_OK);
+}
+
+// GET /api/modbus/metrics/snapshot - Get the Modbus metrics as binary snapshot for tools/modbus_metrics.py
+static esp_err_t api_get_modbus_metrics_snapshot_handler(httpd_req_t *req)
+{
+    uint8_t *buffer = malloc(MODBUS_METRICS_SNAPSHOT_BUFFER_SIZE);
+    if (buffer == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    
+    size_t length = modbus_metrics_snapshot(buffer, MODBUS_METRICS_SNAPSHOT_BUFFER_SIZE);
+    if (length == 0) {
+        free(buffer);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Snapshot buffer too small");
+        return ESP_FAIL;
+    }
+    
+    httpd_resp_set_type(req, "application/octet-stream");
+    esp_err_t err = httpd_resp_send(req, (const char *)buffer, length);
+    free(buffer);
+    return err;
+}
+
 // GET /api/assemblies/sizes - Get assembly sizes
 static esp_err_t api_get_assemblies_sizes_handler(httpd_req_t *req)
 {
@@ -698,13 +793,12 @@ static esp_err_t api_get_assemblies_sizes_handler(httpd_req_t *req)
 // GET /api/status - Get assembly data for status pages
 static esp_err_t api_get_status_handler(httpd_req_t *req)
 {
-    SemaphoreHandle_t mutex = sample_application_get_assembly_mutex();
-    if (mutex == NULL) {
-        return send_json_error(req, "Assembly mutex not available", 500);
-    }
-    
-    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return send_json_error(req, "Failed to acquire assembly mutex", 500);
+    // Take snapshots first, the JSON is built without holding anything
+    uint8_t input_data[sizeof(g_assembly_data064)];
+    uint8_t output_data[sizeof(g_assembly_data096)];
+    if (AssemblyReadData(INPUT_ASSEMBLY_NUM, 0, input_data, sizeof(input_data)) != kEipStatusOk ||
+        AssemblyReadData(OUTPUT_ASSEMBLY_NUM, 0, output_data, sizeof(output_data)) != kEipStatusOk) {
+        return send_json_error(req, "Assemblies not available", 500);
     }
     
     cJSON *json = cJSON_CreateObject();
@@ -712,8 +806,8 @@ static esp_err_t api_get_status_handler(httpd_req_t *req)
     // Input assembly 100 (g_assembly_data064)
     cJSON *input_assembly = cJSON_CreateObject();
     cJSON *input_bytes = cJSON_CreateArray();
-    for (int i = 0; i < sizeof(g_assembly_data064); i++) {
-        cJSON_AddItemToArray(input_bytes, cJSON_CreateNumber(g_assembly_data064[i]));
+    for (int i = 0; i < sizeof(input_data); i++) {
+        cJSON_AddItemToArray(input_bytes, cJSON_CreateNumber(input_data[i]));
     }
     cJSON_AddItemToObject(input_assembly, "raw_bytes", input_bytes);
     cJSON_AddItemToObject(json, "input_assembly_100", input_assembly);
@@ -721,16 +815,216 @@ static esp_err_t api_get_status_handler(httpd_req_t *req)
     // Output assembly 150 (g_assembly_data096)
     cJSON *output_assembly = cJSON_CreateObject();
     cJSON *output_bytes = cJSON_CreateArray();
-    for (int i = 0; i < sizeof(g_assembly_data096); i++) {
-        cJSON_AddItemToArray(output_bytes, cJSON_CreateNumber(g_assembly_data096[i]));
+    for (int i = 0; i < sizeof(output_data); i++) {
+        cJSON_AddItemToArray(output_bytes, cJSON_CreateNumber(output_data[i]));
     }
     cJSON_AddItemToObject(output_assembly, "raw_bytes", output_bytes);
     cJSON_AddItemToObject(json, "output_assembly_150", output_assembly);
     
-    xSemaphoreGive(mutex);
     return send_json_response(req, json, ESP_OK);
 }
 
+// GET /api/eip/udpio - Get batched receive statistics of the UDP I/O socket
+static esp_err_t api_get_eip_udpio_handler(httpd_req_t *req)
+{
+    const NetworkUdpIoReceiveStatistics *stats = NetworkGetUdpIoReceiveStatistics();
+    
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "batch_budget", OPENER_UDP_IO_RECEIVE_BATCH_BUDGET);
+    cJSON_AddNumberToObject(json, "batches", stats->batches);
+    cJSON_AddNumberToObject(json, "datagrams", stats->datagrams);
+    cJSON_AddNumberToObject(json, "last_batch_size", stats->last_batch_size);
+    cJSON_AddNumberToObject(json, "maximum_batch_size", stats->maximum_batch_size);
+    cJSON_AddNumberToObject(json, "budget_exhausted", stats->budget_exhausted);
+    cJSON_AddNumberToObject(json, "empty_wakeups", stats->empty_wakeups);
+    
+    return send_json_response(req, json, ESP_OK);
+}
+
+static cJSON *latency_histogram_to_json(const CipDiagnosticsHistogram *histogram)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "count", histogram->count);
+    cJSON_AddNumberToObject(json, "min_us", histogram->minimum);
+    cJSON_AddNumberToObject(json, "max_us", histogram->maximum);
+    cJSON_AddNumberToObject(json, "mean_us",
+                            histogram->count > 0 ? (double)histogram->total / histogram->count : 0);
+    cJSON *buckets = cJSON_CreateArray();
+    for (int i = 0; i < CIP_DIAGNOSTICS_NUMBER_OF_BUCKETS; i++) {
+        cJSON_AddItemToArray(buckets, cJSON_CreateNumber(histogram->buckets[i]));
+    }
+    cJSON_AddItemToObject(json, "buckets", buckets);
+    return json;
+}
+
+// GET /api/eip/latency - Get explicit request and I/O production latency histograms
+static esp_err_t api_get_eip_latency_handler(httpd_req_t *req)
+{
+    cJSON *json = cJSON_CreateObject();
+    
+    cJSON *limits = cJSON_CreateArray();
+    for (int i = 0; i < CIP_DIAGNOSTICS_NUMBER_OF_BUCKETS - 1; i++) {
+        cJSON_AddItemToArray(limits, cJSON_CreateNumber(kCipDiagnosticsBucketLimits[i]));
+    }
+    cJSON_AddItemToObject(json, "bucket_limits_us", limits);
+    
+    const CipDiagnosticsHistogram *histograms = CipDiagnosticsGetServiceHistograms();
+    cJSON *services = cJSON_CreateArray();
+    for (int i = 0; i < OPENER_DIAGNOSTICS_NUMBER_OF_SERVICE_HISTOGRAMS; i++) {
+        if (histograms[i].type == kCipDiagnosticsHistogramTypeUnused) {
+            continue;
+        }
+        cJSON *item = latency_histogram_to_json(&histograms[i]);
+        cJSON_AddNumberToObject(item, "service", histograms[i].key);
+        cJSON_AddItemToArray(services, item);
+    }
+    cJSON_AddItemToObject(json, "explicit_services", services);
+    
+    histograms = CipDiagnosticsGetConnectionHistograms();
+    cJSON *connections = cJSON_CreateArray();
+    for (int i = 0; i < OPENER_DIAGNOSTICS_NUMBER_OF_CONNECTION_HISTOGRAMS; i++) {
+        if (histograms[i].type == kCipDiagnosticsHistogramTypeUnused) {
+            continue;
+        }
+        cJSON *item = latency_histogram_to_json(&histograms[i]);
+        cJSON_AddNumberToObject(item, "connection_id", histograms[i].key);
+        cJSON_AddNumberToObject(item, "rpi_us", histograms[i].rpi);
+        cJSON_AddItemToArray(connections, item);
+    }
+    cJSON_AddItemToObject(json, "io_productions", connections);
+    
+    return send_json_response(req, json, ESP_OK);
+}
+
+// POST /api/eip/latency/reset - Clear all latency histograms
+static esp_err_t api_post_eip_latency_reset_handler(httpd_req_t *req)
+{
+    CipDiagnosticsReset();
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "status", "ok");
+    cJSON_AddStringToObject(response, "message", "Latency histograms cleared");
+    
+    return send_json_response(req, response, ESP_OK);
+}
+
+// GET /api/eip/load - Get the utilization and per-phase time of the OpENer task
+static esp_err_t api_get_eip_load_handler(httpd_req_t *req)
+{
+    static const char *const phase_names[kNetworkHandlerNumberOfPhases] = {
+        "select", "tcp", "udp", "connection_timers",
+        "manage_connections", "timeout_checkers", "other"
+    };
+    const NetworkHandlerLoadStatistics *stats = NetworkGetLoadStatistics();
+    
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "utilization_percent", stats->utilization / 10.0);
+    cJSON_AddNumberToObject(json, "peak_utilization_percent", stats->peak_utilization / 10.0);
+    cJSON_AddNumberToObject(json, "window_us", stats->window_length);
+    cJSON_AddNumberToObject(json, "cycles", stats->cycles);
+    cJSON_AddNumberToObject(json, "max_cycle_busy_us", stats->maximum_cycle_busy_time);
+    
+    cJSON *phases = cJSON_CreateObject();
+    for (int i = 0; i < kNetworkHandlerNumberOfPhases; i++) {
+        cJSON *phase = cJSON_CreateObject();
+        cJSON_AddNumberToObject(phase, "window_us", stats->window[i]);
+        cJSON_AddNumberToObject(phase, "total_us", (double)stats->total[i]);
+        cJSON_AddItemToObject(phases, phase_names[i], phase);
+    }
+    cJSON_AddItemToObject(json, "phases", phases);
+    
+    return send_json_response(req, json, ESP_OK);
+}
+
+// POST /api/eip/load/reset - Clear the load statistics of the OpENer task
+static esp_err_t api_post_eip_load_reset_handler(httpd_req_t *req)
+{
+    NetworkResetLoadStatistics();
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "status", "ok");
+    cJSON_AddStringToObject(response, "message", "Load statistics cleared");
+    
+    return send_json_response(req, response, ESP_OK);
+}
+
+#ifdef OPENER_TRACE_BINARY
+// Size of the buffer a binary trace dump is drained into per request
+#define TRACE_DUMP_BUFFER_SIZE 8192
+
+static cJSON *trace_status_to_json(void)
+{
+    const TraceBufferStatistics *stats = TraceBufferGetStatistics();
+    
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "console", TraceBufferGetConsoleOutput());
+    cJSON_AddNumberToObject(json, "records", stats->records);
+    cJSON_AddNumberToObject(json, "dropped", stats->dropped);
+    cJSON_AddNumberToObject(json, "rings", OPENER_TRACE_BUFFER_NUMBER_OF_RINGS);
+    cJSON_AddNumberToObject(json, "rings_in_use", stats->rings_in_use);
+    cJSON_AddNumberToObject(json, "ring_size_bytes", OPENER_TRACE_BUFFER_RING_SIZE * 8);
+    cJSON_AddNumberToObject(json, "maximum_fill_level_bytes", stats->maximum_fill_level * 8);
+    return json;
+}
+
+// GET /api/trace - Get the state of the binary trace buffer
+static esp_err_t api_get_trace_handler(httpd_req_t *req)
+{
+    return send_json_response(req, trace_status_to_json(), ESP_OK);
+}
+
+// POST /api/trace - Enable or disable decoding of the traces to the console
+static esp_err_t api_post_trace_handler(httpd_req_t *req)
+{
+    char content[64];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+    
+    cJSON *json = cJSON_Parse(content);
+    if (json == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+    
+    cJSON *item = cJSON_GetObjectItem(json, "console");
+    if (item == NULL || !cJSON_IsBool(item)) {
+        cJSON_Delete(json);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or invalid 'console' field");
+        return ESP_FAIL;
+    }
+    
+    TraceBufferSetConsoleOutput(cJSON_IsTrue(item));
+    cJSON_Delete(json);
+    
+    return send_json_response(req, trace_status_to_json(), ESP_OK);
+}
+
+// GET /api/trace/dump - Drain pending traces as binary dump for tools/opener_trace_decode.py
+static esp_err_t api_get_trace_dump_handler(httpd_req_t *req)
+{
+    CipOctet *buffer = malloc(TRACE_DUMP_BUFFER_SIZE);
+    if (buffer == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    
+    size_t length = TraceBufferDrainBinary(buffer, TRACE_DUMP_BUFFER_SIZE);
+    if (length == 0) {
+        free(buffer);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Trace buffer busy");
+        return ESP_FAIL;
+    }
+    
+    httpd_resp_set_type(req, "application/octet-stream");
+    esp_err_t err = httpd_resp_send(req, (const char *)buffer, length);
+    free(buffer);
+    return err;
+}
+#endif
 
 // GET /api/i2c/pullup - Get I2C pull-up enabled state
 static esp_err_t api_get_i2c_pullup_handler(httpd_req_t *req)
@@ -1101,24 +1395,18 @@ static esp_err_t api_get_lsm6ds3_status_handler(httpd_req_t *req)
     }
     
     // Read LSM6DS3 orientation and pressure data from assembly buffer using configured offset
-    SemaphoreHandle_t mutex = sample_application_get_assembly_mutex();
-    if (mutex == NULL) {
-        return send_json_error(req, "Assembly mutex not available", 503);
-    }
-    
-    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return send_json_error(req, "Failed to acquire assembly mutex", 503);
+    uint8_t imu_data[20];
+    if (AssemblyReadData(INPUT_ASSEMBLY_NUM, offset, imu_data, sizeof(imu_data)) != kEipStatusOk) {
+        return send_json_error(req, "Input assembly not available", 503);
     }
     
     // Read 5 int32_t values: roll, pitch, ground_angle, bottom_pressure, top_pressure
     int32_t roll_scaled, pitch_scaled, ground_angle_scaled, bottom_pressure_scaled, top_pressure_scaled;
-    memcpy(&roll_scaled, &g_assembly_data064[offset], sizeof(int32_t));
-    memcpy(&pitch_scaled, &g_assembly_data064[offset + 4], sizeof(int32_t));
-    memcpy(&ground_angle_scaled, &g_assembly_data064[offset + 8], sizeof(int32_t));
-    memcpy(&bottom_pressure_scaled, &g_assembly_data064[offset + 12], sizeof(int32_t));
-    memcpy(&top_pressure_scaled, &g_assembly_data064[offset + 16], sizeof(int32_t));
-    
-    xSemaphoreGive(mutex);
+    memcpy(&roll_scaled, &imu_data[0], sizeof(int32_t));
+    memcpy(&pitch_scaled, &imu_data[4], sizeof(int32_t));
+    memcpy(&ground_angle_scaled, &imu_data[8], sizeof(int32_t));
+    memcpy(&bottom_pressure_scaled, &imu_data[12], sizeof(int32_t));
+    memcpy(&top_pressure_scaled, &imu_data[16], sizeof(int32_t));
     
     // Convert scaled integers to floats
     float roll = roll_scaled / 10000.0f;  // degrees * 10000
@@ -1258,22 +1546,21 @@ static esp_err_t api_get_mpu6050_status_handler(httpd_req_t *req)
         return send_json_error(req, "Invalid MPU6050 byte offset configuration", 500);
     }
     
-    // Get assembly mutex for thread-safe access
-    SemaphoreHandle_t assembly_mutex = sample_application_get_assembly_mutex();
-    if (assembly_mutex != NULL) {
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-    }
-    
     // Read MPU6050 orientation and pressure data from assembly buffer using configured offset
     // Format: 20 bytes (5 int32_t: roll, pitch, ground_angle, bottom_pressure, top_pressure as little-endian)
     // Values are scaled integers: degrees * 10000, pressure * 1000
+    uint8_t imu_data[20];
+    if (AssemblyReadData(INPUT_ASSEMBLY_NUM, offset, imu_data, sizeof(imu_data)) != kEipStatusOk) {
+        return send_json_error(req, "Input assembly not available", 503);
+    }
+    
     // Use memcpy to properly handle endianness and sign extension
     int32_t roll_scaled, pitch_scaled, ground_angle_scaled, bottom_pressure_scaled, top_pressure_scaled;
-    memcpy(&roll_scaled, &g_assembly_data064[offset + 0], sizeof(int32_t));
-    memcpy(&pitch_scaled, &g_assembly_data064[offset + 4], sizeof(int32_t));
-    memcpy(&ground_angle_scaled, &g_assembly_data064[offset + 8], sizeof(int32_t));
-    memcpy(&bottom_pressure_scaled, &g_assembly_data064[offset + 12], sizeof(int32_t));
-    memcpy(&top_pressure_scaled, &g_assembly_data064[offset + 16], sizeof(int32_t));
+    memcpy(&roll_scaled, &imu_data[0], sizeof(int32_t));
+    memcpy(&pitch_scaled, &imu_data[4], sizeof(int32_t));
+    memcpy(&ground_angle_scaled, &imu_data[8], sizeof(int32_t));
+    memcpy(&bottom_pressure_scaled, &imu_data[12], sizeof(int32_t));
+    memcpy(&top_pressure_scaled, &imu_data[16], sizeof(int32_t));
     
     // Convert scaled integers back to degrees and PSI for JSON response
     float roll = roll_scaled / 10000.0f;
@@ -1282,10 +1569,6 @@ static esp_err_t api_get_mpu6050_status_handler(httpd_req_t *req)
     float bottom_pressure = bottom_pressure_scaled / 1000.0f;
     float top_pressure = top_pressure_scaled / 1000.0f;
     
-    if (assembly_mutex != NULL) {
-        xSemaphoreGive(assembly_mutex);
-    }
-    
     // Get enabled state
     bool enabled;
     if (!s_mpu6050_enabled_cached) {
@@ -1804,6 +2087,33 @@ void webui_register_api_handlers(httpd_handle_t server)
     };
     httpd_register_uri_handler(server, &post_modbus_uri);
     
+    // GET /api/modbus/metrics - Get per function code request counts and service time histograms
+    httpd_uri_t get_modbus_metrics_uri = {
+        .uri       = "/api/modbus/metrics",
+        .method    = HTTP_GET,
+        .handler   = api_get_modbus_metrics_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &get_modbus_metrics_uri);
+    
+    // POST /api/modbus/metrics/reset - Clear the Modbus metrics
+    httpd_uri_t post_modbus_metrics_reset_uri = {
+        .uri       = "/api/modbus/metrics/reset",
+        .method    = HTTP_POST,
+        .handler   = api_post_modbus_metrics_reset_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &post_modbus_metrics_reset_uri);
+    
+    // GET /api/modbus/metrics/snapshot - Get the Modbus metrics as binary snapshot
+    httpd_uri_t get_modbus_metrics_snapshot_uri = {
+        .uri       = "/api/modbus/metrics/snapshot",
+        .method    = HTTP_GET,
+        .handler   = api_get_modbus_metrics_snapshot_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &get_modbus_metrics_snapshot_uri);
+    
     // GET /api/mpu6050/enabled
     httpd_uri_t get_mpu6050_enabled_uri = {
         .uri       = "/api/mpu6050/enabled",
@@ -2005,6 +2315,80 @@ void webui_register_api_handlers(httpd_handle_t server)
     };
     httpd_register_uri_handler(server, &get_status_uri);
     
+    // GET /api/eip/udpio - Get batched receive statistics of the UDP I/O socket
+    httpd_uri_t get_eip_udpio_uri = {
+        .uri       = "/api/eip/udpio",
+        .method    = HTTP_GET,
+        .handler   = api_get_eip_udpio_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &get_eip_udpio_uri);
+    
+    // GET /api/eip/latency - Get explicit request and I/O production latency histograms
+    httpd_uri_t get_eip_latency_uri = {
+        .uri       = "/api/eip/latency",
+        .method    = HTTP_GET,
+        .handler   = api_get_eip_latency_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &get_eip_latency_uri);
+    
+    // POST /api/eip/latency/reset - Clear all latency histograms
+    httpd_uri_t post_eip_latency_reset_uri = {
+        .uri       = "/api/eip/latency/reset",
+        .method    = HTTP_POST,
+        .handler   = api_post_eip_latency_reset_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &post_eip_latency_reset_uri);
+    
+    // GET /api/eip/load - Get the utilization and per-phase time of the OpENer task
+    httpd_uri_t get_eip_load_uri = {
+        .uri       = "/api/eip/load",
+        .method    = HTTP_GET,
+        .handler   = api_get_eip_load_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &get_eip_load_uri);
+    
+    // POST /api/eip/load/reset - Clear the load statistics of the OpENer task
+    httpd_uri_t post_eip_load_reset_uri = {
+        .uri       = "/api/eip/load/reset",
+        .method    = HTTP_POST,
+        .handler   = api_post_eip_load_reset_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &post_eip_load_reset_uri);
+    
+#ifdef OPENER_TRACE_BINARY
+    // GET /api/trace - Get the state of the binary trace buffer
+    httpd_uri_t get_trace_uri = {
+        .uri       = "/api/trace",
+        .method    = HTTP_GET,
+        .handler   = api_get_trace_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &get_trace_uri);
+    
+    // POST /api/trace - Enable or disable decoding of the traces to the console
+    httpd_uri_t post_trace_uri = {
+        .uri       = "/api/trace",
+        .method    = HTTP_POST,
+        .handler   = api_post_trace_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &post_trace_uri);
+    
+    // GET /api/trace/dump - Drain pending traces as binary dump
+    httpd_uri_t get_trace_dump_uri = {
+        .uri       = "/api/trace/dump",
+        .method    = HTTP_GET,
+        .handler   = api_get_trace_dump_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &get_trace_dump_uri);
+#endif
+    
     // GET /api/i2c/pullup
     httpd_uri_t get_i2c_pullup_uri = {
         .uri       = "/api/i2c/pullup",
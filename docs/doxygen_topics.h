@@ -215,6 +215,8 @@
  * - Standard Modbus TCP/IP protocol (port 502)
  * - Input Registers 0-15 map to Input Assembly 100
  * - Holding Registers 100-115 map to Output Assembly 150
+ * - Discrete Inputs and Coils 0-255 map to the bits of Input Assembly 100 and Output Assembly 150
+ * - Register map loaded as a table of address ranges, see modbus_register_map_load()
  * - Thread-safe operation
  * - Multiple concurrent connections
  *
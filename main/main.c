@@ -123,6 +123,7 @@
 #include "esp_ota_ops.h"
 #include "esp_timer.h"
 #include "opener.h"
+#include "opener_api.h"
 #include "nvtcpip.h"
 #include "ciptcpipinterface.h"
 #include "sdkconfig.h"
@@ -138,16 +139,18 @@
 #include "driver/i2c_master.h"
 #include "log_buffer.h"
 
-// Forward declaration - function is in opener component
-SemaphoreHandle_t sample_application_get_assembly_mutex(void);
-
 void SampleApplicationSetActiveNetif(struct netif *netif);
 void SampleApplicationNotifyLinkUp(void);
 void SampleApplicationNotifyLinkDown(void);
 
+// Instance numbers of the sample application's assemblies
+#define INPUT_ASSEMBLY_NUM 100  // g_assembly_data064 (Input Assembly 100)
+#define OUTPUT_ASSEMBLY_NUM 150  // g_assembly_data096 (Output Assembly 150)
+
 // External assembly data arrays (defined in opener component)
+// Only accessed with AssemblyReadData()/AssemblyUpdateData(), which never block the I/O path
+// and stay valid while OpENer shuts down and restarts after a link loss
 extern uint8_t g_assembly_data064[32];  // Input Assembly 100
-extern uint8_t g_assembly_data096[32];  // Output Assembly 150
 
 static const char *TAG = "opener_main";
 static struct netif *s_netif = NULL;
@@ -2093,9 +2096,6 @@ static void imu_io_task(void *pvParameters)
         }
     }
     
-    // Get assembly mutex
-    SemaphoreHandle_t assembly_mutex = sample_application_get_assembly_mutex();
-    
     // Get byte offset from NVS based on active sensor type (read with mutex)
     uint8_t byte_start;
     if (s_imu_state_mutex != NULL && xSemaphoreTake(s_imu_state_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
@@ -2144,13 +2144,9 @@ static void imu_io_task(void *pvParameters)
         
         // If disabled, zero out assembly bytes and skip reading
         if (!imu_enabled) {
-            if (assembly_mutex != NULL) {
-                xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-            }
-            memset(&g_assembly_data064[byte_start], 0, imu_data_size);  // Clear all 20 bytes
-            if (assembly_mutex != NULL) {
-                xSemaphoreGive(assembly_mutex);
-            }
+            // Clear all 20 bytes, change-of-state connections only produce if they were set
+            static const uint8_t imu_zero_data[20] = {0};
+            AssemblyUpdateData(INPUT_ASSEMBLY_NUM, byte_start, imu_zero_data, imu_data_size);
             vTaskDelayUntil(&last_wake_time, period_ms);
             continue;
         }
@@ -2281,13 +2277,12 @@ static void imu_io_task(void *pvParameters)
             float desired_tip_force_lbs = 20.0f;  // Default
             float cylinder_bore_inches = 1.0f;  // Default
             
-            if (assembly_mutex != NULL) {
-                xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-            }
-            
-            if (sizeof(g_assembly_data096) >= 32) {
+            // Snapshot of bytes 29-31, the NVS fallbacks below run without holding anything
+            uint8_t output_config_bytes[3];
+            if (AssemblyReadData(OUTPUT_ASSEMBLY_NUM, 29, output_config_bytes,
+                                 sizeof(output_config_bytes)) == kEipStatusOk) {
                 // Read cylinder bore from byte 29 (scaled by 100: 0 = use NVS, 1-255 = 0.01-2.55 inches)
-                uint8_t cylinder_bore_byte = g_assembly_data096[29];
+                uint8_t cylinder_bore_byte = output_config_bytes[0];
                 if (cylinder_bore_byte > 0) {
                     cylinder_bore_inches = (float)cylinder_bore_byte / 100.0f;  // Convert from scaled (1-255) to inches (0.01-2.55)
                 } else {
@@ -2296,27 +2291,23 @@ static void imu_io_task(void *pvParameters)
                 }
                 
                 // Read tool weight from byte 30
-                uint8_t tool_weight_byte = g_assembly_data096[30];
+                uint8_t tool_weight_byte = output_config_bytes[1];
                 tool_weight_lbs = (tool_weight_byte > 0) 
                     ? (float)tool_weight_byte 
                     : (float)system_tool_weight_load();
                 
                 // Read tip force from byte 31
-                uint8_t tip_force_byte = g_assembly_data096[31];
+                uint8_t tip_force_byte = output_config_bytes[2];
                 desired_tip_force_lbs = (tip_force_byte > 0) 
                     ? (float)tip_force_byte 
                     : (float)system_tip_force_load();
             } else {
-                // Assembly too small, use NVS defaults
+                // Assembly too small or not created yet, use NVS defaults
                 cylinder_bore_inches = system_cylinder_bore_load();
                 tool_weight_lbs = (float)system_tool_weight_load();
                 desired_tip_force_lbs = (float)system_tip_force_load();
             }
             
-            if (assembly_mutex != NULL) {
-                xSemaphoreGive(assembly_mutex);
-            }
-            
             // Use same cylinder bore for both top and bottom cylinders
             const float bottom_cylinder_bore_inches = cylinder_bore_inches;
             const float top_cylinder_bore_inches = cylinder_bore_inches;
@@ -2409,15 +2400,12 @@ static void imu_io_task(void *pvParameters)
             imu_data[18] = (uint8_t)((top_pressure_scaled >> 16) & 0xFF);
             imu_data[19] = (uint8_t)((top_pressure_scaled >> 24) & 0xFF);
             
-            // Write to Input Assembly 100 with mutex protection
-            if (assembly_mutex != NULL) {
-                xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-            }
-            
+            // Publish the 20 bytes to Input Assembly 100 as one snapshot
             // Check bounds again (now using 20 bytes total)
             const uint8_t imu_total_size = 20;  // 5 int32_t * 4 bytes each
             if (byte_start + imu_total_size <= sizeof(g_assembly_data064)) {
-                memcpy(&g_assembly_data064[byte_start], imu_data, imu_total_size);
+                // Marks the range changed only if the scaled values differ from the last sample
+                AssemblyUpdateData(INPUT_ASSEMBLY_NUM, byte_start, imu_data, imu_total_size);
             } else {
                 ESP_LOGW(TAG, "IMU: Byte range exceeds assembly size");
             }
@@ -2427,10 +2415,6 @@ static void imu_io_task(void *pvParameters)
             // Byte 29: Cylinder bore (scaled by 100: 0 = use NVS, 1-255 = 0.01-2.55 inches)
             // Byte 30: Tool weight (0 = use NVS, 1-255 = weight in lbs)
             // Byte 31: Tip force (0 = use NVS, 1-255 = force in lbs)
-            
-            if (assembly_mutex != NULL) {
-                xSemaphoreGive(assembly_mutex);
-            }
         
         // Wait for next period
         vTaskDelayUntil(&last_wake_time, period_ms);
@@ -0,0 +1,296 @@
+#!/usr/bin/env python3
+"""
+EtherNet/IP Forward_Open / Forward_Close Rate Benchmark
+
+Simulates the reconnect storm after an originator power cycle: all configured
+class 1 connections are opened back to back, optionally spread over several
+encapsulation sessions in parallel, then closed again. Each cycle measures
+
+    - the round trip time of every Forward_Open and Forward_Close
+    - the time until all connections of the storm were established
+    - on the target: the processing time of the services from the Latency
+      Diagnostics class (0x64)
+
+With --monitor an input only connection is kept open for the whole run and its
+T->O frames show whether the storms stall the cyclic I/O.
+
+By default every cycle reuses the connection triads of the first cycle, as an
+originator does after a reconnect. --fresh-serials uses new connection serial
+numbers in every cycle.
+
+Usage:
+    # 100 storms of one exclusive owner, 2 input only and 3 listen only connections
+    python eip_connection_benchmark.py --target 172.16.82.100 --input-only 2 --listen-only 3 --iterations 100
+
+    # Spread the storm over 3 sessions and watch the cyclic I/O of a monitor connection
+    python eip_connection_benchmark.py --target 172.16.82.100 --listen-only 3 --sessions 3 --monitor
+
+    # Local POSIX build on the same host
+    python eip_connection_benchmark.py --target 192.168.1.10 --local-port 2223 --iterations 200 --json storm.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+import threading
+import time
+from typing import Dict, List, Optional
+
+from eip_io_benchmark import (BenchmarkError, Connection, DIAGNOSTICS_CLASS,
+                              IO_PORT, KINDS, ORIGINATOR_SERIAL, Receiver, Sender, ServiceError, Session,
+                              SERVICE_GET_ATTRIBUTE_SINGLE, SERVICE_FORWARD_OPEN, SERVICE_FORWARD_CLOSE,
+                              logical_path, percentile)
+
+HISTOGRAM_TYPE_EXPLICIT_SERVICE = 1
+
+
+def read_target_counters(session: Session) -> Dict[str, int]:
+    """Sample count and total time of the Forward_Open/Close histograms"""
+    counters: Dict[str, int] = {}
+    instance = 1
+    while True:
+        try:
+            kind = session.request(SERVICE_GET_ATTRIBUTE_SINGLE, logical_path(DIAGNOSTICS_CLASS, instance, 1))
+            key = session.request(SERVICE_GET_ATTRIBUTE_SINGLE, logical_path(DIAGNOSTICS_CLASS, instance, 2))
+        except ServiceError:
+            break
+        if kind[0] == HISTOGRAM_TYPE_EXPLICIT_SERVICE:
+            service = struct.unpack("<I", key)[0]
+            names = {SERVICE_FORWARD_OPEN: "open", SERVICE_FORWARD_CLOSE: "close"}
+            if service in names:
+                count = session.request(SERVICE_GET_ATTRIBUTE_SINGLE, logical_path(DIAGNOSTICS_CLASS, instance, 4))
+                total = session.request(SERVICE_GET_ATTRIBUTE_SINGLE, logical_path(DIAGNOSTICS_CLASS, instance, 7))
+                counters[names[service] + "_count"] = struct.unpack("<I", count)[0]
+                counters[names[service] + "_total_us"] = struct.unpack("<Q", total)[0]
+        instance += 1
+    return counters
+
+
+def target_difference(before: Dict[str, int], after: Dict[str, int]) -> dict:
+    result = {}
+    for name in ("open", "close"):
+        if name + "_count" in after:
+            # the histogram of a service is assigned on its first request
+            count = (after[name + "_count"] - before.get(name + "_count", 0)) & 0xFFFFFFFF
+            total = after[name + "_total_us"] - before.get(name + "_total_us", 0)
+            result[name + "_mean_us"] = total / count if count else None
+    return result
+
+
+class Originator:
+    """One encapsulation session opening and closing its share of the connections"""
+
+    def __init__(self, target: str, local_port: int, connections: List[Connection]):
+        self.session = Session(target)
+        self.session.local_port = local_port
+        self.connections = connections
+        self.open_times: List[float] = []
+        self.close_times: List[float] = []
+        self.errors: List[str] = []
+        self.finished = 0.0
+
+    def open_all(self, multicast: bool, timeout_multiplier: int) -> None:
+        for connection in self.connections:
+            start = time.perf_counter()
+            try:
+                connection.forward_open(self.session, multicast, timeout_multiplier)
+            except BenchmarkError as error:
+                self.errors.append(str(error))
+                continue
+            self.open_times.append((time.perf_counter() - start) * 1e6)
+        self.finished = time.perf_counter()
+
+    def close_all(self) -> None:
+        for connection in reversed(self.connections):
+            start = time.perf_counter()
+            try:
+                connection.forward_close(self.session)
+            except BenchmarkError as error:
+                self.errors.append(str(error))
+                continue
+            self.close_times.append((time.perf_counter() - start) * 1e6)
+        self.finished = time.perf_counter()
+
+
+def run_parallel(originators: List[Originator], action: str, arguments: argparse.Namespace) -> float:
+    """Runs open_all or close_all in all originators at once, returns the duration in ms"""
+    start = time.perf_counter()
+    if action == "open":
+        threads = [threading.Thread(target=o.open_all, args=(arguments.multicast, arguments.timeout_multiplier))
+                   for o in originators]
+    else:
+        threads = [threading.Thread(target=o.close_all) for o in originators]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return (max(o.finished for o in originators) - start) * 1000.0
+
+
+def latency_summary(values: List[float]) -> dict:
+    ordered = sorted(values)
+    return {
+        "count": len(ordered),
+        "mean": sum(ordered) / len(ordered) if ordered else 0.0,
+        "p50": percentile(ordered, 0.5),
+        "p99": percentile(ordered, 0.99),
+        "max": ordered[-1] if ordered else 0.0,
+    }
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="EtherNet/IP Forward_Open/Forward_Close rate benchmark")
+    parser.add_argument("--target", required=True, help="IP address of the adapter")
+    parser.add_argument("--exclusive-owner", type=int, default=1, help="exclusive owner connections per storm")
+    parser.add_argument("--input-only", type=int, default=0, help="input only connections per storm")
+    parser.add_argument("--listen-only", type=int, default=0, help="listen only connections per storm")
+    parser.add_argument("--rpi", type=float, default=10.0, help="RPI of the connections in ms")
+    parser.add_argument("--iterations", type=int, default=50, help="number of open/close storms")
+    parser.add_argument("--sessions", type=int, default=1, help="sessions the storm is spread over")
+    parser.add_argument("--hold", type=float, default=0.0, help="time the connections stay open in seconds")
+    parser.add_argument("--fresh-serials", action="store_true", help="new connection serial numbers in every storm")
+    parser.add_argument("--monitor", action="store_true",
+                        help="keep an input only connection open and measure its T->O frames")
+    parser.add_argument("--multicast", action="store_true", help="request multicast T->O connections")
+    parser.add_argument("--local-port", type=int, default=IO_PORT, help="local UDP port for T->O frames")
+    parser.add_argument("--input", type=int, default=100, help="T->O (input) assembly")
+    parser.add_argument("--output", type=int, default=150, help="O->T (output) assembly of the exclusive owner")
+    parser.add_argument("--config", type=int, default=151, help="configuration assembly")
+    parser.add_argument("--input-only-point", type=int, default=152, help="O->T heartbeat point of input only")
+    parser.add_argument("--listen-only-point", type=int, default=153, help="O->T heartbeat point of listen only")
+    parser.add_argument("--input-size", type=int, default=32, help="size of the input assembly in bytes")
+    parser.add_argument("--output-size", type=int, default=32, help="size of the output assembly in bytes")
+    parser.add_argument("--run-idle", action="store_true", help="O->T frames carry a run/idle header")
+    parser.add_argument("--timeout-multiplier", type=int, default=2, help="connection timeout multiplier")
+    parser.add_argument("--json", help="write the report to this file")
+    arguments = parser.parse_args()
+
+    counts = {"exclusive_owner": arguments.exclusive_owner, "input_only": arguments.input_only,
+              "listen_only": arguments.listen_only}
+    points = {"exclusive_owner": arguments.output, "input_only": arguments.input_only_point,
+              "listen_only": arguments.listen_only_point}
+    rpi_us = int(arguments.rpi * 1000)
+    # listen only connections need an owner, so KINDS order is kept in every session
+    storm = [Connection(kind, index, rpi_us, points[kind], arguments)
+             for kind in KINDS for index in range(counts[kind])]
+    if not storm:
+        parser.error("no connections requested")
+
+    monitor: Optional[Connection] = None
+    receiver = sender = None
+    control = None
+    originators: List[Originator] = []
+    storm_open_ms: List[float] = []
+    storm_close_ms: List[float] = []
+    failed_storms = 0
+    try:
+        control = Session(arguments.target)
+        control.local_port = arguments.local_port
+        if arguments.monitor:
+            import socket
+            monitor = Connection("input_only", 99, rpi_us, arguments.input_only_point, arguments)
+            monitor.serial = 0xFFF0
+            monitor.t2o_id = (ORIGINATOR_SERIAL << 16 | monitor.serial) & 0xFFFFFFFF
+            io_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            io_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            io_socket.bind(("", arguments.local_port))
+            monitor.forward_open(control, False, arguments.timeout_multiplier)
+            receiver = Receiver(io_socket, [monitor])
+            sender = Sender(io_socket, arguments.target, [monitor])
+            receiver.start()
+            sender.start()
+            receiver.recording = True
+
+        for number, connection in enumerate(storm):
+            connection.serial = 0x1000 + number
+        sessions = max(1, min(arguments.sessions, len(storm)))
+        originators = [Originator(arguments.target, arguments.local_port, storm[index::sessions])
+                       for index in range(sessions)]
+        counters_before = read_target_counters(control)
+        start = time.perf_counter()
+
+        for iteration in range(arguments.iterations):
+            if arguments.fresh_serials:
+                for number, connection in enumerate(storm):
+                    connection.serial = 0x1000 + (iteration * len(storm) + number) % 0xE000
+            for connection in storm:
+                connection.t2o_id = (ORIGINATOR_SERIAL << 16 | connection.serial) & 0xFFFFFFFF
+            errors = sum(len(o.errors) for o in originators)
+            storm_open_ms.append(run_parallel(originators, "open", arguments))
+            if arguments.hold:
+                time.sleep(arguments.hold)
+            storm_close_ms.append(run_parallel(originators, "close", arguments))
+            if sum(len(o.errors) for o in originators) != errors:
+                failed_storms += 1
+
+        duration = time.perf_counter() - start
+        counters_after = read_target_counters(control)
+    except (BenchmarkError, OSError) as error:
+        print("Error: %s" % error, file=sys.stderr)
+        return 1
+    except KeyboardInterrupt:
+        return 1
+    finally:
+        if monitor is not None and control is not None:
+            monitor.forward_close(control)
+        for thread in (sender, receiver):
+            if thread is not None:
+                thread.running = False
+                thread.join()
+        for originator in originators:
+            originator.session.close()
+        if control is not None:
+            control.close()
+
+    open_times = [t for o in originators for t in o.open_times]
+    close_times = [t for o in originators for t in o.close_times]
+    errors = [e for o in originators for e in o.errors]
+    report = {
+        "target": arguments.target,
+        "time": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "arguments": vars(arguments),
+        "connections_per_storm": len(storm),
+        "failed_storms": failed_storms,
+        "errors": sorted(set(errors)),
+        "forward_open_rtt_us": latency_summary(open_times),
+        "forward_close_rtt_us": latency_summary(close_times),
+        "storm_open_ms": latency_summary(storm_open_ms),
+        "storm_close_ms": latency_summary(storm_close_ms),
+        "opens_per_second": 1000.0 * len(open_times) / sum(storm_open_ms) if storm_open_ms else 0.0,
+        "device": target_difference(counters_before, counters_after),
+        "monitor": monitor.statistics(duration) if monitor else None,
+    }
+
+    print("%d storms of %d connections over %d session(s)%s" % (
+        arguments.iterations, len(storm), len(originators),
+        ", fresh serial numbers" if arguments.fresh_serials else ""))
+    for name, key in (("Forward_Open RTT", "forward_open_rtt_us"), ("Forward_Close RTT", "forward_close_rtt_us")):
+        values = report[key]
+        print("  %-18s mean %8.1f us  p50 %8.1f us  p99 %8.1f us  max %8.1f us" % (
+            name, values["mean"], values["p50"], values["p99"], values["max"]))
+    for name, key in (("storm open", "storm_open_ms"), ("storm close", "storm_close_ms")):
+        values = report[key]
+        print("  %-18s mean %8.2f ms  p99 %8.2f ms  max %8.2f ms" % (name, values["mean"], values["p99"],
+                                                                      values["max"]))
+    print("  %.0f Forward_Open per second" % report["opens_per_second"])
+    target = report["device"]
+    if target.get("open_mean_us") is not None:
+        print("  target: Forward_Open %.1f us, Forward_Close %.1f us processing time" % (
+            target["open_mean_us"], target.get("close_mean_us") or 0.0))
+    if report["monitor"]:
+        statistics = report["monitor"]
+        print("  monitor: %d frames, interval max %.0f us (API %d us), %d missed RPIs, %d lost" % (
+            statistics["packets"], statistics["interval_us"]["max"], statistics["t2o_api_us"],
+            statistics["missed_rpi"], statistics["sequence_gaps_lost"]))
+    if errors:
+        print("  %d failed requests in %d storms: %s" % (len(errors), failed_storms, "; ".join(sorted(set(errors)))))
+
+    if arguments.json:
+        with open(arguments.json, "w") as output:
+            json.dump(report, output, indent=2)
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
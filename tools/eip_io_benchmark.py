@@ -0,0 +1,721 @@
+#!/usr/bin/env python3
+"""
+EtherNet/IP Implicit I/O Benchmark
+
+Scriptable EtherNet/IP originator which opens exclusive owner, input only and
+listen only class 1 connections against the assemblies of the OpENer sample
+application and measures the produced T->O traffic:
+
+    - arrival interval and jitter against the actual packet interval (API)
+    - missed RPIs (intervals longer than 1.5 API)
+    - gaps, duplicates and reordering of the encapsulation sequence number
+    - CPU cost on the target, read from the network handler load statistics
+      (Latency Diagnostics class 0x64) and, for a local stack, from /proc
+
+The O->T side is produced by this script: data frames for the exclusive owner
+connections and heartbeats for input only and listen only connections.
+
+The sample application provides the connection points of the EDS:
+    Exclusive Owner: config 151, O->T 150 (32 bytes), T->O 100 (32 bytes)
+    Input Only:      config 151, O->T 152 (heartbeat), T->O 100
+    Listen Only:     config 151, O->T 153 (heartbeat), T->O 100
+
+Usage:
+    # One exclusive owner at 10 ms against a device
+    python eip_io_benchmark.py --target 172.16.82.100
+
+    # Exclusive owner, 3 input only and 3 listen only connections, RPI sweep
+    python eip_io_benchmark.py --target 172.16.82.100 --input-only 3 --listen-only 3 \\
+        --rpi 10,5,2,1 --duration 30 --json release.json
+
+    # Local POSIX build on the same host, include its process CPU time
+    python eip_io_benchmark.py --target 192.168.1.10 --local-port 2223 --pid $(pidof OpENer)
+
+    # Compare against the report of the previous release
+    python eip_io_benchmark.py --target 172.16.82.100 --baseline release.json --tolerance 25
+"""
+
+import argparse
+import heapq
+import json
+import math
+import os
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+from typing import Dict, List, Optional, Tuple
+
+ENCAPSULATION_PORT = 44818
+IO_PORT = 2222
+
+COMMAND_REGISTER_SESSION = 0x0065
+COMMAND_UNREGISTER_SESSION = 0x0066
+COMMAND_SEND_RR_DATA = 0x006F
+ENCAPSULATION_HEADER = struct.Struct("<HHII8sI")
+
+ITEM_NULL_ADDRESS = 0x0000
+ITEM_UNCONNECTED_DATA = 0x00B2
+ITEM_CONNECTED_DATA = 0x00B1
+ITEM_SEQUENCED_ADDRESS = 0x8002
+ITEM_SOCKADDR_O2T = 0x8000
+ITEM_SOCKADDR_T2O = 0x8001
+
+SERVICE_FORWARD_OPEN = 0x54
+SERVICE_FORWARD_CLOSE = 0x4E
+SERVICE_GET_ATTRIBUTE_SINGLE = 0x0E
+
+CONNECTION_MANAGER_CLASS = 0x06
+DIAGNOSTICS_CLASS = 0x64
+VENDOR_ID = 0x1234
+# fixed, so a new run may take over the timed out connections of an aborted run
+ORIGINATOR_SERIAL = 0x424D4B31
+
+NETWORK_TYPE_MULTICAST = 0x2000
+NETWORK_TYPE_POINT_TO_POINT = 0x4000
+TRANSPORT_CLASS1_CYCLIC = 0x01
+
+# NetworkHandlerPhase in generic_networkhandler.h
+PHASES = ["select", "tcp", "udp", "connection_timers", "manage_connections",
+          "timeout_checkers", "other"]
+
+KINDS = ("exclusive_owner", "input_only", "listen_only")
+
+
+class BenchmarkError(Exception):
+    pass
+
+
+class ServiceError(BenchmarkError):
+    """The target answered a request with an error status"""
+
+
+class Session:
+    """Encapsulation session used for the explicit requests"""
+
+    def __init__(self, target: str, timeout: float = 2.0):
+        self.socket = socket.create_connection((target, ENCAPSULATION_PORT), timeout=timeout)
+        self.handle = 0
+        reply = self.command(COMMAND_REGISTER_SESSION, struct.pack("<HH", 1, 0))
+        self.handle = reply[0]
+
+    def command(self, command: int, data: bytes) -> Tuple[int, bytes]:
+        self.socket.sendall(ENCAPSULATION_HEADER.pack(command, len(data), self.handle, 0,
+                                                       b"\0" * 8, 0) + data)
+        header = self.receive(ENCAPSULATION_HEADER.size)
+        _, length, handle, status, _, _ = ENCAPSULATION_HEADER.unpack(header)
+        body = self.receive(length)
+        if status != 0:
+            raise BenchmarkError("encapsulation command 0x%04x failed with status 0x%x" % (command, status))
+        return handle, body
+
+    def receive(self, length: int) -> bytes:
+        data = b""
+        while len(data) < length:
+            chunk = self.socket.recv(length - len(data))
+            if not chunk:
+                raise BenchmarkError("target closed the encapsulation session")
+            data += chunk
+        return data
+
+    def send_rr_data(self, request: bytes, extra_items: bytes = b"", extra_count: int = 0) -> Tuple[bytes, Dict[int, bytes]]:
+        """Send an unconnected request, returns the CIP reply and the other CPF items"""
+        cpf = struct.pack("<IHH", 0, 0, 2 + extra_count)
+        cpf += struct.pack("<HH", ITEM_NULL_ADDRESS, 0)
+        cpf += struct.pack("<HH", ITEM_UNCONNECTED_DATA, len(request)) + request + extra_items
+        _, body = self.command(COMMAND_SEND_RR_DATA, cpf)
+        items = parse_items(body[6:])
+        return items.pop(ITEM_UNCONNECTED_DATA, b""), items
+
+    def request(self, service: int, path: bytes, data: bytes = b"") -> bytes:
+        """Send a CIP request, returns the reply data or raises on an error status"""
+        reply, _ = self.send_rr_data(bytes([service, len(path) // 2]) + path + data)
+        status, additional = check_reply(reply)
+        if status != 0:
+            raise ServiceError("service 0x%02x failed with status 0x%02x %s" % (service, status, additional.hex()))
+        return reply[4 + 2 * reply[3]:]
+
+    def close(self) -> None:
+        try:
+            self.socket.sendall(ENCAPSULATION_HEADER.pack(COMMAND_UNREGISTER_SESSION, 0, self.handle,
+                                                           0, b"\0" * 8, 0))
+        except OSError:
+            pass
+        self.socket.close()
+
+
+def parse_items(data: bytes) -> Dict[int, bytes]:
+    count, = struct.unpack_from("<H", data)
+    position = 2
+    items = {}
+    for _ in range(count):
+        item_type, length = struct.unpack_from("<HH", data, position)
+        items[item_type] = data[position + 4:position + 4 + length]
+        position += 4 + length
+    return items
+
+
+def check_reply(reply: bytes) -> Tuple[int, bytes]:
+    if len(reply) < 4:
+        raise BenchmarkError("short CIP reply")
+    return reply[2], reply[4:4 + 2 * reply[3]]
+
+
+def logical_path(class_id: int, instance: int, attribute: Optional[int] = None) -> bytes:
+    path = bytes([0x20, class_id, 0x24, instance])
+    if attribute is not None:
+        path += bytes([0x30, attribute])
+    return path
+
+
+def percentile(ordered: List[float], fraction: float) -> float:
+    if not ordered:
+        return 0.0
+    index = min(len(ordered) - 1, max(0, int(math.ceil(fraction * len(ordered))) - 1))
+    return ordered[index]
+
+
+class Connection:
+    """One class 1 connection and the T->O frames received on it"""
+
+    def __init__(self, kind: str, index: int, rpi_us: int, consumed_point: int, arguments: argparse.Namespace):
+        self.kind = kind
+        self.index = index
+        self.rpi_us = rpi_us
+        self.serial = 0
+        self.path = logical_path(0x04, arguments.config) + bytes([0x2C, consumed_point, 0x2C, arguments.input])
+        run_idle = 4 if arguments.run_idle else 0
+        if kind == "exclusive_owner":
+            self.o2t_data = bytes(arguments.output_size)
+            self.o2t_size = 2 + run_idle + arguments.output_size
+        else:
+            self.o2t_data = b""
+            self.o2t_size = 2
+        self.t2o_size = 2 + arguments.input_size
+        self.o2t_id = 0
+        self.t2o_id = 0
+        self.o2t_api_us = 0
+        self.t2o_api_us = 0
+        self.multicast_group = None
+        self.multicast_port = 0
+        self.run_idle = arguments.run_idle
+        self.open_time = 0.0
+        self.o2t_sequence = 0
+        self.o2t_sent = 0
+        self.arrivals: List[Tuple[int, int, int]] = []
+
+    @property
+    def name(self) -> str:
+        return "%s#%d" % (self.kind, self.index)
+
+    def forward_open(self, session: Session, multicast: bool, timeout_multiplier: int) -> None:
+        t2o_type = NETWORK_TYPE_MULTICAST if multicast else NETWORK_TYPE_POINT_TO_POINT
+        # the consumer chooses the ID of a point to point connection, the
+        # producer the ID of a multicast connection
+        requested_t2o_id = 0 if multicast else self.t2o_id
+        request = struct.pack("<BBIIHHIB3xIHIHB", 0x0A, 0x0E, 0, requested_t2o_id, self.serial, VENDOR_ID,
+                              ORIGINATOR_SERIAL, timeout_multiplier,
+                              self.rpi_us, NETWORK_TYPE_POINT_TO_POINT | self.o2t_size,
+                              self.rpi_us, t2o_type | self.t2o_size, TRANSPORT_CLASS1_CYCLIC)
+        request += bytes([len(self.path) // 2]) + self.path
+        request = bytes([SERVICE_FORWARD_OPEN, 2]) + logical_path(CONNECTION_MANAGER_CLASS, 1) + request
+
+        extra, count = b"", 0
+        if not multicast:
+            extra = struct.pack("<HH", ITEM_SOCKADDR_T2O, 16) + \
+                struct.pack(">hH4s8s", socket.AF_INET, session.local_port, b"\0" * 4, b"\0" * 8)
+            count = 1
+        reply, items = session.send_rr_data(request, extra, count)
+        status, additional = check_reply(reply)
+        if status != 0:
+            extended = struct.unpack_from("<H", additional)[0] if len(additional) >= 2 else 0
+            raise BenchmarkError("Forward_Open of %s failed with status 0x%02x, extended status 0x%04x"
+                                 % (self.name, status, extended))
+        (self.o2t_id, self.t2o_id, _, _, _, self.o2t_api_us,
+         self.t2o_api_us) = struct.unpack_from("<IIHHIII", reply, 4)
+        if ITEM_SOCKADDR_T2O in items and multicast:
+            self.multicast_port, address = struct.unpack_from(">H4s", items[ITEM_SOCKADDR_T2O], 2)
+            self.multicast_group = socket.inet_ntoa(address)
+        self.open_time = time.time()
+
+    def forward_close(self, session: Session) -> None:
+        request = struct.pack("<BBHHI", 0x0A, 0x0E, self.serial, VENDOR_ID, ORIGINATOR_SERIAL)
+        request += bytes([len(self.path) // 2, 0]) + self.path
+        try:
+            session.request(SERVICE_FORWARD_CLOSE, logical_path(CONNECTION_MANAGER_CLASS, 1), request)
+        except (OSError, BenchmarkError):
+            pass
+
+    def o2t_frame(self) -> bytes:
+        self.o2t_sequence = (self.o2t_sequence + 1) & 0xFFFFFFFF
+        data = struct.pack("<H", self.o2t_sequence & 0xFFFF)
+        if self.o2t_data:
+            if self.run_idle:
+                data += struct.pack("<I", 1)
+            data += self.o2t_data
+        return struct.pack("<HHHIIHH", 2, ITEM_SEQUENCED_ADDRESS, 8, self.o2t_id, self.o2t_sequence,
+                           ITEM_CONNECTED_DATA, len(data)) + data
+
+    def statistics(self, duration: float) -> dict:
+        api = float(self.t2o_api_us)
+        intervals = []
+        lost = duplicates = reordered = fresh = 0
+        missed = 0
+        previous = None
+        for timestamp, sequence, cip_sequence in self.arrivals:
+            if previous is not None:
+                step = (sequence - previous[1]) & 0xFFFFFFFF
+                if step == 0:
+                    duplicates += 1
+                    continue
+                if step >= 0x80000000:
+                    reordered += 1
+                    continue
+                lost += step - 1
+                interval = (timestamp - previous[0]) / 1000.0
+                intervals.append(interval)
+                if api and interval > 1.5 * api:
+                    missed += int(interval / api + 0.5) - 1
+                if cip_sequence != previous[2]:
+                    fresh += 1
+            previous = (timestamp, sequence, cip_sequence)
+
+        ordered = sorted(intervals)
+        jitter = sorted(abs(interval - api) for interval in intervals)
+        mean = sum(intervals) / len(intervals) if intervals else 0.0
+        deviation = math.sqrt(sum((i - mean) ** 2 for i in intervals) / len(intervals)) if intervals else 0.0
+        return {
+            "name": self.name,
+            "kind": self.kind,
+            "rpi_us": self.rpi_us,
+            "t2o_api_us": self.t2o_api_us,
+            "o2t_api_us": self.o2t_api_us,
+            "multicast_group": self.multicast_group,
+            "packets": len(self.arrivals),
+            "packets_per_second": len(self.arrivals) / duration if duration else 0.0,
+            "expected_packets": int(duration * 1e6 / api) if api else 0,
+            "o2t_sent": self.o2t_sent,
+            "interval_us": {
+                "min": ordered[0] if ordered else 0.0,
+                "mean": mean,
+                "max": ordered[-1] if ordered else 0.0,
+                "stddev": deviation,
+                "p50": percentile(ordered, 0.5),
+                "p99": percentile(ordered, 0.99),
+                "p999": percentile(ordered, 0.999),
+            },
+            "jitter_us": {
+                "mean": sum(jitter) / len(jitter) if jitter else 0.0,
+                "p99": percentile(jitter, 0.99),
+                "p999": percentile(jitter, 0.999),
+                "max": jitter[-1] if jitter else 0.0,
+            },
+            "missed_rpi": missed,
+            "sequence_gaps_lost": lost,
+            "sequence_duplicates": duplicates,
+            "sequence_reordered": reordered,
+            "fresh_data": fresh,
+        }
+
+
+class Receiver(threading.Thread):
+    """Receives the T->O frames and stamps them, with kernel timestamps if available"""
+
+    def __init__(self, io_socket: socket.socket, connections: List[Connection]):
+        super().__init__(daemon=True)
+        self.socket = io_socket
+        self.by_id: Dict[int, List[Connection]] = {}
+        for connection in connections:
+            self.by_id.setdefault(connection.t2o_id, []).append(connection)
+        self.running = True
+        self.recording = False
+        self.unknown = 0
+        self.kernel_timestamps = False
+        timestamp_option = getattr(socket, "SO_TIMESTAMPNS", 35 if sys.platform.startswith("linux") else None)
+        if timestamp_option is not None:
+            try:
+                self.socket.setsockopt(socket.SOL_SOCKET, timestamp_option, 1)
+                self.timestamp_option = timestamp_option
+                self.kernel_timestamps = True
+            except OSError:
+                pass
+        self.socket.settimeout(0.2)
+
+    def run(self) -> None:
+        while self.running:
+            try:
+                if self.kernel_timestamps:
+                    data, ancillary, _, _ = self.socket.recvmsg(1500, socket.CMSG_SPACE(16))
+                    stamp = None
+                    for level, kind, value in ancillary:
+                        if level == socket.SOL_SOCKET and kind == self.timestamp_option and len(value) >= 16:
+                            seconds, nanoseconds = struct.unpack_from("qq", value)
+                            stamp = seconds * 1000000000 + nanoseconds
+                    if stamp is None:
+                        stamp = time.time_ns()
+                else:
+                    data = self.socket.recv(1500)
+                    stamp = time.time_ns()
+            except socket.timeout:
+                continue
+            except OSError:
+                break
+            if not self.recording or len(data) < 18:
+                continue
+            count, item_type, length, connection_id, sequence = struct.unpack_from("<HHHII", data)
+            if count < 2 or item_type != ITEM_SEQUENCED_ADDRESS or length != 8:
+                self.unknown += 1
+                continue
+            targets = self.by_id.get(connection_id)
+            if targets is None:
+                self.unknown += 1
+                continue
+            cip_sequence = struct.unpack_from("<H", data, 18)[0] if len(data) >= 20 else 0
+            for connection in targets:
+                connection.arrivals.append((stamp, sequence, cip_sequence))
+
+
+class Sender(threading.Thread):
+    """Produces the O->T frames of all connections at their RPI"""
+
+    def __init__(self, io_socket: socket.socket, target: str, connections: List[Connection]):
+        super().__init__(daemon=True)
+        self.socket = io_socket
+        self.address = (target, IO_PORT)
+        self.connections = connections
+        self.running = True
+        self.lateness: List[float] = []
+
+    def run(self) -> None:
+        start = time.perf_counter()
+        schedule = [(start, index) for index in range(len(self.connections))]
+        heapq.heapify(schedule)
+        while self.running and schedule:
+            deadline, index = schedule[0]
+            delay = deadline - time.perf_counter()
+            if delay > 0:
+                time.sleep(min(delay, 0.1))
+                continue
+            connection = self.connections[index]
+            self.lateness.append(-delay * 1e6)
+            try:
+                self.socket.sendto(connection.o2t_frame(), self.address)
+                connection.o2t_sent += 1
+            except OSError:
+                pass
+            interval = (connection.o2t_api_us or connection.rpi_us) / 1e6
+            # keep the phase, but do not burst to catch up after a stall
+            next_deadline = deadline + interval
+            if next_deadline < time.perf_counter() - interval:
+                next_deadline = time.perf_counter() + interval
+            heapq.heapreplace(schedule, (next_deadline, index))
+
+
+class DeviceLoad:
+    """Network handler load statistics of the target (Latency Diagnostics class)"""
+
+    def __init__(self, session: Session):
+        self.session = session
+        self.available = True
+
+    def snapshot(self) -> Optional[dict]:
+        if not self.available:
+            return None
+        try:
+            totals = self.session.request(SERVICE_GET_ATTRIBUTE_SINGLE, logical_path(DIAGNOSTICS_CLASS, 0, 9))
+            cycles = self.session.request(SERVICE_GET_ATTRIBUTE_SINGLE, logical_path(DIAGNOSTICS_CLASS, 0, 14))
+            busy = self.session.request(SERVICE_GET_ATTRIBUTE_SINGLE, logical_path(DIAGNOSTICS_CLASS, 0, 15))
+            utilization = self.session.request(SERVICE_GET_ATTRIBUTE_SINGLE,
+                                               logical_path(CONNECTION_MANAGER_CLASS, 1, 11))
+        except ServiceError:
+            self.available = False
+            return None
+        return {
+            "totals": list(struct.unpack("<%dQ" % (len(totals) // 8), totals)),
+            "cycles": struct.unpack("<I", cycles)[0],
+            "maximum_cycle_busy_us": struct.unpack("<I", busy)[0],
+            "utilization_permille": struct.unpack("<H", utilization)[0],
+        }
+
+    @staticmethod
+    def difference(before: Optional[dict], after: Optional[dict], produced: int, consumed: int) -> Optional[dict]:
+        if before is None or after is None:
+            return None
+        delta = [(b - a) & 0xFFFFFFFFFFFFFFFF for a, b in zip(before["totals"], after["totals"])]
+        elapsed = sum(delta)
+        if elapsed == 0:
+            return None
+        phases = dict(zip(PHASES, delta))
+        busy = elapsed - phases["select"]
+        return {
+            "utilization_percent": 100.0 * busy / elapsed,
+            "phase_percent": {name: 100.0 * value / elapsed for name, value in phases.items()},
+            "cycles_per_second": ((after["cycles"] - before["cycles"]) & 0xFFFFFFFF) * 1e6 / elapsed,
+            "us_per_produced_frame": phases["connection_timers"] / produced if produced else None,
+            "us_per_consumed_frame": phases["udp"] / consumed if consumed else None,
+            "maximum_cycle_busy_us": after["maximum_cycle_busy_us"],
+            "connection_manager_utilization_percent": after["utilization_permille"] / 10.0,
+        }
+
+
+def process_times(pid: int) -> Optional[float]:
+    """User plus system CPU time of a local process in seconds"""
+    try:
+        with open("/proc/%d/stat" % pid) as stat:
+            fields = stat.read().rsplit(")", 1)[1].split()
+    except OSError:
+        return None
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def build_connections(arguments: argparse.Namespace, rpi_ms: float) -> List[Connection]:
+    counts = {"exclusive_owner": arguments.exclusive_owner, "input_only": arguments.input_only,
+              "listen_only": arguments.listen_only}
+    points = {"exclusive_owner": arguments.output, "input_only": arguments.input_only_point,
+              "listen_only": arguments.listen_only_point}
+    connections = []
+    for kind in KINDS:
+        rpi = getattr(arguments, "rpi_" + kind) or rpi_ms
+        for index in range(counts[kind]):
+            connections.append(Connection(kind, index, int(rpi * 1000), points[kind], arguments))
+    return connections
+
+
+def run(arguments: argparse.Namespace, rpi_ms: float) -> dict:
+    connections = build_connections(arguments, rpi_ms)
+    if not connections:
+        raise BenchmarkError("no connections requested")
+
+    io_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    io_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    io_socket.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+    io_socket.bind(("", arguments.local_port))
+
+    session = Session(arguments.target)
+    session.local_port = arguments.local_port
+    load = DeviceLoad(session)
+    serial_base = random.randrange(1, 0xF000)
+    opened: List[Connection] = []
+    sender = receiver = None
+    try:
+        # listen only connections need an owning connection, so open in KINDS order
+        for number, connection in enumerate(connections):
+            connection.serial = serial_base + number
+            connection.t2o_id = (ORIGINATOR_SERIAL << 16 | connection.serial) & 0xFFFFFFFF
+            connection.forward_open(session, arguments.multicast, arguments.timeout_multiplier)
+            opened.append(connection)
+            if connection.multicast_group:
+                if connection.multicast_port != arguments.local_port:
+                    raise BenchmarkError("multicast T->O frames are sent to port %d, use --local-port %d"
+                                         % (connection.multicast_port, connection.multicast_port))
+                membership = struct.pack("4s4s", socket.inet_aton(connection.multicast_group),
+                                         socket.inet_aton(arguments.interface_address))
+                try:
+                    io_socket.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+                except OSError:
+                    pass  # already joined by an earlier listener
+
+        receiver = Receiver(io_socket, connections)
+        sender = Sender(io_socket, arguments.target, connections)
+        receiver.start()
+        sender.start()
+        time.sleep(arguments.warmup)
+
+        device_before = load.snapshot()
+        pid_before = process_times(arguments.pid) if arguments.pid else None
+        harness_before = time.process_time()
+        sent_before = sum(c.o2t_sent for c in connections)
+        sender.lateness.clear()
+        receiver.recording = True
+        start = time.perf_counter()
+        time.sleep(arguments.duration)
+        receiver.recording = False
+        duration = time.perf_counter() - start
+        sent = sum(c.o2t_sent for c in connections) - sent_before
+        harness = time.process_time() - harness_before
+        pid_after = process_times(arguments.pid) if arguments.pid else None
+
+        # frames produced by the target: one stream per T->O connection ID
+        produced = sum(len(c.arrivals) for c in {c.t2o_id: c for c in connections}.values())
+        device_after = load.snapshot()
+    finally:
+        # close while the O->T frames are still sent, a timed out exclusive
+        # owner connection makes the target close the session
+        for connection in reversed(opened):
+            connection.forward_close(session)
+        for thread in (sender, receiver):
+            if thread is not None:
+                thread.running = False
+                thread.join()
+        session.close()
+        io_socket.close()
+
+    lateness = sorted(sender.lateness)
+    report = {
+        "rpi_ms": rpi_ms,
+        "duration_s": duration,
+        "kernel_timestamps": receiver.kernel_timestamps,
+        "unknown_frames": receiver.unknown,
+        "connections": [c.statistics(duration) for c in connections],
+        "device": DeviceLoad.difference(device_before, device_after, produced, sent),
+        "process_cpu_percent": 100.0 * (pid_after - pid_before) / duration
+        if pid_before is not None and pid_after is not None else None,
+        "harness": {
+            "cpu_percent": 100.0 * harness / duration,
+            "o2t_frames": sent,
+            "send_lateness_p99_us": percentile(lateness, 0.99),
+            "send_lateness_max_us": lateness[-1] if lateness else 0.0,
+        },
+    }
+    report["summary"] = summarize(report["connections"])
+    return report
+
+
+def summarize(connections: List[dict]) -> Dict[str, dict]:
+    summary = {}
+    for kind in KINDS:
+        selected = [c for c in connections if c["kind"] == kind]
+        if not selected:
+            continue
+        summary[kind] = {
+            "connections": len(selected),
+            "packets": sum(c["packets"] for c in selected),
+            "jitter_p99_us": max(c["jitter_us"]["p99"] for c in selected),
+            "jitter_max_us": max(c["jitter_us"]["max"] for c in selected),
+            "missed_rpi": sum(c["missed_rpi"] for c in selected),
+            "sequence_gaps_lost": sum(c["sequence_gaps_lost"] for c in selected),
+        }
+    return summary
+
+
+def print_report(report: dict) -> None:
+    print("\nRPI %.3f ms, %.1f s%s" % (report["rpi_ms"], report["duration_s"],
+                                        "" if report["kernel_timestamps"] else " (user space timestamps)"))
+    print("  %-18s %8s %8s %9s %9s %9s %9s %7s %6s" % ("connection", "API us", "packets", "mean us",
+                                                      "stddev", "jit p99", "jit max", "missed", "lost"))
+    for c in report["connections"]:
+        print("  %-18s %8d %8d %9.1f %9.1f %9.1f %9.1f %7d %6d" % (
+            c["name"], c["t2o_api_us"], c["packets"], c["interval_us"]["mean"], c["interval_us"]["stddev"],
+            c["jitter_us"]["p99"], c["jitter_us"]["max"], c["missed_rpi"], c["sequence_gaps_lost"]))
+    device = report["device"]
+    if device:
+        print("  target: %.1f %% busy, %.0f cycles/s, max cycle %d us" % (
+            device["utilization_percent"], device["cycles_per_second"], device["maximum_cycle_busy_us"]))
+        print("          " + ", ".join("%s %.2f %%" % (name, value)
+                                       for name, value in device["phase_percent"].items() if name != "select"))
+        costs = ["%.2f us per %s frame" % (device["us_per_%s_frame" % direction], direction)
+                 for direction in ("produced", "consumed") if device["us_per_%s_frame" % direction] is not None]
+        if costs:
+            print("          " + ", ".join(costs))
+    else:
+        print("  target: no load statistics (Latency Diagnostics class 0x64 not available)")
+    if report["process_cpu_percent"] is not None:
+        print("  target process: %.2f %% CPU" % report["process_cpu_percent"])
+    harness = report["harness"]
+    print("  harness: %.1f %% CPU, send lateness p99 %.0f us, max %.0f us" % (
+        harness["cpu_percent"], harness["send_lateness_p99_us"], harness["send_lateness_max_us"]))
+    if harness["send_lateness_p99_us"] > 0.25 * report["rpi_ms"] * 1000:
+        print("  warning: the harness could not keep up with the RPI, O->T results are not reliable")
+
+
+def compare(reports: List[dict], baseline: dict, tolerance: float) -> List[str]:
+    """Returns the regressions against a baseline report"""
+    regressions = []
+    previous = {run["rpi_ms"]: run for run in baseline.get("runs", [])}
+    for report in reports:
+        old = previous.get(report["rpi_ms"])
+        if old is None:
+            continue
+        checks = []
+        for kind, values in report["summary"].items():
+            if kind not in old["summary"]:
+                continue
+            for metric in ("jitter_p99_us", "missed_rpi", "sequence_gaps_lost"):
+                checks.append(("%s %s" % (kind, metric), old["summary"][kind][metric], values[metric]))
+        if report["device"] and old.get("device"):
+            for metric in ("utilization_percent", "us_per_produced_frame", "us_per_consumed_frame"):
+                if report["device"][metric] is not None and old["device"].get(metric) is not None:
+                    checks.append(("target %s" % metric, old["device"][metric], report["device"][metric]))
+        for name, old_value, new_value in checks:
+            # allow one occurrence more for the counters, which are often zero,
+            # and 5 % of the RPI for the jitter, which is noisy on short runs
+            slack = 1 if isinstance(old_value, int) else 0
+            if "jitter" in name:
+                slack = 50.0 * report["rpi_ms"]
+            limit = old_value * (1.0 + tolerance / 100.0) + slack
+            if new_value > limit:
+                regressions.append("RPI %.3f ms: %s %.2f -> %.2f" % (report["rpi_ms"], name, old_value, new_value))
+    return regressions
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="EtherNet/IP implicit I/O throughput and jitter benchmark")
+    parser.add_argument("--target", required=True, help="IP address of the adapter")
+    parser.add_argument("--exclusive-owner", type=int, default=1, help="number of exclusive owner connections")
+    parser.add_argument("--input-only", type=int, default=0, help="number of input only connections")
+    parser.add_argument("--listen-only", type=int, default=0, help="number of listen only connections")
+    parser.add_argument("--rpi", default="10", help="RPI in ms, a comma separated list runs a sweep")
+    for kind in KINDS:
+        parser.add_argument("--rpi-" + kind.replace("_", "-"), type=float,
+                            help="RPI in ms of the %s connections, overrides --rpi" % kind.replace("_", " "))
+    parser.add_argument("--duration", type=float, default=10.0, help="measurement time per RPI in seconds")
+    parser.add_argument("--warmup", type=float, default=1.0, help="time before the measurement starts in seconds")
+    parser.add_argument("--multicast", action="store_true", help="request multicast T->O connections")
+    parser.add_argument("--interface-address", default="0.0.0.0", help="local address used to join multicast groups")
+    parser.add_argument("--local-port", type=int, default=IO_PORT,
+                        help="local UDP port for T->O frames, use another port than 2222 against a local stack")
+    parser.add_argument("--input", type=int, default=100, help="T->O (input) assembly")
+    parser.add_argument("--output", type=int, default=150, help="O->T (output) assembly of the exclusive owner")
+    parser.add_argument("--config", type=int, default=151, help="configuration assembly")
+    parser.add_argument("--input-only-point", type=int, default=152, help="O->T heartbeat point of input only")
+    parser.add_argument("--listen-only-point", type=int, default=153, help="O->T heartbeat point of listen only")
+    parser.add_argument("--input-size", type=int, default=32, help="size of the input assembly in bytes")
+    parser.add_argument("--output-size", type=int, default=32, help="size of the output assembly in bytes")
+    parser.add_argument("--run-idle", action="store_true", help="send a run/idle header in the O->T frames")
+    parser.add_argument("--timeout-multiplier", type=int, default=2,
+                        help="connection timeout multiplier, 0 = x4 ... 7 = x512 RPI (default x16, "
+                             "the script cannot keep short RPIs precisely)")
+    parser.add_argument("--pid", type=int, help="PID of a local stack, adds its CPU time to the report")
+    parser.add_argument("--json", help="write the report to this file")
+    parser.add_argument("--baseline", help="report of an earlier run to compare with")
+    parser.add_argument("--tolerance", type=float, default=20.0, help="allowed regression against the baseline in %%")
+    arguments = parser.parse_args()
+
+    try:
+        rpis = [float(value) for value in arguments.rpi.split(",")]
+    except ValueError:
+        parser.error("--rpi takes a comma separated list of numbers")
+
+    reports = []
+    try:
+        for rpi_ms in rpis:
+            report = run(arguments, rpi_ms)
+            print_report(report)
+            reports.append(report)
+            time.sleep(0.5)  # let the target release the connections
+    except (BenchmarkError, OSError) as error:
+        print("Error: %s" % error, file=sys.stderr)
+        return 1
+    except KeyboardInterrupt:
+        return 1
+
+    document = {"target": arguments.target, "time": time.strftime("%Y-%m-%dT%H:%M:%S"),
+                "arguments": vars(arguments), "runs": reports}
+    if arguments.json:
+        with open(arguments.json, "w") as output:
+            json.dump(document, output, indent=2)
+
+    if arguments.baseline:
+        with open(arguments.baseline) as baseline_file:
+            regressions = compare(reports, json.load(baseline_file), arguments.tolerance)
+        for regression in regressions:
+            print("regression: %s" % regression)
+        if regressions:
+            return 2
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""
+Decode ModbusTCP Server Metrics Snapshots
+
+The ModbusTCP server counts requests, exceptions and bytes per function code
+and keeps a histogram of the service time, from the reception of a request's
+MBAP header until its response was accepted by the socket. GET
+/api/modbus/metrics/snapshot returns them as a compact binary snapshot. This
+script prints a snapshot, or the difference of two snapshots as rates.
+
+Usage:
+    # Print the metrics of a device
+    python modbus_metrics.py --device 172.16.82.100
+
+    # Throughput and service times over a 10 second window
+    python modbus_metrics.py --device 172.16.82.100 --interval 10
+
+    # Print previously saved snapshots
+    curl -o metrics.bin http://172.16.82.100/api/modbus/metrics/snapshot
+    python modbus_metrics.py metrics.bin
+"""
+
+import argparse
+import struct
+import sys
+import time
+import urllib.request
+from typing import List, Optional
+
+MAGIC = b"MBM1"
+HEADER = struct.Struct("<4sBBBB")
+TOTALS = struct.Struct("<QQ8I")
+FUNCTION = struct.Struct("<B3x5IQ")
+
+FUNCTION_NAMES = {
+    0x01: "Read Coils",
+    0x02: "Read Discrete Inputs",
+    0x03: "Read Holding Registers",
+    0x04: "Read Input Registers",
+    0x05: "Write Single Coil",
+    0x06: "Write Single Register",
+    0x0F: "Write Multiple Coils",
+    0x10: "Write Multiple Registers",
+    0x17: "Read/Write Multiple Registers",
+    0x00: "Unsupported",
+}
+
+COUNTERS = ("bytes_in", "bytes_out", "protocol_errors", "connections_accepted",
+            "connections_evicted", "connections_rejected", "connections_timed_out",
+            "connections_closed", "connections_current", "connections_peak")
+
+
+class SnapshotError(Exception):
+    pass
+
+
+def parse_snapshot(data: bytes) -> dict:
+    if len(data) < HEADER.size:
+        raise SnapshotError("snapshot shorter than its header")
+    magic, version, function_count, bucket_count, _ = HEADER.unpack_from(data)
+    if magic != MAGIC or version != 2:
+        raise SnapshotError("not a ModbusTCP metrics snapshot (magic %r, version %d)" % (magic, version))
+    limits_format = "<%dI" % (bucket_count - 1)
+    buckets_format = "<%dI" % bucket_count
+    size = (HEADER.size + struct.calcsize(limits_format) + TOTALS.size +
+            function_count * (FUNCTION.size + struct.calcsize(buckets_format)))
+    if len(data) < size:
+        raise SnapshotError("snapshot truncated (%d of %d bytes)" % (len(data), size))
+
+    position = HEADER.size
+    snapshot = {"limits": list(struct.unpack_from(limits_format, data, position))}
+    position += struct.calcsize(limits_format)
+    snapshot.update(zip(COUNTERS, TOTALS.unpack_from(data, position)))
+    position += TOTALS.size
+
+    functions = []
+    for _ in range(function_count):
+        code, requests, exceptions, responses, min_us, max_us, total_us = FUNCTION.unpack_from(data, position)
+        position += FUNCTION.size
+        buckets = list(struct.unpack_from(buckets_format, data, position))
+        position += struct.calcsize(buckets_format)
+        functions.append({"code": code, "requests": requests, "exceptions": exceptions,
+                          "responses": responses, "min_us": min_us, "max_us": max_us,
+                          "total_us": total_us, "buckets": buckets})
+    snapshot["functions"] = functions
+    return snapshot
+
+
+def difference(first: dict, second: dict) -> dict:
+    """Metrics accumulated between two snapshots, min and max stay cumulative"""
+    result = dict(second)
+    for name in COUNTERS[:8]:
+        result[name] = (second[name] - first[name]) & (0xFFFFFFFFFFFFFFFF if name.startswith("bytes") else 0xFFFFFFFF)
+    functions = []
+    for old, new in zip(first["functions"], second["functions"]):
+        function = dict(new)
+        for name in ("requests", "exceptions", "responses", "total_us"):
+            function[name] = new[name] - old[name]
+        function["buckets"] = [b - a for a, b in zip(old["buckets"], new["buckets"])]
+        functions.append(function)
+    result["functions"] = functions
+    return result
+
+
+def percentile(buckets: List[int], limits: List[int], fraction: float) -> Optional[str]:
+    """Upper bound of the bucket holding the given fraction of the samples"""
+    total = sum(buckets)
+    if total == 0:
+        return None
+    threshold = fraction * total
+    count = 0
+    for index, samples in enumerate(buckets):
+        count += samples
+        if count >= threshold:
+            return "<=%d" % limits[index] if index < len(limits) else ">%d" % limits[-1]
+    return None
+
+
+def format_snapshot(snapshot: dict, seconds: Optional[float] = None) -> List[str]:
+    lines = []
+    if seconds:
+        lines.append("Window: %.1f s" % seconds)
+        lines.append("Bytes in: %d (%.0f B/s), bytes out: %d (%.0f B/s)" % (
+            snapshot["bytes_in"], snapshot["bytes_in"] / seconds,
+            snapshot["bytes_out"], snapshot["bytes_out"] / seconds))
+    else:
+        lines.append("Bytes in: %d, bytes out: %d" % (snapshot["bytes_in"], snapshot["bytes_out"]))
+    lines.append("Connections: %d current, %d peak, %d accepted, %d closed, %d evicted, %d rejected, %d timed out" % (
+        snapshot["connections_current"], snapshot["connections_peak"], snapshot["connections_accepted"],
+        snapshot["connections_closed"], snapshot["connections_evicted"], snapshot["connections_rejected"],
+        snapshot["connections_timed_out"]))
+    lines.append("Protocol errors: %d" % snapshot["protocol_errors"])
+    lines.append("")
+
+    lines.append("%-4s %-30s %10s %10s %10s %9s %9s %9s %9s %9s" % (
+        "FC", "Function", "Requests", "Exceptions", "Rate/s" if seconds else "Responses",
+        "Min us", "Mean us", "P50 us", "P99 us", "Max us"))
+    for function in snapshot["functions"]:
+        if function["requests"] == 0 and function["responses"] == 0:
+            continue
+        responses = function["responses"]
+        mean = "%d" % (function["total_us"] // responses) if responses else "-"
+        lines.append("%02X   %-30s %10d %10d %10s %9s %9s %9s %9s %9s" % (
+            function["code"], FUNCTION_NAMES.get(function["code"], "?"),
+            function["requests"], function["exceptions"],
+            "%.1f" % (function["requests"] / seconds) if seconds else "%d" % responses,
+            "%d" % function["min_us"] if responses else "-", mean,
+            percentile(function["buckets"], snapshot["limits"], 0.5) or "-",
+            percentile(function["buckets"], snapshot["limits"], 0.99) or "-",
+            "%d" % function["max_us"] if responses else "-"))
+    return lines
+
+
+def fetch(device: str) -> bytes:
+    with urllib.request.urlopen("http://%s/api/modbus/metrics/snapshot" % device, timeout=5) as response:
+        return response.read()
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Decode ModbusTCP server metrics snapshots")
+    parser.add_argument("snapshots", nargs="*", help="files written by GET /api/modbus/metrics/snapshot")
+    parser.add_argument("--device", help="IP address of the device to fetch the snapshot from")
+    parser.add_argument("--interval", type=float,
+                        help="fetch twice this many seconds apart and print the difference")
+    args = parser.parse_args()
+
+    if not args.snapshots and not args.device:
+        parser.error("give snapshot files or --device")
+
+    try:
+        for filename in args.snapshots:
+            with open(filename, "rb") as snapshot:
+                print("\n".join(format_snapshot(parse_snapshot(snapshot.read()))))
+        if args.device:
+            first = parse_snapshot(fetch(args.device))
+            if not args.interval:
+                print("\n".join(format_snapshot(first)))
+                return 0
+            start = time.monotonic()
+            time.sleep(args.interval)
+            second = parse_snapshot(fetch(args.device))
+            seconds = time.monotonic() - start
+            print("\n".join(format_snapshot(difference(first, second), seconds)))
+    except SnapshotError as error:
+        print("Error: %s" % error, file=sys.stderr)
+        return 1
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
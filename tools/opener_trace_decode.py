@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""
+Decode OpENer Binary Trace Dumps
+
+With OPENER_TRACE_BINARY the OPENER_TRACE_* macros store a format ID, a
+timestamp and the raw arguments in a per-task ring buffer instead of printing.
+GET /api/trace/dump drains the rings into a self contained binary dump (the
+format strings are part of the dump). This script decodes one or more dumps
+to the text the traces would have printed.
+
+Usage:
+    # Fetch and decode the pending traces from a device
+    python opener_trace_decode.py --device 172.16.82.100
+
+    # Keep polling the device, e.g. while reproducing a problem
+    python opener_trace_decode.py --device 172.16.82.100 --follow
+
+    # Decode previously saved dumps
+    curl -o trace.bin http://172.16.82.100/api/trace/dump
+    python opener_trace_decode.py trace.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+import time
+import urllib.request
+from typing import Dict, Iterator, List, Tuple
+
+MAGIC = b"OTB1"
+HEADER = struct.Struct("<4sBBBBI")
+
+ENTRY_FORMAT = 1
+ENTRY_RECORD = 2
+
+ARG_SIGNED = 1
+ARG_UNSIGNED = 2
+ARG_DOUBLE = 3
+ARG_POINTER = 4
+ARG_STRING = 5
+
+LEVELS = {0x01: "E", 0x02: "W", 0x04: "S", 0x08: "I"}
+
+CONVERSION = re.compile(
+    r"%(?P<flags>[-+ #0]*)(?P<width>\*|\d+)?(?:\.(?P<precision>\*|\d*))?"
+    r"(?P<length>hh|h|ll|l|j|z|t|L)?(?P<conversion>[diouxXcspfFeEgGaA%])")
+
+
+class DumpError(Exception):
+    pass
+
+
+def parse_dump(data: bytes, formats: Dict[int, str]) -> Tuple[dict, List[tuple]]:
+    """Parse a dump, format strings are collected in formats across dumps"""
+    if len(data) < HEADER.size:
+        raise DumpError("dump shorter than its header")
+    magic, version, long_size, pointer_size, _, dropped = HEADER.unpack_from(data)
+    if magic != MAGIC or version != 1:
+        raise DumpError("not an OpENer trace dump (magic %r, version %d)" % (magic, version))
+    header = {"long_size": long_size, "pointer_size": pointer_size, "dropped": dropped}
+
+    records = []
+    position = HEADER.size
+    while position < len(data):
+        entry = data[position]
+        position += 1
+        if entry == ENTRY_FORMAT:
+            format_id, length = struct.unpack_from("<QH", data, position)
+            position += 10
+            formats[format_id] = data[position:position + length].decode("latin-1")
+            position += length
+        elif entry == ENTRY_RECORD:
+            format_id, timestamp, level, ring, count = struct.unpack_from("<QQBBB", data, position)
+            position += 19
+            arguments = []
+            for _ in range(count):
+                kind = data[position]
+                position += 1
+                if kind == ARG_STRING:
+                    length = data[position]
+                    arguments.append((kind, data[position + 1:position + 1 + length].decode("latin-1")))
+                    position += 1 + length
+                else:
+                    value, = struct.unpack_from("<Q", data, position)
+                    arguments.append((kind, value))
+                    position += 8
+            records.append((timestamp, level, ring, format_id, arguments))
+        else:
+            raise DumpError("unknown entry type %d at offset %d" % (entry, position - 1))
+    return header, records
+
+
+def integer_bits(length: str, header: dict) -> int:
+    if length == "hh":
+        return 8
+    if length == "h":
+        return 16
+    if length in ("ll", "j"):
+        return 64
+    if length == "l":
+        return header["long_size"] * 8
+    if length in ("z", "t"):
+        return header["pointer_size"] * 8
+    return 32
+
+
+def format_record(format_string: str, arguments: List[tuple], header: dict) -> str:
+    """Apply the C format string to the recorded arguments"""
+    remaining: Iterator[tuple] = iter(arguments)
+
+    def next_value():
+        return next(remaining, (ARG_UNSIGNED, 0))
+
+    def replace(match: re.Match) -> str:
+        conversion = match.group("conversion")
+        if conversion == "%":
+            return "%"
+        width = match.group("width") or ""
+        precision = match.group("precision")
+        if width == "*":
+            width = str(to_signed(next_value()[1], 32))
+        if precision == "*":
+            precision = str(to_signed(next_value()[1], 32))
+        spec = "%" + match.group("flags") + width + ("." + precision if precision is not None else "")
+        kind, value = next_value()
+        bits = integer_bits(match.group("length") or "", header)
+
+        if conversion in "di":
+            return (spec + "d") % to_signed(value, bits)
+        if conversion in "ouxX":
+            return (spec + ("d" if conversion == "u" else conversion)) % (value & ((1 << bits) - 1))
+        if conversion == "c":
+            return (spec + "c") % chr(value & 0xFF)
+        if conversion == "s":
+            if kind == ARG_STRING:
+                return (spec + "s") % value
+            return "(null)" if value == 0 else "<0x%x>" % value
+        if conversion == "p":
+            return (spec + "s") % ("0x%x" % value if value else "(nil)")
+        if kind == ARG_DOUBLE:
+            number = struct.unpack("<d", struct.pack("<Q", value))[0]
+        elif kind == ARG_SIGNED:
+            number = float(to_signed(value, 64))
+        else:
+            number = float(value)
+        if conversion in "aA":
+            return number.hex()
+        return (spec + conversion) % number
+
+    return CONVERSION.sub(replace, format_string)
+
+
+def to_signed(value: int, bits: int) -> int:
+    value &= (1 << bits) - 1
+    return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def decode(data: bytes, formats: Dict[int, str], show_level: bool) -> List[str]:
+    header, records = parse_dump(data, formats)
+    lines = []
+    if header["dropped"]:
+        lines.append("# %d trace records dropped on the device so far\n" % header["dropped"])
+    for timestamp, level, ring, format_id, arguments in sorted(records, key=lambda r: r[0]):
+        format_string = formats.get(format_id)
+        if format_string is None:
+            text = "<unknown format 0x%x> %r\n" % (format_id, [a[1] for a in arguments])
+        else:
+            text = format_record(format_string, arguments, header)
+        prefix = "[%d.%06d]" % (timestamp // 1000000, timestamp % 1000000)
+        if show_level:
+            prefix += " %s%d" % (LEVELS.get(level, "?"), ring)
+        lines.append("%s %s" % (prefix, text if text.endswith("\n") else text + "\n"))
+    return lines
+
+
+def fetch(device: str) -> bytes:
+    with urllib.request.urlopen("http://%s/api/trace/dump" % device, timeout=5) as response:
+        return response.read()
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Decode OpENer binary trace dumps")
+    parser.add_argument("dumps", nargs="*", help="dump files written by GET /api/trace/dump")
+    parser.add_argument("--device", help="IP address of the device to fetch the dump from")
+    parser.add_argument("--follow", action="store_true", help="keep fetching from the device")
+    parser.add_argument("--interval", type=float, default=0.5, help="poll interval in seconds for --follow")
+    parser.add_argument("--level", action="store_true", help="prefix each line with trace level and ring")
+    args = parser.parse_args()
+
+    if not args.dumps and not args.device:
+        parser.error("give dump files or --device")
+
+    formats: Dict[int, str] = {}
+    try:
+        for filename in args.dumps:
+            with open(filename, "rb") as dump:
+                sys.stdout.writelines(decode(dump.read(), formats, args.level))
+        if args.device:
+            while True:
+                # drain until the device returns an empty dump
+                data = fetch(args.device)
+                sys.stdout.writelines(decode(data, formats, args.level))
+                sys.stdout.flush()
+                if not args.follow:
+                    if len(data) > HEADER.size:
+                        continue
+                    break
+                if len(data) <= HEADER.size:
+                    time.sleep(args.interval)
+    except DumpError as error:
+        print("Error: %s" % error, file=sys.stderr)
+        return 1
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())